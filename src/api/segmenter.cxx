@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+#include "api/segmenter.h"
+
+#include "itkConnectedComponentImageFilter.h"
+#include "itkRelabelComponentImageFilter.h"
+
+#include "stage/transformStage.h"
+#include "stage/maskStage.h"
+#include "util/profiler.h"
+
+namespace cascade
+{
+
+namespace
+{
+
+typedef stage::ImageType ImageType;
+
+/** Subject images are read through their own view, see util::ShareImage */
+ImageType::Pointer View(const ImageType* image)
+  {
+  if (!image)
+    {
+    itkGenericExceptionMacro("Subject image is not set.");
+    }
+  return util::ShareImage(image);
+  }
+
+/*
+ * Score the first sequence is combined with. As the zero image the scripts
+ * start from, it clamps the negative z-scores of the first sequence to 0.
+ */
+ImageType::Pointer ZeroImage(const ImageType* reference)
+  {
+  ImageType::Pointer image = ImageType::New();
+  image->CopyInformation(reference);
+  image->SetRegions(reference->GetLargestPossibleRegion());
+  image->Allocate();
+  image->FillBuffer(0);
+  return image;
+  }
+
+}  // namespace
+
+void SegmenterModel::Load(std::string const &filename)
+  {
+  util::StateModelInfo info;
+  StateImageType::Pointer model = util::ReadStateModel< StateImageType >(
+      filename, info);
+  this->SetModel(model, info);
+  }
+
+void SegmenterModel::SetModel(const StateImageType* model,
+                              util::StateModelInfo const &info)
+  {
+  m_StateImage = model;
+  m_Info = info;
+  }
+
+void SegmenterModel::SetTargetHistogram(std::string const &sequence,
+                                        util::HistogramTable const &histogram)
+  {
+  m_TargetHistograms[sequence] = histogram;
+  }
+
+void SegmenterModel::LoadTargetHistogram(std::string const &sequence,
+                                         std::string const &filename)
+  {
+  util::HistogramTable histogram;
+  if (!util::ReadHistogram(filename, histogram))
+    {
+    itkGenericExceptionMacro("Can not read histogram " << filename);
+    }
+  this->SetTargetHistogram(sequence, histogram);
+  }
+
+const util::HistogramTable* SegmenterModel::GetTargetHistogram(
+    std::string const &sequence) const
+  {
+  std::map< std::string, util::HistogramTable >::const_iterator histogram =
+      m_TargetHistograms.find(sequence);
+  return histogram == m_TargetHistograms.end() ? 0 : &histogram->second;
+  }
+
+void SegmenterSubject::AddSequence(std::string const &name,
+                                   std::string const &type,
+                                   const ImageType* image)
+  {
+  Sequence sequence;
+  sequence.Name = name;
+  sequence.Type = type;
+  sequence.Image = image;
+  m_Sequences.push_back(sequence);
+  }
+
+SegmenterSubject::ImageType::Pointer SegmenterSubject::ImportImage(
+    const PixelType* buffer, ImageType::SizeType const &size,
+    ImageType::SpacingType const &spacing, ImageType::PointType const &origin,
+    ImageType::DirectionType const &direction)
+  {
+  ImageType::RegionType region;
+  region.SetSize(size);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->SetSpacing(spacing);
+  image->SetOrigin(origin);
+  image->SetDirection(direction);
+  image->GetPixelContainer()->SetImportPointer(
+      const_cast< PixelType* >(buffer), region.GetNumberOfPixels(), false);
+  return image;
+  }
+
+SegmenterResult Segmenter::Segment(SegmenterSubject const &subject) const
+  {
+  typedef itk::ConnectedComponentImageFilter< ImageType, LabelImageType > ConnectedComponentFilterType;
+  typedef itk::RelabelComponentImageFilter< LabelImageType, LabelImageType > RelabelFilterType;
+
+  if (!m_Model.GetStateImage())
+    {
+    itkGenericExceptionMacro("Model is not loaded.");
+    }
+  std::vector< SegmenterSubject::Sequence > const & sequences =
+      subject.GetSequences();
+  if (sequences.empty())
+    {
+    itkGenericExceptionMacro("Subject has no sequence.");
+    }
+
+  const ImageType::Pointer pve = View(subject.GetPVE());
+  const ImageType::Pointer mask = View(subject.GetMask());
+  const stage::RangeStage::MaskImageType::Pointer rangeMask =
+      stage::CastImage< stage::RangeStage::MaskImageType >(mask.GetPointer());
+  const stage::HistogramStage::MaskImageType::Pointer histogramMask =
+      stage::CastImage< stage::HistogramStage::MaskImageType >(
+          mask.GetPointer());
+
+  SegmenterResult result;
+  for (size_t s = 0; s < sequences.size(); s++)
+    {
+    const ImageType::Pointer image = View(sequences[s].Image);
+    const itk::SizeValueType voxels =
+        image->GetLargestPossibleRegion().GetNumberOfPixels();
+
+    util::ProfileScope rangeProfile("Segmenter", "range", voxels);
+    ImageType::Pointer range = stage::RangeStage::Process(
+        stage::CastImage< stage::RangeStage::InputImageType >(
+            image.GetPointer()), rangeMask, m_Settings.Range);
+    rangeProfile.Stop();
+
+    const util::HistogramTable* target = m_Model.GetTargetHistogram(
+        sequences[s].Name);
+    if (target)
+      {
+      util::ProfileScope transformProfile("Segmenter", "transform", voxels);
+      const util::HistogramTable source = stage::HistogramStage::Process(
+          image, histogramMask, m_Settings.Histogram);
+      range = stage::TransformStage::Process(
+          stage::CastImage< stage::TransformStage::InputImageType >(
+              range.GetPointer()), *target, &source, 0,
+          m_Settings.Histogram.Bins);
+      }
+
+    util::ProfileScope scoreProfile("Segmenter", "score", voxels);
+    if (!result.Score) result.Score = ZeroImage(range);
+    stage::ScoreSettings settings = m_Settings.Score;
+    settings.Sequence = sequences[s].Name;
+    settings.Type = sequences[s].Type;
+    stage::ScoreStage::ScoreFilterType::Pointer scoreFilter =
+        stage::ScoreStage::Process(range, pve, mask, result.Score,
+                                   m_Model.GetStateImage(), m_Model.GetInfo(),
+                                   subject.GetTransform(), settings);
+    result.Score = scoreFilter->GetScoreOutput();
+    result.Score->DisconnectPipeline();
+    }
+
+  util::ProfileScope lesionProfile("Segmenter", "lesions");
+  ImageType::Pointer score = result.Score;
+  if (subject.GetHypothesis())
+    {
+    score = stage::MaskStage::Process(score,
+                                      View(subject.GetHypothesis()));
+    }
+  result.Likelihood = stage::StatisticsStage::Process(score,
+                                                      m_Settings.Likelihood);
+
+  ConnectedComponentFilterType::Pointer componentFilter =
+      ConnectedComponentFilterType::New();
+  componentFilter->SetInput(result.Likelihood);
+  componentFilter->FullyConnectedOn();
+
+  RelabelFilterType::Pointer relabelFilter = RelabelFilterType::New();
+  relabelFilter->SetInput(componentFilter->GetOutput());
+  relabelFilter->SetMinimumObjectSize(m_Settings.MinimumLesionSize);
+  relabelFilter->Update();
+
+  result.Lesions = relabelFilter->GetOutput();
+  result.Lesions->DisconnectPipeline();
+  result.NumberOfLesions = relabelFilter->GetNumberOfObjects();
+  return result;
+  }
+
+}  // namespace cascade
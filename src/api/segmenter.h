@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef SEGMENTER_H_
+#define SEGMENTER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "itkImage.h"
+#include "itkTransform.h"
+
+#include "stage/stage.h"
+#include "stage/rangeStage.h"
+#include "stage/histogramStage.h"
+#include "stage/scoreStage.h"
+#include "stage/statisticsStage.h"
+#include "util/histogram.h"
+#include "util/stateModel.h"
+
+namespace cascade
+{
+
+/*
+ * Normal brain model and the target histograms of its sequences, loaded once
+ * and shared by Segmenters. The packed model is memory mapped and never
+ * written, so one instance serves any number of concurrent segmentations.
+ */
+class SegmenterModel
+{
+public:
+  typedef stage::ScoreStage::StateImageType StateImageType;
+
+  /** Packed model (.cms) of cascade-train */
+  void Load(std::string const &filename);
+  void SetModel(const StateImageType* model, util::StateModelInfo const &info);
+
+  /*
+   * Histogram of the normal brain the range image of a sequence is matched
+   * to before scoring, as cascade-transform target=. Sequences without one
+   * are scored on the range image as it is.
+   */
+  void SetTargetHistogram(std::string const &sequence,
+                          util::HistogramTable const &histogram);
+  void LoadTargetHistogram(std::string const &sequence,
+                           std::string const &filename);
+
+  const StateImageType* GetStateImage() const
+    {
+    return m_StateImage;
+    }
+  util::StateModelInfo const & GetInfo() const
+    {
+    return m_Info;
+    }
+  /** Null if the sequence has no target histogram */
+  const util::HistogramTable* GetTargetHistogram(
+      std::string const &sequence) const;
+
+private:
+  StateImageType::ConstPointer m_StateImage;
+  util::StateModelInfo m_Info;
+  std::map< std::string, util::HistogramTable > m_TargetHistograms;
+};
+
+/*
+ * Images of a single subject, all on the same grid. The images are only
+ * read and may be shared between subjects.
+ */
+class SegmenterSubject
+{
+public:
+  typedef stage::PixelType PixelType;
+  typedef stage::ImageType ImageType;
+  typedef stage::ScoreStage::TransformType TransformType;
+
+  struct Sequence
+    {
+    /** Name of the sequence in the model e.g. flair */
+    std::string Name;
+    /** light, dark or other as cascade-score --type */
+    std::string Type;
+    ImageType::ConstPointer Image;
+    };
+
+  /** Brain extracted image of a sequence, scored in the order added */
+  void AddSequence(std::string const &name, std::string const &type,
+                   const ImageType* image);
+  /** Tissue labels and white plus gray matter mask of cascade-tissue */
+  void SetPVE(const ImageType* pve)
+    {
+    m_PVE = pve;
+    }
+  void SetMask(const ImageType* mask)
+    {
+    m_Mask = mask;
+    }
+  /** Optional lesion hypothesis of cascade-hyp the likelihood is kept in */
+  void SetHypothesis(const ImageType* hypothesis)
+    {
+    m_Hypothesis = hypothesis;
+    }
+  /** Optional transform from subject to model points */
+  void SetTransform(const TransformType* transform)
+    {
+    m_Transform = transform;
+    }
+
+  std::vector< Sequence > const & GetSequences() const
+    {
+    return m_Sequences;
+    }
+  const ImageType* GetPVE() const
+    {
+    return m_PVE;
+    }
+  const ImageType* GetMask() const
+    {
+    return m_Mask;
+    }
+  const ImageType* GetHypothesis() const
+    {
+    return m_Hypothesis;
+    }
+  const TransformType* GetTransform() const
+    {
+    return m_Transform;
+    }
+
+  /*
+   * Image over a raw buffer in x fastest order. The buffer is not copied and
+   * should outlive the image.
+   */
+  static ImageType::Pointer ImportImage(
+      const PixelType* buffer, ImageType::SizeType const &size,
+      ImageType::SpacingType const &spacing,
+      ImageType::PointType const &origin,
+      ImageType::DirectionType const &direction);
+
+private:
+  std::vector< Sequence > m_Sequences;
+  ImageType::ConstPointer m_PVE;
+  ImageType::ConstPointer m_Mask;
+  ImageType::ConstPointer m_Hypothesis;
+  TransformType::ConstPointer m_Transform;
+};
+
+/** Defaults are the ones of the cascade-pre2 and cascade-std-normal scripts */
+struct SegmenterSettings
+  {
+  stage::RangeSettings Range;
+  /** Histogram of the brain extracted image matched to the target */
+  stage::HistogramSettings Histogram;
+  /** Type and Sequence are taken from the subject */
+  stage::ScoreSettings Score;
+  stage::StatisticsSettings Likelihood;
+  /** Smallest lesion in voxels */
+  unsigned int MinimumLesionSize;
+
+  SegmenterSettings() :
+      MinimumLesionSize(10)
+    {
+    Range.Scale = false;
+    Likelihood.Property = "Maximum";
+    Likelihood.Threshold = 4;
+    Likelihood.BinarizeThreshold = 1.5;
+    }
+  };
+
+struct SegmenterResult
+  {
+  typedef stage::ImageType ImageType;
+  typedef itk::Image< unsigned int, DIM > LabelImageType;
+
+  /** Maximum of zero and the z-scores of all the sequences */
+  ImageType::Pointer Score;
+  ImageType::Pointer Likelihood;
+  /** Lesions labeled from 1 by decreasing size */
+  LabelImageType::Pointer Lesions;
+  unsigned long NumberOfLesions;
+
+  SegmenterResult() :
+      NumberOfLesions(0)
+    {
+    }
+  };
+
+/*
+ * In process segmentation of a subject: range normalization, histogram
+ * matching and scoring of every sequence, then the likelihood filter and
+ * the lesion labels, as the scripts do with cascade-run but without any
+ * file. Segment only reads the Segmenter, the model and the subject, so
+ * several subjects can be segmented at once from different threads.
+ */
+class Segmenter
+{
+public:
+  typedef SegmenterResult::ImageType ImageType;
+  typedef SegmenterResult::LabelImageType LabelImageType;
+
+  Segmenter(SegmenterModel const &model,
+            SegmenterSettings const &settings = SegmenterSettings()) :
+      m_Model(model), m_Settings(settings)
+    {
+    }
+
+  SegmenterResult Segment(SegmenterSubject const &subject) const;
+
+private:
+  SegmenterModel m_Model;
+  SegmenterSettings m_Settings;
+};
+
+}  // namespace cascade
+
+#endif /* SEGMENTER_H_ */
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+/*
+ * General ITK
+ */
+#include "itkMultiThreader.h"
+/*
+ * Others
+ */
+#include "util/batch.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+/*
+ * A subject job: the command is run by /bin/sh, its output goes to
+ * <directory>/<name>.<extension>.
+ */
+struct Job
+  {
+  std::string Directory;
+  std::string Command;
+  };
+
+struct RunningJob
+  {
+  size_t Index;
+  unsigned int Threads;
+  int Node;
+  std::time_t Start;
+  };
+
+struct SchedulerSettings
+  {
+  std::string Name;
+  std::string OutputExtension;
+  std::string ErrorExtension;
+  unsigned int Jobs;
+  unsigned int Threads;
+  size_t NumberOfNodes;
+  };
+
+std::string JobFile(const Job & job, const std::string & name,
+                    const std::string & extension)
+  {
+  return job.Directory + "/" + name + "." + extension;
+  }
+
+std::string SubjectName(const Job & job)
+  {
+  const std::string::size_type slash = job.Directory.find_last_of('/');
+  return slash == std::string::npos ? job.Directory :
+                                      job.Directory.substr(slash + 1);
+  }
+
+/*
+ * Start a job with its share of the threads. ITK and OpenMP in every process
+ * the job spawns read their number of threads from the environment. A job
+ * with a node is pinned to the CPUs of that NUMA node.
+ */
+pid_t LaunchJob(const Job & job, unsigned int threads, int node,
+                const SchedulerSettings & settings)
+  {
+  const std::string marker = JobFile(job, settings.Name, "failed");
+  std::remove(marker.c_str());
+
+  std::ostringstream threadString;
+  threadString << threads;
+  const std::string outFile = JobFile(job, settings.Name,
+                                      settings.OutputExtension);
+  const std::string errFile = JobFile(job, settings.Name,
+                                      settings.ErrorExtension);
+
+  const pid_t pid = fork();
+  if (pid != 0) return pid;
+
+  const int out = open(outFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  const int err = open(errFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out < 0 || err < 0) _exit(126);
+  dup2(out, STDOUT_FILENO);
+  dup2(err, STDERR_FILENO);
+  close(out);
+  close(err);
+  /** The job is kept on its node, its own workers are not spread again */
+  if (node >= 0 && cascade::util::PinToNumaNode(node))
+    unsetenv("CASCADE_PIN_NUMA");
+  setenv("CASCADE_NUM_THREADS", threadString.str().c_str(), 1);
+  setenv("ITK_GLOBAL_DEFAULT_NUMBER_OF_THREADS", threadString.str().c_str(), 1);
+  setenv("OMP_NUM_THREADS", threadString.str().c_str(), 1);
+  execl("/bin/sh", "sh", "-c", job.Command.c_str(), static_cast< char* >(0));
+  _exit(127);
+  }
+
+/** NUMA node with the fewest threads in use, -1 when jobs are not pinned */
+int LeastLoadedNode(const std::map< pid_t, RunningJob > & running,
+                    const SchedulerSettings & settings)
+  {
+  if (settings.NumberOfNodes < 2) return -1;
+  std::vector< unsigned int > load(settings.NumberOfNodes, 0);
+  for (std::map< pid_t, RunningJob >::const_iterator it = running.begin();
+      it != running.end(); ++it)
+    {
+    if (it->second.Node >= 0) load[it->second.Node] += it->second.Threads;
+    }
+  return static_cast< int >(std::min_element(load.begin(), load.end())
+      - load.begin());
+  }
+
+/*
+ * Keep settings.Jobs jobs running until the manifest is exhausted. A slot is
+ * refilled as soon as any job finishes, so a slow subject only holds its own
+ * slot. Free threads are split between the jobs that can still start, which
+ * gives the last jobs of a batch more threads. Returns the number of failed
+ * jobs.
+ */
+size_t RunJobs(const std::vector< Job > & jobs,
+               const SchedulerSettings & settings)
+  {
+  std::map< pid_t, RunningJob > running;
+  unsigned int freeThreads = settings.Threads;
+  size_t next = 0;
+  size_t failed = 0;
+
+  while (next < jobs.size() || !running.empty())
+    {
+    while (next < jobs.size() && running.size() < settings.Jobs)
+      {
+      const size_t startable = std::min< size_t >(settings.Jobs
+                                                      - running.size(),
+                                                  jobs.size() - next);
+      const unsigned int threads = std::max< unsigned int >(
+          freeThreads / startable, 1);
+      const int node = LeastLoadedNode(running, settings);
+      const pid_t pid = LaunchJob(jobs[next], threads, node, settings);
+      if (pid < 0)
+        {
+        if (running.empty())
+          {
+          itkGenericExceptionMacro("Can not start " << SubjectName(jobs[next]));
+          }
+        break;
+        }
+      RunningJob job;
+      job.Index = next++;
+      job.Threads = threads;
+      job.Node = node;
+      job.Start = std::time(0);
+      running[pid] = job;
+      freeThreads -= std::min(threads, freeThreads);
+      std::cout << "Launching " << SubjectName(jobs[job.Index]) << " with "
+                << threads << " threads" << std::endl;
+      }
+
+    int status = 0;
+    const pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0)
+      {
+      if (errno == EINTR) continue;
+      itkGenericExceptionMacro("Lost track of the running jobs.");
+      }
+    std::map< pid_t, RunningJob >::iterator finished = running.find(pid);
+    if (finished == running.end()) continue;
+
+    const RunningJob job = finished->second;
+    running.erase(finished);
+    freeThreads += job.Threads;
+
+    const Job & done = jobs[job.Index];
+    const std::string marker = JobFile(done, settings.Name, "failed");
+    const long seconds = static_cast< long >(std::time(0) - job.Start);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+      {
+      std::remove(marker.c_str());
+      std::cout << "Done " << SubjectName(done) << " in " << seconds << "s"
+                << std::endl;
+      }
+    else
+      {
+      ++failed;
+      std::FILE* file = std::fopen(marker.c_str(), "w");
+      if (file) std::fclose(file);
+      std::cout << "Failed " << SubjectName(done) << " after " << seconds
+                << "s, see " << JobFile(done, settings.Name,
+                                         settings.ErrorExtension)
+                << std::endl;
+      }
+    }
+  return failed;
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Subject batch scheduler " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > errorExtension(
+      "", "stderr-extension", "Extension of the standard error log", false,
+      "stderr", "string", cmd);
+
+  TCLAP::ValueArg< std::string > name(
+      "n", "name",
+      "Job name, <directory>/<name>.failed marks the failed subjects", false,
+      "job", "string", cmd);
+
+  TCLAP::SwitchArg pinNuma(
+      "", "pin-numa",
+      "Spread the jobs over the NUMA nodes and keep each on its node "
+      "(default $CASCADE_PIN_NUMA)", cmd, false);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "t", "threads",
+      "Threads shared by all the jobs, $CASCADE_NUM_THREADS or all cores by "
+      "default", false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< unsigned int > jobs("j", "jobs",
+                                       "Number of subjects run at the same time",
+                                       false, 1, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > manifest(
+      "m", "manifest",
+      "Manifest with one \"subject-directory command ...\" per line", true,
+      "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    const cascade::util::ManifestType rows = cascade::util::ReadManifest(
+        manifest.getValue(), 2, std::numeric_limits< size_t >::max());
+    std::vector< Job > subjectJobs(rows.size());
+    for (size_t r = 0; r < rows.size(); r++)
+      {
+      subjectJobs[r].Directory = rows[r][0];
+      subjectJobs[r].Command = cascade::util::batch::JoinRow(
+          cascade::util::ManifestRow(rows[r].begin() + 1, rows[r].end()));
+      }
+
+    SchedulerSettings settings;
+    settings.Name = name.getValue();
+    settings.OutputExtension = "stdout";
+    settings.ErrorExtension = errorExtension.getValue();
+    settings.Jobs = std::max(jobs.getValue(), 1u);
+    settings.Threads = cascade::util::SetNumberOfThreads(threads.getValue());
+    settings.NumberOfNodes = 0;
+    if (pinNuma.getValue() || cascade::util::IsNumaPinningEnabled())
+      {
+      settings.NumberOfNodes = cascade::util::NumaNodes().size();
+      }
+
+    if (RunJobs(subjectJobs, settings))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
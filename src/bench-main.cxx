@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+#include "itkVectorImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkMultiThreader.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+/*
+ * ITK Filters
+ */
+#include "util/itkIntensityTableLookupFunctor.h"
+#include "util/itkChiSquaredFunctor.h"
+#include "util/itkWeightedSinglePassMeanCovarianceUpdate.h"
+#include "util/itkStateInterpolatorFunction.h"
+#include "util/itkOrientationEnhanceFilter.h"
+/*
+ * Others
+ */
+#include "util/benchmark.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+typedef float PixelType;
+typedef itk::Image< PixelType, DIM > ImageType;
+typedef itk::VectorImage< PixelType, DIM > StateImageType;
+typedef StateImageType::PixelType StateType;
+typedef itk::WeightedSinglePassMeanCovarianceUpdate< StateType > StateFunc;
+typedef StateFunc::MeasurementType MeasurementType;
+typedef itk::StateInterpolatorFunction< StateImageType, double > StateInterpolatorType;
+typedef itk::OrientationEnhanceFilter< ImageType > OrientationFilterType;
+typedef itk::IntensityTableLookupFunctor< PixelType, PixelType > LookupFunctorType;
+typedef itk::Functor::ChiSquaredFunctor< PixelType, PixelType > ChiFunctorType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomType;
+
+/** Values of the kernels are summed here so they are not optimized away */
+volatile double sink;
+
+/** Number of values, measurements or points a kernel goes through */
+const size_t NumberOfSamples = 4096;
+
+std::vector< PixelType > RandomValues(RandomType* random, double minimum,
+                                      double maximum)
+  {
+  std::vector< PixelType > values(NumberOfSamples);
+  for (size_t v = 0; v < values.size(); v++)
+    values[v] = random->GetUniformVariate(minimum, maximum);
+  return values;
+  }
+
+struct LookupCase
+  {
+  LookupFunctorType Functor;
+  std::vector< PixelType > Values;
+  };
+
+void LookupKernel(void* userData, itk::SizeValueType iterations)
+  {
+  const LookupCase & data = *static_cast< LookupCase* >(userData);
+  double sum = 0;
+  for (itk::SizeValueType i = 0; i < iterations; i++)
+    for (size_t v = 0; v < data.Values.size(); v++)
+      sum += data.Functor(data.Values[v]);
+  sink = sum;
+  }
+
+struct ChiSquaredCase
+  {
+  ChiFunctorType Functor;
+  std::vector< PixelType > Values;
+  };
+
+void ChiSquaredKernel(void* userData, itk::SizeValueType iterations)
+  {
+  const ChiSquaredCase & data = *static_cast< ChiSquaredCase* >(userData);
+  double sum = 0;
+  for (itk::SizeValueType i = 0; i < iterations; i++)
+    for (size_t v = 0; v < data.Values.size(); v++)
+      sum += data.Functor(data.Values[v]);
+  sink = sum;
+  }
+
+/*
+ * Measurements of dimension D, states that have seen a few of them each and
+ * a ready state of all of them.
+ */
+struct StateCase
+  {
+  unsigned int Dimension;
+  std::vector< MeasurementType > Measurements;
+  std::vector< StateType > States;
+  StateType Ready;
+  StateType Work;
+  };
+
+StateType ZeroState(unsigned int dimension)
+  {
+  StateType state(StateFunc::MeasurementToStateDim(dimension));
+  StateFunc::ResetState(state);
+  return state;
+  }
+
+void InitializeStateCase(StateCase & data, unsigned int dimension,
+                         RandomType* random)
+  {
+  const unsigned int samplesPerState = 8;
+  data.Dimension = dimension;
+  data.Measurements.resize(NumberOfSamples);
+  data.States.assign(NumberOfSamples / samplesPerState,
+                     ZeroState(dimension));
+  data.Ready = ZeroState(dimension);
+  for (size_t m = 0; m < data.Measurements.size(); m++)
+    {
+    MeasurementType & measurement = data.Measurements[m];
+    measurement.SetSize(dimension);
+    for (unsigned int d = 0; d < dimension; d++)
+      measurement[d] = random->GetNormalVariate(d, 1);
+    StateFunc::UpdateState(measurement, data.States[m / samplesPerState]);
+    StateFunc::UpdateState(measurement, data.Ready);
+    }
+  StateFunc::MakeReady(data.Ready);
+  data.Work = ZeroState(dimension);
+  }
+
+void UpdateStateKernel(void* userData, itk::SizeValueType iterations)
+  {
+  StateCase & data = *static_cast< StateCase* >(userData);
+  double sum = 0;
+  for (itk::SizeValueType i = 0; i < iterations; i++)
+    {
+    StateFunc::ResetState(data.Work);
+    for (size_t m = 0; m < data.Measurements.size(); m++)
+      StateFunc::UpdateState(data.Measurements[m], data.Work);
+    sum += data.Work[1];
+    }
+  sink = sum;
+  }
+
+void MergeKernel(void* userData, itk::SizeValueType iterations)
+  {
+  StateCase & data = *static_cast< StateCase* >(userData);
+  double sum = 0;
+  for (itk::SizeValueType i = 0; i < iterations; i++)
+    {
+    StateFunc::ResetState(data.Work);
+    for (size_t s = 0; s < data.States.size(); s++)
+      StateFunc::Merge(data.Work, data.States[s]);
+    sum += data.Work[1];
+    }
+  sink = sum;
+  }
+
+void DistanceKernel(void* userData, itk::SizeValueType iterations)
+  {
+  const StateCase & data = *static_cast< StateCase* >(userData);
+  double sum = 0;
+  for (itk::SizeValueType i = 0; i < iterations; i++)
+    for (size_t m = 0; m < data.Measurements.size(); m++)
+      sum += StateFunc::Distance(data.Ready, data.Measurements[m]);
+  sink = sum;
+  }
+
+/** Includes copying the state, MakeReady works in place */
+void MakeReadyKernel(void* userData, itk::SizeValueType iterations)
+  {
+  StateCase & data = *static_cast< StateCase* >(userData);
+  double sum = 0;
+  for (itk::SizeValueType i = 0; i < iterations; i++)
+    for (size_t s = 0; s < data.States.size(); s++)
+      {
+      data.Work = data.States[s];
+      StateFunc::MakeReady(data.Work);
+      sum += data.Work[1];
+      }
+  sink = sum;
+  }
+
+struct InterpolatorCase
+  {
+  StateImageType::Pointer Image;
+  StateInterpolatorType::Pointer Interpolator;
+  std::vector< StateInterpolatorType::ContinuousIndexType > Indices;
+  };
+
+void InitializeInterpolatorCase(InterpolatorCase & data,
+                                StateCase const &states, RandomType* random)
+  {
+  const unsigned int size = 32;
+  StateImageType::SizeType imageSize;
+  imageSize.Fill(size);
+  data.Image = StateImageType::New();
+  data.Image->SetRegions(imageSize);
+  data.Image->SetNumberOfComponentsPerPixel(
+      StateFunc::MeasurementToStateDim(states.Dimension));
+  data.Image->Allocate();
+  itk::ImageRegionIterator< StateImageType > it(
+      data.Image, data.Image->GetLargestPossibleRegion());
+  for (size_t s = 0; !it.IsAtEnd(); ++it, ++s)
+    it.Set(states.States[s % states.States.size()]);
+
+  data.Interpolator = StateInterpolatorType::New();
+  data.Interpolator->SetInputImage(data.Image);
+  data.Indices.resize(NumberOfSamples);
+  for (size_t i = 0; i < data.Indices.size(); i++)
+    for (unsigned int d = 0; d < DIM; d++)
+      data.Indices[i][d] = random->GetUniformVariate(0, size - 1);
+  }
+
+void InterpolatorKernel(void* userData, itk::SizeValueType iterations)
+  {
+  const InterpolatorCase & data = *static_cast< InterpolatorCase* >(userData);
+  double sum = 0;
+  for (itk::SizeValueType i = 0; i < iterations; i++)
+    for (size_t p = 0; p < data.Indices.size(); p++)
+      sum += data.Interpolator->EvaluateAtContinuousIndex(data.Indices[p])[0];
+  sink = sum;
+  }
+
+void OrientationKernel(void* userData, itk::SizeValueType iterations)
+  {
+  OrientationFilterType* filter = static_cast< OrientationFilterType* >(
+      userData);
+  for (itk::SizeValueType i = 0; i < iterations; i++)
+    {
+    filter->Modified();
+    filter->Update();
+    }
+  }
+
+std::string CaseName(std::string const &kernel, std::string const &parameter,
+                     unsigned int value)
+  {
+  std::ostringstream name;
+  name << kernel << "/" << parameter << ":" << value;
+  return name.str();
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Micro-benchmarks of the kernels " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > outfile(
+      "o", "out", "Write the results to a JSON file", false, "", "string",
+      cmd);
+
+  TCLAP::ValueArg< std::string > filter(
+      "f", "filter", "Only run the benchmarks whose name contains this",
+      false, "", "string", cmd);
+
+  TCLAP::ValueArg< double > minTime(
+      "", "min-time", "Minimum time of a benchmark in seconds", false, 0.5,
+      "Float", cmd);
+
+  TCLAP::ValueArg< unsigned int > maxThreads(
+      "t", "max-threads",
+      "Largest number of threads of the filter benchmarks, "
+      "$CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< unsigned int > size(
+      "s", "size", "Image size along each axis of the filter benchmarks",
+      false, 64, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    cascade::util::BenchmarkRunner runner(minTime.getValue(),
+                                          filter.getValue());
+    RandomType::Pointer random = RandomType::New();
+    random->Initialize(2013);
+
+    const unsigned int tableRows[] = { 2, 4, 16, 64, 256 };
+    for (unsigned int t = 0; t < sizeof(tableRows) / sizeof(*tableRows); t++)
+      {
+      LookupCase data;
+      for (unsigned int r = 0; r < tableRows[t]; r++)
+        data.Functor.AddLookupRow(1000. * r / (tableRows[t] - 1),
+                                  random->GetUniformVariate(0, 1));
+      data.Values = RandomValues(random, 0, 1000);
+      runner.Run(CaseName("IntensityTableLookupFunctor", "rows", tableRows[t]),
+                 LookupKernel, &data, data.Values.size());
+      }
+
+    for (unsigned int dof = 1; dof <= 4; dof++)
+      {
+      ChiSquaredCase data;
+      data.Functor.SetDOF(dof);
+      data.Values = RandomValues(random, -20, 20);
+      runner.Run(CaseName("ChiSquaredFunctor", "dof", dof), ChiSquaredKernel,
+                 &data, data.Values.size());
+      }
+
+    for (unsigned int dimension = 1; dimension <= 4; dimension++)
+      {
+      StateCase data;
+      InitializeStateCase(data, dimension, random);
+      const std::string kernel = "WeightedSinglePassMeanCovarianceUpdate::";
+      runner.Run(CaseName(kernel + "UpdateState", "D", dimension),
+                 UpdateStateKernel, &data, data.Measurements.size());
+      runner.Run(CaseName(kernel + "Merge", "D", dimension), MergeKernel,
+                 &data, data.States.size());
+      runner.Run(CaseName(kernel + "Distance", "D", dimension),
+                 DistanceKernel, &data, data.Measurements.size());
+      runner.Run(CaseName(kernel + "MakeReady", "D", dimension),
+                 MakeReadyKernel, &data, data.States.size());
+
+      InterpolatorCase interpolator;
+      InitializeInterpolatorCase(interpolator, data, random);
+      runner.Run(
+          CaseName("StateInterpolatorFunction::EvaluateAtContinuousIndex",
+                   "D", dimension),
+          InterpolatorKernel, &interpolator, interpolator.Indices.size());
+      }
+
+    const unsigned int threads = cascade::util::SetNumberOfThreads(
+        maxThreads.getValue());
+    std::vector< unsigned int > threadCounts;
+    for (unsigned int t = 1; t < threads; t *= 2)
+      threadCounts.push_back(t);
+    threadCounts.push_back(threads);
+
+    ImageType::SizeType imageSize;
+    imageSize.Fill(size.getValue());
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(imageSize);
+    image->Allocate();
+    itk::ImageRegionIterator< ImageType > it(image,
+                                             image->GetLargestPossibleRegion());
+    for (; !it.IsAtEnd(); ++it)
+      it.Set(random->GetUniformVariate(-1, 1));
+    const itk::SizeValueType voxels =
+        image->GetLargestPossibleRegion().GetNumberOfPixels();
+
+    for (unsigned int radius = 1; radius <= 3; radius++)
+      {
+      for (size_t t = 0; t < threadCounts.size(); t++)
+        {
+        OrientationFilterType::Pointer orientationFilter =
+            OrientationFilterType::New();
+        orientationFilter->SetInput(image);
+        orientationFilter->SetRadius(radius);
+        orientationFilter->SetNumberOfThreads(threadCounts[t]);
+        runner.Run(
+            CaseName(CaseName("OrientationEnhanceFilter", "radius", radius),
+                     "threads", threadCounts[t]),
+            OrientationKernel, orientationFilter.GetPointer(), voxels);
+        }
+      }
+
+    if (!outfile.getValue().empty())
+      {
+      std::ofstream out(outfile.getValue().c_str());
+      if (!out)
+        {
+        itkGenericExceptionMacro("Can not write " << outfile.getValue());
+        }
+      runner.Write(out, "cascade-bench", CASCADE_VERSION, BUILDINFO, threads);
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <string>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+/*
+ * Others
+ */
+#include "stage/histogramStage.h"
+#include "util/histogram.h"
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+typedef cascade::stage::HistogramStage HistogramStageType;
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Intensity histogram " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > outfile("o", "out",
+                                         "Output histogram, '-' for stdout",
+                                         false, "-", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > bins("b", "bins", "Number of bins", false,
+                                       100, "Integer", cmd);
+
+  TCLAP::ValueArg< float > percentile(
+      "p", "percentile",
+      "Upper bound of the histogram as a percentile of non-zero voxels",
+      false, 95, "Float", cmd);
+
+  TCLAP::ValueArg< float > dilate(
+      "d", "dilate", "Radius of the mask dilation in mm", false, 0, "Float",
+      cmd);
+
+  TCLAP::ValueArg< std::string > mask("m", "mask",
+                                      "Mask sequences e.g. WMGM.nii.gz", false,
+                                      "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > input("i", "input",
+                                       "Input sequences e.g. MPRAGE.nii.gz",
+                                       true, "", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    HistogramStageType::MaskImageType::Pointer maskImage;
+    if (mask.isSet())
+      {
+      maskImage = cascade::util::LoadImage<
+          HistogramStageType::MaskImageType >(mask.getValue());
+      }
+
+    cascade::stage::HistogramSettings settings;
+    settings.Bins = bins.getValue();
+    settings.Percentile = percentile.getValue();
+    settings.Dilate = dilate.getValue();
+    cascade::util::WriteHistogram(
+        outfile.getValue(),
+        HistogramStageType::Process(
+            cascade::util::LoadImage< cascade::stage::ImageType >(
+                input.getValue()),
+            maskImage, settings));
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
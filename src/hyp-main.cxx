@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <string>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+/*
+ * Others
+ */
+#include "stage/hypStage.h"
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+typedef cascade::stage::ImageType InputImageType;
+
+InputImageType::Pointer LoadIfSet(
+    const TCLAP::ValueArg< std::string > & filename)
+  {
+  InputImageType::Pointer image;
+  if (filename.isSet())
+    {
+    image = cascade::util::LoadImage< InputImageType >(filename.getValue());
+    }
+  return image;
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Lesion hypothesis mask " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > outfile("o", "out", "Output hypothesis mask",
+                                         true, "", "string", cmd);
+
+  TCLAP::ValueArg< float > radius(
+      "r", "radius", "Radius of the WM-GM boundary in mm", false, 1,
+      "Float", cmd);
+  TCLAP::SwitchArg boundary(
+      "b", "boundary", "Keep only WM and the WM-GM boundary", cmd, false);
+
+  TCLAP::ValueArg< float > gmPercentile(
+      "", "gm-percentile",
+      "Light sequences should be above this percentile of GM out of WM",
+      false, 90, "Float", cmd);
+  TCLAP::ValueArg< float > wmPercentile(
+      "", "wm-percentile",
+      "Light sequences should be above (T1 below) this percentile of WM out of GM",
+      false, 80, "Float", cmd);
+
+  TCLAP::ValueArg< std::string > csf("", "csf", "CSF mask e.g. csf.nii.gz",
+                                     false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > gm("", "gm",
+                                    "GM mask or partial volume e.g. gm.nii.gz",
+                                    true, "", "string", cmd);
+  TCLAP::ValueArg< std::string > wm("", "wm",
+                                    "WM mask or partial volume e.g. wm.nii.gz",
+                                    true, "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > t2("", "t2", "T2 image e.g. brain_t2.nii.gz",
+                                    false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > flair("", "flair",
+                                       "FLAIR image e.g. brain_flair.nii.gz",
+                                       false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > t1("", "t1", "T1 image e.g. brain_t1.nii.gz",
+                                    true, "", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    cascade::stage::HypSettings settings;
+    settings.Radius = radius.getValue();
+    settings.Boundary = boundary.getValue();
+    settings.GMPercentile = gmPercentile.getValue();
+    settings.WMPercentile = wmPercentile.getValue();
+
+    cascade::util::WriteImage(
+        outfile.getValue(),
+        cascade::stage::HypStage::Process(
+            cascade::util::LoadImage< InputImageType >(t1.getValue()),
+            cascade::util::LoadImage< InputImageType >(wm.getValue()),
+            cascade::util::LoadImage< InputImageType >(gm.getValue()),
+            LoadIfSet(csf), LoadIfSet(flair), LoadIfSet(t2), settings)
+            .GetPointer());
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+/*
+ * General ITK
+ */
+#include "itkImageIOFactory.h"
+#include "itkMultiThreader.h"
+
+/*
+ * Others
+ */
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+/*
+ * Result of checking a single file.
+ */
+struct FileInfo
+  {
+  std::string FileName;
+  bool Valid;
+  bool HeaderRead;
+  /** Whether the size of the voxel data could be checked */
+  bool DataChecked;
+  std::string Error;
+  itk::ImageIOBase::Pointer IO;
+  };
+
+struct CheckJob
+  {
+  std::vector< FileInfo >* Files;
+  bool InflateIfNeeded;
+  };
+
+template< class T >
+std::string JoinValues(const std::vector< T > & values)
+  {
+  std::ostringstream stream;
+  for (size_t i = 0; i < values.size(); i++)
+    stream << (i ? "," : "") << values[i];
+  return stream.str();
+  }
+
+/*
+ * Expected size of the whole file (uncompressed) for NIfTI images. Returns
+ * false for other formats.
+ */
+bool ExpectedNiftiSize(FileInfo & info, itk::uint64_t & size)
+  {
+  cascade::util::NiftiHeaderInfo header;
+  if (!cascade::util::ReadNiftiHeader(info.FileName, header)) return false;
+  size = static_cast< itk::uint64_t >(header.VoxOffset)
+      + info.IO->GetImageSizeInBytes();
+  return true;
+  }
+
+void CheckDataSize(FileInfo & info, bool inflateIfNeeded)
+  {
+  itk::uint64_t expected;
+  if (!ExpectedNiftiSize(info, expected)) return;
+
+  itk::uint64_t actual = 0;
+  if (cascade::util::endsWith(info.FileName, ".nii"))
+    {
+    std::ifstream file(info.FileName.c_str(),
+                       std::ios::in | std::ios::binary);
+    file.seekg(0, std::ios::end);
+    actual = static_cast< itk::uint64_t >(file.tellg());
+    info.DataChecked = true;
+    info.Valid = actual >= expected;
+    }
+  else if (cascade::util::endsWith(info.FileName, ".nii.gz"))
+    {
+    bool exact;
+    if (!cascade::util::GzipUncompressedSize(info.FileName, actual, exact))
+      {
+      info.Valid = false;
+      }
+    else if (exact)
+      {
+      info.DataChecked = true;
+      info.Valid = actual >= expected;
+      }
+    /** The trailer of a single member file holds the size modulo 2^32 */
+    else if (actual == (expected & 0xffffffffULL))
+      {
+      info.DataChecked = true;
+      }
+    /** Could be several members or truncated, only inflating tells */
+    else if (inflateIfNeeded)
+      {
+      info.DataChecked = true;
+      info.Valid = cascade::util::GzipInflatedSize(info.FileName, actual)
+          && actual >= expected;
+      }
+    }
+  if (!info.Valid && info.Error.empty())
+    {
+    info.Error = "image data is truncated";
+    }
+  }
+
+void CheckFile(FileInfo & info, bool inflateIfNeeded)
+  {
+  info.Valid = false;
+  info.HeaderRead = false;
+  info.DataChecked = false;
+  try
+    {
+    info.IO = itk::ImageIOFactory::CreateImageIO(
+        info.FileName.c_str(), itk::ImageIOFactory::ReadMode);
+    if (!info.IO)
+      {
+      info.Error = "unknown image format";
+      return;
+      }
+    info.IO->SetFileName(info.FileName);
+    info.IO->ReadImageInformation();
+    info.HeaderRead = true;
+    info.Valid = true;
+    CheckDataSize(info, inflateIfNeeded);
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    info.Valid = false;
+    info.Error = err.GetDescription();
+    }
+  }
+
+ITK_THREAD_RETURN_TYPE CheckFilesCallback(void* arg)
+  {
+  itk::MultiThreader::ThreadInfoStruct* threadInfo =
+      static_cast< itk::MultiThreader::ThreadInfoStruct* >(arg);
+  CheckJob* job = static_cast< CheckJob* >(threadInfo->UserData);
+  std::vector< FileInfo > & files = *job->Files;
+  for (size_t f = threadInfo->ThreadID; f < files.size();
+      f += threadInfo->NumberOfThreads)
+    CheckFile(files[f], job->InflateIfNeeded);
+  return ITK_THREAD_RETURN_VALUE;
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Image header information and validation " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::SwitchArg invalidSwitch(
+      "", "invalid", "Only list the files that are not valid images.", cmd,
+      false);
+
+  TCLAP::SwitchArg quickSwitch(
+      "", "quick",
+      "Never inflate a compressed image, even if its size can not be checked "
+      "from the gzip trailer.",
+      cmd, false);
+
+  TCLAP::UnlabeledMultiArg< std::string > inputs(
+      "files", "Images e.g. FLAIR.nii.gz", false, "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  bool allValid = true;
+  try
+    {
+    std::vector< FileInfo > files(inputs.getValue().size());
+    for (size_t f = 0; f < files.size(); f++)
+      files[f].FileName = inputs.getValue()[f];
+
+    /** Factories are registered once before the files are checked */
+    itk::ImageIOFactory::CreateImageIO("", itk::ImageIOFactory::ReadMode);
+
+    CheckJob job;
+    job.Files = &files;
+    job.InflateIfNeeded = !quickSwitch.getValue();
+    if (!files.empty())
+      {
+      itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+      threader->SetNumberOfThreads(
+          std::min< size_t >(threader->GetNumberOfThreads(), files.size()));
+      threader->SetSingleMethod(CheckFilesCallback, &job);
+      threader->SingleMethodExecute();
+      }
+
+    std::ostringstream out;
+    if (!invalidSwitch.getValue())
+      {
+      out << "file\tvalid\tdata_checked\tdimension\tsize\tspacing\torigin"
+          "\tdirection\tpixel_type\tcomponent_type\tcomponents\terror\n";
+      }
+    for (size_t f = 0; f < files.size(); f++)
+      {
+      const FileInfo & info = files[f];
+      allValid &= info.Valid;
+      if (invalidSwitch.getValue())
+        {
+        if (!info.Valid) out << info.FileName << "\n";
+        continue;
+        }
+      out << info.FileName << "\t" << info.Valid << "\t" << info.DataChecked;
+      if (info.HeaderRead)
+        {
+        const itk::ImageIOBase* io = info.IO;
+        const unsigned int dimension = io->GetNumberOfDimensions();
+        std::vector< itk::SizeValueType > size;
+        std::vector< double > spacing, origin, direction;
+        for (unsigned int i = 0; i < dimension; i++)
+          {
+          size.push_back(io->GetDimensions(i));
+          spacing.push_back(io->GetSpacing(i));
+          origin.push_back(io->GetOrigin(i));
+          const std::vector< double > axis = io->GetDirection(i);
+          direction.insert(direction.end(), axis.begin(), axis.end());
+          }
+        out << "\t" << dimension << "\t" << JoinValues(size) << "\t"
+            << JoinValues(spacing) << "\t" << JoinValues(origin) << "\t"
+            << JoinValues(direction) << "\t"
+            << itk::ImageIOBase::GetPixelTypeAsString(io->GetPixelType())
+            << "\t"
+            << itk::ImageIOBase::GetComponentTypeAsString(
+                io->GetComponentType()) << "\t"
+            << io->GetNumberOfComponents();
+        }
+      else
+        {
+        out << "\t\t\t\t\t\t\t\t";
+        }
+      out << "\t" << info.Error << "\n";
+      }
+    std::cout << out.str() << std::flush;
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  /** Listing the invalid files is not a failure */
+  return allValid || invalidSwitch.getValue() ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
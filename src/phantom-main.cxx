@@ -0,0 +1,403 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "vnl/vnl_math.h"
+/*
+ * ITK Filters
+ */
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkResampleImageFilter.h"
+/*
+ * Others
+ */
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+typedef float PixelType;
+typedef itk::Image< PixelType, DIM > ImageType;
+typedef itk::Image< unsigned short, DIM > SequenceImageType;
+typedef itk::Image< unsigned char, DIM > LabelImageType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomType;
+
+/*
+ * Mean intensity of the tissues in a sequence, roughly the contrast of a
+ * brain extracted scan.
+ */
+struct SequenceModel
+  {
+  const char* Name;
+  float CSF;
+  float GM;
+  float WM;
+  float Lesion;
+  };
+
+const SequenceModel Sequences[] =
+  {
+    { "flair", 100, 750, 600, 1200 },
+    { "t1", 250, 600, 850, 500 },
+    { "t2", 1000, 600, 450, 900 },
+    { "pd", 850, 800, 650, 900 } };
+
+struct PhantomSettings
+  {
+  double Spacing;
+  double Bias;
+  double Noise;
+  unsigned int Lesions;
+  double LesionRadius;
+  };
+
+/** Linear resampling to an isotropic grid covering the same extent */
+ImageType::Pointer Resample(const ImageType* image, double spacing)
+  {
+  const ImageType::SpacingType inputSpacing = image->GetSpacing();
+  const ImageType::SizeType inputSize =
+      image->GetLargestPossibleRegion().GetSize();
+
+  ImageType::SpacingType outputSpacing;
+  ImageType::SizeType outputSize;
+  itk::Vector< double, DIM > shift;
+  for (unsigned int d = 0; d < DIM; d++)
+    {
+    outputSpacing[d] = spacing;
+    outputSize[d] = std::max< itk::SizeValueType >(
+        1, std::ceil(inputSize[d] * inputSpacing[d] / spacing));
+    shift[d] = 0.5 * (spacing - inputSpacing[d]);
+    }
+
+  typedef itk::ResampleImageFilter< ImageType, ImageType > ResampleFilterType;
+  ResampleFilterType::Pointer resampleFilter = ResampleFilterType::New();
+  resampleFilter->SetInput(image);
+  resampleFilter->SetSize(outputSize);
+  resampleFilter->SetOutputSpacing(outputSpacing);
+  resampleFilter->SetOutputOrigin(
+      image->GetOrigin() + image->GetDirection() * shift);
+  resampleFilter->SetOutputDirection(image->GetDirection());
+  resampleFilter->Update();
+  ImageType::Pointer resampled = resampleFilter->GetOutput();
+  resampled->DisconnectPipeline();
+  return resampled;
+  }
+
+/*
+ * Spherical blobs centred in deep white matter, 1 at the centre fading to 0
+ * at a random radius between half and all of the maximum radius.
+ */
+ImageType::Pointer LesionBlobs(const ImageType* white,
+                               PhantomSettings const &settings,
+                               RandomType* random)
+  {
+  const ImageType::RegionType region = white->GetLargestPossibleRegion();
+  ImageType::Pointer lesion = ImageType::New();
+  lesion->CopyInformation(white);
+  lesion->SetRegions(region);
+  lesion->Allocate();
+  lesion->FillBuffer(0);
+  if (settings.Lesions == 0) return lesion;
+
+  std::vector< ImageType::IndexType > candidates;
+  itk::ImageRegionConstIteratorWithIndex< ImageType > wit(white, region);
+  for (; !wit.IsAtEnd(); ++wit)
+    if (wit.Get() >= 0.9) candidates.push_back(wit.GetIndex());
+  if (candidates.empty())
+    {
+    itkGenericExceptionMacro("No white matter to place lesions in.");
+    }
+
+  for (unsigned int l = 0; l < settings.Lesions; l++)
+    {
+    const ImageType::IndexType center = candidates[random->GetIntegerVariate(
+        candidates.size() - 1)];
+    const double radius = random->GetUniformVariate(
+        0.5 * settings.LesionRadius, settings.LesionRadius);
+
+    ImageType::PointType centerPoint;
+    lesion->TransformIndexToPhysicalPoint(center, centerPoint);
+    ImageType::RegionType blob;
+    for (unsigned int d = 0; d < DIM; d++)
+      {
+      const long extent = std::ceil(radius / lesion->GetSpacing()[d]);
+      blob.SetIndex(d, center[d] - extent);
+      blob.SetSize(d, 2 * extent + 1);
+      }
+    blob.Crop(region);
+
+    itk::ImageRegionIteratorWithIndex< ImageType > it(lesion, blob);
+    for (; !it.IsAtEnd(); ++it)
+      {
+      ImageType::PointType point;
+      lesion->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+      const double distance = point.EuclideanDistanceTo(centerPoint) / radius;
+      const double value = 1 - distance * distance;
+      if (value > it.Get()) it.Set(value);
+      }
+    }
+  return lesion;
+  }
+
+/*
+ * Smooth multiplicative field, exp of a sum of three random plane waves of
+ * at most one and a half cycle over the image.
+ */
+ImageType::Pointer BiasField(const ImageType* reference, double strength,
+                             RandomType* random)
+  {
+  const ImageType::RegionType region = reference->GetLargestPossibleRegion();
+  ImageType::Pointer bias = ImageType::New();
+  bias->CopyInformation(reference);
+  bias->SetRegions(region);
+  bias->Allocate();
+
+  const unsigned int waves = 3;
+  double frequency[waves][DIM];
+  double phase[waves];
+  for (unsigned int w = 0; w < waves; w++)
+    {
+    for (unsigned int d = 0; d < DIM; d++)
+      {
+      const double extent = region.GetSize(d) * reference->GetSpacing()[d];
+      frequency[w][d] = 2 * vnl_math::pi
+          * random->GetUniformVariate(-1.5, 1.5) / extent;
+      }
+    phase[w] = random->GetUniformVariate(0, 2 * vnl_math::pi);
+    }
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it(bias, region);
+  for (; !it.IsAtEnd(); ++it)
+    {
+    ImageType::PointType point;
+    bias->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    double field = 0;
+    for (unsigned int w = 0; w < waves; w++)
+      {
+      double angle = phase[w];
+      for (unsigned int d = 0; d < DIM; d++)
+        angle += frequency[w][d] * point[d];
+      field += std::cos(angle) / waves;
+      }
+    it.Set(std::exp(strength * field));
+    }
+  return bias;
+  }
+
+/*
+ * Mixture of the tissue intensities by their partial volumes, lesions
+ * replacing the tissue they are in, times the bias field with Rician noise.
+ * Outside the brain stays zero as in a brain extracted scan.
+ */
+SequenceImageType::Pointer Synthesize(const ImageType* csf, const ImageType* gm,
+                                      const ImageType* wm,
+                                      const ImageType* lesion,
+                                      const ImageType* bias,
+                                      SequenceModel const &model,
+                                      double noise, RandomType* random)
+  {
+  const ImageType::RegionType region = wm->GetLargestPossibleRegion();
+  SequenceImageType::Pointer image = SequenceImageType::New();
+  image->CopyInformation(wm);
+  image->SetRegions(region);
+  image->Allocate();
+
+  const double sigma = noise
+      * std::max(model.CSF, std::max(model.GM, model.WM));
+  const double maximum = itk::NumericTraits< SequenceImageType::PixelType >::max();
+
+  itk::ImageRegionConstIterator< ImageType > cit(csf, region);
+  itk::ImageRegionConstIterator< ImageType > git(gm, region);
+  itk::ImageRegionConstIterator< ImageType > wit(wm, region);
+  itk::ImageRegionConstIterator< ImageType > lit(lesion, region);
+  itk::ImageRegionConstIterator< ImageType > bit(bias, region);
+  itk::ImageRegionIterator< SequenceImageType > oit(image, region);
+  for (; !oit.IsAtEnd(); ++cit, ++git, ++wit, ++lit, ++bit, ++oit)
+    {
+    const double tissue = cit.Get() + git.Get() + wit.Get();
+    if (tissue <= 0)
+      {
+      oit.Set(0);
+      continue;
+      }
+    double value = cit.Get() * model.CSF + git.Get() * model.GM
+        + wit.Get() * model.WM;
+    value = (1 - lit.Get()) * value + lit.Get() * tissue * model.Lesion;
+    value *= bit.Get();
+    if (sigma > 0)
+      {
+      const double real = value
+          + random->GetNormalVariate(0, sigma * sigma);
+      const double imaginary = random->GetNormalVariate(0, sigma * sigma);
+      value = std::sqrt(real * real + imaginary * imaginary);
+      }
+    oit.Set(std::min(maximum, value + 0.5));
+    }
+  return image;
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Synthetic multi-sequence phantom " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > outPrefix(
+      "o", "out",
+      "Output prefix of brain_{flair,t1,t2,pd}, csf, gray, white and lesion "
+      ".nii.gz",
+      true, "", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > seed("", "seed",
+                                       "Seed of the random generator", false,
+                                       2013, "Integer", cmd);
+
+  TCLAP::ValueArg< double > lesionRadius("", "lesion-radius",
+                                         "Largest lesion radius in mm", false,
+                                         6, "Float", cmd);
+
+  TCLAP::ValueArg< unsigned int > lesions("l", "lesions",
+                                          "Number of lesion blobs", false, 10,
+                                          "Integer", cmd);
+
+  TCLAP::ValueArg< double > noise(
+      "n", "noise",
+      "Standard deviation of the noise relative to the brightest tissue",
+      false, 0.03, "Float", cmd);
+
+  TCLAP::ValueArg< double > bias("b", "bias",
+                                 "Strength of the bias field, 0 for none",
+                                 false, 0.2, "Float", cmd);
+
+  TCLAP::ValueArg< double > spacing(
+      "s", "spacing", "Isotropic voxel size in mm, 0 keeps the input grid",
+      false, 0, "Float", cmd);
+
+  TCLAP::ValueArg< std::string > csf(
+      "c", "csf", "CSF probability e.g. data/standard/csf.nii.gz", true, "",
+      "string", cmd);
+
+  TCLAP::ValueArg< std::string > gray(
+      "g", "gray", "Gray matter probability e.g. data/standard/gray.nii.gz",
+      true, "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > white(
+      "w", "white", "White matter probability e.g. data/standard/white.nii.gz",
+      true, "", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    PhantomSettings settings;
+    settings.Spacing = spacing.getValue();
+    settings.Bias = bias.getValue();
+    settings.Noise = noise.getValue();
+    settings.Lesions = lesions.getValue();
+    settings.LesionRadius = lesionRadius.getValue();
+
+    RandomType::Pointer random = RandomType::New();
+    random->Initialize(seed.getValue());
+
+    ImageType::Pointer pve[3] =
+      {
+      cascade::util::LoadImage< ImageType >(csf.getValue()),
+      cascade::util::LoadImage< ImageType >(gray.getValue()),
+      cascade::util::LoadImage< ImageType >(white.getValue()) };
+    const char* pveNames[3] = { "csf", "gray", "white" };
+    for (unsigned int t = 0; t < 3; t++)
+      {
+      if (settings.Spacing > 0) pve[t] = Resample(pve[t], settings.Spacing);
+      cascade::util::WriteImage(
+          outPrefix.getValue() + pveNames[t] + ".nii.gz", pve[t].GetPointer());
+      }
+
+    ImageType::Pointer lesion = LesionBlobs(pve[2], settings, random);
+    typedef itk::BinaryThresholdImageFilter< ImageType, LabelImageType > ThresholdFilterType;
+    ThresholdFilterType::Pointer thresholdFilter = ThresholdFilterType::New();
+    thresholdFilter->SetInput(lesion);
+    thresholdFilter->SetLowerThreshold(0.5);
+    thresholdFilter->SetInsideValue(1);
+    thresholdFilter->SetOutsideValue(0);
+    thresholdFilter->Update();
+    cascade::util::WriteImage(outPrefix.getValue() + "lesion.nii.gz",
+                              thresholdFilter->GetOutput());
+
+    for (unsigned int s = 0; s < sizeof(Sequences) / sizeof(*Sequences); s++)
+      {
+      ImageType::Pointer field = BiasField(pve[2], settings.Bias, random);
+      cascade::util::WriteImage(
+          outPrefix.getValue() + "brain_" + Sequences[s].Name + ".nii.gz",
+          Synthesize(pve[0], pve[1], pve[2], lesion, field, Sequences[s],
+                     settings.Noise, random).GetPointer());
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
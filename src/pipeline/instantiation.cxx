@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+/*
+ * Explicit instantiations of the normalization pipelines used by
+ * cascade-range. See util/instantiation.cxx.
+ */
+#include "buildinfo.h"
+
+#include "itkImage.h"
+
+#include "pipeline/itkSliceNormalizerPipeline.hxx"
+#include "pipeline/itkIntensityNormalizerPipeline.hxx"
+#include "pipeline/itkN4Pipeline.hxx"
+
+#define CASCADE_INSTANTIATE_PIPELINES(D)                                                        \
+  template class SliceNormalizerPipeline< Image< float, D >, Image< float, D >, Image< char, D > >;     \
+  template class IntensityNormalizerPipeline< Image< float, D >, Image< float, D >, Image< char, D > >; \
+  template class N4Pipeline< Image< float, D >, Image< float, D > >;
+
+namespace itk
+{
+CASCADE_INSTANTIATE_PIPELINES(2)
+CASCADE_INSTANTIATE_PIPELINES(3)
+#if DIM != 2 && DIM != 3
+CASCADE_INSTANTIATE_PIPELINES(DIM)
+#endif
+} // end namespace itk
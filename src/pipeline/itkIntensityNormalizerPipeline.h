@@ -111,7 +111,7 @@ private:
 };
 } // end namespace itk
 
-#ifndef ITK_MANUAL_INSTANTIATION
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
 #include "itkIntensityNormalizerPipeline.hxx"
 #endif
 
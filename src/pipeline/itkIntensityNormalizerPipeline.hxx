@@ -18,6 +18,8 @@
 #define __itkIntensityNormalizerPipeline_hxx
 #include "itkIntensityNormalizerPipeline.h"
 
+#include "util/profiler.h"
+
 namespace itk
 {
 template< class TInputImage, class TOutputImage, class TMaskImage >
@@ -43,11 +45,17 @@ void IntensityNormalizerPipeline< TInputImage, TOutputImage, TMaskImage >::Gener
 
   itkAssertOrThrowMacro(numElems == 1, "Input should be an scalar image");
 
+  const SizeValueType voxels =
+      this->GetInput()->GetLargestPossibleRegion().GetNumberOfPixels();
+  cascade::util::ProfileScope histogramProfile(this->GetNameOfClass(),
+                                               "histogram", voxels);
+
   /** Then blur the image to reduce noise  */
   typename GaussianFilterType::Pointer gaussianFilter =
       GaussianFilterType::New();
   gaussianFilter->SetInput(this->GetInput());
   gaussianFilter->SetVariance(1);
+  gaussianFilter->SetNumberOfThreads(this->GetNumberOfThreads());
 
   /** Generate histogram for area non zero area */
   typename HistogramGeneratorType::Pointer histogramGenerator =
@@ -61,7 +69,9 @@ void IntensityNormalizerPipeline< TInputImage, TOutputImage, TMaskImage >::Gener
 
   histogramGenerator->SetHistogramSize(size);
   histogramGenerator->SetAutoMinimumMaximum(true);
+  histogramGenerator->SetNumberOfThreads(this->GetNumberOfThreads());
   histogramGenerator->Update();
+  histogramProfile.Stop();
 
   LookupFunctorType lookupFunctor;
 
@@ -98,9 +108,12 @@ void IntensityNormalizerPipeline< TInputImage, TOutputImage, TMaskImage >::Gener
    */
 
   /* Linearly map peak and extreme landmarks to desired valuse */
+  cascade::util::ProfileScope lookupProfile(this->GetNameOfClass(), "lookup",
+                                            voxels);
   typename LookupTransform::Pointer lookupTransform = LookupTransform::New();
   lookupTransform->SetInput(this->GetInput());
   lookupTransform->SetFunctor(lookupFunctor);
+  lookupTransform->SetNumberOfThreads(this->GetNumberOfThreads());
   lookupTransform->Update();
 
   this->GraftOutput(lookupTransform->GetOutput());
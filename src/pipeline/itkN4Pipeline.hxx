@@ -32,7 +32,8 @@
 #include "itkOtsuThresholdImageFilter.h"
 #include "itkShrinkImageFilter.h"
 
-#include "itkTimeProbe.h"
+#include "util/profiler.h"
+#include "util/threading.h"
 
 namespace itk
 {
@@ -57,6 +58,9 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
   typedef itk::Image< unsigned char, InputImageDimension > MaskImageType;
 
   const InputImageType* inputImage = this->GetInput();
+  const SizeValueType voxels =
+      inputImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  const ThreadIdType threads = this->GetNumberOfThreads();
   typename MaskImageType::Pointer maskImage = NULL;
   typename InputImageType::Pointer weightImage = NULL;
 
@@ -70,6 +74,8 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
 
   if (!maskImage)
     {
+    cascade::util::ProfileScope profile(this->GetNameOfClass(), "mask",
+                                        voxels);
     itkDebugMacro("Mask not read.  Creating Otsu mask.");
     typedef itk::OtsuThresholdImageFilter< InputImageType, MaskImageType > ThresholderType;
     typename ThresholderType::Pointer otsu = ThresholderType::New();
@@ -77,6 +83,7 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
     otsu->SetNumberOfHistogramBins(200);
     otsu->SetInsideValue(0);
     otsu->SetOutsideValue(1);
+    otsu->SetNumberOfThreads(threads);
     maskImage = otsu->GetOutput();
     maskImage->Update();
     maskImage->DisconnectPipeline();
@@ -119,15 +126,19 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
 
   itkDebugMacro(<< shrinkage);
 
+  cascade::util::ProfileScope shrinkProfile(this->GetNameOfClass(), "shrink",
+                                            voxels);
   typename ShrinkerType::Pointer shrinker = ShrinkerType::New();
   shrinker->SetInput(inputImage);
   shrinker->SetShrinkFactors(shrinkage);
+  shrinker->SetNumberOfThreads(threads);
   shrinker->Update();
 
   typedef itk::ShrinkImageFilter< MaskImageType, MaskImageType > MaskShrinkerType;
   typename MaskShrinkerType::Pointer maskshrinker = MaskShrinkerType::New();
   maskshrinker->SetInput(maskImage);
   maskshrinker->SetShrinkFactors(shrinkage);
+  maskshrinker->SetNumberOfThreads(threads);
   maskshrinker->Update();
 
   correcter->SetInput(shrinker->GetOutput());
@@ -140,6 +151,7 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
     {
     weightshrinker->SetInput(weightImage);
     weightshrinker->SetShrinkFactors(shrinkage);
+    weightshrinker->SetNumberOfThreads(threads);
     weightshrinker->Update();
 
     correcter->SetConfidenceImage(weightshrinker->GetOutput());
@@ -152,7 +164,17 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
    * correcter->SetNumberOfHistogramBins();
    */
 
+  shrinkProfile.Stop();
+
+  /** The shrunk image may be too small for all the threads */
+  const SizeValueType shrunkVoxels =
+      shrinker->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels();
+  cascade::util::ProfileScope correctProfile(this->GetNameOfClass(), "correct",
+                                             shrunkVoxels);
+  correcter->SetNumberOfThreads(
+      cascade::util::ThreadsForVoxels(shrunkVoxels, threads));
   correcter->Update();
+  correctProfile.Stop();
 
   /**
    * Reconstruct the bias field at full image resolution.  Divide
@@ -162,6 +184,8 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
   typedef itk::BSplineControlPointImageFilter<
       typename CorrecterType::BiasFieldControlPointLatticeType,
       typename CorrecterType::ScalarImageType > BSplinerType;
+  cascade::util::ProfileScope reconstructProfile(this->GetNameOfClass(),
+                                                 "reconstruct", voxels);
   typename BSplinerType::Pointer bspliner = BSplinerType::New();
   bspliner->SetInput(correcter->GetLogBiasFieldControlPointLattice());
   bspliner->SetSplineOrder(correcter->GetSplineOrder());
@@ -169,6 +193,7 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
   bspliner->SetOrigin(newOrigin);
   bspliner->SetDirection(inputImage->GetDirection());
   bspliner->SetSpacing(inputImage->GetSpacing());
+  bspliner->SetNumberOfThreads(threads);
   bspliner->Update();
 
   typename InputImageType::Pointer logField = InputImageType::New();
@@ -190,12 +215,14 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
   typedef itk::ExpImageFilter< InputImageType, InputImageType > ExpFilterType;
   typename ExpFilterType::Pointer expFilter = ExpFilterType::New();
   expFilter->SetInput(logField);
+  expFilter->SetNumberOfThreads(threads);
   expFilter->Update();
 
   typedef itk::DivideImageFilter< InputImageType, InputImageType, InputImageType > DividerType;
   typename DividerType::Pointer divider = DividerType::New();
   divider->SetInput1(inputImage);
   divider->SetInput2(expFilter->GetOutput());
+  divider->SetNumberOfThreads(threads);
   divider->Update();
 
   typename InputImageType::RegionType inputRegion;
@@ -206,11 +233,13 @@ void N4Pipeline< TInputImage, TOutputImage >::GenerateData()
   typename CropperType::Pointer cropper = CropperType::New();
   cropper->SetInput(divider->GetOutput());
   cropper->SetExtractionRegion(inputRegion);
+  cropper->SetNumberOfThreads(threads);
   cropper->Update();
 
   typename CropperType::Pointer biasFieldCropper = CropperType::New();
   biasFieldCropper->SetInput(expFilter->GetOutput());
   biasFieldCropper->SetExtractionRegion(inputRegion);
+  biasFieldCropper->SetNumberOfThreads(threads);
   biasFieldCropper->Update();
 
   this->GraftNthOutput(0, cropper->GetOutput());
@@ -20,6 +20,8 @@
 
 #include "itkNumericTraits.h"
 
+#include "util/profiler.h"
+
 #include <fstream>
 #include <iostream>
 
@@ -68,6 +70,11 @@ void RobustMeanVariancePipeline< TInputImage >::GenerateData()
     m_Percentile = 1 - m_Percentile;
     }
 
+  const SizeValueType voxels =
+      this->GetInput()->GetLargestPossibleRegion().GetNumberOfPixels();
+  cascade::util::ProfileScope histogramProfile(this->GetNameOfClass(),
+                                               "histogram", voxels);
+
   SizeType size(m_NumOfComponents);
   size.Fill(m_NumberOfBins);
 
@@ -77,6 +84,7 @@ void RobustMeanVariancePipeline< TInputImage >::GenerateData()
     imageToHistogramFilter->SetMaskImage(this->GetMaskImage());
     }
   imageToHistogramFilter->SetInput(this->GetInput());
+  imageToHistogramFilter->SetNumberOfThreads(this->GetNumberOfThreads());
   imageToHistogramFilter->SetHistogramSize(size);
   imageToHistogramFilter->SetAutoMinimumMaximum(true);
   imageToHistogramFilter->Update();
@@ -90,12 +98,19 @@ void RobustMeanVariancePipeline< TInputImage >::GenerateData()
     upperBound[i] = hist->Quantile(i, 1 - m_Percentile);
     size[i] = int(upperBound[i] - lowerBound[i]);
     }
+  histogramProfile.Stop();
+
+  cascade::util::ProfileScope trimProfile(this->GetNameOfClass(),
+                                          "trimmed-histogram", voxels);
   imageToHistogramFilter->SetHistogramSize(size);
   imageToHistogramFilter->SetAutoMinimumMaximum(false);
   imageToHistogramFilter->SetHistogramBinMinimum(lowerBound);
   imageToHistogramFilter->SetHistogramBinMaximum(upperBound);
   imageToHistogramFilter->Update();
+  trimProfile.Stop();
 
+  cascade::util::ProfileScope covarianceProfile(this->GetNameOfClass(),
+                                                "covariance");
   covarianceAlgorithm->SetInput(imageToHistogramFilter->GetOutput());
   covarianceAlgorithm->Update();
 
@@ -131,6 +131,27 @@ public:
     return m_MahalanobisFilter->GetStateImage();
     }
 
+  virtual void SetStateGroup(const unsigned int _arg)
+    {
+    if (m_MahalanobisFilter->GetStateGroup() != _arg)
+      {
+      m_MahalanobisFilter->SetStateGroup(_arg);
+      this->Modified();
+      }
+    }
+  virtual unsigned int GetStateGroup() const
+    {
+    return m_MahalanobisFilter->GetStateGroup();
+    }
+
+  void SetStateModel(const StateImageType * model,
+                     const cascade::util::StateModelInfo & info, int label,
+                     const std::string & sequence)
+    {
+    m_MahalanobisFilter->SetStateModel(model, info, label, sequence);
+    this->Modified();
+    }
+
   virtual void SetTransform(const TransformType * _arg)
     {
     if (m_MahalanobisFilter->GetTransform() != _arg)
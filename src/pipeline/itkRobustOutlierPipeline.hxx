@@ -21,6 +21,7 @@
 #include "itkMultiplyImageFilter.h"
 #include "util/itkOrientationEnhanceFilter.h"
 #include "util/helpers.h"
+#include "util/profiler.h"
 namespace itk
 {
 
@@ -48,6 +49,15 @@ void RobustOutlierPipeline< TInputImage, TOutputImage >::GenerateData()
       static_cast< InputImageType * >(this->ProcessObject::GetInput(0));
 
   itkAssertOrThrowMacro(inputImage, "Input image should be set.");
+  const SizeValueType voxels =
+      inputImage->GetLargestPossibleRegion().GetNumberOfPixels();
+
+  /** The inner filters run with the threads of the pipeline */
+  const ThreadIdType threads = this->GetNumberOfThreads();
+  m_MahalanobisFilter->SetNumberOfThreads(threads);
+  m_MeanCovCalculator->SetNumberOfThreads(threads);
+  m_ChiFilter->SetNumberOfThreads(threads);
+  m_Castor->SetNumberOfThreads(threads);
 
   m_MahalanobisFilter->SetInput(inputImage);
   if (GetMaskImage())
@@ -64,19 +74,26 @@ void RobustOutlierPipeline< TInputImage, TOutputImage >::GenerateData()
       m_MeanCovCalculator->SetMaskValue(this->GetMaskValue());
       }
 
+    cascade::util::ProfileScope profile(this->GetNameOfClass(),
+                                        "mean-covariance", voxels);
     m_MeanCovCalculator->SetInput(inputImage);
     m_MeanCovCalculator->Update();
     m_MahalanobisFilter->SetGlobalState(
         StateFunc::GetState(GetMean(), GetCovariance()));
     }
 
+  cascade::util::ProfileScope distanceProfile(this->GetNameOfClass(),
+                                              "distance", voxels);
   m_ChiFilter->GetFunctor().SetDOF(inputImage->GetNumberOfComponentsPerPixel());
   m_ChiFilter->SetInput(m_MahalanobisFilter->GetDistanceImage());
   m_ChiFilter->Update();
   typename ScalarImageType::Pointer out_img = m_ChiFilter->GetOutput();
+  distanceProfile.Stop();
 
   if (m_PerformOrient)
     {
+    cascade::util::ProfileScope profile(this->GetNameOfClass(), "orientation",
+                                        voxels);
     typedef MultiplyImageFilter< ScalarImageType, ScalarImageType > MultiplyImageFilterType;
     typename MultiplyImageFilterType::Pointer multiplyFilter =
         MultiplyImageFilterType::New();
@@ -86,6 +103,8 @@ void RobustOutlierPipeline< TInputImage, TOutputImage >::GenerateData()
 
     multiplyFilter->SetInput1(out_img);
     multiplyFilter->SetInput2(m_MahalanobisFilter->GetOrientImage());
+    multiplyFilter->SetNumberOfThreads(threads);
+    orientEnhance->SetNumberOfThreads(threads);
     orientEnhance->SetInput(multiplyFilter->GetOutput());
     orientEnhance->Update();
     out_img = orientEnhance->GetOutput();
@@ -110,7 +110,7 @@ public:
 
     };} // end namespace itk
 
-#ifndef ITK_MANUAL_INSTANTIATION
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
 #include "itkSliceNormalizerPipeline.hxx"
 #endif
 
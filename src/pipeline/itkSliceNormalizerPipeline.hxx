@@ -23,6 +23,8 @@
 
 #include "util/itkIntensityTableLookupFunctor.h"
 #include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
 
 namespace itk
 {
@@ -47,7 +49,12 @@ void SliceNormalizerPipeline< TInputImage, TOutputImage, TMaskImage >::GenerateD
   {
   this->AllocateOutputs();
 
+  const SizeValueType voxels =
+      this->GetInput()->GetLargestPossibleRegion().GetNumberOfPixels();
+
   /** First calculate the overall image histogram */
+  cascade::util::ProfileScope histogramProfile(this->GetNameOfClass(),
+                                               "histogram", voxels);
   typename ImageHistogramType::Pointer imgHistogram = ImageHistogramType::New();
   typename ImageHistogramType::HistogramType::SizeType size(1);
   size.Fill(m_NumberOfLevels);
@@ -56,11 +63,16 @@ void SliceNormalizerPipeline< TInputImage, TOutputImage, TMaskImage >::GenerateD
   imgHistogram->SetMaskValue(this->GetMaskValue());
   imgHistogram->SetHistogramSize(size);
   imgHistogram->SetAutoMinimumMaximum(true);
+  imgHistogram->SetNumberOfThreads(this->GetNumberOfThreads());
   imgHistogram->Update();
 
   m_MinValue = imgHistogram->GetOutput()->Quantile(0, m_Percentile);
   m_MaxValue = imgHistogram->GetOutput()->Quantile(0, 1 - m_Percentile);
   m_MeanValue = imgHistogram->GetOutput()->Quantile(0, 0.5);
+  histogramProfile.Stop();
+
+  cascade::util::ProfileScope sliceProfile(this->GetNameOfClass(), "slices",
+                                           voxels);
 
   const typename InputImageType::RegionType requestedRegion =
       this->GetInput()->GetLargestPossibleRegion();
@@ -80,6 +92,10 @@ void SliceNormalizerPipeline< TInputImage, TOutputImage, TMaskImage >::GenerateD
     internalRegion.SetIndex(internal_i, requestedIndex[i]);
     }
 
+  /** A slice is too small for a full thread team */
+  const ThreadIdType sliceThreads = cascade::util::ThreadsForVoxels(
+      internalRegion.GetNumberOfPixels(), this->GetNumberOfThreads());
+
   const IndexValueType sliceRangeMax =
       static_cast< IndexValueType >(requestedSize[GetDimToFold()]
           + requestedIndex[GetDimToFold()]);
@@ -116,6 +132,7 @@ void SliceNormalizerPipeline< TInputImage, TOutputImage, TMaskImage >::GenerateD
     slcHistogram->SetMaskValue(this->GetMaskValue());
     slcHistogram->SetHistogramSize(size);
     slcHistogram->SetAutoMinimumMaximum(true);
+    slcHistogram->SetNumberOfThreads(sliceThreads);
     slcHistogram->Update();
 
     /** Calculate robust measures */
@@ -138,6 +155,7 @@ void SliceNormalizerPipeline< TInputImage, TOutputImage, TMaskImage >::GenerateD
     typename LookupTransform::Pointer lookupTransform = LookupTransform::New();
     lookupTransform->SetInput(slice);
     lookupTransform->SetFunctor(lookupFunctor);
+    lookupTransform->SetNumberOfThreads(sliceThreads);
     lookupTransform->Update();
 
     ImageAlgorithm::Copy(lookupTransform->GetOutput(), this->GetOutput(0),
@@ -20,6 +20,8 @@
  */
 #include <vector>
 #include <string>
+#include <sstream>
+#include <algorithm>
 /*
  * General ITK
  */
@@ -27,10 +29,8 @@
 /*
  * ITK Filters
  */
-#include "itkBinaryThresholdImageFilter.h"
 #include "itkBinaryImageToShapeLabelMapFilter.h"
 #include "itkShapeOpeningLabelMapFilter.h"
-#include "itkLabelMapToLabelImageFilter.h"
 
 /*
  * ITK IO
@@ -42,6 +42,9 @@
  * Others
  */
 #include "util/helpers.h"
+#include "util/reportWriter.h"
+#include "util/profiler.h"
+#include "util/threading.h"
 #include "3rdparty/tclap/CmdLine.h"
 /*
  * Pixel types
@@ -54,25 +57,180 @@ typedef unsigned int LabelType;
 typedef itk::Image< PixelType, DIM > ImageType;
 typedef itk::Image< LabelType, DIM > LabelImageType;
 
-typedef itk::BinaryThresholdImageFilter< ImageType, ImageType > BinaryThresholdImageFilterType;
 typedef itk::BinaryImageToShapeLabelMapFilter< ImageType > BinaryImageToShapeLabelMapFilterType;
 typedef BinaryImageToShapeLabelMapFilterType::OutputImageType ShapeLabelMapType;
 typedef itk::ShapeOpeningLabelMapFilter< ShapeLabelMapType > ShapeOpeningLabelMapFilterType;
-typedef itk::LabelMapToLabelImageFilter< ShapeLabelMapType, LabelImageType > LabelMapToLabelImageFilterType;
+typedef ShapeLabelMapType::LabelObjectType ShapeLabelObjectType;
 
 /*
  * IO types
  */
 typedef itk::ImageFileWriter< ImageType > WriterType;
 
+/*
+ * A report column: an attribute of the label object and, for vector
+ * attributes, the component to report.
+ */
+struct ReportColumn
+  {
+  std::string Name;
+  std::string Attribute;
+  unsigned int Component;
+  };
+
+const char* const defaultAttributes =
+    "NumberOfPixels,PhysicalSize,Perimeter,Elongation,Roundness,Centroid,"
+    "EquivalentSphericalRadius,EquivalentSphericalPerimeter";
+
+bool IsVectorAttribute(const std::string & name)
+  {
+  return name == "Centroid" || name == "EquivalentEllipsoidDiameter"
+      || name == "PrincipalMoments";
+  }
+
+bool IsScalarAttribute(const std::string & name)
+  {
+  return name == "Label" || name == "NumberOfPixels" || name == "PhysicalSize"
+      || name == "Perimeter" || name == "NumberOfPixelsOnBorder"
+      || name == "PerimeterOnBorder" || name == "PerimeterOnBorderRatio"
+      || name == "Elongation" || name == "Flatness" || name == "Roundness"
+      || name == "EquivalentSphericalRadius"
+      || name == "EquivalentSphericalPerimeter" || name == "FeretDiameter";
+  }
+
+bool IsCountAttribute(const std::string & name)
+  {
+  return name == "Label" || name == "NumberOfPixels"
+      || name == "NumberOfPixelsOnBorder";
+  }
+
+double GetAttributeValue(const ShapeLabelObjectType* labelObject,
+                         const ReportColumn & column)
+  {
+  const std::string & a = column.Attribute;
+  if (a == "Label") return labelObject->GetLabel();
+  if (a == "NumberOfPixels") return labelObject->GetNumberOfPixels();
+  if (a == "PhysicalSize") return labelObject->GetPhysicalSize();
+  if (a == "Perimeter") return labelObject->GetPerimeter();
+  if (a == "NumberOfPixelsOnBorder")
+    return labelObject->GetNumberOfPixelsOnBorder();
+  if (a == "PerimeterOnBorder") return labelObject->GetPerimeterOnBorder();
+  if (a == "PerimeterOnBorderRatio")
+    return labelObject->GetPerimeterOnBorderRatio();
+  if (a == "Elongation") return labelObject->GetElongation();
+  if (a == "Flatness") return labelObject->GetFlatness();
+  if (a == "Roundness") return labelObject->GetRoundness();
+  if (a == "EquivalentSphericalRadius")
+    return labelObject->GetEquivalentSphericalRadius();
+  if (a == "EquivalentSphericalPerimeter")
+    return labelObject->GetEquivalentSphericalPerimeter();
+  if (a == "FeretDiameter") return labelObject->GetFeretDiameter();
+  if (a == "Centroid") return labelObject->GetCentroid()[column.Component];
+  if (a == "EquivalentEllipsoidDiameter")
+    return labelObject->GetEquivalentEllipsoidDiameter()[column.Component];
+  if (a == "PrincipalMoments")
+    return labelObject->GetPrincipalMoments()[column.Component];
+  return 0;
+  }
+
+/*
+ * The report cascade-property-filter printed for -o - before --report: the
+ * default stream precision and ", " between the columns.
+ */
+void WriteLegacyReport(ShapeLabelMapType* shapeLabel,
+                       const std::vector< ReportColumn > & columns)
+  {
+  for (size_t c = 0; c < columns.size(); c++)
+    std::cout << (c ? ", " : "") << columns[c].Name;
+  std::cout << std::endl;
+
+  ShapeLabelMapType::Iterator shapeIterator(shapeLabel);
+  while (!shapeIterator.IsAtEnd())
+    {
+    const ShapeLabelObjectType* labelObject = shapeIterator.GetLabelObject();
+    for (size_t c = 0; c < columns.size(); c++)
+      {
+      const double value = GetAttributeValue(labelObject, columns[c]);
+      std::cout << (c ? ", " : "");
+      /** Counts were printed as integers whatever their size */
+      if (IsCountAttribute(columns[c].Attribute))
+        std::cout << static_cast< itk::SizeValueType >(value);
+      else
+        std::cout << value;
+      }
+    std::cout << std::endl;
+    ++shapeIterator;
+    }
+  }
+
+/*
+ * Parse a comma separated list of attributes. Vector attributes e.g.
+ * Centroid are expanded to one column per dimension.
+ */
+std::vector< ReportColumn > ParseReportColumns(const std::string & list)
+  {
+  std::vector< ReportColumn > columns;
+  std::istringstream stream(list);
+  std::string name;
+  while (std::getline(stream, name, ','))
+    {
+    if (name.empty()) continue;
+    ReportColumn column;
+    column.Attribute = name;
+    column.Component = 0;
+    if (IsScalarAttribute(name))
+      {
+      column.Name = name;
+      columns.push_back(column);
+      }
+    else if (IsVectorAttribute(name))
+      {
+      for (unsigned int i = 0; i < DIM; i++)
+        {
+        std::ostringstream columnName;
+        columnName << name << "[" << i << "]";
+        column.Name = columnName.str();
+        column.Component = i;
+        columns.push_back(column);
+        }
+      }
+    else
+      {
+      itkGenericExceptionMacro("Unknown attribute: " << name);
+      }
+    }
+  return columns;
+  }
+
 int main(int argc, char *argv[])
   {
   TCLAP::CmdLine cmd(
       "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Image intensity range controller " BUILDINFO,
       ' ', CASCADE_VERSION);
 
-  TCLAP::ValueArg< std::string > outfile("o", "out", "Output filename", false,
-                                         "out.nii.gz", "string", cmd);
+  TCLAP::ValueArg< std::string > outfile(
+      "o", "out",
+      "Output filename. '-' only writes the report to stdout, in the "
+      "legacy format unless --format is given.",
+      false, "out.nii.gz", "string", cmd);
+
+  TCLAP::ValueArg< std::string > reportfile(
+      "", "report", "Per lesion report filename, '-' for stdout.", false, "",
+      "string", cmd);
+
+  std::vector< std::string > allowedFormat;
+  allowedFormat.push_back("csv");
+  allowedFormat.push_back("binary");
+  TCLAP::ValuesConstraint< std::string > allowedFormatVals(allowedFormat);
+  TCLAP::ValueArg< std::string > reportFormat("", "format", "Report format.",
+                                              false, "csv", &allowedFormatVals,
+                                              cmd);
+
+  TCLAP::ValueArg< std::string > attributes(
+      "", "attributes",
+      "Comma separated attributes to report. Besides the filter properties "
+      "Label, Centroid and PrincipalMoments are available.",
+      false, defaultAttributes, "list", cmd);
 
   TCLAP::SwitchArg reverseSwitch("r", "reverse", "Threshold backwards", cmd,
                                  false);
@@ -104,6 +262,16 @@ int main(int argc, char *argv[])
                                        "Input sequences e.g. MPRAGE.nii.gz",
                                        true, "", "string", cmd);
 
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
   /*
    * Parse the argv array.
    */
@@ -120,27 +288,42 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
     }
 
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
   /*
    * Argument and setting up the pipeline
    */
   try
     {
-    const PixelType thrVal = 0;
     const PixelType foreground = 1;
 
+    const bool writeImage = outfile.getValue() != "-";
+    std::string reportFilename = reportfile.getValue();
+    /** -o - alone keeps printing the report as it always did */
+    const bool legacyReport = !writeImage && reportFilename.empty()
+        && !reportFormat.isSet();
+    if (!writeImage && reportFilename.empty())
+      {
+      reportFilename = "-";
+      }
+    const std::vector< ReportColumn > columns = ParseReportColumns(
+        attributes.getValue());
+
+    bool computeFeretDiameter = property.getValue() == "FeretDiameter";
+    for (size_t c = 0; c < columns.size(); c++)
+      computeFeretDiameter |= columns[c].Attribute == "FeretDiameter";
+
     ImageType::Pointer inputIMage = cascade::util::LoadImage< ImageType >(
         input.getValue());
-    BinaryThresholdImageFilterType::Pointer thresholdFilter =
-        BinaryThresholdImageFilterType::New();
-    thresholdFilter->SetInput(inputIMage);
-    thresholdFilter->SetLowerThreshold(thrVal);
-    thresholdFilter->SetInsideValue(foreground);
-    thresholdFilter->SetOutsideValue(thrVal);
 
     BinaryImageToShapeLabelMapFilterType::Pointer binaryImageToShapeLabelMapFilter =
         BinaryImageToShapeLabelMapFilterType::New();
     binaryImageToShapeLabelMapFilter->FullyConnectedOn();
     binaryImageToShapeLabelMapFilter->SetInputForegroundValue(foreground);
+    binaryImageToShapeLabelMapFilter->SetComputeFeretDiameter(
+        computeFeretDiameter);
     binaryImageToShapeLabelMapFilter->SetInput(inputIMage);
     binaryImageToShapeLabelMapFilter->Update();
 
@@ -153,59 +336,65 @@ int main(int argc, char *argv[])
     shapeOpeningLabelMapFilter->SetAttribute(property.getValue());
     shapeOpeningLabelMapFilter->Update();
 
+    ShapeLabelMapType* shapeLabel = shapeOpeningLabelMapFilter->GetOutput();
+
     /** Statistics on image should be reported */
-    if (outfile.getValue() == "-")
+    if (legacyReport)
       {
-      std::cout << "NumberOfPixels" << ", ";
-      std::cout << "PhysicalSize" << ", ";
-      std::cout << "Perimeter" << ", ";
-      std::cout << "Elongation" << ", ";
-      std::cout << "Roundness" << ", ";
-      for (int i = 0; i < DIM; i++)
-        std::cout << "Centroid[" << i << "], ";
-
-      std::cout << "EquivalentSphericalRadius" << ", ";
-      std::cout << "EquivalentSphericalPerimeter";
-      std::cout << std::endl;
-
-      ShapeLabelMapType* shapeLabel =
-          shapeOpeningLabelMapFilter->GetOutput();
+      WriteLegacyReport(shapeLabel, columns);
+      }
+    else if (!reportFilename.empty())
+      {
+      cascade::util::ReportWriter::FormatType format;
+      cascade::util::ReportWriter::ParseFormat(reportFormat.getValue(),
+                                               format);
+      std::vector< std::string > columnNames;
+      for (size_t c = 0; c < columns.size(); c++)
+        columnNames.push_back(columns[c].Name);
+      cascade::util::ReportWriter report(reportFilename, format, columnNames);
+
+      std::vector< double > row(columns.size());
       ShapeLabelMapType::Iterator shapeIterator(shapeLabel);
       while (!shapeIterator.IsAtEnd())
         {
-        ShapeLabelMapType::LabelObjectType* labelObject =
+        const ShapeLabelObjectType* labelObject =
             shapeIterator.GetLabelObject();
-        std::cout << labelObject->GetNumberOfPixels() << ", ";
-        std::cout << labelObject->GetPhysicalSize() << ", ";
-        std::cout << labelObject->GetPerimeter() << ", ";
-        std::cout << labelObject->GetElongation() << ", ";
-        std::cout << labelObject->GetRoundness() << ", ";
-
-        for (int i = 0; i < DIM; i++)
-          std::cout << labelObject->GetCentroid()[i] << ", ";
-
-        std::cout << labelObject->GetEquivalentSphericalRadius() << ", ";
-        std::cout << labelObject->GetEquivalentSphericalPerimeter();
-        std::cout << std::endl;
+        for (size_t c = 0; c < columns.size(); c++)
+          row[c] = GetAttributeValue(labelObject, columns[c]);
+        report.AddRow(row);
         ++shapeIterator;
         }
+      report.Close();
       }
-    else
-      {
 
-      LabelMapToLabelImageFilterType::Pointer labelMapToLabelImageFilter =
-          LabelMapToLabelImageFilterType::New();
-      labelMapToLabelImageFilter->SetInput(
-          shapeOpeningLabelMapFilter->GetOutput());
-      labelMapToLabelImageFilter->Update();
+    /**
+     * The remaining objects are painted straight from their run-length lines
+     * so the label map does not need to be relabeled and thresholded.
+     */
+    if (writeImage)
+      {
+      ImageType::Pointer outputImage = ImageType::New();
+      outputImage->CopyInformation(shapeLabel);
+      outputImage->SetRegions(shapeLabel->GetLargestPossibleRegion());
+      outputImage->Allocate();
+      outputImage->FillBuffer(itk::NumericTraits< PixelType >::Zero);
 
-      thresholdFilter->SetInput(labelMapToLabelImageFilter->GetOutput());
-      thresholdFilter->SetLowerThreshold(thrVal + 1);
-      thresholdFilter->SetInsideValue(foreground);
-      thresholdFilter->SetOutsideValue(thrVal);
+      ShapeLabelMapType::Iterator shapeIterator(shapeLabel);
+      while (!shapeIterator.IsAtEnd())
+        {
+        const ShapeLabelObjectType* labelObject =
+            shapeIterator.GetLabelObject();
+        for (itk::SizeValueType l = 0; l < labelObject->GetNumberOfLines(); l++)
+          {
+          const ShapeLabelObjectType::LineType & line = labelObject->GetLine(l);
+          PixelType* pixel = &outputImage->GetPixel(line.GetIndex());
+          std::fill(pixel, pixel + line.GetLength(), foreground);
+          }
+        ++shapeIterator;
+        }
 
       WriterType::Pointer writer = WriterType::New();
-      writer->SetInput(thresholdFilter->GetOutput());
+      writer->SetInput(outputImage);
       writer->SetFileName(outfile.getValue());
       writer->Update();
       }
@@ -23,50 +23,42 @@
  * General ITK
  */
 #include "itkImage.h"
-/*
- * ITK Filters
- */
-#include "itkCastImageFilter.h"
-#include "itkBilateralImageFilter.h"
-#include "itkMaskImageFilter.h"
-#include "itkBinaryThresholdImageFilter.h"
 /*
  * Others
  */
-#include "pipeline/itkSliceNormalizerPipeline.h"
-#include "pipeline/itkN4Pipeline.h"
-#include "pipeline/itkRobustOutlierPipeline.h"
-#include "pipeline/itkIntensityNormalizerPipeline.h"
+#include "stage/rangeStage.h"
 
 #include "util/helpers.h"
+#include "util/batch.h"
+#include "util/profiler.h"
+#include "util/threading.h"
 #include "3rdparty/tclap/CmdLine.h"
 
-/*
- * Pixel types
- */
-typedef unsigned int InputPixelType;
-typedef float OutputPixelType;
-typedef float InterimPixelType;
-typedef char MaskPixelType;
-/*
- * Image types
- */
-typedef itk::Image< InputPixelType, DIM > InputImageType;
-typedef itk::Image< OutputPixelType, DIM > OutputImageType;
-typedef itk::Image< MaskPixelType, DIM > MaskImageType;
-
-typedef itk::Image< InterimPixelType, DIM > InterimImageType;
-typedef itk::Image< InterimPixelType, SLICEDIM > InterimSliceType;
-
-typedef itk::CastImageFilter< InputImageType, InterimImageType > CastToInterimType;
-typedef itk::CastImageFilter< InterimImageType, OutputImageType > CastToOutputType;
+typedef cascade::stage::RangeStage RangeStageType;
+typedef cascade::stage::RangeSettings RangeSettings;
 
-typedef itk::SliceNormalizerPipeline< InterimImageType, InterimImageType, MaskImageType > SliceNormalizerType;
-typedef itk::IntensityNormalizerPipeline< InterimImageType, InterimImageType, MaskImageType > IntensityNormalizerType;
+void RangeImage(const std::string & inputFile, const std::string & maskFile,
+                const std::string & outputFile, const RangeSettings & settings)
+  {
+  cascade::util::WriteImage(
+      outputFile,
+      RangeStageType::Process(
+          cascade::util::LoadImage< RangeStageType::InputImageType >(
+              inputFile),
+          cascade::util::LoadImage< RangeStageType::MaskImageType >(
+              maskFile.empty() ? inputFile : maskFile),
+          settings).GetPointer());
+  }
 
-typedef itk::BinaryThresholdImageFilter< MaskImageType, MaskImageType > BinaryThresholdImageFilterType;
-typedef itk::N4Pipeline< InterimImageType, InterimImageType > N4PipelineType;
-typedef itk::MaskImageFilter< InterimImageType, InterimImageType > MaskFilterType;
+/*
+ * Manifest rows are "input mask output", a mask of "-" uses the input as
+ * mask.
+ */
+void RangeJob(const cascade::util::ManifestRow & row, void* userData)
+  {
+  const RangeSettings & settings = *static_cast< RangeSettings* >(userData);
+  RangeImage(row[0], row[1] == "-" ? "" : row[1], row[2], settings);
+  }
 
 int main(int argc, char *argv[])
   {
@@ -87,9 +79,30 @@ int main(int argc, char *argv[])
                                       "Mask sequences e.g. mask.nii.gz", false,
                                       "", "string", cmd);
 
+  TCLAP::ValueArg< unsigned int > jobs(
+      "j", "jobs", "Number of images processed at the same time in batch mode",
+      false, 2, "Integer", cmd);
+
   TCLAP::ValueArg< std::string > input("i", "input",
                                        "Input sequences e.g. MPRAGE.nii.gz",
-                                       true, "", "string", cmd);
+                                       true, "", "string");
+
+  TCLAP::ValueArg< std::string > batch(
+      "", "batch",
+      "Manifest with one \"input mask output\" per line, '-' for no mask. "
+      "Other options apply to all the images.",
+      true, "", "string");
+  cmd.xorAdd(input, batch);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
 
   /*
    * Parse the argv array.
@@ -107,63 +120,34 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
     }
 
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
   /*
    * Argument and setting up the pipeline
    */
   try
     {
-    BinaryThresholdImageFilterType::Pointer thresholdFilter =
-        BinaryThresholdImageFilterType::New();
+    RangeSettings settings;
+    settings.Bins = bins.getValue();
+    settings.Scale = scaleSwitch.getValue();
 
-    if (mask.isSet())
+    if (batch.isSet())
       {
-      thresholdFilter->SetInput(
-          cascade::util::LoadImage< MaskImageType >(mask.getValue()));
+      const cascade::util::ManifestType manifest =
+          cascade::util::ReadManifest(batch.getValue(), 3, 3);
+      if (cascade::util::RunBatch(manifest, RangeJob, &settings,
+                                  jobs.getValue()))
+        {
+        return EXIT_FAILURE;
+        }
       }
     else
       {
-      thresholdFilter->SetInput(
-          cascade::util::LoadImage< MaskImageType >(input.getValue()));
-      }
-
-    thresholdFilter->SetLowerThreshold(1);
-
-    CastToInterimType::Pointer castToInterim = CastToInterimType::New();
-    castToInterim->SetInput(
-        cascade::util::LoadImage< InputImageType >(input.getValue()));
-
-    SliceNormalizerType::Pointer sliceNormalizer = SliceNormalizerType::New();
-    sliceNormalizer->SetInput(castToInterim->GetOutput());
-    sliceNormalizer->SetMaskImage(thresholdFilter->GetOutput());
-    sliceNormalizer->SetMaskValue(thresholdFilter->GetInsideValue());
-    sliceNormalizer->SetNumberOfLevels(bins.getValue());
-
-    N4PipelineType::Pointer n4Corrector = N4PipelineType::New();
-    n4Corrector->SetInput(sliceNormalizer->GetOutput());
-    n4Corrector->Update();
-
-    IntensityNormalizerType::Pointer intensityNormalizer =
-        IntensityNormalizerType::New();
-
-    MaskFilterType::Pointer maskFilter = MaskFilterType::New();
-    maskFilter->SetMaskImage(castToInterim->GetOutput());
-
-    if(scaleSwitch.getValue())
-      {
-      intensityNormalizer->SetInput(n4Corrector->GetOutput());
-      intensityNormalizer->SetMaskImage(thresholdFilter->GetOutput());
-      intensityNormalizer->SetMaskValue(thresholdFilter->GetInsideValue());
-      intensityNormalizer->SetNumberOfLevels(bins.getValue());
-
-      maskFilter->SetInput(intensityNormalizer->GetOutput());
-      }else{
-        maskFilter->SetInput(n4Corrector->GetOutput());
+      RangeImage(input.getValue(), mask.getValue(), outfile.getValue(),
+                 settings);
       }
-    CastToOutputType::Pointer castToOutput = CastToOutputType::New();
-    castToOutput->SetInput(maskFilter->GetOutput());
-    castToOutput->Update();
-
-    cascade::util::WriteImage(outfile.getValue(), castToOutput->GetOutput());
     }
   catch (itk::ExceptionObject & err)
     {
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <cstdlib>
+#include <iostream>
+#include <string>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+/*
+ * Others
+ */
+#include "stage/stage.h"
+#include "stage/plan.h"
+
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Run the stages of a subject in one process " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::SwitchArg verbose("v", "verbose", "Report the time of every stage",
+                           cmd, false);
+
+  TCLAP::ValueArg< std::string > plan(
+      "p", "plan",
+      "Plan with one \"input slot file\", \"output slot file\" or "
+      "\"stage key=value ...\" per line",
+      true, "", "string", cmd);
+
+  const char* cacheDirectory = std::getenv("CASCADE_CACHE_DIR");
+  TCLAP::ValueArg< std::string > cache(
+      "c", "cache",
+      "Directory to keep the outputs of the stages in and reuse them when "
+      "nothing they depend on has changed (default $CASCADE_CACHE_DIR)",
+      false, cacheDirectory ? cacheDirectory : "", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    cascade::stage::Context context;
+    cascade::stage::Graph graph;
+    cascade::stage::ReadPlan(plan.getValue(), context, graph);
+    std::ostream* log = verbose.getValue() ? &std::cout : 0;
+    if (cache.getValue().empty())
+      {
+      graph.Run(context, log);
+      }
+    else
+      {
+      cascade::stage::StageCache stageCache(cache.getValue());
+      graph.Run(context, log, &stageCache);
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
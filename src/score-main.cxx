@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <string>
+#include <vector>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+/*
+ * Others
+ */
+#include "stage/scoreStage.h"
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+typedef cascade::stage::ImageType ImageType;
+typedef cascade::stage::ScoreStage::ScoreFilterType ScoreFilterType;
+
+ImageType::Pointer LoadIfSet(const TCLAP::ValueArg< std::string > & filename)
+  {
+  ImageType::Pointer image;
+  if (filename.isSet())
+    {
+    image = cascade::util::LoadImage< ImageType >(filename.getValue());
+    }
+  return image;
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Normal brain model and z-score " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > stdOut("", "model-std",
+                                        "Model standard deviation output",
+                                        false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > meanOut("", "model-mean", "Model mean output",
+                                         false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > outfile("o", "out", "Output z-score", true,
+                                         "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > previous(
+      "", "previous",
+      "Score of the previous sequences, the output is the maximum of both",
+      false, "", "string", cmd);
+
+  TCLAP::ValueArg< float > meanPercentile(
+      "", "mean-percentile",
+      "Minimum model mean as a percentile of the reference class", false, 20,
+      "Float", cmd);
+  TCLAP::ValueArg< int > reference(
+      "", "reference",
+      "Class whose non-zero voxels give the minimum mean and stddev", false, 3,
+      "Integer", cmd);
+  TCLAP::MultiArg< int > classes("c", "class",
+                                 "Class label in the tissue image (2 and 3)",
+                                 false, "Integer", cmd);
+  TCLAP::SwitchArg absoluteSwitch("a", "absolute",
+                                  "FSL warp field uses absolute convention",
+                                  cmd, false);
+  TCLAP::ValueArg< std::string > space(
+      "", "space",
+      "Image the model side of an FSL transform refers to, the model grid by default",
+      false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > transformFile(
+      "", "transform",
+      "Transform from model to range space: FSL matrix (.mat), FSL warp field (.nii.gz, convertwarp --relout) or ITK transform file",
+      false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > sequence(
+      "q", "sequence", "Sequence name in the model e.g. flair", false, "",
+      "string", cmd);
+  TCLAP::ValueArg< std::string > model(
+      "", "model", "Packed model (.cms) evaluated in range space", false, "",
+      "string", cmd);
+  TCLAP::ValueArg< std::string > state(
+      "s", "state",
+      "Native state prefix, <prefix>_<class>_{number,mean,stddev}.nii.gz",
+      false, "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > mask("m", "mask", "Score mask e.g. WMGM",
+                                      false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > pve("p", "pve", "Tissue types e.g. pve",
+                                     true, "", "string", cmd);
+  std::vector< std::string > allowedTypes;
+  allowedTypes.push_back("light");
+  allowedTypes.push_back("dark");
+  allowedTypes.push_back("other");
+  TCLAP::ValuesConstraint< std::string > allowedTypesConstraint(allowedTypes);
+  TCLAP::ValueArg< std::string > type("t", "type", "Type of WML in the sequence",
+                                      false, "other", &allowedTypesConstraint,
+                                      cmd);
+  TCLAP::ValueArg< std::string > range("r", "range",
+                                       "Sequence in range space", true, "",
+                                       "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    cascade::stage::ScoreSettings settings;
+    settings.Type = type.getValue();
+    settings.Reference = reference.getValue();
+    settings.MeanPercentile = meanPercentile.getValue();
+    if (!classes.getValue().empty())
+      {
+      settings.Classes = classes.getValue();
+      }
+    settings.State = state.getValue();
+    settings.Model = model.getValue();
+    settings.Sequence = sequence.getValue();
+    settings.Transform = transformFile.getValue();
+    settings.Absolute = absoluteSwitch.getValue();
+
+    ScoreFilterType::Pointer scoreFilter =
+        cascade::stage::ScoreStage::Process(
+            cascade::util::LoadImage< ImageType >(range.getValue()),
+            cascade::util::LoadImage< ImageType >(pve.getValue()),
+            LoadIfSet(mask), LoadIfSet(previous), LoadIfSet(space),
+            settings);
+
+    cascade::util::WriteImage(outfile.getValue(), scoreFilter->GetScoreOutput());
+    if (meanOut.isSet())
+      {
+      cascade::util::WriteImage(meanOut.getValue(),
+                                scoreFilter->GetMeanOutput());
+      }
+    if (stdOut.isSet())
+      {
+      cascade::util::WriteImage(stdOut.getValue(),
+                                scoreFilter->GetStandardDeviationOutput());
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
@@ -0,0 +1,170 @@
+#! /bin/bash
+#  Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+#  You may use and distribute, but not modify this code under the terms of the
+#  Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+#  under the following conditions:
+#
+#  Attribution — You must attribute the work in the manner specified by the
+#  author or licensor (but not in any way that suggests that they endorse you
+#  or your use of the work).
+#  Noncommercial — You may not use this work for commercial purposes.
+#  No Derivative Works — You may not alter, transform, or build upon this
+#  work
+#
+#  To view a copy of the license, visit
+#  http://creativecommons.org/licenses/by-nc-nd/3.0/
+#  
+
+usage()
+{
+cat << EOF
+${bold}usage${normal}: $0 options
+
+This script benchmarks the native stages of the Cascade pipeline end to end
+on synthetic phantoms made from the standard tissue maps. Every stage is run
+with --profile and its throughput and peak memory are reported per voxel
+size.
+
+${bold}OPTIONS$normal:
+   -h      Show this message
+   -s      Voxel sizes in mm (default "2 1.5 1")
+   -o      Results as tab separated values (default stdout)
+   -k      Keep the phantoms and profiles in this directory
+   -l      Show license
+   
+EOF
+}
+
+source $(cd $(dirname "${BASH_SOURCE[0]}") && pwd -P )/cascade-setup.sh
+
+SPACINGS="2 1.5 1"
+RESULT_FILE=
+WORK_DIR=${SAFE_TMP_DIR}
+
+while getopts “hs:o:k:l” OPTION
+do
+  case $OPTION in
+    s)
+      SPACINGS=$OPTARG
+      ;;
+    o)
+      RESULT_FILE=$OPTARG
+      ;;
+    k)
+      mkdir -p "$OPTARG"
+      WORK_DIR=$(cd "$OPTARG" && pwd -P )
+      ;;
+## Help and license      
+    l)
+      cascade_copyright
+      cascade_license
+      exit 1
+      ;;
+    h)
+      usage
+      exit 1
+      ;;
+    ?)
+      usage
+      exit
+      ;;
+  esac
+done
+
+for ce in cascade-{phantom,info,tissue,range,transform,train,score,statistics-filter,property-filter}
+do
+  if [ ! -x $CASCADEDIR/$ce ]
+  then
+    echo_fatal "Cascade executable ${underline}${ce}${normal} is not available. Please check your Cascade installation."
+  fi
+done
+
+SEQUENCES="flair t1 t2 pd"
+
+# Number of voxels of an image, from the size column of cascade-info
+voxels()
+{
+  ${CASCADEDIR}/cascade-info $1 | awk -F'\t' 'NR==2{n=split($5,s,","); v=1; for(i=1;i<=n;i++) v*=s[i]; print v}'
+}
+
+# Runs a cascade tool with --profile and appends a row for it to the results
+bench()
+{
+  local stage=$1
+  local profile=${PHANTOM_DIR}/${stage}.json
+  shift
+  runname "    ${stage}"
+  "$@" --profile ${profile} > ${PHANTOM_DIR}/${stage}.stdout
+  local status=$?
+  rundone $status
+  [ $status -eq 0 ] || echo_fatal "Unable to run ${stage}."
+
+  local wall=$(sed -n 's/.*"stage": "total".*"wall_seconds": \([0-9.]*\).*/\1/p' ${profile})
+  local cpu=$(sed -n 's/.*"stage": "total".*"cpu_seconds": \([0-9.]*\).*/\1/p' ${profile})
+  local peak=$(sed -n 's/.*"peak_rss_kb": \([0-9]*\).*/\1/p' ${profile})
+  local throughput=$(awk -v n=$VOXELS -v t=$wall 'BEGIN{printf "%.0f", t > 0 ? n / t : 0}')
+  printf "%s\t%s\t%s\t%s\t%s\t%s\t%s\n" $SPACING $stage $VOXELS $wall $cpu \
+    $throughput $peak >> ${RESULTS}
+}
+
+RESULTS=${WORK_DIR}/results.tsv
+printf "spacing\tstage\tvoxels\twall_seconds\tcpu_seconds\tvoxels_per_second\tpeak_rss_kb\n" > ${RESULTS}
+
+for SPACING in $SPACINGS
+do
+  echo -e "${header_format}Phantom at ${SPACING}mm${normal}"
+  PHANTOM_DIR=${WORK_DIR}/phantom_${SPACING}
+  mkdir -p ${PHANTOM_DIR}
+  P=${PHANTOM_DIR}/
+
+  # The phantom itself is not benchmarked, the voxel count is known after it
+  runname "    phantom"
+  ${CASCADEDIR}/cascade-phantom --white ${STANDARD_ROOT}/white.nii.gz \
+    --gray ${STANDARD_ROOT}/gray.nii.gz --csf ${STANDARD_ROOT}/csf.nii.gz \
+    --spacing ${SPACING} --out ${P}
+  rundone $? || echo_fatal "Unable to create the phantom at ${SPACING}mm."
+  VOXELS=$(voxels ${P}brain_flair.nii.gz)
+
+  bench tissue ${CASCADEDIR}/cascade-tissue --csf-pve ${P}csf.nii.gz \
+    --gm-pve ${P}gray.nii.gz --wm-pve ${P}white.nii.gz --pve ${P}pve.nii.gz \
+    --wmgm ${P}wmgm.nii.gz
+
+  TRAIN_ARGS=()
+  for seq in $SEQUENCES
+  do
+    bench range-${seq} ${CASCADEDIR}/cascade-range -i ${P}brain_${seq}.nii.gz \
+      -m ${P}wmgm.nii.gz --no-scale -o ${P}range_${seq}.nii.gz
+    bench transform-${seq} ${CASCADEDIR}/cascade-transform \
+      -i ${P}range_${seq}.nii.gz -m ${P}wmgm.nii.gz \
+      --target-hist ${HIST_ROOT}/brain_${seq}.hist -o ${P}normal_${seq}.nii.gz
+    TRAIN_ARGS+=(--image ${P}normal_${seq}.nii.gz --sequence ${seq})
+  done
+
+  bench train ${CASCADEDIR}/cascade-train --pve ${P}pve.nii.gz "${TRAIN_ARGS[@]}" \
+    --class 2 --class 3 --exclude ${P}lesion.nii.gz --out ${P}model.cms
+
+  PREVIOUS_ARGS=()
+  for seq in $SEQUENCES
+  do
+    bench score-${seq} ${CASCADEDIR}/cascade-score \
+      --range ${P}normal_${seq}.nii.gz --pve ${P}pve.nii.gz \
+      --mask ${P}wmgm.nii.gz --model ${P}model.cms --sequence ${seq} \
+      --type $(sequence_type brain_${seq}.nii.gz) "${PREVIOUS_ARGS[@]}" \
+      --out ${P}z_${seq}.nii.gz
+    PREVIOUS_ARGS=(--previous ${P}z_${seq}.nii.gz)
+  done
+
+  bench statistics-filter ${CASCADEDIR}/cascade-statistics-filter \
+    -i ${P}z_${seq}.nii.gz --bin-threshold 1.5 --property Maximum \
+    --threshold 4 -o ${P}likelihood.nii.gz
+  bench property-filter ${CASCADEDIR}/cascade-property-filter \
+    -i ${P}likelihood.nii.gz --property NumberOfPixels --threshold 10 \
+    -o ${P}lesions.nii.gz
+done
+
+if [ -n "$RESULT_FILE" ]
+then
+  cp ${RESULTS} "$RESULT_FILE"
+else
+  cat ${RESULTS}
+fi
@@ -11,6 +11,7 @@ TRG_INTENSITY=($(cut -d ' ' -f1 $TRG_HISTOGRAM))
 TRG_PERCENTILE=($(cut -d ' ' -f4 $TRG_HISTOGRAM))
 
 j=0
+> $OUTFILE
 for i in "${!SRC_INTENSITY[@]}"; do 
   FROM_INT=${SRC_INTENSITY[$i]}
   PERC=${SRC_PERCENTILE[$i]}
@@ -41,5 +42,5 @@ for i in "${!SRC_INTENSITY[@]}"; do
 	  INTERPOLATION="( $INT_HI - $INT_LO )/( $PERC_HI - $PERC_LO ) * ( $PERC - $PERC_LO ) + $INT_LO"
   fi  
   TO_INT=$(bc -l <<< "a=$INTERPOLATION;if(a>0) a else 0" )
-	echo "$PERC $FROM_INT $TO_INT" > $OUTFILE
+	echo "$PERC $FROM_INT $TO_INT" >> $OUTFILE
 done
\ No newline at end of file
@@ -37,26 +37,7 @@ do
   
   if ! [ -s $HISTOGRAM_FILE ]
   then
-    MASK_FOR_HISTOGRAM=${SAFE_TMP_DIR}/mask_for_histogram.nii.gz
-	  [ ! -s $MASK_FOR_HISTOGRAM ] && ${FSLPREFIX}fslmaths ${BRAIN_WMGM} -kernel -sphere 2 -mas ${IMAGEROOT}/${images_dir}/${IMGNAME} -bin $MASK_FOR_HISTOGRAM
-		MASK_OPTIONS="-k $MASK_FOR_HISTOGRAM"
-		
-		this_maximum=$(${FSLPREFIX}fslstats ${IMAGEROOT}/${images_dir}/${IMGNAME} -P 95 )
-		this_histogram=$(${FSLPREFIX}fslstats ${IMAGEROOT}/${images_dir}/${IMGNAME} $MASK_OPTIONS -H $NBIN 0 ${this_maximum} )
-		
-		this_total=$(echo $this_histogram | sed -e 's/^ *//g' -e 's/ *$//g' -e 's/  */+/g' | bc)
-		
-		i=0;this_cum=0
-		> $HISTOGRAM_FILE
-		for elem in $this_histogram
-		do
-		  this_elem=$(bc -l <<< "$elem / ${this_total}" )
-		  this_cum=$(bc -l <<< "$this_cum + $this_elem" )
-		  this_bin=$(bc -l <<< "($i + 0.5) * ${this_maximum} / $NBIN " )
-		     
-		  echo $i $this_bin $this_elem $this_cum >> $HISTOGRAM_FILE
-		  i=$(( $i + 1 ))
-		done
+    ${CASCADEDIR}/cascade-histogram --input ${IMAGEROOT}/${images_dir}/${IMGNAME} --mask ${BRAIN_WMGM} --bins $NBIN --percentile 95 --out $HISTOGRAM_FILE
   fi
 done
 )
@@ -41,107 +41,32 @@ done
 
 echo "${bold}Calculating heuristics${normal}"
 
-${FSLPREFIX}fslmaths ${T1_BRAIN} -bin $HYP_MASK
-
-
 WM_IMAGE=${IMAGEROOT}/${temp_dir}/brain_pve_2.nii.gz
 GM_IMAGE=${IMAGEROOT}/${temp_dir}/brain_pve_1.nii.gz
+HYP_ARGS=()
 
 # If we already refined the brain tissue we can have a better guess
 [ -s "${BRAIN_WM}" ] && WM_IMAGE=${BRAIN_WM}
 [ -s "${BRAIN_GM}" ] && GM_IMAGE=${BRAIN_GM}
 
-if [ -s "$FLAIR_BRAIN" ]
-then
-  runname "    Heuristic: Should be light FLAIR"
-  (
-    set -e
-    flair_thresh=$(${FSLPREFIX}fslstats $FLAIR_BRAIN -k ${WM_IMAGE} -P 80)
-    ${FSLPREFIX}fslmaths $FLAIR_BRAIN -thr $flair_thresh -add ${GM_IMAGE} -mul $HYP_MASK -bin $HYP_MASK
-    flair_thresh=$(${FSLPREFIX}fslstats $FLAIR_BRAIN -k ${GM_IMAGE} -P 90)
-    ${FSLPREFIX}fslmaths $FLAIR_BRAIN -thr $flair_thresh -add ${WM_IMAGE} -mul $HYP_MASK -bin $HYP_MASK
-  )
-  if [ $? -eq 0 ]
-  then
-    rundone 0
-  else
-    rundone 1
-    rm "$HYP_MASK"  >/dev/null 2>&1
-    echo_fatal "Unable to process. Please try again."
-  fi
-fi
-
-if [ -s "$T2_BRAIN" ]
-then
-  runname "    Heuristic: Should be light T2"
-  (
-    set -e
-    t2_thresh=$(${FSLPREFIX}fslstats $T2_BRAIN -k ${WM_IMAGE} -P 80)
-    ${FSLPREFIX}fslmaths $T2_BRAIN -thr $t2_thresh -add ${GM_IMAGE} -mul $HYP_MASK -bin $HYP_MASK
-    t2_thresh=$(${FSLPREFIX}fslstats $T2_BRAIN -k ${GM_IMAGE} -P 90)
-    ${FSLPREFIX}fslmaths $T2_BRAIN -thr $t2_thresh -add ${WM_IMAGE} -mul $HYP_MASK -bin $HYP_MASK
-  )
-  if [ $? -eq 0 ]
-  then
-    rundone 0
-  else
-    rundone 1
-    rm "$HYP_MASK"  >/dev/null 2>&1
-    echo_fatal "Unable to process. Please try again."
-  fi
-fi
-
-if [ -s "$T1_BRAIN" ]
-then
-  runname "    Heuristic: Not bright on T1"
-  (
-    set -e
-    t1_thresh=$(${FSLPREFIX}fslstats $T1_BRAIN -k ${WM_IMAGE} -P 80)
-    ${FSLPREFIX}fslmaths $T1_BRAIN -uthr $t1_thresh -bin -mul $HYP_MASK -bin $HYP_MASK
-  )
-  if [ $? -eq 0 ]
-  then
-    rundone 0
-  else
-    rundone 1
-    rm "$HYP_MASK"  >/dev/null 2>&1
-    echo_fatal "Unable to process. Please try again."
-  fi
-fi
-
-if [ -s "${BRAIN_WM}" ]
-then
-  runname "    Heuristic: Either WM or in the WM-GM boundary"
-  (
-    set -e
-    ${FSLPREFIX}fslmaths ${BRAIN_WM} -bin -kernel sphere 1 -dilF ${SAFE_TMP_DIR}/enlarged-wm.nii.gz
-    ${FSLPREFIX}fslmaths ${SAFE_TMP_DIR}/enlarged-wm.nii.gz -mul $HYP_MASK -bin $HYP_MASK
-  )
-  if [ $? -eq 0 ]
-  then
-    rundone 0
-  else
-    rundone 1
-    rm "$HYP_MASK"  >/dev/null 2>&1
-    echo_fatal "Unable to process. Please try again."
-  fi
-fi
+[ -s "$FLAIR_BRAIN" ] && HYP_ARGS+=(--flair "$FLAIR_BRAIN")
+[ -s "$T2_BRAIN" ] && HYP_ARGS+=(--t2 "$T2_BRAIN")
+# Either WM or in the WM-GM boundary
+[ -s "${BRAIN_WM}" ] && HYP_ARGS+=(--boundary --radius 1)
+# Not in CSF
+[ -s "${BRAIN_CSF}" ] && HYP_ARGS+=(--csf "${BRAIN_CSF}")
 
-if [ -s "${BRAIN_CSF}" ] 
+runname "    Heuristic: Light FLAIR and T2, not bright on T1"
+(
+  set -e
+  ${CASCADEDIR}/cascade-hyp --t1 ${T1_BRAIN} --wm ${WM_IMAGE} --gm ${GM_IMAGE} \
+    "${HYP_ARGS[@]}" --out $HYP_MASK
+)
+if [ $? -eq 0 ]
 then
-  runname "    Heuristic: Either Not in CSF"
-  (
-    set -e
-    ${FSLPREFIX}fslmaths ${BRAIN_CSF} -bin -mul -1 -add 1 -mul $HYP_MASK -bin $HYP_MASK
-  )
-  if [ $? -eq 0 ]
-  then
-    rundone 0
-  else
-    rundone 1
-    rm "$HYP_MASK"  >/dev/null 2>&1
-    echo_fatal "Unable to process. Please try again."
-  fi
+  rundone 0
+else
+  rundone 1
+  rm "$HYP_MASK"  >/dev/null 2>&1
+  echo_fatal "Unable to process. Please try again."
 fi
-
-
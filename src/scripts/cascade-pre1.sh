@@ -138,11 +138,13 @@ echo "${bold}The Cascade Pre-processing step 1${normal}"
 (
 set +e
 find  "${IMAGEROOT}" -empty -delete >/dev/null 2>&1
-for niiImage in $(find "${IMAGEROOT}" -name "*.nii.gz" 2>/dev/null)
-do
-  ${FSLPREFIX}fslinfo "$niiImage" >/dev/null 2>&1
-  [ $? -ne 0 ] && rm -rf "$niiImage" >/dev/null 2>&1
-done
+# Only headers and gzip trailers are read, files are checked in parallel
+find "${IMAGEROOT}" -name "*.nii.gz" -print0 2>/dev/null |
+  xargs -0 ${CASCADEDIR}/cascade-info --invalid |
+  while read -r badImage
+  do
+    rm -rf "$badImage" >/dev/null 2>&1
+  done
 )
 
 
@@ -72,21 +72,34 @@ set +e
 ALL_IMAGES=$(ls ${IMAGEROOT}/${images_dir}/brain_{flair,t1,t2,pd}.nii.gz 2>/dev/null)
 set -e
 
+# All the images are normalized by a single cascade-run, the range corrected
+# images are transformed in memory. With CASCADE_CACHE_DIR set the stage
+# cache decides what is recomputed instead of the modification times.
+NORMALIZE_PLAN=${SAFE_TMP_DIR}/normalize.plan
+echo "input wmgm ${BRAIN_WMGM}" > $NORMALIZE_PLAN
 for img in $ALL_IMAGES
 do
   ranged_img=$(range_image $img)
-  [ "$BASH_SOURCE" -nt "$ranged_img" ] || continue
+  [ -n "$CASCADE_CACHE_DIR" ] || [ "$BASH_SOURCE" -nt "$ranged_img" ] || continue
   
   img_type=$(basename $img .nii.gz)
-  transform_file=${IMAGEROOT}/${trans_dir}/${img_type}.trans
   histogram_file=${IMAGEROOT}/${trans_dir}/${img_type}.hist
   normal_histogram=${HIST_ROOT}/$(basename $histogram_file)
   
-  ${CASCADESCRIPT}/cascade-histogram-match.sh $histogram_file $normal_histogram $transform_file
-  
-  $CASCADEDIR/cascade-range --input ${img} --mask ${BRAIN_WMGM} --out ${ranged_img} --no-scale     
-  $CASCADEDIR/cascade-transform --input ${ranged_img} --transform ${transform_file} --out ${ranged_img}
+  cat >> $NORMALIZE_PLAN << EOF
+input ${img_type} ${img}
+input ${img_type}_hist ${histogram_file}
+input ${img_type}_target ${normal_histogram}
+output ${img_type}_ranged ${ranged_img}
+range input=${img_type} mask=wmgm out=${img_type}_range no-scale
+transform input=${img_type}_range target=${img_type}_target source=${img_type}_hist out=${img_type}_ranged
+EOF
 done
+
+if grep -q "^range" $NORMALIZE_PLAN
+then
+  $CASCADEDIR/cascade-run --plan $NORMALIZE_PLAN
+fi
 )
 if [ $? -eq 0 ]
 then
@@ -86,6 +86,7 @@ then
 	[ -z "$NBIN" ] && NBIN=100
 	[ -z "$PERCENTILE" ] && PERCENTILE=98
 	[ -z "$PARALLEL" ] && PARALLEL=$NUMCPU
+	[ -z "$CASCADE_THREADS" ] && CASCADE_THREADS=${CASCADE_NUM_THREADS:-$NUMCPU}
   
 	export ATLAS_TO_USE
 	export NON_LINEAR
@@ -125,7 +126,7 @@ trap "rm -rf ${SAFE_TMP_DIR}" EXIT
 
 check_cascade()
 {
-for ce in cascade-{range,transform,property-filter,statistics-filter}
+for ce in cascade-{range,transform,property-filter,statistics-filter,info,histogram,tissue,hyp,score,warp-state,state,train,run,batch}
 do
   if [ ! -x $CASCADEDIR/$ce ]
   then
@@ -97,134 +97,99 @@ set +e
 ALL_IMAGES=$(ls ${IMAGEROOT}/${ranges_dir}/brain_{flair,t1,t2,pd}.nii.gz 2>/dev/null)
 set -e
 
-CLASSMASK_DIR=${SAFE_TMP_DIR}
-Z_SCORE_DIR=${SAFE_TMP_DIR}
 NATIVE_STATE_DIR=${SAFE_TMP_DIR}
 
 if [ "$CASCADE_DEBUG" -ge "3" ]
 then
-  CLASSMASK_DIR=${IMAGEROOT}/${temp_dir}
-  Z_SCORE_DIR=${IMAGEROOT}/${temp_dir}
   NATIVE_STATE_DIR=${IMAGEROOT}/${temp_dir}
 fi
 NATIVE_STATE_DIR=${IMAGEROOT}/${temp_dir}
 
 ${FSLPREFIX}fslmaths ${T1_BRAIN} -mul 0 ${Z_SCORE}
 
-for img in $ALL_IMAGES
-do
-  IMAGE_NAME=$(sequence_name $img)
-  IMAGE_TYPE=$(sequence_type $img) 
-  RANGE_IMAGE=$(range_image $img)
-  
-  IMAGE_MODEL_M=${NATIVE_STATE_DIR}/model_${IMAGE_NAME}_mean.nii.gz
-  IMAGE_MODEL_S=${NATIVE_STATE_DIR}/model_${IMAGE_NAME}_stddev.nii.gz
-  
-  IMAGE_Z_SCORE=${Z_SCORE_DIR}/${IMAGE_NAME}_zsc.nii.gz
-
-  runname "Calculating model for ${IMAGE_NAME}"
-  (
-  [ "$BASH_SOURCE" -ot "$IMAGE_MODEL_S" ] && [ "$BASH_SOURCE" -ot "$IMAGE_MODEL_M" ] && exit 0
-  rm -f "$IMAGE_MODEL_S" "$IMAGE_MODEL_M"
-  for CLASS_INDEX in {2..3}
-  do
-    set -e
-# Calculate native mean and variance
-    CLASS_N=${STATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_number.nii.gz
-    CLASS_M=${STATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_mean.nii.gz
-    CLASS_S=${STATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_stddev.nii.gz  
-
-    C_CLASS_N=${SAFE_TMP_DIR}/native_${IMAGE_NAME}_${CLASS_INDEX}_number.nii.gz
-    C_CLASS_M=${SAFE_TMP_DIR}/native_${IMAGE_NAME}_${CLASS_INDEX}_mean.nii.gz
-    C_CLASS_S=${SAFE_TMP_DIR}/native_${IMAGE_NAME}_${CLASS_INDEX}_stddev.nii.gz  
-    
+if [ "${NON_LINEAR}" = "YES" ]
+then
+  NATIVE_TRANSFORM=${SAFE_TMP_DIR}/std_to_native_warp.nii.gz
+else
+  NATIVE_TRANSFORM=${IMAGEROOT}/${trans_dir}/$(fsl_trans_name STD_IMAGE PROC )
+fi
 
-    if [ "${NON_LINEAR}" = "YES" ]
-    then
-      WARP_CMD="${FSLPREFIX}applywarp --ref=$RANGE_IMAGE --warp=${IMAGEROOT}/${trans_dir}/$(nonlinear_trans_name STD_IMAGE PROC )"
-      $WARP_CMD --in=$CLASS_N --out=$C_CLASS_N
-      $WARP_CMD --in=$CLASS_M --out=$C_CLASS_M
-      $WARP_CMD --in=$CLASS_S --out=$C_CLASS_S
-    else
-      register CLASS_N RANGE_IMAGE  - $(fsl_trans_name STD_IMAGE PROC ) $C_CLASS_N
-      register CLASS_N RANGE_IMAGE  - $(fsl_trans_name STD_IMAGE PROC ) $C_CLASS_N
-      register CLASS_N RANGE_IMAGE  - $(fsl_trans_name STD_IMAGE PROC ) $C_CLASS_N
-    fi
-       
-    CLASS_MASK=${CLASSMASK_DIR}/class_${CLASS_INDEX}_mask.nii.gz
-    ${FSLPREFIX}fslmaths ${BRAIN_PVE} -thr ${CLASS_INDEX} -uthr ${CLASS_INDEX} -bin ${CLASS_MASK}
-
-    IMAGE_CLASS_STD_MIN=$(${FSLPREFIX}fslstats $RANGE_IMAGE -k ${BRAIN_WM} -S )
-    IMAGE_CLASS_MEAN_MIN=$(${FSLPREFIX}fslstats $RANGE_IMAGE -k ${BRAIN_WM} -P 20 )
-
-    ${FSLPREFIX}fslmaths ${C_CLASS_M} -div ${C_CLASS_N} -nan -max ${IMAGE_CLASS_MEAN_MIN} ${C_CLASS_M}
-    ${FSLPREFIX}fslmaths ${C_CLASS_N} -sub 1 -div ${C_CLASS_S} -recip -sqrt -nan -thr 0 -max ${IMAGE_CLASS_STD_MIN} -min ${C_CLASS_M} ${C_CLASS_S}
-
-    median_img=$(${FSLPREFIX}fslstats ${RANGE_IMAGE} -k ${CLASS_MASK} -p 50)
-    median_model=$(${FSLPREFIX}fslstats ${C_CLASS_M} -k ${CLASS_MASK} -p 50)
-
-    corr_ratio=$(bc -l <<< "$median_img / $median_model" )
-    
-    [ "$corr_ratio" ] || exit 1
-
-    if [ -s "$IMAGE_MODEL_M" ]
-    then
-      ${FSLPREFIX}fslmaths ${C_CLASS_M} -mul $corr_ratio -mas ${CLASS_MASK} -add $IMAGE_MODEL_M $IMAGE_MODEL_M
-    else
-      ${FSLPREFIX}fslmaths ${C_CLASS_M} -mul $corr_ratio -mas ${CLASS_MASK} $IMAGE_MODEL_M
-    fi
-
-    if [ -s "$IMAGE_MODEL_S" ]
-    then
-      ${FSLPREFIX}fslmaths ${C_CLASS_S} -mul $corr_ratio -mas ${CLASS_MASK} -add $IMAGE_MODEL_S $IMAGE_MODEL_S
-    else
-      ${FSLPREFIX}fslmaths ${C_CLASS_S} -mul $corr_ratio -mas ${CLASS_MASK} $IMAGE_MODEL_S
-    fi
-    
+runname "Warping model"
+(
+set -e
+if [ "${NON_LINEAR}" = "YES" ]
+then
+  ${FSLPREFIX}convertwarp --ref=${T1_BRAIN} --warp1=${IMAGEROOT}/${trans_dir}/$(nonlinear_trans_name STD_IMAGE PROC ) --relout --out=${NATIVE_TRANSFORM}
+fi
+# A packed model is evaluated in native space by cascade-score directly
+if [ "${STATEIMAGE%.cms}" = "${STATEIMAGE}" ]
+then
+  SEQUENCE_ARGS=()
+  for img in $ALL_IMAGES
+  do
+    SEQUENCE_ARGS+=(--sequence $(sequence_name $img))
   done
-  )
-  if [ $? -eq 0 ]
-  then
-    rundone 0
-  else
-    rundone 1
-    rm -f ${CUSTOM_STATE_DIR}/model_* >/dev/null 2>&1 
-    echo_fatal "Unable to calculate model."
-  fi
-
-  runname "Agregating normal brain from ${IMAGE_NAME}"  
-  (
-  set -e
-# Membership calculation
-   
-  if [ "$IMAGE_TYPE" == "light" ]
-  then
-    ${FSLPREFIX}fslmaths ${RANGE_IMAGE} -sub ${IMAGE_MODEL_M} -div ${IMAGE_MODEL_S} -mas ${BRAIN_WMGM} ${IMAGE_Z_SCORE}    
-  elif [ "$IMAGE_TYPE" == "dark" ]
-  then
-    ${FSLPREFIX}fslmaths ${IMAGE_MODEL_M} -sub ${RANGE_IMAGE} -div ${IMAGE_MODEL_S} -mas ${BRAIN_WMGM} ${IMAGE_Z_SCORE}
-  else
-    ${FSLPREFIX}fslmaths ${RANGE_IMAGE} -sub ${IMAGE_MODEL_M} -abs -div ${IMAGE_MODEL_S} -mas ${BRAIN_WMGM} ${IMAGE_Z_SCORE}
-  fi
+# All classes and sequences are merged onto the native grid with the same weights
+  ${CASCADEDIR}/cascade-warp-state --state ${STATEIMAGE} "${SEQUENCE_ARGS[@]}" \
+    --class 2 --class 3 --transform ${NATIVE_TRANSFORM} --reference ${T1_BRAIN} \
+    --out ${SAFE_TMP_DIR}/native
+fi
+)
+if [ $? -eq 0 ]
+then
+  rundone 0
+else
+  rundone 1
+  echo_fatal "Unable to warp model."
+fi
 
-  ${FSLPREFIX}fslmaths ${IMAGE_Z_SCORE} -max ${Z_SCORE} ${Z_SCORE}
-  true
-  )
-  if [ $? -eq 0 ]
+# Scoring of all sequences, masking and the statistics filter run in a
+# single cascade-run, the intermediate scores stay in memory
+NORMAL_PLAN=${SAFE_TMP_DIR}/normal.plan
+PREVIOUS=zero
+{
+echo "input zero ${Z_SCORE}"
+echo "input pve ${BRAIN_PVE}"
+echo "input wmgm ${BRAIN_WMGM}"
+echo "input hyp ${HYP_MASK}"
+echo "input std_image ${STD_IMAGE}"
+for img in $ALL_IMAGES
+do
+  IMAGE_NAME=$(sequence_name $img)
+  if [ "${STATEIMAGE%.cms}" = "${STATEIMAGE}" ]
   then
-    [ "$CASCADE_DEBUG" -ge "2" ] && cp ${IMAGE_Z_SCORE} ${IMAGEROOT}/${temp_dir}
-    rundone 0
+    MODEL_ARGS="state=${SAFE_TMP_DIR}/native_${IMAGE_NAME}"
   else
-    rundone 1
-    rm -f ${Z_SCORE_DIR}/*_zsc.nii.gz ${NORMAL_MASK} >/dev/null 2>&1 
-    echo_fatal "Unable to pick normal brain."
+    MODEL_ARGS="model=${STATEIMAGE} sequence=${IMAGE_NAME} transform=${NATIVE_TRANSFORM} space=std_image"
   fi
+  echo "input range_${IMAGE_NAME} $(range_image $img)"
+  echo "output mean_${IMAGE_NAME} ${NATIVE_STATE_DIR}/model_${IMAGE_NAME}_mean.nii.gz"
+  echo "output stddev_${IMAGE_NAME} ${NATIVE_STATE_DIR}/model_${IMAGE_NAME}_stddev.nii.gz"
+  echo "score range=range_${IMAGE_NAME} type=$(sequence_type $img) pve=pve mask=wmgm ${MODEL_ARGS} class=2,3 previous=${PREVIOUS} model-mean=mean_${IMAGE_NAME} model-std=stddev_${IMAGE_NAME} out=z_${IMAGE_NAME}"
+  PREVIOUS=z_${IMAGE_NAME}
 done
+echo "output ${PREVIOUS} ${Z_SCORE}"
+echo "mask input=${PREVIOUS} mask=hyp out=z_masked"
+echo "output likelihood ${LIKELIHOOD}"
+echo "statistics-filter input=z_masked bin-threshold=1.5 property=Maximum threshold=4 out=likelihood"
+} > ${NORMAL_PLAN}
+
+runname "Agregating normal brain"
+(
+set -e
+${CASCADEDIR}/cascade-run --plan ${NORMAL_PLAN}
+)
+if [ $? -eq 0 ]
+then
+  rundone 0
+else
+  rundone 1
+  rm -f ${NATIVE_STATE_DIR}/model_*_{mean,stddev}.nii.gz >/dev/null 2>&1
+  echo_fatal "Unable to pick normal brain."
+fi
 runname "Normalizeing"
 (
 set -e
-${FSLPREFIX}fslmaths ${Z_SCORE} -mas ${HYP_MASK} ${SAFE_TMP_DIR}/z-masked.nii.gz
-${CASCADEDIR}/cascade-statistics-filter -i ${SAFE_TMP_DIR}/z-masked.nii.gz -b 1.5 -o ${LIKELIHOOD} --property Maximum --threshold 4
 ${FSLPREFIX}fslmaths ${LIKELIHOOD} -sub 3 -mul -3 -exp -add 1 -recip ${PVALUEIMAGE}
 ${FSLPREFIX}fslmaths ${PVALUEIMAGE} -min 1 -max 0 ${PVALUEIMAGE}
 )
@@ -25,9 +25,9 @@ This script runs the preprocessing of the Cascade pipeline
 ${bold}OPTIONS$normal:
    -h      Show this message
    -r      Image root directory
-   -s      State image
+   -s      State model (.cms)
    -m      WML mask
-   -n      Updated state image
+   -n      Updated state model (.cms)
    -l      Show license
    
 EOF
@@ -79,62 +79,38 @@ fi
 
 
 set_filenames
-WEIGHT_SAMPLE=1
-for CLASS_INDEX in {1..3}
+STATE_MODEL=${STATEIMAGE%.cms}.cms
+NEW_STATE_MODEL=${NEWSTATEIMAGE%.cms}.cms
+
+runname "Training the coarse model"
+(
+set -e
+if [ "$MASKIMAGE" ]
+then
+  EXCLUDE_MASK=$MASKIMAGE
+else
+  EXCLUDE_MASK=$(std_image ${HYP_MASK})
+fi
+
+set +e
+ALL_IMAGES=$(ls ${IMAGEROOT}/${std_dir}/brain_{flair,t1,t2,pd}.nii.gz 2>/dev/null)
+set -e
+
+TRAIN_ARGS=()
+for img in $ALL_IMAGES
 do
-  runname "Training on $(tissue_name ${CLASS_INDEX})"
-  (
-  set -e
-  CLASS_MASK=${SAFE_TMP_DIR}/class_traing_${CLASS_INDEX}_mask.nii.gz
-  F_IMG=${SAFE_TMP_DIR}/F_image.nii.gz
-  D_IMG=${SAFE_TMP_DIR}/D_image.nii.gz
-  
-  ${FSLPREFIX}fslmaths $(std_image ${BRAIN_PVE}) -thr ${CLASS_INDEX} -uthr ${CLASS_INDEX} -bin ${CLASS_MASK}
-  if [ "$MASKIMAGE" ]
-  then
-    ${FSLPREFIX}fslmaths $MASKIMAGE -bin -mul -1 -add 1 -mas ${CLASS_MASK} -bin ${CLASS_MASK}
-  else
-    ${FSLPREFIX}fslmaths $(std_image ${HYP_MASK}) -mul -1 -add 1 -mas ${CLASS_MASK} -bin ${CLASS_MASK}
-  fi
-  
-  set +e
-  ALL_IMAGES=$(ls ${IMAGEROOT}/${std_dir}/brain_{flair,t1,t2,pd}.nii.gz 2>/dev/null)
-  set -e
-  
-  for img in $ALL_IMAGES
-  do
-    IMAGE_NAME=$(sequence_name $img)
-    
-    CLASS_N=${STATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_number.nii.gz
-    CLASS_M=${STATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_mean.nii.gz
-    CLASS_S=${STATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_stddev.nii.gz
-    
-    NEW_CLASS_N=${NEWSTATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_number.nii.gz
-    NEW_CLASS_M=${NEWSTATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_mean.nii.gz
-    NEW_CLASS_S=${NEWSTATEIMAGE}_${IMAGE_NAME}_${CLASS_INDEX}_stddev.nii.gz
-    
-    if [ ! -e "$CLASS_N" ] ||[ ! -e "$CLASS_N" ] ||[ ! -e "$CLASS_M" ]
-    then
-      ${FSLPREFIX}fslmaths $(std_image ${BRAIN_PVE}) -mul 0 $CLASS_N
-      cp $CLASS_N $CLASS_M
-      cp $CLASS_N $CLASS_S
-    fi
-    
-    ${FSLPREFIX}fslmaths ${CLASS_N} -add 1 -div ${CLASS_N} -recip -nan ${F_IMG}
-    ${FSLPREFIX}fslmaths ${CLASS_M} -div ${CLASS_N} -sub ${img} -mul -1 -nan ${D_IMG}
-  
-    ${FSLPREFIX}fslmaths ${img} -mas ${CLASS_MASK} -add ${CLASS_M} ${NEW_CLASS_M}
-    ${FSLPREFIX}fslmaths ${D_IMG} -mas ${CLASS_MASK} -sqr -mul ${F_IMG} -add ${CLASS_S} ${NEW_CLASS_S}
-    ${FSLPREFIX}fslmaths ${CLASS_MASK} -bin -add ${CLASS_N} ${NEW_CLASS_N}
-  
-  done
-  )
-  if [ $? -eq 0 ]
-  then
-    rundone 0
-  else
-    rundone 1
-    rm ${NEWSTATEIMAGE}_*.nii.gz  >/dev/null 2>&1
-    echo_fatal "Unable to calculate the new state. NOTE: None of the new state for any class is not usable anymore."
-  fi
+  TRAIN_ARGS+=(--sequence $(sequence_name $img) --image $img)
 done
+[ -e "$STATE_MODEL" ] && TRAIN_ARGS+=(--model $STATE_MODEL)
+
+# All classes and sequences are splatted on the coarse grid in one run
+${CASCADEDIR}/cascade-train --pve $(std_image ${BRAIN_PVE}) --exclude ${EXCLUDE_MASK} \
+  --class 1 --class 2 --class 3 "${TRAIN_ARGS[@]}" --out ${NEW_STATE_MODEL}
+)
+if [ $? -eq 0 ]
+then
+  rundone 0
+else
+  rundone 1
+  echo_fatal "Unable to calculate the new state."
+fi
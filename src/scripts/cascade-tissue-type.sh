@@ -51,50 +51,22 @@ runname "Refining brain segmentation"
 set -e
 if [ "$BASH_SOURCE" -nt "$BRAIN_PV" ]
 then
-  POS_WM=${SAFE_TMP_DIR}/possible_wm.nii.gz
-
-  ${FSLPREFIX}fslmaths ${IMAGEROOT}/${temp_dir}/brain_pve_0.nii.gz -nan -thr 0.5 -bin ${BRAIN_CSF}
-  ${FSLPREFIX}fslmaths ${IMAGEROOT}/${temp_dir}/brain_pve_1.nii.gz -nan -thr 0.5 -bin ${BRAIN_GM}
-  ${FSLPREFIX}fslmaths ${IMAGEROOT}/${temp_dir}/brain_pve_2.nii.gz -nan -thr 0.5 -bin ${BRAIN_WM}
-  ${FSLPREFIX}fslmaths ${BRAIN_WM} -mul 0 "$POS_WM"
+  TISSUE_ARGS=()
+  [ -s "$FLAIR_BRAIN" ] && TISSUE_ARGS+=(--flair "$FLAIR_BRAIN")
+  [ -s "$T2_BRAIN" ] && TISSUE_ARGS+=(--t2 "$T2_BRAIN")
+  [ -s "${IMAGEROOT}/${images_dir}/std-white.nii.gz" ] && TISSUE_ARGS+=(--std-white "${IMAGEROOT}/${images_dir}/std-white.nii.gz")
 
 # TODO: Maybe small CSF can be a candidate
-       
-  if [ -s "$FLAIR_BRAIN" ]
-  then
-    _perc=($(${FSLPREFIX}fslstats $FLAIR_BRAIN -k ${BRAIN_GM} -p 16 -p 84))
-    flair_thresh=$( bc -l <<< "${_perc[1]} + 0.5 * (${_perc[1]}-${_perc[0]})" )
-    ${FSLPREFIX}fslmaths $FLAIR_BRAIN -thr $flair_thresh -add "$POS_WM" -bin "$POS_WM"
-  fi
-
-  if [ -s "$T2_BRAIN" ]
-  then
-    _perc=($(${FSLPREFIX}fslstats $T2_BRAIN -k ${BRAIN_GM} -p 16 -p 84))
-    t2_thresh=$( bc -l <<< "${_perc[1]} + 0.5 * (${_perc[1]}-${_perc[0]})" )
-    ${FSLPREFIX}fslmaths $T2_BRAIN -thr $t2_thresh -add "$POS_WM" -bin "$POS_WM"
-  fi
-
-	if [ -s "${IMAGEROOT}/${images_dir}/std-white.nii.gz" ]
-  then
-    ${FSLPREFIX}fslmaths "$POS_WM" -mul ${IMAGEROOT}/${images_dir}/std-white.nii.gz -thr 0.35 -bin  "$POS_WM"
-  fi
-  
 # TODO: IF a POS_WM segment is sorounded by GM or CSF then it is probably actually a GM
 
-  ${FSLPREFIX}fslmaths ${BRAIN_CSF} -mul -1 -add 1 -mul "$POS_WM" -bin "$POS_WM"
-  
-  ${FSLPREFIX}fslmaths ${BRAIN_WM} -mul -1 -add 1 -mul "$POS_WM" ${IMAGEROOT}/${images_dir}/possible_wm
-
-  ${FSLPREFIX}fslmaths ${BRAIN_WM} -add "$POS_WM" -bin ${BRAIN_WM}
-
-  ${FSLPREFIX}fslmaths ${BRAIN_WM} -mul -1 -add 1 -mul ${BRAIN_CSF} -bin ${BRAIN_CSF}    
-  ${FSLPREFIX}fslmaths ${BRAIN_WM} -mul -1 -add 1 -mul ${BRAIN_GM} -bin -mul 2 ${BRAIN_GM}
-  ${FSLPREFIX}fslmaths ${BRAIN_WM} -bin -mul 3 ${BRAIN_WM}
-  
-  ${FSLPREFIX}fslmaths ${BRAIN_GM} -add ${BRAIN_WM} -bin ${BRAIN_WMGM}
-  ${FSLPREFIX}fslmaths ${BRAIN_CSF} -add ${BRAIN_GM} -add ${BRAIN_WM} ${BRAIN_PVE}
-
-  cp $POS_WM ${IMAGEROOT}/${images_dir}
+  ${CASCADEDIR}/cascade-tissue \
+    --csf-pve ${IMAGEROOT}/${temp_dir}/brain_pve_0.nii.gz \
+    --gm-pve ${IMAGEROOT}/${temp_dir}/brain_pve_1.nii.gz \
+    --wm-pve ${IMAGEROOT}/${temp_dir}/brain_pve_2.nii.gz \
+    "${TISSUE_ARGS[@]}" \
+    --csf ${BRAIN_CSF} --gm ${BRAIN_GM} --wm ${BRAIN_WM} \
+    --wmgm ${BRAIN_WMGM} --pve ${BRAIN_PVE} \
+    --possible-wm ${IMAGEROOT}/${images_dir}/possible_wm.nii.gz
 fi
 )
 if [ $? -eq 0 ]
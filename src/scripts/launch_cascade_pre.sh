@@ -8,7 +8,9 @@ source $(cd $(dirname "${BASH_SOURCE[0]}") && pwd -P )/cascade-setup.sh
 
 [ -z "$PRJHOME" ] && echo "No proper settings. Are you sure you have a proper project_setting.sh file?" >&2 && exit 1
 
-loop_index=0
+# One subject per line, cascade-batch runs them within the thread budget
+PRE_MANIFEST=${PRJCASCADE}/pre.manifest
+> $PRE_MANIFEST
 
 for f in $(find "${PRJORIGINAL}" -mindepth 1 -maxdepth 1 -name "${PRJSUBJPATTERN}" | sort)
 do
@@ -48,34 +50,13 @@ INPUT_ARG=""
 [ -s "$t2" ]    && INPUT_ARG="$INPUT_ARG -s $t2"
 
 mkdir -p ${PRJCASCADE}/${id}
-[ "$CASCADE_ONLY_FAILED" ] && [ ! -e "${PRJCASCADE}/${id}/pre1.failed" ] && continue
+[ "$CASCADE_ONLY_FAILED" ] && [ ! -e "${PRJCASCADE}/${id}/pre.failed" ] && continue
 
-STDOUT=${PRJCASCADE}/${id}/pre.stdout
-XTRACE=${PRJCASCADE}/${id}/pre.xtrace
->$STDOUT
->$XTRACE
-echo -e "${header_format}Launching ${id}${normal}"
-(
-printf "PRE 1\n" >>$STDOUT
-printf "PRE 1\n" >>$XTRACE
-bash -x ${CASCADESCRIPT}/cascade-pre1.sh -r ${PRJCASCADE}/${id} -n $mask_space $INPUT_ARG 1>>$STDOUT 2>>$XTRACE
-
-printf "\nPRE 2\n" >>$STDOUT
-printf "\nPRE 2\n" >>$XTRACE
-bash -x ${CASCADESCRIPT}/cascade-pre2.sh -r ${PRJCASCADE}/${id} 1>>$STDOUT 2>>$XTRACE
-if [ "$?" -ne "0" ]
-then
-  touch ${PRJCASCADE}/${id}/pre.failed
-else
-  rm -f ${PRJCASCADE}/${id}/pre.failed
-fi
-) &
-
-loop_index=$(( $loop_index + 1 ))
-if (( $loop_index % $PARALLEL == 0 )); then wait; fi
+echo "${PRJCASCADE}/${id} bash -x ${CASCADESCRIPT}/cascade-pre1.sh -r ${PRJCASCADE}/${id} -n $mask_space $INPUT_ARG ; bash -x ${CASCADESCRIPT}/cascade-pre2.sh -r ${PRJCASCADE}/${id}" >> $PRE_MANIFEST
 
 done
-wait
+${CASCADEDIR}/cascade-batch --manifest $PRE_MANIFEST --name pre \
+  --stderr-extension xtrace --jobs $PARALLEL --threads $CASCADE_THREADS
 FAILED_IDS=$(find -name "pre.failed" -exec dirname {} \; | xargs -n1 basename 2>/dev/null | sort )
 if [ "$FAILED_IDS" ]
 then
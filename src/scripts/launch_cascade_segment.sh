@@ -8,31 +8,25 @@ source $(cd $(dirname "${BASH_SOURCE[0]}") && pwd -P )/cascade-setup.sh
 
 [ -z "$PRJHOME" ] && echo "No proper settings. Are you sure you have a proper project_setting.sh file?" >&2 && exit 1
 
-loop_index=0
+# The packed model is used when training produced one
+STATE_MODEL=$STATE_PREFIX
+[ -f "${STATE_PREFIX}.cms" ] && STATE_MODEL=${STATE_PREFIX}.cms
+
+# One subject per line, cascade-batch runs them within the thread budget
+SEGMENT_MANIFEST=${PRJCASCADE}/segment.manifest
+> $SEGMENT_MANIFEST
 
 for f in $(find "${PRJCASCADE}" -mindepth 1 -maxdepth 1 -name "${PRJSUBJPATTERN}" | sort)
 do
   id=$(basename $f)
   [ "$CASCADE_MIN_ID" \> "$id" ] && continue
   
-  echo -e "${header_format}Launching ${id}${normal}"
-  (
-  echo -e "${header_format}Processing ${id}${normal}"
-  rm -f ${PRJCASCADE}/${id}/segment.failed
-  bash -x ${CASCADESCRIPT}/cascade-std-normal.sh -r ${f} -s $STATE_PREFIX
-  if [ "$?" -ne "0" ]
-  then
-    touch ${PRJCASCADE}/${id}/segment.failed
-  else
-    rm -f ${PRJCASCADE}/${id}/segment.failed
-  fi
-  ) 1>${PRJCASCADE}/${id}/segment.stdout 2>${PRJCASCADE}/${id}/segment.stderr &
-  
-  loop_index=$(( $loop_index + 1 ))
-  if (( $loop_index % $PARALLEL == 0 )); then time wait; fi
+  [ "$CASCADE_ONLY_FAILED" ] && [ ! -e "${PRJCASCADE}/${id}/segment.failed" ] && continue
   
+  echo "${f} bash -x ${CASCADESCRIPT}/cascade-std-normal.sh -r ${f} -s $STATE_MODEL" >> $SEGMENT_MANIFEST
 done
-wait
+${CASCADEDIR}/cascade-batch --manifest $SEGMENT_MANIFEST --name segment \
+  --jobs $PARALLEL --threads $CASCADE_THREADS
 FAILED_IDS=$(find -name "segment.failed" -exec dirname {} \; | xargs -n1 basename 2>/dev/null | sort )
 if [ "$FAILED_IDS" ]
 then
@@ -0,0 +1,468 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+/*
+ * General ITK
+ */
+#include "itkMultiThreader.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkTimeProbe.h"
+#include "itkImageIOFactory.h"
+/*
+ * Others
+ */
+#include "stage/stage.h"
+#include "stage/plan.h"
+
+#include "util/batch.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+/*
+ * A job is a cascade-run plan sent over the socket, ended by a line "end" or
+ * by the client closing its side. The server answers with a line per stage
+ * as it is done, "output <slot> <file>" for the outputs of the plan and
+ * finally "ok <seconds>" or "error <message>", then closes the connection.
+ */
+const size_t MaxRequestLength = 1 << 20;
+
+/** Output stream buffer writing to a socket, flushed at every std::endl */
+class SocketBuffer: public std::streambuf
+{
+public:
+  SocketBuffer(int socket) :
+      m_Socket(socket)
+    {
+    this->setp(m_Buffer, m_Buffer + sizeof(m_Buffer));
+    }
+
+protected:
+  int overflow(int c)
+    {
+    if (this->sync() != 0) return traits_type::eof();
+    if (c != traits_type::eof())
+      {
+      *this->pptr() = traits_type::to_char_type(c);
+      this->pbump(1);
+      }
+    return traits_type::not_eof(c);
+    }
+
+  /** A client that went away only loses the rest of its answer */
+  int sync()
+    {
+    const char* data = this->pbase();
+    while (data < this->pptr())
+      {
+      const ssize_t written = write(m_Socket, data, this->pptr() - data);
+      if (written < 0 && errno == EINTR) continue;
+      if (written <= 0) break;
+      data += written;
+      }
+    this->setp(m_Buffer, m_Buffer + sizeof(m_Buffer));
+    return 0;
+    }
+
+private:
+  int m_Socket;
+  char m_Buffer[4096];
+};
+
+struct Server
+  {
+  int Socket;
+  cascade::stage::AssetStore* Assets;
+  const cascade::stage::StageCache* Cache;
+  bool PinToNumaNodes;
+  itk::SimpleFastMutexLock Lock;
+  };
+
+/** Set by the signal handler, accept fails once the socket is shut down */
+volatile sig_atomic_t listeningSocket = -1;
+
+extern "C" void StopServing(int)
+  {
+  if (listeningSocket >= 0) shutdown(listeningSocket, SHUT_RDWR);
+  }
+
+bool ReadRequest(int client, std::string & request)
+  {
+  char buffer[4096];
+  size_t lineStart = 0;
+  while (request.size() < MaxRequestLength)
+    {
+    const ssize_t length = read(client, buffer, sizeof(buffer));
+    if (length < 0 && errno == EINTR) continue;
+    if (length < 0) return false;
+    if (length == 0) return true;
+    request.append(buffer, length);
+
+    std::string::size_type lineEnd;
+    while ((lineEnd = request.find('\n', lineStart)) != std::string::npos)
+      {
+      std::istringstream line(request.substr(lineStart, lineEnd - lineStart));
+      std::string word, rest;
+      if (line >> word && word == "end" && !(line >> rest))
+        {
+        request.resize(lineStart);
+        return true;
+        }
+      lineStart = lineEnd + 1;
+      }
+    }
+  return false;
+  }
+
+void ServeJob(int client, Server & server)
+  {
+  SocketBuffer buffer(client);
+  std::ostream response(&buffer);
+
+  itk::TimeProbe clock;
+  clock.Start();
+  std::string error;
+  size_t numberOfStages = 0;
+  try
+    {
+    std::string request;
+    if (!ReadRequest(client, request))
+      {
+      itkGenericExceptionMacro("Can not read the plan.");
+      }
+    std::istringstream stream(request);
+    const cascade::util::ManifestType plan = cascade::util::ParseManifest(
+        stream, "plan", 1, std::numeric_limits< size_t >::max());
+
+    cascade::stage::Context context;
+    context.SetAssetStore(server.Assets);
+    cascade::stage::Graph graph;
+    cascade::stage::AddPlan(plan, "plan", context, graph);
+    numberOfStages = graph.GetNumberOfStages();
+    graph.Run(context, &response, server.Cache);
+
+    for (size_t r = 0; r < plan.size(); r++)
+      {
+      if (plan[r][0] == "output")
+        response << "output " << plan[r][1] << " " << plan[r][2] << "\n";
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    error = err.GetDescription();
+    }
+  catch (std::exception & err)
+    {
+    error = err.what();
+    }
+  clock.Stop();
+
+  std::replace(error.begin(), error.end(), '\n', ' ');
+  if (error.empty()) response << "ok " << clock.GetTotal() << std::endl;
+  else response << "error " << error << std::endl;
+
+  server.Lock.Lock();
+  if (error.empty())
+    std::cout << "Done " << numberOfStages << " stages in " << clock.GetTotal()
+              << "s" << std::endl;
+  else std::cout << "Failed: " << error << std::endl;
+  server.Lock.Unlock();
+  }
+
+ITK_THREAD_RETURN_TYPE ServeCallback(void* arg)
+  {
+  itk::MultiThreader::ThreadInfoStruct* info =
+      static_cast< itk::MultiThreader::ThreadInfoStruct* >(arg);
+  Server* server = static_cast< Server* >(info->UserData);
+  if (server->PinToNumaNodes) cascade::util::PinToNumaNode(info->ThreadID);
+  while (true)
+    {
+    const int client = accept(server->Socket, 0, 0);
+    if (client < 0)
+      {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      break;
+      }
+    ServeJob(client, *server);
+    close(client);
+    }
+  return ITK_THREAD_RETURN_VALUE;
+  }
+
+sockaddr_un SocketAddress(const std::string & path)
+  {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+    {
+    itkGenericExceptionMacro("Socket path is too long: " << path);
+    }
+  std::strcpy(address.sun_path, path.c_str());
+  return address;
+  }
+
+int Listen(const std::string & path)
+  {
+  const sockaddr_un address = SocketAddress(path);
+
+  /** Only a socket left by a server that did not shut down is replaced */
+  struct stat status;
+  if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+    {
+    const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0)
+      {
+      itkGenericExceptionMacro("Can not probe " << path << ": "
+                               << std::strerror(errno));
+      }
+    const bool served = connect(probe,
+                                reinterpret_cast< const sockaddr* >(&address),
+                                sizeof(address)) == 0;
+    const int reason = errno;
+    close(probe);
+    if (served)
+      {
+      itkGenericExceptionMacro("Already serving on " << path);
+      }
+    if (reason != ECONNREFUSED)
+      {
+      itkGenericExceptionMacro("Can not probe " << path << ": "
+                               << std::strerror(reason));
+      }
+    unlink(path.c_str());
+    }
+
+  const int listening = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listening < 0
+      || bind(listening, reinterpret_cast< const sockaddr* >(&address),
+              sizeof(address)) != 0 || listen(listening, SOMAXCONN) != 0)
+    {
+    const std::string reason = std::strerror(errno);
+    if (listening >= 0) close(listening);
+    itkGenericExceptionMacro("Can not listen on " << path << ": " << reason);
+    }
+  return listening;
+  }
+
+/** Send a plan to a running server and print its answer */
+bool Submit(const std::string & path, const std::string & planFile)
+  {
+  std::ifstream file(planFile.c_str());
+  if (!file)
+    {
+    itkGenericExceptionMacro("Can not read plan " << planFile);
+    }
+  std::ostringstream plan;
+  plan << file.rdbuf();
+  const std::string request = plan.str();
+
+  const sockaddr_un address = SocketAddress(path);
+  const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0
+      || connect(server, reinterpret_cast< const sockaddr* >(&address),
+                 sizeof(address)) != 0)
+    {
+    const std::string reason = std::strerror(errno);
+    if (server >= 0) close(server);
+    itkGenericExceptionMacro("Can not connect to " << path << ": " << reason);
+    }
+
+  for (size_t sent = 0; sent < request.size();)
+    {
+    const ssize_t written = write(server, request.data() + sent,
+                                  request.size() - sent);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) break;
+    sent += written;
+    }
+  shutdown(server, SHUT_WR);
+
+  std::string answer;
+  char buffer[4096];
+  ssize_t length;
+  while ((length = read(server, buffer, sizeof(buffer))) != 0)
+    {
+    if (length < 0 && errno == EINTR) continue;
+    if (length < 0) break;
+    answer.append(buffer, length);
+    std::cout.write(buffer, length);
+    std::cout.flush();
+    }
+  close(server);
+
+  const std::string::size_type last = answer.rfind('\n',
+                                                   answer.size() - 2);
+  return answer.compare(last == std::string::npos ? 0 : last + 1, 3, "ok ")
+      == 0;
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Serve cascade-run plans on a local socket with the models kept in memory " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > submit(
+      "p", "plan",
+      "Send a plan to the server listening on the socket, print its answer "
+      "and exit", false, "", "string", cmd);
+
+  const char* cacheDirectory = std::getenv("CASCADE_CACHE_DIR");
+  TCLAP::ValueArg< std::string > cache(
+      "c", "cache",
+      "Directory to keep the outputs of the stages in and reuse them when "
+      "nothing they depend on has changed (default $CASCADE_CACHE_DIR)",
+      false, cacheDirectory ? cacheDirectory : "", "string", cmd);
+
+  TCLAP::MultiArg< std::string > assets(
+      "a", "assets",
+      "Directory whose images and histograms are kept in memory once read, "
+      "e.g. data/ and the models (default $CASCADEDATA)",
+      false, "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "t", "threads",
+      "Threads shared by all the jobs, $CASCADE_NUM_THREADS or all cores by "
+      "default", false, 0, "Integer", cmd);
+
+  TCLAP::SwitchArg pinNuma(
+      "", "pin-numa",
+      "Spread the jobs over the NUMA nodes and keep each on its node "
+      "(default $CASCADE_PIN_NUMA)", cmd, false);
+
+  TCLAP::ValueArg< unsigned int > jobs("j", "jobs",
+                                       "Number of plans run at the same time",
+                                       false, 1, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > socketPath("s", "socket",
+                                            "Unix socket to listen on", true,
+                                            "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    if (!submit.getValue().empty())
+      {
+      return Submit(socketPath.getValue(), submit.getValue()) ?
+          EXIT_SUCCESS : EXIT_FAILURE;
+      }
+
+    cascade::stage::AssetStore assetStore;
+    std::vector< std::string > assetDirectories = assets.getValue();
+    const char* dataDirectory = std::getenv("CASCADEDATA");
+    if (assetDirectories.empty() && dataDirectory)
+      assetDirectories.push_back(dataDirectory);
+    for (size_t d = 0; d < assetDirectories.size(); d++)
+      assetStore.AddDirectory(assetDirectories[d]);
+
+    /** Factories are registered once before the workers start */
+    itk::ImageIOFactory::CreateImageIO("", itk::ImageIOFactory::ReadMode);
+
+    const itk::ThreadIdType workers = std::max(jobs.getValue(), 1u);
+    const itk::ThreadIdType numberOfThreads =
+        cascade::util::SetNumberOfThreads(threads.getValue());
+    itk::MultiThreader::SetGlobalDefaultNumberOfThreads(
+        std::max< itk::ThreadIdType >(numberOfThreads / workers, 1));
+
+    Server server;
+    server.Assets = &assetStore;
+    server.Cache = 0;
+    server.PinToNumaNodes = pinNuma.getValue()
+        || cascade::util::IsNumaPinningEnabled();
+    server.Socket = Listen(socketPath.getValue());
+
+    std::signal(SIGPIPE, SIG_IGN);
+    listeningSocket = server.Socket;
+    std::signal(SIGINT, StopServing);
+    std::signal(SIGTERM, StopServing);
+    std::cout << "Serving on " << socketPath.getValue() << " with " << workers
+              << " jobs" << std::endl;
+
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+    threader->SetNumberOfThreads(workers);
+    threader->SetSingleMethod(ServeCallback, &server);
+    if (cache.getValue().empty())
+      {
+      threader->SingleMethodExecute();
+      }
+    else
+      {
+      cascade::stage::StageCache stageCache(cache.getValue());
+      server.Cache = &stageCache;
+      threader->SingleMethodExecute();
+      }
+
+    listeningSocket = -1;
+    close(server.Socket);
+    unlink(socketPath.getValue().c_str());
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef HISTOGRAMSTAGE_H_
+#define HISTOGRAMSTAGE_H_
+
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkBinaryDilateImageFilter.h"
+#include "itkBinaryBallStructuringElement.h"
+#include "itkMath.h"
+
+#include "util/itkMaskedQuantileImageFilter.h"
+
+#include "stage/stage.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+struct HistogramSettings
+  {
+  unsigned int Bins;
+  /** Upper bound as a percentile of the non-zero voxels */
+  float Percentile;
+  /** Radius of the mask dilation in mm */
+  float Dilate;
+
+  HistogramSettings() :
+      Bins(100), Percentile(95), Dilate(0)
+    {
+    }
+  };
+
+/*
+ * Intensity histogram of cascade-histogram.
+ *
+ * histogram input=<slot> [mask=<slot>] out=<hist slot> [bins=100]
+ *   [percentile=95] [dilate=0]
+ */
+class HistogramStage: public Stage
+{
+public:
+  typedef unsigned char MaskPixelType;
+  typedef itk::Image< MaskPixelType, DIM > MaskImageType;
+
+  typedef itk::BinaryThresholdImageFilter< MaskImageType, MaskImageType > BinaryThresholdImageFilterType;
+  typedef itk::BinaryBallStructuringElement< MaskPixelType, DIM > StructuringElementType;
+  typedef itk::BinaryDilateImageFilter< MaskImageType, MaskImageType,
+      StructuringElementType > DilateFilterType;
+  typedef itk::MaskedQuantileImageFilter< ImageType, MaskImageType > QuantileFilterType;
+
+  static util::HistogramTable Process(const ImageType* input,
+                                      const MaskImageType* mask,
+                                      HistogramSettings const &settings)
+    {
+    QuantileFilterType::Pointer quantileFilter = QuantileFilterType::New();
+    quantileFilter->SetInput(input);
+    /** Upper bound over the whole image as fslstats -P */
+    const unsigned int boundChannel = quantileFilter->AddChannel(0, true);
+
+    /** Histogram of the non-zero voxels in the mask as fslstats -k -H */
+    MaskImageType::Pointer histogramMask;
+    if (mask)
+      {
+      BinaryThresholdImageFilterType::Pointer thresholdFilter =
+          BinaryThresholdImageFilterType::New();
+      thresholdFilter->InPlaceOff();
+      thresholdFilter->SetInput(mask);
+      thresholdFilter->SetLowerThreshold(1);
+      thresholdFilter->SetInsideValue(1);
+      thresholdFilter->SetOutsideValue(0);
+      thresholdFilter->Update();
+      histogramMask = thresholdFilter->GetOutput();
+
+      if (settings.Dilate > 0)
+        {
+        StructuringElementType structuringElement;
+        StructuringElementType::SizeType radius;
+        for (unsigned int i = 0; i < DIM; i++)
+          radius[i] = itk::Math::Round< itk::SizeValueType >(
+              settings.Dilate / histogramMask->GetSpacing()[i]);
+        structuringElement.SetRadius(radius);
+        structuringElement.CreateStructuringElement();
+
+        DilateFilterType::Pointer dilateFilter = DilateFilterType::New();
+        dilateFilter->SetInput(histogramMask);
+        dilateFilter->SetKernel(structuringElement);
+        dilateFilter->SetForegroundValue(1);
+        dilateFilter->Update();
+        histogramMask = dilateFilter->GetOutput();
+        }
+      }
+    const unsigned int histogramChannel = quantileFilter->AddChannel(
+        histogramMask, true);
+    quantileFilter->Update();
+
+    const double upperBound = quantileFilter->GetQuantile(
+        boundChannel, settings.Percentile / 100.0);
+    return util::ComputeHistogram(quantileFilter->GetSamples(histogramChannel),
+                                  settings.Bins, 0, upperBound);
+    }
+
+  HistogramStage(ParameterMap const &parameters) :
+      Stage("histogram", parameters)
+    {
+    m_Input = this->InputSlot("input");
+    m_Mask = this->InputSlot("mask", false);
+    m_Output = this->OutputSlot("out");
+    m_Settings.Bins = this->GetValue< unsigned int >("bins", 100);
+    m_Settings.Percentile = this->GetValue< float >("percentile", 95);
+    m_Settings.Dilate = this->GetValue< float >("dilate", 0);
+    }
+
+  void Run(Context & context)
+    {
+    MaskImageType::Pointer mask;
+    if (!m_Mask.empty())
+      {
+      mask = CastImage< MaskImageType >(context.GetImage(m_Mask).GetPointer());
+      }
+    context.SetHistogram(
+        m_Output, Process(context.GetImage(m_Input), mask, m_Settings));
+    }
+
+private:
+  std::string m_Input;
+  std::string m_Mask;
+  std::string m_Output;
+  HistogramSettings m_Settings;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* HISTOGRAMSTAGE_H_ */
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef HYPSTAGE_H_
+#define HYPSTAGE_H_
+
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkSignedMaurerDistanceMapImageFilter.h"
+
+#include "util/itkMaskedQuantileImageFilter.h"
+#include "util/itkLesionHypothesisImageFilter.h"
+
+#include "stage/stage.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+struct HypSettings
+  {
+  /** Radius of the WM-GM boundary in mm */
+  float Radius;
+  /** Keep only WM and the WM-GM boundary */
+  bool Boundary;
+  float GMPercentile;
+  float WMPercentile;
+
+  HypSettings() :
+      Radius(1), Boundary(false), GMPercentile(90), WMPercentile(80)
+    {
+    }
+  };
+
+/*
+ * Lesion hypothesis mask of cascade-hyp.
+ *
+ * hyp t1=<slot> wm=<slot> gm=<slot> [csf=<slot>] [flair=<slot>] [t2=<slot>]
+ *   out=<slot> [boundary] [radius=1] [gm-percentile=90] [wm-percentile=80]
+ */
+class HypStage: public Stage
+{
+public:
+  typedef unsigned char OutputPixelType;
+  typedef itk::Image< OutputPixelType, DIM > OutputImageType;
+
+  typedef itk::BinaryThresholdImageFilter< ImageType, OutputImageType > BinaryThresholdImageFilterType;
+  typedef itk::SignedMaurerDistanceMapImageFilter< OutputImageType, ImageType > DistanceMapFilterType;
+  typedef itk::MaskedQuantileImageFilter< ImageType, ImageType > QuantileFilterType;
+  typedef itk::LesionHypothesisImageFilter< ImageType, OutputImageType > HypothesisFilterType;
+
+  /** csf, flair and t2 may be null */
+  static OutputImageType::Pointer Process(const ImageType* t1,
+                                          const ImageType* wm,
+                                          const ImageType* gm,
+                                          const ImageType* csf,
+                                          const ImageType* flair,
+                                          const ImageType* t2,
+                                          HypSettings const &settings)
+    {
+    HypothesisFilterType::Pointer hypothesisFilter =
+        HypothesisFilterType::New();
+    hypothesisFilter->SetWMImage(wm);
+    hypothesisFilter->SetGMImage(gm);
+    if (csf)
+      {
+      hypothesisFilter->SetCSFImage(csf);
+      }
+
+    /*
+     * Percentiles of the non-zero voxels as fslstats -k -P. All thresholds
+     * of a sequence come from a single pass over it.
+     */
+    const double wmP = settings.WMPercentile / 100.0;
+    const double gmP = settings.GMPercentile / 100.0;
+    {
+    QuantileFilterType::Pointer quantileFilter = QuantileFilterType::New();
+    quantileFilter->SetInput(t1);
+    const unsigned int wmChannel = quantileFilter->AddChannel(wm, true);
+    quantileFilter->Update();
+    hypothesisFilter->SetT1Image(t1);
+    hypothesisFilter->SetT1Threshold(
+        quantileFilter->GetQuantile(wmChannel, wmP));
+    }
+
+    const ImageType* lightSequences[] = { flair, t2 };
+    for (unsigned int s = 0; s < 2; s++)
+      {
+      if (!lightSequences[s]) continue;
+      QuantileFilterType::Pointer quantileFilter = QuantileFilterType::New();
+      quantileFilter->SetInput(lightSequences[s]);
+      const unsigned int wmChannel = quantileFilter->AddChannel(wm, true);
+      const unsigned int gmChannel = quantileFilter->AddChannel(gm, true);
+      quantileFilter->Update();
+      hypothesisFilter->AddLightImage(
+          lightSequences[s], quantileFilter->GetQuantile(wmChannel, wmP),
+          quantileFilter->GetQuantile(gmChannel, gmP));
+      }
+
+    /** Sphere dilation of WM as a threshold on the distance map */
+    if (settings.Boundary)
+      {
+      BinaryThresholdImageFilterType::Pointer wmMask =
+          BinaryThresholdImageFilterType::New();
+      wmMask->SetInput(wm);
+      wmMask->SetLowerThreshold(0);
+      wmMask->SetUpperThreshold(0);
+      wmMask->SetInsideValue(0);
+      wmMask->SetOutsideValue(1);
+
+      DistanceMapFilterType::Pointer distanceFilter =
+          DistanceMapFilterType::New();
+      distanceFilter->SetInput(wmMask->GetOutput());
+      distanceFilter->SetBackgroundValue(0);
+      distanceFilter->SetUseImageSpacing(true);
+      distanceFilter->SetSquaredDistance(true);
+      distanceFilter->SetInsideIsPositive(false);
+      distanceFilter->Update();
+
+      hypothesisFilter->SetWMDistanceImage(distanceFilter->GetOutput());
+      hypothesisFilter->SetBoundaryRadius(settings.Radius);
+      }
+
+    hypothesisFilter->Update();
+    OutputImageType::Pointer output = hypothesisFilter->GetOutput();
+    output->DisconnectPipeline();
+    return output;
+    }
+
+  HypStage(ParameterMap const &parameters) :
+      Stage("hyp", parameters)
+    {
+    m_T1 = this->InputSlot("t1");
+    m_WM = this->InputSlot("wm");
+    m_GM = this->InputSlot("gm");
+    m_CSF = this->InputSlot("csf", false);
+    m_Flair = this->InputSlot("flair", false);
+    m_T2 = this->InputSlot("t2", false);
+    m_Output = this->OutputSlot("out");
+    m_Settings.Boundary = this->GetSwitch("boundary");
+    m_Settings.Radius = this->GetValue< float >("radius", 1);
+    m_Settings.GMPercentile = this->GetValue< float >("gm-percentile", 90);
+    m_Settings.WMPercentile = this->GetValue< float >("wm-percentile", 80);
+    }
+
+  void Run(Context & context)
+    {
+    ImageType::Pointer csf, flair, t2;
+    if (!m_CSF.empty()) csf = context.GetImage(m_CSF);
+    if (!m_Flair.empty()) flair = context.GetImage(m_Flair);
+    if (!m_T2.empty()) t2 = context.GetImage(m_T2);
+
+    OutputImageType::Pointer output = Process(context.GetImage(m_T1),
+                                              context.GetImage(m_WM),
+                                              context.GetImage(m_GM), csf,
+                                              flair, t2, m_Settings);
+    context.SetImage(m_Output, output.GetPointer());
+    }
+
+private:
+  std::string m_T1;
+  std::string m_WM;
+  std::string m_GM;
+  std::string m_CSF;
+  std::string m_Flair;
+  std::string m_T2;
+  std::string m_Output;
+  HypSettings m_Settings;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* HYPSTAGE_H_ */
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef MASKSTAGE_H_
+#define MASKSTAGE_H_
+
+#include "itkMaskImageFilter.h"
+
+#include "stage/stage.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+/*
+ * Zero the input out of the non-zero voxels of the mask, as fslmaths -mas,
+ * so masking between two stages does not need a round trip through files.
+ *
+ * mask input=<slot> mask=<slot> out=<slot>
+ */
+class MaskStage: public Stage
+{
+public:
+  typedef itk::MaskImageFilter< ImageType, ImageType > MaskFilterType;
+
+  static ImageType::Pointer Process(const ImageType* input,
+                                    const ImageType* mask)
+    {
+    MaskFilterType::Pointer maskFilter = MaskFilterType::New();
+    /** The input slot may be read again or shared with other contexts */
+    maskFilter->InPlaceOff();
+    maskFilter->SetInput(input);
+    maskFilter->SetMaskImage(mask);
+    maskFilter->Update();
+
+    ImageType::Pointer output = maskFilter->GetOutput();
+    output->DisconnectPipeline();
+    return output;
+    }
+
+  MaskStage(ParameterMap const &parameters) :
+      Stage("mask", parameters)
+    {
+    m_Input = this->InputSlot("input");
+    m_Mask = this->InputSlot("mask");
+    m_Output = this->OutputSlot("out");
+    }
+
+  void Run(Context & context)
+    {
+    ImageType::Pointer output = Process(context.GetImage(m_Input),
+                                        context.GetImage(m_Mask));
+    context.SetImage(m_Output, output.GetPointer());
+    }
+
+private:
+  std::string m_Input;
+  std::string m_Mask;
+  std::string m_Output;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* MASKSTAGE_H_ */
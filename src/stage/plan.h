@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef PLAN_H_
+#define PLAN_H_
+
+#include <limits>
+#include <string>
+
+#include "stage/stage.h"
+#include "stage/rangeStage.h"
+#include "stage/transformStage.h"
+#include "stage/histogramStage.h"
+#include "stage/tissueStage.h"
+#include "stage/hypStage.h"
+#include "stage/scoreStage.h"
+#include "stage/statisticsStage.h"
+#include "stage/maskStage.h"
+
+#include "util/batch.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+inline Stage* CreateStage(std::string const &name,
+                          ParameterMap const &parameters)
+  {
+  if (name == "range") return new RangeStage(parameters);
+  if (name == "transform") return new TransformStage(parameters);
+  if (name == "histogram") return new HistogramStage(parameters);
+  if (name == "tissue") return new TissueStage(parameters);
+  if (name == "hyp") return new HypStage(parameters);
+  if (name == "score") return new ScoreStage(parameters);
+  if (name == "statistics-filter") return new StatisticsStage(parameters);
+  if (name == "mask") return new MaskStage(parameters);
+  itkGenericExceptionMacro("Unknown stage " << name);
+  }
+
+/*
+ * A plan has one entry per line:
+ *   input <slot> <file>     Slot read from file when first used
+ *   output <slot> <file>    Slot written to file once produced
+ *   <stage> key=value ...   Stage with the long options of its cascade-*
+ *                           tool, slots in place of file names. A bare key
+ *                           is a switch.
+ * name is used in the error messages.
+ */
+inline void AddPlan(util::ManifestType const &plan, std::string const &name,
+                    Context & context, Graph & graph)
+  {
+  for (size_t r = 0; r < plan.size(); r++)
+    {
+    const util::ManifestRow & row = plan[r];
+    if (row[0] == "input" || row[0] == "output")
+      {
+      if (row.size() != 3)
+        {
+        itkGenericExceptionMacro(
+            name << ": " << row[0] << " needs a slot and a file.");
+        }
+      if (row[0] == "input") context.BindInput(row[1], row[2]);
+      else context.BindOutput(row[1], row[2]);
+      continue;
+      }
+
+    ParameterMap parameters;
+    for (size_t c = 1; c < row.size(); c++)
+      {
+      const std::string::size_type equal = row[c].find('=');
+      if (equal == std::string::npos) parameters[row[c]] = "1";
+      else parameters[row[c].substr(0, equal)] = row[c].substr(equal + 1);
+      }
+    Stage* stage = CreateStage(row[0], parameters);
+    graph.AddStage(stage);
+    stage->CheckParameters();
+    }
+  }
+
+inline void ReadPlan(std::string const &filename, Context & context,
+                     Graph & graph)
+  {
+  AddPlan(util::ReadManifest(filename, 1,
+                             std::numeric_limits< size_t >::max()),
+          filename, context, graph);
+  }
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* PLAN_H_ */
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef RANGESTAGE_H_
+#define RANGESTAGE_H_
+
+#include "itkCastImageFilter.h"
+#include "itkMaskImageFilter.h"
+#include "itkBinaryThresholdImageFilter.h"
+
+#include "pipeline/itkSliceNormalizerPipeline.h"
+#include "pipeline/itkN4Pipeline.h"
+#include "pipeline/itkIntensityNormalizerPipeline.h"
+
+#include "stage/stage.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+struct RangeSettings
+  {
+  unsigned int Bins;
+  bool Scale;
+
+  RangeSettings() :
+      Bins(20), Scale(true)
+    {
+    }
+  };
+
+/*
+ * Slice and bias field correction of cascade-range.
+ *
+ * range input=<slot> [mask=<slot>] out=<slot> [bins=20] [no-scale]
+ */
+class RangeStage: public Stage
+{
+public:
+  typedef unsigned int InputPixelType;
+  typedef float InterimPixelType;
+  typedef char MaskPixelType;
+
+  typedef itk::Image< InputPixelType, DIM > InputImageType;
+  typedef itk::Image< InterimPixelType, DIM > InterimImageType;
+  typedef itk::Image< MaskPixelType, DIM > MaskImageType;
+
+  typedef itk::CastImageFilter< InputImageType, InterimImageType > CastToInterimType;
+  typedef itk::SliceNormalizerPipeline< InterimImageType, InterimImageType, MaskImageType > SliceNormalizerType;
+  typedef itk::IntensityNormalizerPipeline< InterimImageType, InterimImageType, MaskImageType > IntensityNormalizerType;
+  typedef itk::BinaryThresholdImageFilter< MaskImageType, MaskImageType > BinaryThresholdImageFilterType;
+  typedef itk::N4Pipeline< InterimImageType, InterimImageType > N4PipelineType;
+  typedef itk::MaskImageFilter< InterimImageType, InterimImageType > MaskFilterType;
+
+  /** Without a mask, cascade-range uses the input read as a mask */
+  static ImageType::Pointer Process(const InputImageType* input,
+                                    const MaskImageType* mask,
+                                    RangeSettings const &settings)
+    {
+    BinaryThresholdImageFilterType::Pointer thresholdFilter =
+        BinaryThresholdImageFilterType::New();
+    thresholdFilter->InPlaceOff();
+    thresholdFilter->SetInput(mask);
+    thresholdFilter->SetLowerThreshold(1);
+
+    CastToInterimType::Pointer castToInterim = CastToInterimType::New();
+    castToInterim->SetInput(input);
+
+    SliceNormalizerType::Pointer sliceNormalizer = SliceNormalizerType::New();
+    sliceNormalizer->SetInput(castToInterim->GetOutput());
+    sliceNormalizer->SetMaskImage(thresholdFilter->GetOutput());
+    sliceNormalizer->SetMaskValue(thresholdFilter->GetInsideValue());
+    sliceNormalizer->SetNumberOfLevels(settings.Bins);
+
+    N4PipelineType::Pointer n4Corrector = N4PipelineType::New();
+    n4Corrector->SetInput(sliceNormalizer->GetOutput());
+    n4Corrector->Update();
+
+    IntensityNormalizerType::Pointer intensityNormalizer =
+        IntensityNormalizerType::New();
+
+    MaskFilterType::Pointer maskFilter = MaskFilterType::New();
+    maskFilter->SetMaskImage(castToInterim->GetOutput());
+
+    if (settings.Scale)
+      {
+      intensityNormalizer->SetInput(n4Corrector->GetOutput());
+      intensityNormalizer->SetMaskImage(thresholdFilter->GetOutput());
+      intensityNormalizer->SetMaskValue(thresholdFilter->GetInsideValue());
+      intensityNormalizer->SetNumberOfLevels(settings.Bins);
+
+      maskFilter->SetInput(intensityNormalizer->GetOutput());
+      }
+    else
+      {
+      maskFilter->SetInput(n4Corrector->GetOutput());
+      }
+    maskFilter->Update();
+
+    ImageType::Pointer output = maskFilter->GetOutput();
+    output->DisconnectPipeline();
+    return output;
+    }
+
+  RangeStage(ParameterMap const &parameters) :
+      Stage("range", parameters)
+    {
+    m_Input = this->InputSlot("input");
+    m_Mask = this->InputSlot("mask", false);
+    m_Output = this->OutputSlot("out");
+    m_Settings.Bins = this->GetValue< unsigned int >("bins", 20);
+    m_Settings.Scale = !this->GetSwitch("no-scale");
+    }
+
+  void Run(Context & context)
+    {
+    ImageType::Pointer image = context.GetImage(m_Input);
+    MaskImageType::Pointer mask = CastImage< MaskImageType >(
+        m_Mask.empty() ? image.GetPointer() :
+                         context.GetImage(m_Mask).GetPointer());
+    ImageType::Pointer output = Process(
+        CastImage< InputImageType >(image.GetPointer()), mask, m_Settings);
+    context.SetImage(m_Output, output.GetPointer());
+    }
+
+private:
+  std::string m_Input;
+  std::string m_Mask;
+  std::string m_Output;
+  RangeSettings m_Settings;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* RANGESTAGE_H_ */
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef SCORESTAGE_H_
+#define SCORESTAGE_H_
+
+#include <sstream>
+#include <vector>
+
+#include "itkVectorImage.h"
+#include "itkVectorIndexSelectionCastImageFilter.h"
+
+#include "util/itkNormalModelScoreImageFilter.h"
+#include "util/itkStateResampleImageFilter.h"
+#include "util/transformLoader.h"
+#include "util/stateModel.h"
+
+#include "stage/stage.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+struct ScoreSettings
+  {
+  /** light, dark or other */
+  std::string Type;
+  int Reference;
+  /** Minimum model mean as a percentile of the reference class */
+  float MeanPercentile;
+  std::vector< int > Classes;
+  /** Native state prefix, <prefix>_<class>_{number,mean,stddev}.nii.gz */
+  std::string State;
+  /** Packed model (.cms) and the sequence evaluated from it */
+  std::string Model;
+  std::string Sequence;
+  /** Transform from model to range space */
+  std::string Transform;
+  bool Absolute;
+
+  ScoreSettings() :
+      Type("other"), Reference(3), MeanPercentile(20), Absolute(false)
+    {
+    Classes.push_back(2);
+    Classes.push_back(3);
+    }
+  };
+
+/*
+ * Normal brain model and z-score of cascade-score.
+ *
+ * score range=<slot> pve=<slot> [mask=<slot>] [previous=<slot>]
+ *   (state=<prefix> | model=<file.cms> sequence=<name> [transform=<file>]
+ *   [space=<slot>] [absolute]) out=<slot> [model-mean=<slot>]
+ *   [model-std=<slot>] [type=other] [class=2,3] [reference=3]
+ *   [mean-percentile=20]
+ */
+class ScoreStage: public Stage
+{
+public:
+  typedef itk::VectorImage< PixelType, DIM > StateImageType;
+
+  typedef itk::NormalModelScoreImageFilter< ImageType > ScoreFilterType;
+  typedef itk::StateResampleImageFilter< StateImageType > ResampleFilterType;
+  typedef ResampleFilterType::TransformType TransformType;
+  typedef itk::VectorIndexSelectionCastImageFilter< StateImageType, ImageType > SelectFilterType;
+
+  /** Single sequence states: weight, sum and sum of squared deviations */
+  itkStaticConstMacro(StateLength, unsigned int, 3);
+
+  /*
+   * The returned filter is up to date. mask, previous and space may be null,
+   * space is the image the model side of an FSL transform refers to, the
+   * model grid by default. State images kept by assets are read from it.
+   */
+  static ScoreFilterType::Pointer Process(const ImageType* range,
+                                          const ImageType* pve,
+                                          const ImageType* mask,
+                                          const ImageType* previous,
+                                          const itk::ImageBase< DIM >* space,
+                                          ScoreSettings const &settings,
+                                          AssetStore* assets = 0)
+    {
+    if (settings.State.empty() == settings.Model.empty()
+        || (!settings.Model.empty() && settings.Sequence.empty()))
+      {
+      itkGenericExceptionMacro(
+          << "Either a state or a model with a sequence should be set.");
+      }
+
+    if (!settings.Model.empty())
+      {
+      util::StateModelInfo info;
+      StateImageType::Pointer modelImage = util::ReadStateModel<
+          StateImageType >(settings.Model, info);
+      TransformType::Pointer transform;
+      if (!settings.Transform.empty())
+        {
+        /** FSL transforms refer to the image they were estimated with */
+        transform = util::LoadTransform(
+            settings.Transform, range,
+            space ? space : static_cast< const itk::ImageBase< DIM >* >(
+                                modelImage.GetPointer()),
+            !settings.Absolute);
+        }
+      return Process(range, pve, mask, previous, modelImage, info, transform,
+                     settings);
+      }
+
+    ScoreFilterType::Pointer scoreFilter = CreateScoreFilter(range, pve, mask,
+                                                             previous,
+                                                             settings);
+    const std::vector< int > & labels = settings.Classes;
+    for (unsigned int c = 0; c < labels.size(); c++)
+      {
+      std::ostringstream prefix;
+      prefix << settings.State << "_" << labels[c] << "_";
+      scoreFilter->AddClass(
+          labels[c], ReadImage(prefix.str() + "number.nii.gz", assets),
+          ReadImage(prefix.str() + "mean.nii.gz", assets),
+          ReadImage(prefix.str() + "stddev.nii.gz", assets));
+      }
+    scoreFilter->Update();
+    return scoreFilter;
+    }
+
+  /*
+   * Score against a packed model that is already read. The model is merged
+   * onto the range grid in memory and only read, so one model can serve
+   * concurrent calls. transform maps range points to the model and may be
+   * null. State, Model and Transform of the settings are not used.
+   */
+  static ScoreFilterType::Pointer Process(const ImageType* range,
+                                          const ImageType* pve,
+                                          const ImageType* mask,
+                                          const ImageType* previous,
+                                          const StateImageType* model,
+                                          util::StateModelInfo const &info,
+                                          const TransformType* transform,
+                                          ScoreSettings const &settings)
+    {
+    const std::vector< int > & labels = settings.Classes;
+    std::vector< unsigned int > groups;
+    for (unsigned int c = 0; c < labels.size(); c++)
+      {
+      const int group = info.GetGroupIndex(labels[c], settings.Sequence);
+      if (info.MeasurementDimension != 1 || group < 0)
+        {
+        itkGenericExceptionMacro(<< "No state of " << settings.Sequence
+                                 << " class " << labels[c] << " in the model");
+        }
+      groups.push_back(group);
+      }
+
+    ResampleFilterType::Pointer resampleFilter = ResampleFilterType::New();
+    resampleFilter->SetInput(
+        util::ExtractStateGroups(model, groups, StateLength));
+    resampleFilter->SetReferenceImage(range);
+    resampleFilter->SetStateGroupSize(StateLength);
+    if (transform)
+      {
+      resampleFilter->SetTransform(transform);
+      }
+    resampleFilter->Update();
+
+    ScoreFilterType::Pointer scoreFilter = CreateScoreFilter(range, pve, mask,
+                                                             previous,
+                                                             settings);
+    for (unsigned int c = 0; c < labels.size(); c++)
+      {
+      const StateImageType* native = resampleFilter->GetOutput();
+      scoreFilter->AddClass(labels[c],
+                            SelectComponent(native, c * StateLength),
+                            SelectComponent(native, c * StateLength + 1),
+                            SelectComponent(native, c * StateLength + 2));
+      }
+    scoreFilter->Update();
+    return scoreFilter;
+    }
+
+  ScoreStage(ParameterMap const &parameters) :
+      Stage("score", parameters)
+    {
+    m_Range = this->InputSlot("range");
+    m_PVE = this->InputSlot("pve");
+    m_Mask = this->InputSlot("mask", false);
+    m_Previous = this->InputSlot("previous", false);
+    m_Space = this->InputSlot("space", false);
+    m_Output = this->OutputSlot("out");
+    m_Mean = this->OutputSlot("model-mean", false);
+    m_StandardDeviation = this->OutputSlot("model-std", false);
+    m_Settings.State = this->NameParameter("state");
+    m_Settings.Model = this->FileParameter("model");
+    m_Settings.Sequence = this->GetString("sequence", "");
+    m_Settings.Transform = this->FileParameter("transform");
+    m_Settings.Absolute = this->GetSwitch("absolute");
+    m_Settings.Type = this->GetString("type", m_Settings.Type);
+    m_Settings.Classes = this->GetValues< int >("class", m_Settings.Classes);
+    m_Settings.Reference = this->GetValue< int >("reference",
+                                                 m_Settings.Reference);
+    m_Settings.MeanPercentile = this->GetValue< float >(
+        "mean-percentile", m_Settings.MeanPercentile);
+
+    const char* stateFiles[] = { "number", "mean", "stddev" };
+    for (unsigned int c = 0; !m_Settings.State.empty()
+        && c < m_Settings.Classes.size(); c++)
+      {
+      std::ostringstream prefix;
+      prefix << m_Settings.State << "_" << m_Settings.Classes[c] << "_";
+      for (unsigned int f = 0; f < 3; f++)
+        this->AddFile(prefix.str() + stateFiles[f] + ".nii.gz");
+      }
+    }
+
+  void Run(Context & context)
+    {
+    ImageType::Pointer mask, previous, space;
+    if (!m_Mask.empty()) mask = context.GetImage(m_Mask);
+    if (!m_Previous.empty()) previous = context.GetImage(m_Previous);
+    if (!m_Space.empty()) space = context.GetImage(m_Space);
+
+    ScoreFilterType::Pointer scoreFilter = Process(context.GetImage(m_Range),
+                                                   context.GetImage(m_PVE),
+                                                   mask, previous, space,
+                                                   m_Settings,
+                                                   context.GetAssetStore());
+    context.SetImage(m_Output, scoreFilter->GetScoreOutput());
+    SetIfGiven(context, m_Mean, scoreFilter->GetMeanOutput());
+    SetIfGiven(context, m_StandardDeviation,
+               scoreFilter->GetStandardDeviationOutput());
+    }
+
+private:
+  static ScoreFilterType::Pointer CreateScoreFilter(const ImageType* range,
+                                                    const ImageType* pve,
+                                                    const ImageType* mask,
+                                                    const ImageType* previous,
+                                                    ScoreSettings const &settings)
+    {
+    ScoreFilterType::Pointer scoreFilter = ScoreFilterType::New();
+    scoreFilter->SetRangeImage(range);
+    scoreFilter->SetLabelImage(pve);
+    if (mask)
+      {
+      scoreFilter->SetMaskImage(mask);
+      }
+    if (previous)
+      {
+      scoreFilter->SetPreviousScoreImage(previous);
+      }
+
+    if (settings.Type == "light")
+      scoreFilter->SetSequenceType(ScoreFilterType::LIGHT);
+    else if (settings.Type == "dark")
+      scoreFilter->SetSequenceType(ScoreFilterType::DARK);
+    else
+      scoreFilter->SetSequenceType(ScoreFilterType::OTHER);
+    scoreFilter->SetReferenceLabel(settings.Reference);
+    scoreFilter->SetMeanMinimumPercentile(settings.MeanPercentile / 100.0);
+    return scoreFilter;
+    }
+
+  static ImageType::Pointer SelectComponent(const StateImageType* state,
+                                            unsigned int component)
+    {
+    SelectFilterType::Pointer selectFilter = SelectFilterType::New();
+    selectFilter->SetInput(state);
+    selectFilter->SetIndex(component);
+    selectFilter->Update();
+    return selectFilter->GetOutput();
+    }
+
+  std::string m_Range;
+  std::string m_PVE;
+  std::string m_Mask;
+  std::string m_Previous;
+  std::string m_Space;
+  std::string m_Output;
+  std::string m_Mean;
+  std::string m_StandardDeviation;
+  ScoreSettings m_Settings;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* SCORESTAGE_H_ */
@@ -0,0 +1,859 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef STAGE_H_
+#define STAGE_H_
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "itkImage.h"
+#include "itkCastImageFilter.h"
+#include "itkTimeProbe.h"
+#include "itkSimpleFastMutexLock.h"
+
+#include "util/histogram.h"
+#include "util/helpers.h"
+#include "util/hash.h"
+#include "util/profiler.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+/** Images are exchanged between stages as float, as on disk */
+typedef float PixelType;
+typedef itk::Image< PixelType, DIM > ImageType;
+
+typedef std::map< std::string, std::string > ParameterMap;
+typedef std::vector< std::string > SlotList;
+
+/*
+ * Cast between the float slots and the pixel types the stages work with. The
+ * cast is the same conversion the image reader does when a file is read with
+ * that pixel type, so a stage sees the same values as the cascade-* tool.
+ */
+template< class TOutputImage, class TInputImage >
+typename TOutputImage::Pointer CastImage(const TInputImage* image)
+  {
+  typedef itk::CastImageFilter< TInputImage, TOutputImage > CastFilterType;
+  typename CastFilterType::Pointer castFilter = CastFilterType::New();
+  /** Same pixel types would otherwise hand over and release the input */
+  castFilter->InPlaceOff();
+  castFilter->SetInput(image);
+  castFilter->Update();
+  typename TOutputImage::Pointer output = castFilter->GetOutput();
+  output->DisconnectPipeline();
+  return output;
+  }
+
+/*
+ * Images and histograms of the files under a set of directories, e.g. the
+ * standard space images and the models in data/, kept in memory once read
+ * and read again only when their modification time changes. A store is
+ * shared by the contexts of concurrent subjects, each gets its own view of
+ * the pixels.
+ */
+class AssetStore
+{
+public:
+  void AddDirectory(std::string const &directory)
+    {
+    if (directory.empty()) return;
+    m_Directories.push_back(
+        util::endsWith(directory, "/") ? directory : directory + "/");
+    }
+
+  bool IsAsset(std::string const &filename) const
+    {
+    for (size_t d = 0; d < m_Directories.size(); d++)
+      {
+      if (filename.compare(0, m_Directories[d].size(), m_Directories[d]) == 0)
+        return true;
+      }
+    return false;
+    }
+
+  ImageType::Pointer GetImage(std::string const &filename)
+    {
+    const time_t modified = ModificationTime(filename);
+    m_Lock.Lock();
+    ImageEntry & entry = m_Images[filename];
+    try
+      {
+      if (!entry.Image || entry.Modified != modified)
+        {
+        entry.Image = util::LoadImage< ImageType >(filename);
+        entry.Modified = modified;
+        }
+      }
+    catch (...)
+      {
+      m_Images.erase(filename);
+      m_Lock.Unlock();
+      throw;
+      }
+    ImageType::Pointer image = util::ShareImage(entry.Image.GetPointer());
+    m_Lock.Unlock();
+    return image;
+    }
+
+  bool GetHistogram(std::string const &filename,
+                    util::HistogramTable &histogram)
+    {
+    const time_t modified = ModificationTime(filename);
+    m_Lock.Lock();
+    HistogramEntry & entry = m_Histograms[filename];
+    if (entry.Histogram.empty() || entry.Modified != modified)
+      {
+      entry.Histogram.clear();
+      util::ReadHistogram(filename, entry.Histogram);
+      entry.Modified = modified;
+      }
+    const bool read = !entry.Histogram.empty();
+    if (read) histogram = entry.Histogram;
+    else m_Histograms.erase(filename);
+    m_Lock.Unlock();
+    return read;
+    }
+
+private:
+  struct ImageEntry
+    {
+    ImageType::Pointer Image;
+    time_t Modified;
+
+    ImageEntry() :
+        Modified(0)
+      {
+      }
+    };
+  struct HistogramEntry
+    {
+    util::HistogramTable Histogram;
+    time_t Modified;
+
+    HistogramEntry() :
+        Modified(0)
+      {
+      }
+    };
+
+  static time_t ModificationTime(std::string const &filename)
+    {
+    struct stat status;
+    return stat(filename.c_str(), &status) == 0 ? status.st_mtime : 0;
+    }
+
+  std::vector< std::string > m_Directories;
+  std::map< std::string, ImageEntry > m_Images;
+  std::map< std::string, HistogramEntry > m_Histograms;
+  itk::SimpleFastMutexLock m_Lock;
+};
+
+/** Read through the store when it keeps the file, assets may be null */
+inline ImageType::Pointer ReadImage(std::string const &filename,
+                                    AssetStore* assets)
+  {
+  if (assets && assets->IsAsset(filename)) return assets->GetImage(filename);
+  return util::LoadImage< ImageType >(filename);
+  }
+
+/*
+ * Named images and histograms of a single subject. A slot bound to a file
+ * is read the first time it is used and written as soon as it is produced.
+ * Slots that are not bound only live in memory.
+ */
+class Context
+{
+public:
+  Context() :
+      m_Assets(0)
+    {
+    }
+
+  /** Input files in the store are read from it, the store is not owned */
+  void SetAssetStore(AssetStore* assets)
+    {
+    m_Assets = assets;
+    }
+  AssetStore* GetAssetStore() const
+    {
+    return m_Assets;
+    }
+
+  void BindInput(std::string const &slot, std::string const &filename)
+    {
+    m_InputFiles[slot] = filename;
+    }
+  void BindOutput(std::string const &slot, std::string const &filename)
+    {
+    m_OutputFiles[slot] = filename;
+    }
+  bool IsInput(std::string const &slot) const
+    {
+    return m_InputFiles.count(slot) > 0;
+    }
+  bool IsOutput(std::string const &slot) const
+    {
+    return m_OutputFiles.count(slot) > 0;
+    }
+
+  ImageType::Pointer GetImage(std::string const &slot)
+    {
+    std::map< std::string, ImageType::Pointer >::iterator image =
+        m_Images.find(slot);
+    if (image != m_Images.end()) return image->second;
+    ImageType::Pointer loaded = ReadImage(this->GetInputFile(slot), m_Assets);
+    m_Images[slot] = loaded;
+    return loaded;
+    }
+
+  /** Output slots of a typed image are written with their own pixel type */
+  template< class TImage >
+  void SetImage(std::string const &slot, const TImage* image)
+    {
+    if (this->IsOutput(slot))
+      util::WriteImage(m_OutputFiles[slot], image);
+    m_Images[slot] = CastImage< ImageType >(image);
+    }
+  void SetImage(std::string const &slot, ImageType* image)
+    {
+    image->DisconnectPipeline();
+    if (this->IsOutput(slot)) util::WriteImage(m_OutputFiles[slot], image);
+    m_Images[slot] = image;
+    }
+
+  const util::HistogramTable & GetHistogram(std::string const &slot)
+    {
+    std::map< std::string, util::HistogramTable >::iterator histogram =
+        m_Histograms.find(slot);
+    if (histogram != m_Histograms.end()) return histogram->second;
+    const std::string filename = this->GetInputFile(slot);
+    const bool read = m_Assets && m_Assets->IsAsset(filename) ?
+        m_Assets->GetHistogram(filename, m_Histograms[slot]) :
+        util::ReadHistogram(filename, m_Histograms[slot]);
+    if (!read)
+      {
+      m_Histograms.erase(slot);
+      itkGenericExceptionMacro("Can not read histogram " << filename);
+      }
+    return m_Histograms[slot];
+    }
+  void SetHistogram(std::string const &slot,
+                    util::HistogramTable const &histogram)
+    {
+    if (this->IsOutput(slot))
+      util::WriteHistogram(m_OutputFiles[slot], histogram);
+    m_Histograms[slot] = histogram;
+    }
+
+  /** Free the memory of a slot, bound inputs are read again if needed */
+  void Release(std::string const &slot)
+    {
+    m_Images.erase(slot);
+    m_Histograms.erase(slot);
+    }
+
+  bool IsHistogram(std::string const &slot) const
+    {
+    return m_Histograms.count(slot) > 0
+        || util::endsWith(this->GetFile(m_InputFiles, slot), ".hist")
+        || util::endsWith(this->GetFile(m_OutputFiles, slot), ".hist");
+    }
+  std::string GetOutputFile(std::string const &slot) const
+    {
+    return this->GetFile(m_OutputFiles, slot);
+    }
+
+  /*
+   * Content hash of a slot: the hash of the file of an input slot, or the
+   * hash the producing stage gave to it.
+   */
+  util::HashType GetSlotHash(std::string const &slot)
+    {
+    std::map< std::string, util::HashType >::const_iterator hash =
+        m_SlotHashes.find(slot);
+    if (hash != m_SlotHashes.end()) return hash->second;
+    return m_SlotHashes[slot] = this->GetFileHash(this->GetInputFile(slot));
+    }
+  void SetSlotHash(std::string const &slot, util::HashType hash)
+    {
+    m_SlotHashes[slot] = hash;
+    }
+  util::HashType GetFileHash(std::string const &filename)
+    {
+    std::map< std::string, util::HashType >::const_iterator hash =
+        m_FileHashes.find(filename);
+    if (hash != m_FileHashes.end()) return hash->second;
+    return m_FileHashes[filename] = util::HashFile(filename);
+    }
+
+  /** Write the content of a produced slot */
+  void WriteSlot(std::string const &slot, std::string const &filename)
+    {
+    if (m_Histograms.count(slot))
+      util::WriteHistogram(filename, m_Histograms[slot]);
+    else
+      util::WriteImage(filename, this->GetImage(slot).GetPointer());
+    }
+
+  /*
+   * Use a stored copy of a slot instead of producing it. The slot is read
+   * from the copy when used and a bound output gets the copy as it is.
+   */
+  void RestoreSlot(std::string const &slot, std::string const &filename)
+    {
+    if (this->IsOutput(slot))
+      util::CopyFile(filename, m_OutputFiles[slot]);
+    this->Release(slot);
+    m_InputFiles[slot] = filename;
+    }
+
+private:
+  static std::string GetFile(std::map< std::string, std::string > const &files,
+                             std::string const &slot)
+    {
+    std::map< std::string, std::string >::const_iterator file = files.find(
+        slot);
+    return file == files.end() ? std::string() : file->second;
+    }
+
+  std::string GetInputFile(std::string const &slot) const
+    {
+    std::map< std::string, std::string >::const_iterator file =
+        m_InputFiles.find(slot);
+    if (file == m_InputFiles.end())
+      {
+      itkGenericExceptionMacro("Slot " << slot << " has not been produced.");
+      }
+    return file->second;
+    }
+
+  std::map< std::string, std::string > m_InputFiles;
+  std::map< std::string, std::string > m_OutputFiles;
+  std::map< std::string, ImageType::Pointer > m_Images;
+  std::map< std::string, util::HistogramTable > m_Histograms;
+  std::map< std::string, util::HashType > m_SlotHashes;
+  std::map< std::string, util::HashType > m_FileHashes;
+  AssetStore* m_Assets;
+};
+
+/*
+ * A step of the subject graph. The constructor reads the parameters of the
+ * stage, "key=value" as the long options of the matching cascade-* tool, and
+ * declares which slots the stage reads and writes.
+ */
+class Stage
+{
+public:
+  Stage(std::string const &name, ParameterMap const &parameters) :
+      m_Name(name), m_Parameters(parameters)
+    {
+    }
+  virtual ~Stage()
+    {
+    }
+
+  std::string const & GetName() const
+    {
+    return m_Name;
+    }
+  SlotList const & GetInputs() const
+    {
+    return m_Inputs;
+    }
+  SlotList const & GetOutputs() const
+    {
+    return m_Outputs;
+    }
+  /** The parameter names of the slots, in the order of the slots */
+  SlotList const & GetInputKeys() const
+    {
+    return m_InputKeys;
+    }
+  SlotList const & GetOutputKeys() const
+    {
+    return m_OutputKeys;
+    }
+  /** Files read by the stage besides its slots e.g. a model */
+  SlotList const & GetFiles() const
+    {
+    return m_Files;
+    }
+  /** Parameters other than slot and file names */
+  ParameterMap GetSettings() const
+    {
+    ParameterMap settings;
+    for (ParameterMap::const_iterator p = m_Parameters.begin();
+        p != m_Parameters.end(); ++p)
+      {
+      if (!m_ContentKeys.count(p->first)) settings.insert(*p);
+      }
+    return settings;
+    }
+
+  virtual void Run(Context & context) = 0;
+
+  /** Misspelled parameters would silently fall back to their defaults */
+  void CheckParameters() const
+    {
+    for (ParameterMap::const_iterator p = m_Parameters.begin();
+        p != m_Parameters.end(); ++p)
+      {
+      if (!m_Used.count(p->first))
+        {
+        itkGenericExceptionMacro(
+            "Unknown parameter " << p->first << " of " << m_Name);
+        }
+      }
+    }
+
+protected:
+  /** Slot names, an empty name for a missing optional slot */
+  std::string InputSlot(std::string const &key, bool required = true)
+    {
+    const std::string slot = this->GetString(key, "", required);
+    m_ContentKeys.insert(key);
+    if (!slot.empty())
+      {
+      m_Inputs.push_back(slot);
+      m_InputKeys.push_back(key);
+      }
+    return slot;
+    }
+  std::string OutputSlot(std::string const &key, bool required = true)
+    {
+    const std::string slot = this->GetString(key, "", required);
+    m_ContentKeys.insert(key);
+    if (!slot.empty())
+      {
+      m_Outputs.push_back(slot);
+      m_OutputKeys.push_back(key);
+      }
+    return slot;
+    }
+
+  /** A file read by the stage, an empty name if not given */
+  std::string FileParameter(std::string const &key, bool required = false)
+    {
+    const std::string filename = this->NameParameter(key, required);
+    this->AddFile(filename);
+    return filename;
+    }
+  /** A name of files, e.g. a prefix, the stage declares with AddFile */
+  std::string NameParameter(std::string const &key, bool required = false)
+    {
+    m_ContentKeys.insert(key);
+    return this->GetString(key, "", required);
+    }
+  void AddFile(std::string const &filename)
+    {
+    if (!filename.empty()) m_Files.push_back(filename);
+    }
+
+  std::string GetString(std::string const &key,
+                        std::string const &defaultValue,
+                        bool required = false)
+    {
+    m_Used.insert(key);
+    ParameterMap::const_iterator p = m_Parameters.find(key);
+    if (p != m_Parameters.end()) return p->second;
+    if (required)
+      {
+      itkGenericExceptionMacro(
+          "Parameter " << key << " of " << m_Name << " is required.");
+      }
+    return defaultValue;
+    }
+
+  template< class T >
+  T GetValue(std::string const &key, T defaultValue)
+    {
+    const std::string value = this->GetString(key, "");
+    if (value.empty()) return defaultValue;
+    std::istringstream stream(value);
+    T parsed;
+    if (!(stream >> parsed) || !stream.eof())
+      {
+      itkGenericExceptionMacro(
+          "Invalid value " << value << " for " << key << " of " << m_Name);
+      }
+    return parsed;
+    }
+
+  /** Comma separated values e.g. class=2,3 */
+  template< class T >
+  std::vector< T > GetValues(std::string const &key,
+                             std::vector< T > const &defaultValues)
+    {
+    std::string value = this->GetString(key, "");
+    if (value.empty()) return defaultValues;
+    std::replace(value.begin(), value.end(), ',', ' ');
+    std::istringstream stream(value);
+    std::vector< T > parsed;
+    T item;
+    while (stream >> item)
+      parsed.push_back(item);
+    if (!stream.eof() || parsed.empty())
+      {
+      itkGenericExceptionMacro(
+          "Invalid values " << value << " for " << key << " of " << m_Name);
+      }
+    return parsed;
+    }
+
+  /** A switch is given as a bare key or key=1 */
+  bool GetSwitch(std::string const &key)
+    {
+    return this->GetValue< int >(key, 0) != 0;
+    }
+
+  static void SetIfGiven(Context & context, std::string const &slot,
+                         ImageType* image)
+    {
+    if (!slot.empty()) context.SetImage(slot, image);
+    }
+  template< class TImage >
+  static void SetIfGiven(Context & context, std::string const &slot,
+                         const TImage* image)
+    {
+    if (!slot.empty()) context.SetImage(slot, image);
+    }
+
+private:
+  std::string m_Name;
+  ParameterMap m_Parameters;
+  std::set< std::string > m_Used;
+  std::set< std::string > m_ContentKeys;
+  SlotList m_Inputs;
+  SlotList m_Outputs;
+  SlotList m_InputKeys;
+  SlotList m_OutputKeys;
+  SlotList m_Files;
+};
+
+/*
+ * Content addressed store of stage outputs, so re-running a plan only
+ * recomputes the stages whose inputs or settings changed. The key of a
+ * stage hashes CASCADE_VERSION, the stage name and settings, the content of
+ * its input slots and files, the names of its outputs and how they are kept:
+ * a bound output is stored as a copy of its file, with the pixel type and
+ * compression of that file, an unbound one as .nii or .hist. The content of a
+ * produced slot is identified by the key of its stage, so unchanged
+ * upstream stages are neither run nor hashed pixel by pixel. The outputs of
+ * a stage are kept in <directory>/<key>/<output parameter><extension>.
+ */
+class StageCache
+{
+public:
+  StageCache(std::string const &directory) :
+      m_Directory(directory)
+    {
+    struct stat status;
+    if ((mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST)
+        || stat(directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode))
+      {
+      itkGenericExceptionMacro("Can not use cache directory " << directory);
+      }
+    }
+
+  util::HashType ComputeKey(Stage const &stage, Context & context) const
+    {
+    util::HashType key = util::HashString(CASCADE_VERSION);
+    key = util::HashString(stage.GetName(), key);
+    const ParameterMap settings = stage.GetSettings();
+    for (ParameterMap::const_iterator p = settings.begin();
+        p != settings.end(); ++p)
+      {
+      key = util::HashString(p->first, key);
+      key = util::HashString(p->second, key);
+      }
+    const SlotList & inputs = stage.GetInputs();
+    for (size_t i = 0; i < inputs.size(); i++)
+      {
+      const util::HashType content = context.GetSlotHash(inputs[i]);
+      key = util::HashString(stage.GetInputKeys()[i], key);
+      key = util::HashBytes(&content, sizeof(content), key);
+      }
+    const SlotList & files = stage.GetFiles();
+    for (size_t f = 0; f < files.size(); f++)
+      {
+      const util::HashType content = context.GetFileHash(files[f]);
+      key = util::HashBytes(&content, sizeof(content), key);
+      }
+    const SlotList & outputKeys = stage.GetOutputKeys();
+    const SlotList & outputs = stage.GetOutputs();
+    for (size_t o = 0; o < outputKeys.size(); o++)
+      {
+      key = util::HashString(outputKeys[o], key);
+      key = util::HashString(
+          context.IsOutput(outputs[o]) ?
+              "file" + Extension(context.GetOutputFile(outputs[o])) :
+              std::string("memory"), key);
+      }
+    return key;
+    }
+
+  /** Restore all outputs of the stage, false if any is missing */
+  bool Restore(util::HashType key, Stage const &stage,
+               Context & context) const
+    {
+    const std::string entry = this->GetEntry(key);
+    const SlotList & outputs = stage.GetOutputs();
+    SlotList stored(outputs.size());
+    for (size_t o = 0; o < outputs.size(); o++)
+      {
+      const std::string name = entry + "/" + stage.GetOutputKeys()[o];
+      const std::string outputFile = context.GetOutputFile(outputs[o]);
+      if (!outputFile.empty())
+        {
+        stored[o] = name + Extension(outputFile);
+        }
+      else if (Exists(name + ".nii"))
+        {
+        stored[o] = name + ".nii";
+        }
+      else
+        {
+        stored[o] = name + ".hist";
+        }
+      if (!Exists(stored[o])) return false;
+      }
+    for (size_t o = 0; o < outputs.size(); o++)
+      context.RestoreSlot(outputs[o], stored[o]);
+    return true;
+    }
+
+  /** Store the outputs of a stage that has just run */
+  void Store(util::HashType key, Stage const &stage, Context & context) const
+    {
+    const std::string entry = this->GetEntry(key);
+    if (Exists(entry)) return;
+
+    std::string temporary = m_Directory + "/.entry-XXXXXX";
+    if (!mkdtemp(&temporary[0]))
+      {
+      itkGenericExceptionMacro("Can not write to cache " << m_Directory);
+      }
+    const SlotList & outputs = stage.GetOutputs();
+    SlotList stored;
+    try
+      {
+      for (size_t o = 0; o < outputs.size(); o++)
+        {
+        const std::string name = temporary + "/"
+            + stage.GetOutputKeys()[o];
+        const std::string outputFile = context.GetOutputFile(outputs[o]);
+        if (!outputFile.empty())
+          {
+          stored.push_back(name + Extension(outputFile));
+          util::CopyFile(outputFile, stored.back());
+          }
+        else
+          {
+          stored.push_back(
+              name + (context.IsHistogram(outputs[o]) ? ".hist" : ".nii"));
+          context.WriteSlot(outputs[o], stored.back());
+          }
+        }
+      }
+    catch (...)
+      {
+      Remove(temporary, stored);
+      throw;
+      }
+    /** Another process may have stored the same entry meanwhile */
+    if (std::rename(temporary.c_str(), entry.c_str()) != 0)
+      Remove(temporary, stored);
+    }
+
+private:
+  std::string GetEntry(util::HashType key) const
+    {
+    return m_Directory + "/" + util::HashToString(key);
+    }
+
+  static std::string Extension(std::string const &filename)
+    {
+    if (util::endsWith(filename, ".nii.gz")) return ".nii.gz";
+    const std::string::size_type dot = filename.find_last_of("./");
+    if (dot == std::string::npos || filename[dot] == '/') return "";
+    return filename.substr(dot);
+    }
+
+  static bool Exists(std::string const &filename)
+    {
+    struct stat status;
+    return stat(filename.c_str(), &status) == 0;
+    }
+
+  static void Remove(std::string const &directory, SlotList const &files)
+    {
+    for (size_t f = 0; f < files.size(); f++)
+      std::remove(files[f].c_str());
+    rmdir(directory.c_str());
+    }
+
+  std::string m_Directory;
+};
+
+/*
+ * The stages of a subject, run in dependency order in a single process. A
+ * slot consumed by a stage is produced by another stage or bound to an input
+ * file. Intermediate slots are released as soon as their last consumer is
+ * done, so only the images still needed are kept in memory.
+ */
+class Graph
+{
+public:
+  ~Graph()
+    {
+    for (size_t s = 0; s < m_Stages.size(); s++)
+      delete m_Stages[s];
+    }
+
+  /** The graph takes the ownership of the stage */
+  void AddStage(Stage* stage)
+    {
+    m_Stages.push_back(stage);
+    }
+
+  size_t GetNumberOfStages() const
+    {
+    return m_Stages.size();
+    }
+
+  /** With a cache, stages whose outputs are stored are not run */
+  void Run(Context & context, std::ostream* log = 0,
+           const StageCache* cache = 0)
+    {
+    std::map< std::string, size_t > producer;
+    std::map< std::string, unsigned int > consumers;
+    for (size_t s = 0; s < m_Stages.size(); s++)
+      {
+      const SlotList & outputs = m_Stages[s]->GetOutputs();
+      for (size_t o = 0; o < outputs.size(); o++)
+        {
+        if (producer.count(outputs[o]) || context.IsInput(outputs[o]))
+          {
+          itkGenericExceptionMacro(
+              "Slot " << outputs[o] << " is produced more than once.");
+          }
+        producer[outputs[o]] = s;
+        }
+      }
+    for (size_t s = 0; s < m_Stages.size(); s++)
+      {
+      const SlotList & inputs = m_Stages[s]->GetInputs();
+      for (size_t i = 0; i < inputs.size(); i++)
+        {
+        if (!producer.count(inputs[i]) && !context.IsInput(inputs[i]))
+          {
+          itkGenericExceptionMacro(
+              "Slot " << inputs[i] << " of " << m_Stages[s]->GetName()
+              << " is neither produced nor an input.");
+          }
+        ++consumers[inputs[i]];
+        }
+      }
+
+    std::vector< bool > done(m_Stages.size(), false);
+    for (size_t finished = 0; finished < m_Stages.size(); finished++)
+      {
+      /** The first stage, in plan order, whose inputs are all available */
+      size_t next = m_Stages.size();
+      for (size_t s = 0; s < m_Stages.size() && next == m_Stages.size(); s++)
+        {
+        if (done[s]) continue;
+        const SlotList & inputs = m_Stages[s]->GetInputs();
+        bool ready = true;
+        for (size_t i = 0; i < inputs.size() && ready; i++)
+          {
+          std::map< std::string, size_t >::const_iterator p = producer.find(
+              inputs[i]);
+          ready = p == producer.end() || done[p->second];
+          }
+        if (ready) next = s;
+        }
+      if (next == m_Stages.size())
+        {
+        itkGenericExceptionMacro("The stages depend on each other in a cycle.");
+        }
+
+      Stage* stage = m_Stages[next];
+      itk::TimeProbe clock;
+      clock.Start();
+      util::ProfileScope profile("Graph", stage->GetName());
+      util::HashType key = 0;
+      const bool restored = cache
+          && cache->Restore(key = cache->ComputeKey(*stage, context), *stage,
+                            context);
+      if (!restored)
+        {
+        stage->Run(context);
+        if (cache) cache->Store(key, *stage, context);
+        }
+      clock.Stop();
+      profile.Stop();
+      done[next] = true;
+      if (log)
+        {
+        (*log) << stage->GetName()
+               << (restored ? " restored from cache in " : " done in ")
+               << clock.GetTotal() << "s" << std::endl;
+        }
+
+      const SlotList & outputKeys = stage->GetOutputKeys();
+      for (size_t o = 0; cache && o < outputKeys.size(); o++)
+        {
+        context.SetSlotHash(stage->GetOutputs()[o],
+                            util::HashString(outputKeys[o], key));
+        }
+
+      const SlotList & inputs = stage->GetInputs();
+      for (size_t i = 0; i < inputs.size(); i++)
+        {
+        if (--consumers[inputs[i]] == 0) context.Release(inputs[i]);
+        }
+      const SlotList & outputs = stage->GetOutputs();
+      for (size_t o = 0; o < outputs.size(); o++)
+        {
+        if (!consumers.count(outputs[o])) context.Release(outputs[o]);
+        }
+      }
+    }
+
+private:
+  std::vector< Stage* > m_Stages;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* STAGE_H_ */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef STATISTICSSTAGE_H_
+#define STATISTICSSTAGE_H_
+
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkBinaryImageToShapeLabelMapFilter.h"
+#include "itkLabelMapToLabelImageFilter.h"
+#include "itkLabelStatisticsOpeningImageFilter.h"
+#include "itkMaskImageFilter.h"
+
+#include "util/itkComponentStatisticsOpeningImageFilter.h"
+
+#include "stage/stage.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+struct StatisticsSettings
+  {
+  /** LabelStatisticsOpening attribute name */
+  std::string Property;
+  float Threshold;
+  float BinarizeThreshold;
+  bool Reverse;
+
+  StatisticsSettings() :
+      Property("NumberOfPixels"), Threshold(0), BinarizeThreshold(0),
+      Reverse(false)
+    {
+    }
+  };
+
+/*
+ * Connected component statistics filter of cascade-statistics-filter.
+ *
+ * statistics-filter input=<slot> out=<slot> [property=NumberOfPixels]
+ *   [threshold=0] [bin-threshold=0] [reverse]
+ */
+class StatisticsStage: public Stage
+{
+public:
+  typedef unsigned int LabelType;
+  typedef itk::Image< LabelType, DIM > LabelImageType;
+
+  typedef itk::BinaryThresholdImageFilter< ImageType, ImageType > BinaryThresholdImageFilterType;
+  typedef itk::BinaryImageToShapeLabelMapFilter< ImageType > BinaryImageToShapeLabelMapFilterType;
+  typedef BinaryImageToShapeLabelMapFilterType::OutputImageType ShapeLabelMapType;
+  typedef itk::LabelMapToLabelImageFilter< ShapeLabelMapType, LabelImageType > LabelMapToLabelImageFilterType;
+  typedef itk::LabelStatisticsOpeningImageFilter< LabelImageType, ImageType > LabelStatisticsOpeningFilterType;
+  typedef itk::MaskImageFilter< ImageType, LabelImageType, ImageType > MaskFilterType;
+  typedef itk::ComponentStatisticsOpeningImageFilter< ImageType, ImageType > ComponentStatisticsOpeningFilterType;
+
+  static ImageType::Pointer Process(const ImageType* input,
+                                    StatisticsSettings const &settings)
+    {
+    const PixelType thrVal = 0;
+    const PixelType foreground = 1;
+    ImageType::Pointer output;
+
+    /*
+     * Simple moments are accumulated while labeling, no label map needed.
+     */
+    if (ComponentStatisticsOpeningFilterType::IsAttributeSupported(
+        settings.Property))
+      {
+      ComponentStatisticsOpeningFilterType::Pointer componentOpeningFilter =
+          ComponentStatisticsOpeningFilterType::New();
+      componentOpeningFilter->SetInput(input);
+      componentOpeningFilter->SetBinarizeThreshold(settings.BinarizeThreshold);
+      componentOpeningFilter->FullyConnectedOn();
+      componentOpeningFilter->SetLambda(settings.Threshold);
+      componentOpeningFilter->SetReverseOrdering(settings.Reverse);
+      componentOpeningFilter->SetAttribute(settings.Property);
+      componentOpeningFilter->Update();
+
+      output = componentOpeningFilter->GetOutput();
+      output->DisconnectPipeline();
+      return output;
+      }
+
+    BinaryThresholdImageFilterType::Pointer thresholdFilter =
+        BinaryThresholdImageFilterType::New();
+    /** The input is the feature image and the masked image below */
+    thresholdFilter->InPlaceOff();
+    thresholdFilter->SetInput(input);
+    thresholdFilter->SetLowerThreshold(settings.BinarizeThreshold);
+    thresholdFilter->SetInsideValue(foreground);
+    thresholdFilter->SetOutsideValue(thrVal);
+
+    BinaryImageToShapeLabelMapFilterType::Pointer binaryImageToShapeLabelMapFilter =
+        BinaryImageToShapeLabelMapFilterType::New();
+    binaryImageToShapeLabelMapFilter->FullyConnectedOn();
+    binaryImageToShapeLabelMapFilter->SetInputForegroundValue(foreground);
+    binaryImageToShapeLabelMapFilter->SetInput(thresholdFilter->GetOutput());
+
+    LabelMapToLabelImageFilterType::Pointer labelMapToLabelImageFilter =
+        LabelMapToLabelImageFilterType::New();
+    labelMapToLabelImageFilter->SetInput(
+        binaryImageToShapeLabelMapFilter->GetOutput());
+
+    LabelStatisticsOpeningFilterType::Pointer statisticsOpeningFilter =
+        LabelStatisticsOpeningFilterType::New();
+    statisticsOpeningFilter->SetInput(
+        labelMapToLabelImageFilter->GetOutput());
+    statisticsOpeningFilter->SetFeatureImage(input);
+
+    statisticsOpeningFilter->SetLambda(settings.Threshold);
+    statisticsOpeningFilter->SetReverseOrdering(settings.Reverse);
+    statisticsOpeningFilter->SetAttribute(settings.Property);
+
+    MaskFilterType::Pointer negatedMask = MaskFilterType::New();
+    negatedMask->InPlaceOff();
+    negatedMask->SetInput(input);
+    negatedMask->SetMaskImage(statisticsOpeningFilter->GetOutput());
+    negatedMask->Update();
+
+    output = negatedMask->GetOutput();
+    output->DisconnectPipeline();
+    return output;
+    }
+
+  StatisticsStage(ParameterMap const &parameters) :
+      Stage("statistics-filter", parameters)
+    {
+    m_Input = this->InputSlot("input");
+    m_Output = this->OutputSlot("out");
+    m_Settings.Property = this->GetString("property", m_Settings.Property);
+    m_Settings.Threshold = this->GetValue< float >("threshold", 0);
+    m_Settings.BinarizeThreshold = this->GetValue< float >("bin-threshold", 0);
+    m_Settings.Reverse = this->GetSwitch("reverse");
+    }
+
+  void Run(Context & context)
+    {
+    ImageType::Pointer output = Process(context.GetImage(m_Input),
+                                        m_Settings);
+    context.SetImage(m_Output, output.GetPointer());
+    }
+
+private:
+  std::string m_Input;
+  std::string m_Output;
+  StatisticsSettings m_Settings;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* STATISTICSSTAGE_H_ */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef TISSUESTAGE_H_
+#define TISSUESTAGE_H_
+
+#include "itkBinaryThresholdImageFilter.h"
+
+#include "util/itkMaskedQuantileImageFilter.h"
+#include "util/itkTissueTypeRefinementFilter.h"
+
+#include "stage/stage.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+struct TissueSettings
+  {
+  /** Partial volume threshold */
+  float Threshold;
+  /** Standard white matter probability threshold */
+  float WhiteThreshold;
+
+  TissueSettings() :
+      Threshold(0.5), WhiteThreshold(0.35)
+    {
+    }
+  };
+
+/*
+ * Tissue type refinement of cascade-tissue. All outputs are optional.
+ *
+ * tissue csf-pve=<slot> gm-pve=<slot> wm-pve=<slot> [std-white=<slot>]
+ *   [flair=<slot>] [t2=<slot>] [csf=<slot>] [gm=<slot>] [wm=<slot>]
+ *   [wmgm=<slot>] [pve=<slot>] [possible-wm=<slot>] [threshold=0.5]
+ *   [white-threshold=0.35]
+ */
+class TissueStage: public Stage
+{
+public:
+  typedef unsigned char OutputPixelType;
+  typedef itk::Image< OutputPixelType, DIM > OutputImageType;
+
+  typedef itk::BinaryThresholdImageFilter< ImageType, OutputImageType > BinaryThresholdImageFilterType;
+  typedef itk::MaskedQuantileImageFilter< ImageType, OutputImageType > QuantileFilterType;
+  typedef itk::TissueTypeRefinementFilter< ImageType, OutputImageType > TissueFilterType;
+
+  /*
+   * Threshold of a hyperintense sequence: the 84th percentile plus half the
+   * 16-84 percentile range of the sequence in GM (zeros included, as
+   * fslstats -k GM -p).
+   */
+  static double HyperintenseThreshold(const ImageType* image,
+                                      const OutputImageType* gmMask)
+    {
+    QuantileFilterType::Pointer quantileFilter = QuantileFilterType::New();
+    quantileFilter->SetInput(image);
+    const unsigned int channel = quantileFilter->AddChannel(gmMask, false);
+    quantileFilter->Update();
+    const double p16 = quantileFilter->GetQuantile(channel, 0.16);
+    const double p84 = quantileFilter->GetQuantile(channel, 0.84);
+    return p84 + 0.5 * (p84 - p16);
+    }
+
+  /** The returned filter is up to date, stdWhite, flair and t2 may be null */
+  static TissueFilterType::Pointer Process(const ImageType* csfPve,
+                                           const ImageType* gmPve,
+                                           const ImageType* wmPve,
+                                           const ImageType* stdWhite,
+                                           const ImageType* flair,
+                                           const ImageType* t2,
+                                           TissueSettings const &settings)
+    {
+    TissueFilterType::Pointer tissueFilter = TissueFilterType::New();
+    tissueFilter->SetProbabilityThreshold(settings.Threshold);
+    tissueFilter->SetStandardWhiteThreshold(settings.WhiteThreshold);
+    tissueFilter->SetCSFProbabilityImage(csfPve);
+    tissueFilter->SetGMProbabilityImage(gmPve);
+    tissueFilter->SetWMProbabilityImage(wmPve);
+    if (stdWhite)
+      {
+      tissueFilter->SetStandardWhiteImage(stdWhite);
+      }
+
+    /** Thresholds of the hyperintense sequences use the unrefined GM */
+    if (flair || t2)
+      {
+      BinaryThresholdImageFilterType::Pointer gmMask =
+          BinaryThresholdImageFilterType::New();
+      gmMask->SetInput(gmPve);
+      gmMask->SetLowerThreshold(settings.Threshold);
+      gmMask->SetInsideValue(1);
+      gmMask->SetOutsideValue(0);
+      gmMask->Update();
+
+      const ImageType* sequences[] = { flair, t2 };
+      for (unsigned int s = 0; s < 2; s++)
+        {
+        if (!sequences[s]) continue;
+        tissueFilter->AddHyperintenseImage(
+            sequences[s],
+            HyperintenseThreshold(sequences[s], gmMask->GetOutput()));
+        }
+      }
+    tissueFilter->Update();
+    return tissueFilter;
+    }
+
+  TissueStage(ParameterMap const &parameters) :
+      Stage("tissue", parameters)
+    {
+    m_CSFPve = this->InputSlot("csf-pve");
+    m_GMPve = this->InputSlot("gm-pve");
+    m_WMPve = this->InputSlot("wm-pve");
+    m_StdWhite = this->InputSlot("std-white", false);
+    m_Flair = this->InputSlot("flair", false);
+    m_T2 = this->InputSlot("t2", false);
+    m_CSF = this->OutputSlot("csf", false);
+    m_GM = this->OutputSlot("gm", false);
+    m_WM = this->OutputSlot("wm", false);
+    m_WMGM = this->OutputSlot("wmgm", false);
+    m_PVE = this->OutputSlot("pve", false);
+    m_PossibleWM = this->OutputSlot("possible-wm", false);
+    m_Settings.Threshold = this->GetValue< float >("threshold", 0.5);
+    m_Settings.WhiteThreshold = this->GetValue< float >("white-threshold",
+                                                        0.35);
+    }
+
+  void Run(Context & context)
+    {
+    ImageType::Pointer stdWhite, flair, t2;
+    if (!m_StdWhite.empty()) stdWhite = context.GetImage(m_StdWhite);
+    if (!m_Flair.empty()) flair = context.GetImage(m_Flair);
+    if (!m_T2.empty()) t2 = context.GetImage(m_T2);
+
+    TissueFilterType::Pointer tissueFilter = Process(
+        context.GetImage(m_CSFPve), context.GetImage(m_GMPve),
+        context.GetImage(m_WMPve), stdWhite, flair, t2, m_Settings);
+
+    SetIfGiven(context, m_CSF, tissueFilter->GetCSFOutput());
+    SetIfGiven(context, m_GM, tissueFilter->GetGMOutput());
+    SetIfGiven(context, m_WM, tissueFilter->GetWMOutput());
+    SetIfGiven(context, m_WMGM, tissueFilter->GetWMGMOutput());
+    SetIfGiven(context, m_PVE, tissueFilter->GetPVEOutput());
+    SetIfGiven(context, m_PossibleWM, tissueFilter->GetPossibleWMOutput());
+    }
+
+private:
+  std::string m_CSFPve;
+  std::string m_GMPve;
+  std::string m_WMPve;
+  std::string m_StdWhite;
+  std::string m_Flair;
+  std::string m_T2;
+  std::string m_CSF;
+  std::string m_GM;
+  std::string m_WM;
+  std::string m_WMGM;
+  std::string m_PVE;
+  std::string m_PossibleWM;
+  TissueSettings m_Settings;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* TISSUESTAGE_H_ */
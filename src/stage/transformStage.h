@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef TRANSFORMSTAGE_H_
+#define TRANSFORMSTAGE_H_
+
+#include <fstream>
+
+#include "itkCastImageFilter.h"
+#include "itkUnaryFunctorImageFilter.h"
+
+#include "util/itkIntensityTableLookupFunctor.h"
+#include "util/itkMaskedQuantileImageFilter.h"
+
+#include "stage/stage.h"
+
+namespace cascade
+{
+
+namespace stage
+{
+
+/*
+ * Intensity transformation of cascade-transform, either to a target
+ * histogram or by an intensity transformation file.
+ *
+ * transform input=<slot> (target=<hist slot> [source=<hist slot>]
+ *   [mask=<slot>] [bins=100] | table=<file>) out=<slot>
+ */
+class TransformStage: public Stage
+{
+public:
+  typedef unsigned int InputPixelType;
+  typedef float InterimPixelType;
+  typedef unsigned char MaskPixelType;
+
+  typedef itk::Image< InputPixelType, DIM > InputImageType;
+  typedef itk::Image< InterimPixelType, DIM > InterimImageType;
+  typedef itk::Image< MaskPixelType, DIM > MaskImageType;
+
+  typedef itk::CastImageFilter< InputImageType, InterimImageType > CastToInterimType;
+  typedef itk::IntensityTableLookupFunctor< InterimPixelType, InterimPixelType > LookupFunctorType;
+  typedef itk::UnaryFunctorImageFilter< InterimImageType, InterimImageType,
+      LookupFunctorType > LookupTransform;
+  typedef itk::MaskedQuantileImageFilter< InterimImageType, MaskImageType > QuantileFilterType;
+
+  /*
+   * Match input to the target histogram. The histogram of the input is the
+   * same as cascade-histogram on the input, in mask if given, when source is
+   * not given.
+   */
+  static ImageType::Pointer Process(const InputImageType* input,
+                                    util::HistogramTable const &target,
+                                    const util::HistogramTable* source,
+                                    const MaskImageType* mask,
+                                    unsigned int bins)
+    {
+    CastToInterimType::Pointer castToInterim = CastToInterimType::New();
+    castToInterim->SetInput(input);
+
+    util::HistogramTable inputHistogram;
+    if (source)
+      {
+      inputHistogram = *source;
+      }
+    else
+      {
+      QuantileFilterType::Pointer quantileFilter = QuantileFilterType::New();
+      quantileFilter->SetInput(castToInterim->GetOutput());
+      const unsigned int boundChannel = quantileFilter->AddChannel(0, true);
+      const unsigned int histogramChannel = quantileFilter->AddChannel(mask,
+                                                                       true);
+      quantileFilter->Update();
+      inputHistogram = util::ComputeHistogram(
+          quantileFilter->GetSamples(histogramChannel), bins, 0,
+          quantileFilter->GetQuantile(boundChannel, 0.95));
+      }
+
+    LookupFunctorType lookupFunctor;
+    const util::IntensityMatchTable match = util::MatchHistograms(
+        inputHistogram, target);
+    for (size_t r = 0; r < match.size(); r++)
+      {
+      lookupFunctor.AddLookupRow(match[r].From, match[r].To);
+      }
+    return Lookup(castToInterim->GetOutput(), lookupFunctor);
+    }
+
+  /** Rows of "percentile from to" of an intensity transformation file */
+  static ImageType::Pointer Process(const InputImageType* input,
+                                    std::string const &tableFile)
+    {
+    CastToInterimType::Pointer castToInterim = CastToInterimType::New();
+    castToInterim->SetInput(input);
+
+    LookupFunctorType lookupFunctor;
+    std::ifstream infile(tableFile.c_str());
+    double from, to, perc;
+    while (infile >> perc >> from >> to)
+      {
+      lookupFunctor.AddLookupRow(from, to);
+      }
+    return Lookup(castToInterim->GetOutput(), lookupFunctor);
+    }
+
+  TransformStage(ParameterMap const &parameters) :
+      Stage("transform", parameters)
+    {
+    m_Input = this->InputSlot("input");
+    m_Table = this->FileParameter("table");
+    m_Target = this->InputSlot("target", m_Table.empty());
+    m_Source = this->InputSlot("source", false);
+    m_Mask = this->InputSlot("mask", false);
+    m_Bins = this->GetValue< unsigned int >("bins", 100);
+    m_Output = this->OutputSlot("out");
+    }
+
+  void Run(Context & context)
+    {
+    InputImageType::Pointer input = CastImage< InputImageType >(
+        context.GetImage(m_Input).GetPointer());
+    ImageType::Pointer output;
+    if (m_Target.empty())
+      {
+      output = Process(input, m_Table);
+      }
+    else
+      {
+      MaskImageType::Pointer mask;
+      if (!m_Mask.empty())
+        {
+        mask = CastImage< MaskImageType >(
+            context.GetImage(m_Mask).GetPointer());
+        }
+      output = Process(input, context.GetHistogram(m_Target),
+                       m_Source.empty() ? 0 : &context.GetHistogram(m_Source),
+                       mask, m_Bins);
+      }
+    context.SetImage(m_Output, output.GetPointer());
+    }
+
+private:
+  static ImageType::Pointer Lookup(const InterimImageType* image,
+                                   LookupFunctorType lookupFunctor)
+    {
+    lookupFunctor.AddLookupRow(0, 0);
+
+    LookupTransform::Pointer lookupTransform = LookupTransform::New();
+    lookupTransform->SetInput(image);
+    lookupTransform->SetFunctor(lookupFunctor);
+    lookupTransform->Update();
+
+    ImageType::Pointer output = lookupTransform->GetOutput();
+    output->DisconnectPipeline();
+    return output;
+    }
+
+  std::string m_Input;
+  std::string m_Table;
+  std::string m_Target;
+  std::string m_Source;
+  std::string m_Mask;
+  unsigned int m_Bins;
+  std::string m_Output;
+};
+
+}  // namespace stage
+
+}  // namespace cascade
+
+#endif /* TRANSFORMSTAGE_H_ */
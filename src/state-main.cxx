@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+#include "itkVectorImage.h"
+/*
+ * ITK Filters
+ */
+#include "itkComposeImageFilter.h"
+#include "itkVectorIndexSelectionCastImageFilter.h"
+/*
+ * Others
+ */
+#include "util/stateModel.h"
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+/*
+ * Pixel types
+ */
+typedef float PixelType;
+/*
+ * Image types
+ */
+typedef itk::Image< PixelType, DIM > ImageType;
+typedef itk::VectorImage< PixelType, DIM > StateImageType;
+
+typedef itk::ComposeImageFilter< ImageType, StateImageType > ComposeFilterType;
+typedef itk::VectorIndexSelectionCastImageFilter< StateImageType, ImageType > SelectFilterType;
+
+/** Scalar state files of a sequence and class, in state order */
+static const char* const StateSuffixes[] = { "number", "mean", "stddev" };
+static const unsigned int StateLength = 3;
+/** Sequences looked for when none is given */
+static const char* const KnownSequences[] = { "flair", "t1", "t2", "pd" };
+static const unsigned int NumberOfKnownSequences = 4;
+
+std::string StateFileName(const std::string & prefix,
+                          const std::string & sequence, int label,
+                          const char* suffix)
+  {
+  std::ostringstream filename;
+  filename << prefix << "_" << sequence << "_" << label << "_" << suffix
+           << ".nii.gz";
+  return filename.str();
+  }
+
+bool FileExists(const std::string & filename)
+  {
+  return std::ifstream(filename.c_str()).good();
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Packed state model " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::SwitchArg infoSwitch("i", "info", "Print the model header", cmd,
+                              false);
+  TCLAP::SwitchArg extractSwitch(
+      "x", "extract", "Write the states of the model as separate files", cmd,
+      false);
+  TCLAP::ValueArg< std::string > model("m", "model", "Packed model (.cms)",
+                                       true, "", "string", cmd);
+
+  TCLAP::MultiArg< int > classes("c", "class", "Class label (1, 2 and 3)",
+                                 false, "Integer", cmd);
+  TCLAP::MultiArg< std::string > sequences(
+      "q", "sequence", "Sequence name, all present sequences if not set",
+      false, "string", cmd);
+  TCLAP::ValueArg< std::string > statePrefix(
+      "s", "state",
+      "State prefix, <prefix>_<sequence>_<class>_{number,mean,stddev}.nii.gz",
+      false, "", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    cascade::util::StateModelInfo info;
+    if (infoSwitch.getValue() || extractSwitch.getValue())
+      {
+      StateImageType::Pointer state = cascade::util::ReadStateModel<
+          StateImageType >(model.getValue(), info);
+      if (infoSwitch.getValue())
+        {
+        std::cout << "size";
+        for (unsigned int i = 0; i < DIM; i++)
+          std::cout << " " << state->GetLargestPossibleRegion().GetSize(i);
+        std::cout << "\nspacing";
+        for (unsigned int i = 0; i < DIM; i++)
+          std::cout << " " << state->GetSpacing()[i];
+        std::cout << "\nmeasurement " << info.MeasurementDimension;
+        std::cout << "\nsequences";
+        for (unsigned int i = 0; i < info.Sequences.size(); i++)
+          std::cout << " " << info.Sequences[i];
+        std::cout << "\nclasses";
+        for (unsigned int i = 0; i < info.Classes.size(); i++)
+          std::cout << " " << info.Classes[i];
+        std::cout << "\ncomponents " << info.GetNumberOfComponents()
+                  << std::endl;
+        }
+      if (extractSwitch.getValue())
+        {
+        if (!statePrefix.isSet() || info.MeasurementDimension != 1)
+          {
+          itkGenericExceptionMacro(
+              << "Extracting needs --state and a model of single sequence states.");
+          }
+        for (unsigned int c = 0; c < info.Classes.size(); c++)
+          {
+          for (unsigned int s = 0; s < info.Sequences.size(); s++)
+            {
+            const unsigned int group = info.GetGroupIndex(info.Classes[c],
+                                                          info.Sequences[s]);
+            for (unsigned int k = 0; k < StateLength; k++)
+              {
+              SelectFilterType::Pointer selectFilter = SelectFilterType::New();
+              selectFilter->SetInput(state);
+              selectFilter->SetIndex(group * StateLength + k);
+              selectFilter->Update();
+              cascade::util::WriteImage(
+                  StateFileName(statePrefix.getValue(), info.Sequences[s],
+                                info.Classes[c], StateSuffixes[k]),
+                  selectFilter->GetOutput());
+              }
+            }
+          }
+        }
+      return EXIT_SUCCESS;
+      }
+
+    /** Pack the separate state files into a model */
+    if (!statePrefix.isSet())
+      {
+      itkGenericExceptionMacro(<< "Packing needs --state.");
+      }
+    info.Classes = classes.getValue();
+    if (info.Classes.empty())
+      {
+      info.Classes.push_back(1);
+      info.Classes.push_back(2);
+      info.Classes.push_back(3);
+      }
+    info.Sequences = sequences.getValue();
+    if (info.Sequences.empty())
+      {
+      for (unsigned int s = 0; s < NumberOfKnownSequences; s++)
+        {
+        bool present = true;
+        for (unsigned int c = 0; c < info.Classes.size(); c++)
+          for (unsigned int k = 0; k < StateLength; k++)
+            present = present
+                && FileExists(
+                    StateFileName(statePrefix.getValue(), KnownSequences[s],
+                                  info.Classes[c], StateSuffixes[k]));
+        if (present) info.Sequences.push_back(KnownSequences[s]);
+        }
+      if (info.Sequences.empty())
+        {
+        itkGenericExceptionMacro(<< "No state found for " << statePrefix.getValue());
+        }
+      }
+
+    ComposeFilterType::Pointer composeFilter = ComposeFilterType::New();
+    unsigned int component = 0;
+    for (unsigned int c = 0; c < info.Classes.size(); c++)
+      {
+      for (unsigned int s = 0; s < info.Sequences.size(); s++)
+        {
+        for (unsigned int k = 0; k < StateLength; k++)
+          {
+          composeFilter->SetInput(
+              component++,
+              cascade::util::LoadImage< ImageType >(
+                  StateFileName(statePrefix.getValue(), info.Sequences[s],
+                                info.Classes[c], StateSuffixes[k])));
+          }
+        }
+      }
+    composeFilter->Update();
+    cascade::util::WriteStateModel(model.getValue(), info,
+                                   composeFilter->GetOutput());
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
@@ -24,41 +24,16 @@
  * General ITK
  */
 #include "itkImage.h"
-/*
- * ITK Filters
- */
-#include "itkBinaryThresholdImageFilter.h"
-#include "itkBinaryImageToShapeLabelMapFilter.h"
-#include "itkShapeOpeningLabelMapFilter.h"
-#include "itkLabelStatisticsOpeningImageFilter.h"
-#include "itkMaskImageFilter.h"
 /*
  * Others
  */
+#include "stage/statisticsStage.h"
 #include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
 #include "3rdparty/tclap/CmdLine.h"
-/*
- * Pixel types
- */
-typedef float PixelType;
-typedef unsigned int LabelType;
-/*
- * Image types
- */
-typedef itk::Image< PixelType, DIM > ImageType;
-typedef itk::Image< LabelType, DIM > LabelImageType;
 
-typedef itk::BinaryThresholdImageFilter< ImageType, ImageType > BinaryThresholdImageFilterType;
-typedef itk::BinaryImageToShapeLabelMapFilter< ImageType > BinaryImageToShapeLabelMapFilterType;
-typedef BinaryImageToShapeLabelMapFilterType::OutputImageType ShapeLabelMapType;
-typedef itk::LabelMapToLabelImageFilter< ShapeLabelMapType, LabelImageType > LabelMapToLabelImageFilterType;
-typedef itk::LabelStatisticsOpeningImageFilter< LabelImageType, ImageType > LabelStatisticsOpeningFilterType;
-typedef itk::MaskImageFilter<ImageType, LabelImageType,ImageType> MaskFilterType;
-
-/*
- * IO types
- */
-typedef itk::ImageFileWriter< ImageType > WriterType;
+typedef cascade::stage::ImageType ImageType;
 
 int main(int argc, char *argv[])
   {
@@ -77,6 +52,7 @@ int main(int argc, char *argv[])
                                      "Threshold", cmd);
 
   std::vector< std::string > allowedProperty;
+  allowedProperty.push_back("NumberOfPixels");
   allowedProperty.push_back("Minimum");
   allowedProperty.push_back("Maximum");
   allowedProperty.push_back("Mean");
@@ -109,6 +85,16 @@ int main(int argc, char *argv[])
                                        "Input sequences e.g. MPRAGE.nii.gz",
                                        true, "", "string", cmd);
 
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
   /*
    * Parse the argv array.
    */
@@ -125,49 +111,26 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
     }
 
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
   /*
    * Argument and setting up the pipeline
    */
   try
     {
-    const PixelType thrVal = 0;
-    const PixelType foreground = 1;
-
-    ImageType::Pointer inputIMage = cascade::util::LoadImage< ImageType >(
-        input.getValue());
-    BinaryThresholdImageFilterType::Pointer thresholdFilter =
-        BinaryThresholdImageFilterType::New();
-    thresholdFilter->SetInput(inputIMage);
-    thresholdFilter->SetLowerThreshold(binarize.getValue());
-    thresholdFilter->SetInsideValue(foreground);
-    thresholdFilter->SetOutsideValue(thrVal);
-
-    BinaryImageToShapeLabelMapFilterType::Pointer binaryImageToShapeLabelMapFilter =
-        BinaryImageToShapeLabelMapFilterType::New();
-    binaryImageToShapeLabelMapFilter->FullyConnectedOn();
-    binaryImageToShapeLabelMapFilter->SetInputForegroundValue(foreground);
-    binaryImageToShapeLabelMapFilter->SetInput(thresholdFilter->GetOutput());
-
-    LabelMapToLabelImageFilterType::Pointer labelMapToLabelImageFilter =
-        LabelMapToLabelImageFilterType::New();
-    labelMapToLabelImageFilter->SetInput(
-        binaryImageToShapeLabelMapFilter->GetOutput());
-
-    LabelStatisticsOpeningFilterType::Pointer statisticsOpeningFilter =
-        LabelStatisticsOpeningFilterType::New();
-    statisticsOpeningFilter->SetInput(
-        labelMapToLabelImageFilter->GetOutput());
-    statisticsOpeningFilter->SetFeatureImage(inputIMage);
-
-    statisticsOpeningFilter->SetLambda(threshold.getValue());
-    statisticsOpeningFilter->SetReverseOrdering(reverseSwitch.getValue());
-    statisticsOpeningFilter->SetAttribute(property.getValue());
-
-    MaskFilterType::Pointer negatedMask = MaskFilterType::New();
-    negatedMask->SetInput(inputIMage);
-    negatedMask->SetMaskImage(statisticsOpeningFilter->GetOutput());
-
-    cascade::util::WriteImage(outfile.getValue(), negatedMask->GetOutput());
+    cascade::stage::StatisticsSettings settings;
+    settings.Property = property.getValue();
+    settings.Threshold = threshold.getValue();
+    settings.BinarizeThreshold = binarize.getValue();
+    settings.Reverse = reverseSwitch.getValue();
+
+    cascade::util::WriteImage(
+        outfile.getValue(),
+        cascade::stage::StatisticsStage::Process(
+            cascade::util::LoadImage< ImageType >(input.getValue()), settings)
+            .GetPointer());
     }
   catch (itk::ExceptionObject & err)
     {
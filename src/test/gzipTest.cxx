@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <fstream>
+#include <string>
+#include <vector>
+/*
+ * Others
+ */
+#include "util/helpers.h"
+#include "util/parallelGzip.h"
+
+#include "test/testing.h"
+
+typedef itk::Image< float, 3 > ImageType;
+using cascade::test::CreateImage;
+using cascade::test::FillCube;
+using cascade::test::SameVoxels;
+
+/** 8 MB of voxels, several gzip members and one shared with the header */
+ImageType::Pointer CreateVolume()
+  {
+  ImageType::Pointer image = CreateImage< ImageType >(128, 1);
+  FillCube< ImageType >(image, 10, 100, 3);
+  FillCube< ImageType >(image, 60, 61, -7);
+  return image;
+  }
+
+/** Overwrite the uncompressed size in the trailer of a member */
+void SetMemberSize(std::string const &filename, unsigned int member,
+                   itk::uint32_t size)
+  {
+  std::vector< unsigned char > data;
+  cascade::util::gzip::ReadFile(filename, data);
+  size_t p = 0;
+  for (unsigned int m = 0; m < member; m++)
+    p += cascade::util::gzip::GetUInt32(&data[p + 16]);
+  p += cascade::util::gzip::GetUInt32(&data[p + 16]);
+  cascade::util::gzip::PutUInt32(&data[p - 4], size);
+
+  std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast< char* >(&data[0]), data.size());
+  }
+
+void TestInflateMatchesImage()
+  {
+  cascade::test::ScratchDirectory directory;
+  const std::string filename = directory.File("volume.nii.gz");
+  ImageType::Pointer image = CreateVolume();
+  cascade::util::WriteImage(filename, image.GetPointer());
+
+  ImageType::Pointer inflated = cascade::util::InflateImage< ImageType >(
+      filename);
+  CASCADE_CHECK(SameVoxels(inflated.GetPointer(), image.GetPointer()));
+  CASCADE_CHECK(SameVoxels(
+      cascade::util::LoadImage< ImageType >(filename).GetPointer(),
+      image.GetPointer()));
+  }
+
+/** Sizes that do not add up to the header must not be allocated */
+void TestInflateChecksSizes()
+  {
+  cascade::test::ScratchDirectory directory;
+  const std::string filename = directory.File("volume.nii.gz");
+  cascade::util::WriteImage(filename, CreateVolume().GetPointer());
+
+  SetMemberSize(filename, 1, 0xffffffff);
+  CASCADE_CHECK(!cascade::util::InflateImage< ImageType >(filename));
+
+  cascade::util::WriteImage(filename, CreateVolume().GetPointer());
+  SetMemberSize(filename, 1, (1 << 20) - 1);
+  CASCADE_CHECK(!cascade::util::InflateImage< ImageType >(filename));
+  }
+
+int main(int, char *[])
+  {
+  TestInflateMatchesImage();
+  TestInflateChecksSizes();
+  return cascade::test::Result();
+  }
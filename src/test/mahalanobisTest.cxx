@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <string>
+#include <vector>
+/*
+ * ITK Filters
+ */
+#include "itkIdentityTransform.h"
+/*
+ * Others
+ */
+#include "util/itkMahalanobisDistanceImageFilter.h"
+#include "util/stateModel.h"
+
+#include "test/testing.h"
+
+typedef itk::Image< float, DIM > ImageType;
+typedef itk::MahalanobisDistanceImageFilter< ImageType, ImageType > DistanceFilterType;
+typedef DistanceFilterType::StateImageType StateImageType;
+typedef itk::IdentityTransform< double, DIM > TransformType;
+
+using cascade::test::CreateImage;
+using cascade::test::FillCube;
+using cascade::test::SameVoxels;
+
+/*
+ * Packed model on a grid twice as coarse as the subject, so the states are
+ * interpolated. Every group and voxel has a state of its own.
+ */
+StateImageType::Pointer CreateModel(cascade::util::StateModelInfo & info)
+  {
+  info.Sequences.push_back("flair");
+  info.Sequences.push_back("t1");
+  info.Classes.push_back(2);
+  info.Classes.push_back(3);
+
+  StateImageType::SizeType size;
+  size.Fill(4);
+  StateImageType::RegionType region;
+  region.SetSize(size);
+  StateImageType::SpacingType spacing;
+  spacing.Fill(2);
+  StateImageType::Pointer model = StateImageType::New();
+  model->SetRegions(region);
+  model->SetSpacing(spacing);
+  model->SetNumberOfComponentsPerPixel(info.GetNumberOfComponents());
+  model->Allocate();
+
+  const unsigned int length = info.GetGroupLength();
+  StateImageType::PixelType state(info.GetNumberOfComponents());
+  itk::ImageRegionIteratorWithIndex< StateImageType > it(model, region);
+  for (; !it.IsAtEnd(); ++it)
+    {
+    const StateImageType::IndexType index = it.GetIndex();
+    for (unsigned int g = 0; g < info.GetNumberOfComponents() / length; g++)
+      {
+      const double number = 20 + index[0] + g;
+      state[g * length] = number;
+      state[g * length + 1] = number * (50 + 10 * g + 3 * index[1]);
+      state[g * length + 2] = (number - 1) * (16 + index[2] + g);
+      }
+    it.Set(state);
+    }
+  return model;
+  }
+
+ImageType::Pointer CreateSubject()
+  {
+  ImageType::Pointer image = CreateImage< ImageType >(8, 60);
+  FillCube< ImageType >(image, 2, 5, 90);
+  FillCube< ImageType >(image, 3, 4, 140);
+  return image;
+  }
+
+ImageType::Pointer Distance(const StateImageType* state, unsigned int group,
+                            const ImageType* subject)
+  {
+  DistanceFilterType::Pointer filter = DistanceFilterType::New();
+  filter->SetInput(subject);
+  filter->SetStateImage(state);
+  filter->SetStateGroup(group);
+  filter->SetTransform(TransformType::New());
+  filter->Update();
+  return filter->GetDistanceImage();
+  }
+
+/*
+ * A class of a packed model read in place gives the distances of the same
+ * states unpacked into a state image of their own.
+ */
+void TestModelMatchesUnpackedState()
+  {
+  cascade::test::ScratchDirectory scratch;
+  cascade::util::StateModelInfo written;
+  const std::string filename = scratch.File("model.cms");
+  cascade::util::WriteStateModel(filename, written,
+                                 CreateModel(written).GetPointer());
+  cascade::util::StateModelInfo info;
+  StateImageType::Pointer model = cascade::util::ReadStateModel<
+      StateImageType >(filename, info);
+  const ImageType::Pointer subject = CreateSubject();
+
+  for (unsigned int c = 0; c < info.Classes.size(); c++)
+    {
+    for (unsigned int s = 0; s < info.Sequences.size(); s++)
+      {
+      DistanceFilterType::Pointer filter = DistanceFilterType::New();
+      filter->SetInput(subject);
+      filter->SetStateModel(model, info, info.Classes[c], info.Sequences[s]);
+      filter->SetTransform(TransformType::New());
+      filter->Update();
+
+      std::vector< unsigned int > groups(
+          1, info.GetGroupIndex(info.Classes[c], info.Sequences[s]));
+      const StateImageType::Pointer unpacked =
+          cascade::util::ExtractStateGroups(model.GetPointer(), groups,
+                                            info.GetGroupLength());
+      CASCADE_CHECK(SameVoxels(
+          filter->GetDistanceImage(),
+          Distance(unpacked, 0, subject).GetPointer(), 1e-5));
+      }
+    }
+
+  /** Different groups must give different distances */
+  CASCADE_CHECK(!SameVoxels(Distance(model, 0, subject).GetPointer(),
+                            Distance(model, 3, subject).GetPointer(), 1e-5));
+  }
+
+void TestModelWithoutClass()
+  {
+  cascade::util::StateModelInfo info;
+  StateImageType::Pointer model = CreateModel(info);
+  DistanceFilterType::Pointer filter = DistanceFilterType::New();
+  bool thrown = false;
+  try
+    {
+    filter->SetStateModel(model, info, 4, "flair");
+    }
+  catch (itk::ExceptionObject &)
+    {
+    thrown = true;
+    }
+  CASCADE_CHECK(thrown);
+  }
+
+int main(int, char *[])
+  {
+  TestModelMatchesUnpackedState();
+  TestModelWithoutClass();
+  return cascade::test::Result();
+  }
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <string>
+/*
+ * Others
+ */
+#include "itkImageRegionConstIterator.h"
+
+#include "api/segmenter.h"
+#include "stage/plan.h"
+#include "util/batch.h"
+#include "util/helpers.h"
+#include "util/stateModel.h"
+
+#include "test/testing.h"
+
+using cascade::stage::ImageType;
+using cascade::test::CreateImage;
+using cascade::test::FillCube;
+using cascade::test::SameVoxels;
+
+typedef cascade::SegmenterModel::StateImageType StateImageType;
+
+const unsigned int PhantomSize = 32;
+
+/*
+ * White matter in gray matter with a lesion in the middle, light on FLAIR
+ * and dark on T1. The hypothesis covers the lesion and its surrounding.
+ */
+struct Phantom
+  {
+  ImageType::Pointer Flair;
+  ImageType::Pointer T1;
+  ImageType::Pointer PVE;
+  ImageType::Pointer Mask;
+  ImageType::Pointer Hypothesis;
+  };
+
+ImageType::Pointer CreateTissueImage(float gray, float white, float lesion)
+  {
+  ImageType::Pointer image = CreateImage< ImageType >(PhantomSize, 0);
+  FillCube< ImageType >(image, 4, 27, gray);
+  FillCube< ImageType >(image, 8, 23, white);
+  FillCube< ImageType >(image, 14, 17, lesion);
+  return image;
+  }
+
+ImageType::Pointer CreateHypothesis()
+  {
+  ImageType::Pointer hypothesis = CreateImage< ImageType >(PhantomSize, 0);
+  FillCube< ImageType >(hypothesis, 12, 19, 1);
+  return hypothesis;
+  }
+
+Phantom CreatePhantom()
+  {
+  Phantom phantom;
+  phantom.Flair = CreateTissueImage(80, 100, 200);
+  phantom.T1 = CreateTissueImage(60, 90, 40);
+  phantom.PVE = CreateTissueImage(2, 3, 3);
+  phantom.Mask = CreateTissueImage(1, 1, 1);
+  phantom.Hypothesis = CreateHypothesis();
+  return phantom;
+  }
+
+/*
+ * Packed model with the same normal state everywhere. The states are the
+ * number, sum and sum of squared deviations of the normal tissue of the
+ * range normalized phantom, as cascade-train would gather them.
+ */
+std::string WriteModel(Phantom const &phantom,
+                       cascade::test::ScratchDirectory & scratch)
+  {
+  typedef cascade::stage::RangeStage RangeStageType;
+
+  cascade::util::StateModelInfo info;
+  info.Sequences.push_back("flair");
+  info.Sequences.push_back("t1");
+  info.Classes.push_back(2);
+  info.Classes.push_back(3);
+  const ImageType::Pointer images[] = { phantom.Flair, phantom.T1 };
+  const ImageType::Pointer lesion = CreateTissueImage(0, 0, 1);
+
+  StateImageType::SizeType size;
+  size.Fill(PhantomSize);
+  StateImageType::RegionType region;
+  region.SetSize(size);
+  StateImageType::Pointer state = StateImageType::New();
+  state->SetRegions(region);
+  state->SetNumberOfComponentsPerPixel(info.GetNumberOfComponents());
+  state->Allocate();
+
+  StateImageType::PixelType value(info.GetNumberOfComponents());
+  value.Fill(0);
+  cascade::stage::RangeSettings settings;
+  settings.Scale = false;
+  for (unsigned int s = 0; s < info.Sequences.size(); s++)
+    {
+    const ImageType::Pointer range = RangeStageType::Process(
+        cascade::stage::CastImage< RangeStageType::InputImageType >(
+            images[s].GetPointer()),
+        cascade::stage::CastImage< RangeStageType::MaskImageType >(
+            phantom.Mask.GetPointer()), settings);
+    for (unsigned int c = 0; c < info.Classes.size(); c++)
+      {
+      double number = 0, sum = 0, sumOfSquares = 0;
+      itk::ImageRegionConstIterator< ImageType > rangeIt(
+          range, range->GetBufferedRegion());
+      itk::ImageRegionConstIterator< ImageType > pveIt(
+          phantom.PVE, phantom.PVE->GetBufferedRegion());
+      itk::ImageRegionConstIterator< ImageType > lesionIt(
+          lesion, lesion->GetBufferedRegion());
+      for (; !rangeIt.IsAtEnd(); ++rangeIt, ++pveIt, ++lesionIt)
+        {
+        if (pveIt.Get() != info.Classes[c] || lesionIt.Get() != 0) continue;
+        number += 1;
+        sum += rangeIt.Get();
+        sumOfSquares += static_cast< double >(rangeIt.Get()) * rangeIt.Get();
+        }
+      const int group = info.GetGroupIndex(info.Classes[c],
+                                           info.Sequences[s]);
+      value[group * info.GetGroupLength()] = number;
+      value[group * info.GetGroupLength() + 1] = sum;
+      value[group * info.GetGroupLength() + 2] = std::max(
+          sumOfSquares - sum * sum / number, 0.0);
+      }
+    }
+  state->FillBuffer(value);
+
+  const std::string filename = scratch.File("model.cms");
+  cascade::util::WriteStateModel(filename, info, state.GetPointer());
+  return filename;
+  }
+
+cascade::SegmenterSubject CreateSubject(Phantom const &phantom)
+  {
+  cascade::SegmenterSubject subject;
+  subject.AddSequence("flair", "light", phantom.Flair);
+  subject.AddSequence("t1", "dark", phantom.T1);
+  subject.SetPVE(phantom.PVE);
+  subject.SetMask(phantom.Mask);
+  return subject;
+  }
+
+ImageType::IndexType Voxel(unsigned int position)
+  {
+  ImageType::IndexType index;
+  index.Fill(position);
+  return index;
+  }
+
+/** The lesion is the only object left, normal white matter is not */
+void TestFindsLesion(Phantom const &phantom, std::string const &modelFile)
+  {
+  cascade::SegmenterModel model;
+  model.Load(modelFile);
+  cascade::SegmenterSubject subject = CreateSubject(phantom);
+  subject.SetHypothesis(phantom.Hypothesis);
+  const cascade::SegmenterResult result = cascade::Segmenter(model).Segment(
+      subject);
+
+  CASCADE_CHECK(result.Likelihood->GetPixel(Voxel(14)) > 0);
+  CASCADE_CHECK(result.Likelihood->GetPixel(Voxel(17)) > 0);
+  CASCADE_CHECK(result.Likelihood->GetPixel(Voxel(12)) == 0);
+  CASCADE_CHECK(result.Likelihood->GetPixel(Voxel(20)) == 0);
+  CASCADE_CHECK(result.NumberOfLesions == 1);
+  CASCADE_CHECK(result.Lesions->GetPixel(Voxel(15)) == 1);
+  CASCADE_CHECK(result.Lesions->GetPixel(Voxel(12)) == 0);
+  }
+
+/** Masking with the hypothesis must not touch the returned score */
+void TestHypothesisKeepsScore(Phantom const &phantom,
+                              std::string const &modelFile)
+  {
+  cascade::SegmenterModel model;
+  model.Load(modelFile);
+  const cascade::Segmenter segmenter(model);
+
+  cascade::SegmenterSubject subject = CreateSubject(phantom);
+  const cascade::SegmenterResult plain = segmenter.Segment(subject);
+
+  subject.SetHypothesis(phantom.Hypothesis);
+  const cascade::SegmenterResult masked = segmenter.Segment(subject);
+
+  CASCADE_CHECK(SameVoxels(masked.Score.GetPointer(),
+                           plain.Score.GetPointer()));
+  CASCADE_CHECK(SameVoxels(phantom.Hypothesis.GetPointer(),
+                           CreateHypothesis().GetPointer()));
+
+  CASCADE_CHECK(masked.Likelihood->GetPixel(Voxel(9)) == 0);
+  }
+
+/*
+ * The Segmenter gives the likelihood of the cascade-std-normal plan, whose
+ * score starts from a zero image.
+ */
+void TestMatchesPlan(Phantom const &phantom, std::string const &modelFile,
+                     cascade::test::ScratchDirectory & scratch)
+  {
+  cascade::SegmenterModel model;
+  model.Load(modelFile);
+  cascade::SegmenterSubject subject = CreateSubject(phantom);
+  subject.SetHypothesis(phantom.Hypothesis);
+  const cascade::SegmenterResult result = cascade::Segmenter(model).Segment(
+      subject);
+
+  const std::string names[] = { "flair", "t1", "pve", "mask", "hyp", "zero" };
+  const ImageType::Pointer images[] = { phantom.Flair, phantom.T1,
+      phantom.PVE, phantom.Mask, phantom.Hypothesis,
+      CreateImage< ImageType >(PhantomSize, 0) };
+  std::ostringstream plan;
+  for (unsigned int i = 0; i < 6; i++)
+    {
+    const std::string filename = scratch.File(names[i] + ".nii");
+    cascade::util::WriteImage(filename, images[i].GetPointer());
+    plan << "input " << names[i] << " " << filename << "\n";
+    }
+  const std::string scoreFile = scratch.File("z.nii");
+  const std::string likelihoodFile = scratch.File("likelihood.nii");
+  plan << "output z_t1 " << scoreFile << "\n"
+       << "output likelihood " << likelihoodFile << "\n"
+       << "range input=flair mask=mask out=range_flair no-scale\n"
+       << "range input=t1 mask=mask out=range_t1 no-scale\n"
+       << "score range=range_flair type=light pve=pve mask=mask model="
+       << modelFile << " sequence=flair previous=zero out=z_flair\n"
+       << "score range=range_t1 type=dark pve=pve mask=mask model="
+       << modelFile << " sequence=t1 previous=z_flair out=z_t1\n"
+       << "mask input=z_t1 mask=hyp out=z_masked\n"
+       << "statistics-filter input=z_masked bin-threshold=1.5"
+       << " property=Maximum threshold=4 out=likelihood\n";
+
+  std::istringstream stream(plan.str());
+  cascade::stage::Context context;
+  cascade::stage::Graph graph;
+  cascade::stage::AddPlan(
+      cascade::util::ParseManifest(stream, "plan", 1,
+                                   std::numeric_limits< size_t >::max()),
+      "plan", context, graph);
+  graph.Run(context);
+
+  CASCADE_CHECK(SameVoxels(
+      result.Score.GetPointer(),
+      cascade::util::LoadImage< ImageType >(scoreFile).GetPointer(), 1e-4));
+  CASCADE_CHECK(SameVoxels(
+      result.Likelihood.GetPointer(),
+      cascade::util::LoadImage< ImageType >(likelihoodFile).GetPointer(),
+      1e-4));
+
+  float minimum = 0;
+  itk::ImageRegionConstIterator< ImageType > it(
+      result.Score, result.Score->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+    minimum = std::min(minimum, it.Get());
+  CASCADE_CHECK(minimum == 0);
+  }
+
+int main(int, char *[])
+  {
+  cascade::test::ScratchDirectory scratch;
+  const Phantom phantom = CreatePhantom();
+  const std::string modelFile = WriteModel(phantom, scratch);
+
+  TestFindsLesion(phantom, modelFile);
+  TestHypothesisKeepsScore(phantom, modelFile);
+  TestMatchesPlan(phantom, modelFile, scratch);
+  return cascade::test::Result();
+  }
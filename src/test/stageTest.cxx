@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <string>
+/*
+ * Others
+ */
+#include "stage/stage.h"
+#include "stage/maskStage.h"
+#include "stage/statisticsStage.h"
+#include "stage/plan.h"
+
+#include "util/batch.h"
+#include "util/helpers.h"
+
+#include "test/testing.h"
+
+using cascade::stage::ImageType;
+using cascade::test::CreateImage;
+using cascade::test::FillCube;
+using cascade::test::SameVoxels;
+
+/** A lesion of 27 voxels of 5 and a single voxel of 2 */
+ImageType::Pointer CreateSubject()
+  {
+  ImageType::Pointer image = CreateImage< ImageType >(8, 0);
+  FillCube< ImageType >(image, 2, 4, 5);
+  FillCube< ImageType >(image, 6, 6, 2);
+  return image;
+  }
+
+float VoxelAt(ImageType::Pointer image, unsigned int position)
+  {
+  ImageType::IndexType index;
+  index.Fill(position);
+  return image->GetPixel(index);
+  }
+
+/** Stages must leave their input slots as they found them */
+void TestMaskKeepsInput()
+  {
+  const ImageType::Pointer original = CreateSubject();
+  ImageType::Pointer mask = CreateImage< ImageType >(8, 0);
+  FillCube< ImageType >(mask, 0, 3, 1);
+
+  cascade::stage::Context context;
+  context.SetImage("t1", CreateSubject().GetPointer());
+  context.SetImage("brain", mask.GetPointer());
+
+  cascade::stage::ParameterMap parameters;
+  parameters["input"] = "t1";
+  parameters["mask"] = "brain";
+  parameters["out"] = "masked";
+  cascade::stage::MaskStage stage(parameters);
+  stage.Run(context);
+
+  const ImageType::Pointer masked = context.GetImage("masked");
+  CASCADE_CHECK(VoxelAt(masked, 3) == 5);
+  CASCADE_CHECK(VoxelAt(masked, 4) == 0);
+  CASCADE_CHECK(SameVoxels(context.GetImage("t1").GetPointer(),
+                           original.GetPointer()));
+
+  /** A second stage reading the same slot sees the original voxels */
+  parameters["mask"] = "t1";
+  parameters["out"] = "again";
+  cascade::stage::MaskStage again(parameters);
+  again.Run(context);
+  CASCADE_CHECK(SameVoxels(context.GetImage("again").GetPointer(),
+                           original.GetPointer()));
+  }
+
+void TestStatisticsKeepsInput()
+  {
+  const ImageType::Pointer original = CreateSubject();
+
+  cascade::stage::Context context;
+  context.SetImage("t1", CreateSubject().GetPointer());
+
+  /** Median is not a moment, it goes through the label map filters */
+  cascade::stage::ParameterMap parameters;
+  parameters["input"] = "t1";
+  parameters["out"] = "kept";
+  parameters["property"] = "Median";
+  parameters["threshold"] = "3";
+  /** The background must not join the lesions into one component */
+  parameters["bin-threshold"] = "1";
+  cascade::stage::StatisticsStage stage(parameters);
+  stage.Run(context);
+
+  const ImageType::Pointer kept = context.GetImage("kept");
+  CASCADE_CHECK(VoxelAt(kept, 3) == 5);
+  CASCADE_CHECK(VoxelAt(kept, 6) == 0);
+  CASCADE_CHECK(SameVoxels(context.GetImage("t1").GetPointer(),
+                           original.GetPointer()));
+  }
+
+/** Run a plan with a cache, true if its stages were restored from it */
+bool RunCachedPlan(std::string const &plan,
+                   cascade::stage::StageCache const &cache)
+  {
+  std::istringstream stream(plan);
+  cascade::stage::Context context;
+  cascade::stage::Graph graph;
+  cascade::stage::AddPlan(
+      cascade::util::ParseManifest(stream, "plan", 1,
+                                   std::numeric_limits< size_t >::max()),
+      "plan", context, graph);
+  std::ostringstream log;
+  graph.Run(context, &log, &cache);
+  return log.str().find("restored from cache") != std::string::npos;
+  }
+
+/*
+ * An entry stored for an unbound output is not used for an output bound to
+ * a compressed file, which gets an entry of its own.
+ */
+void TestCacheFollowsOutputFormat()
+  {
+  cascade::test::ScratchDirectory scratch;
+  ImageType::Pointer mask = CreateImage< ImageType >(8, 0);
+  FillCube< ImageType >(mask, 0, 3, 1);
+  const ImageType::Pointer expected = cascade::stage::MaskStage::Process(
+      CreateSubject(), mask);
+
+  const std::string t1 = scratch.File("t1.nii");
+  const std::string brain = scratch.File("brain.nii");
+  const std::string masked = scratch.File("masked.nii.gz");
+  cascade::util::WriteImage(t1, CreateSubject().GetPointer());
+  cascade::util::WriteImage(brain, mask.GetPointer());
+  const cascade::stage::StageCache cache(scratch.File("cache"));
+
+  const std::string inputs = "input t1 " + t1 + "\ninput brain " + brain
+      + "\n";
+  const std::string stage = "mask input=t1 mask=brain out=masked\n";
+  const std::string output = "output masked " + masked + "\n";
+
+  CASCADE_CHECK(!RunCachedPlan(inputs + stage, cache));
+  CASCADE_CHECK(!RunCachedPlan(inputs + output + stage, cache));
+  CASCADE_CHECK(SameVoxels(
+      cascade::util::LoadImage< ImageType >(masked).GetPointer(),
+      expected.GetPointer()));
+
+  std::remove(masked.c_str());
+  CASCADE_CHECK(RunCachedPlan(inputs + output + stage, cache));
+  CASCADE_CHECK(SameVoxels(
+      cascade::util::LoadImage< ImageType >(masked).GetPointer(),
+      expected.GetPointer()));
+  CASCADE_CHECK(RunCachedPlan(inputs + stage, cache));
+  }
+
+int main(int, char *[])
+  {
+  TestMaskKeepsInput();
+  TestStatisticsKeepsInput();
+  TestCacheFollowsOutputFormat();
+  return cascade::test::Result();
+  }
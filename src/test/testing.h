@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef TESTING_H_
+#define TESTING_H_
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <ftw.h>
+#include <unistd.h>
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMacro.h"
+
+#include "util/helpers.h"
+
+namespace cascade
+{
+
+namespace test
+{
+
+/*
+ * Minimal checks for the test programs: a failed check is reported and the
+ * program carries on, Result() is the exit status.
+ */
+inline unsigned int & NumberOfFailures()
+  {
+  static unsigned int failures = 0;
+  return failures;
+  }
+
+inline void Check(bool passed, const char* expression, const char* file,
+                  int line)
+  {
+  if (passed) return;
+  ++NumberOfFailures();
+  std::cerr << file << ":" << line << ": check failed: " << expression
+            << std::endl;
+  }
+
+inline int Result()
+  {
+  if (NumberOfFailures())
+    std::cerr << NumberOfFailures() << " checks failed" << std::endl;
+  return NumberOfFailures() ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
+#define CASCADE_CHECK(expression) \
+  cascade::test::Check((expression), #expression, __FILE__, __LINE__)
+
+/** Image of the given size, filled with value */
+template< class TImage >
+typename TImage::Pointer CreateImage(unsigned int size,
+                                     typename TImage::PixelType value)
+  {
+  typename TImage::SizeType imageSize;
+  imageSize.Fill(size);
+  typename TImage::RegionType region;
+  region.SetSize(imageSize);
+
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(region);
+  image->Allocate();
+  image->FillBuffer(value);
+  return image;
+  }
+
+/** Set the voxels of a cube from index first to last, both included */
+template< class TImage >
+void FillCube(TImage* image, unsigned int first, unsigned int last,
+              typename TImage::PixelType value)
+  {
+  typename TImage::RegionType region;
+  for (unsigned int d = 0; d < TImage::ImageDimension; d++)
+    {
+    region.SetIndex(d, first);
+    region.SetSize(d, last - first + 1);
+    }
+  itk::ImageRegionIteratorWithIndex< TImage > it(image, region);
+  for (; !it.IsAtEnd(); ++it)
+    it.Set(value);
+  }
+
+/** Whether both images have the same voxels within tolerance */
+template< class TImage, class TOtherImage >
+bool SameVoxels(const TImage* image, const TOtherImage* other,
+                double tolerance = 0)
+  {
+  if (!image || !other || !image->GetBufferPointer()
+      || !other->GetBufferPointer()
+      || image->GetBufferedRegion() != other->GetBufferedRegion())
+    return false;
+  itk::ImageRegionConstIterator< TImage > it(image,
+                                             image->GetBufferedRegion());
+  itk::ImageRegionConstIterator< TOtherImage > ot(other,
+                                                  other->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it, ++ot)
+    {
+    if (std::fabs(static_cast< double >(it.Get())
+        - static_cast< double >(ot.Get())) > tolerance)
+      return false;
+    }
+  return true;
+  }
+
+/** Directory for the files of a test, removed with all it contains */
+class ScratchDirectory
+{
+public:
+  ScratchDirectory()
+    {
+    std::string name = cascade::util::TemporaryDirectory()
+        + "/cascade-test-XXXXXX";
+    std::vector< char > buffer(name.begin(), name.end());
+    buffer.push_back('\0');
+    if (!mkdtemp(&buffer[0]))
+      {
+      itkGenericExceptionMacro("Can not create a directory in "
+                               << cascade::util::TemporaryDirectory());
+      }
+    m_Directory = &buffer[0];
+    }
+  ~ScratchDirectory()
+    {
+    nftw(m_Directory.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+
+  std::string File(std::string const &name) const
+    {
+    return m_Directory + "/" + name;
+    }
+
+private:
+  static int RemoveEntry(const char* path, const struct stat*, int,
+                         struct FTW*)
+    {
+    return std::remove(path);
+    }
+
+  std::string m_Directory;
+};
+
+}  // namespace test
+
+}  // namespace cascade
+
+#endif /* TESTING_H_ */
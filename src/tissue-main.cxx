@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <string>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+/*
+ * Others
+ */
+#include "stage/tissueStage.h"
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+typedef cascade::stage::ImageType InputImageType;
+typedef cascade::stage::TissueStage::OutputImageType OutputImageType;
+typedef cascade::stage::TissueStage::TissueFilterType TissueFilterType;
+
+InputImageType::Pointer LoadIfSet(
+    const TCLAP::ValueArg< std::string > & filename)
+  {
+  InputImageType::Pointer image;
+  if (filename.isSet())
+    {
+    image = cascade::util::LoadImage< InputImageType >(filename.getValue());
+    }
+  return image;
+  }
+
+void WriteIfSet(const TCLAP::ValueArg< std::string > & filename,
+                const OutputImageType* image)
+  {
+  if (filename.isSet())
+    {
+    cascade::util::WriteImage(filename.getValue(), image);
+    }
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Tissue type refinement " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > csfOut("", "csf", "CSF mask output (1)",
+                                        false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > gmOut("", "gm", "GM mask output (2)", false,
+                                       "", "string", cmd);
+  TCLAP::ValueArg< std::string > wmOut("", "wm", "WM mask output (3)", false,
+                                       "", "string", cmd);
+  TCLAP::ValueArg< std::string > wmgmOut("", "wmgm", "WM and GM mask output",
+                                         false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > pveOut("", "pve",
+                                        "Tissue type output (1, 2, 3)", false,
+                                        "", "string", cmd);
+  TCLAP::ValueArg< std::string > possibleWMOut(
+      "", "possible-wm", "Possible WM output", false, "", "string", cmd);
+
+  TCLAP::ValueArg< float > threshold("", "threshold",
+                                     "Partial volume threshold", false, 0.5,
+                                     "Float", cmd);
+  TCLAP::ValueArg< float > whiteThreshold(
+      "", "white-threshold", "Standard white matter probability threshold",
+      false, 0.35, "Float", cmd);
+
+  TCLAP::ValueArg< std::string > stdWhite(
+      "", "std-white", "Standard white matter probability in subject space",
+      false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > t2("", "t2", "T2 image e.g. brain_t2.nii.gz",
+                                    false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > flair("", "flair",
+                                       "FLAIR image e.g. brain_flair.nii.gz",
+                                       false, "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > wmPve("", "wm-pve",
+                                       "WM partial volume e.g. brain_pve_2",
+                                       true, "", "string", cmd);
+  TCLAP::ValueArg< std::string > gmPve("", "gm-pve",
+                                       "GM partial volume e.g. brain_pve_1",
+                                       true, "", "string", cmd);
+  TCLAP::ValueArg< std::string > csfPve("", "csf-pve",
+                                        "CSF partial volume e.g. brain_pve_0",
+                                        true, "", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    cascade::stage::TissueSettings settings;
+    settings.Threshold = threshold.getValue();
+    settings.WhiteThreshold = whiteThreshold.getValue();
+
+    TissueFilterType::Pointer tissueFilter =
+        cascade::stage::TissueStage::Process(
+            cascade::util::LoadImage< InputImageType >(csfPve.getValue()),
+            cascade::util::LoadImage< InputImageType >(gmPve.getValue()),
+            cascade::util::LoadImage< InputImageType >(wmPve.getValue()),
+            LoadIfSet(stdWhite), LoadIfSet(flair), LoadIfSet(t2), settings);
+
+    WriteIfSet(csfOut, tissueFilter->GetCSFOutput());
+    WriteIfSet(gmOut, tissueFilter->GetGMOutput());
+    WriteIfSet(wmOut, tissueFilter->GetWMOutput());
+    WriteIfSet(wmgmOut, tissueFilter->GetWMGMOutput());
+    WriteIfSet(pveOut, tissueFilter->GetPVEOutput());
+    WriteIfSet(possibleWMOut, tissueFilter->GetPossibleWMOutput());
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
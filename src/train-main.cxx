@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+#include "itkVectorImage.h"
+/*
+ * ITK Filters
+ */
+#include "itkComposeImageFilter.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkMaskNegatedImageFilter.h"
+/*
+ * Others
+ */
+#include "util/itkTrainSingleNodeFilter.h"
+#include "util/stateModel.h"
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+/*
+ * Pixel types
+ */
+typedef float PixelType;
+/*
+ * Image types
+ */
+typedef itk::Image< PixelType, DIM > ImageType;
+typedef itk::VectorImage< PixelType, DIM > StateImageType;
+
+typedef itk::ComposeImageFilter< ImageType, StateImageType > ComposeFilterType;
+typedef itk::BinaryThresholdImageFilter< ImageType, ImageType > ThresholdFilterType;
+typedef itk::MaskNegatedImageFilter< ImageType, ImageType > MaskNegatedFilterType;
+typedef itk::TrainSingleNodeFilter< StateImageType, StateImageType > TrainFilterType;
+
+/** Single sequence states: weight, sum and sum of squared deviations */
+static const unsigned int StateLength = 3;
+
+/*
+ * Copy a single group state image into a group of a packed state image on
+ * the same grid.
+ */
+void SetStateGroup(StateImageType* model, unsigned int group,
+                   const StateImageType* state)
+  {
+  const unsigned int length = model->GetNumberOfComponentsPerPixel();
+  const itk::SizeValueType numberOfPixels =
+      model->GetLargestPossibleRegion().GetNumberOfPixels();
+  const PixelType* in = state->GetBufferPointer();
+  PixelType* out = model->GetBufferPointer();
+  for (itk::SizeValueType p = 0; p < numberOfPixels; p++)
+    std::copy(in + p * StateLength, in + (p + 1) * StateLength,
+              out + p * length + group * StateLength);
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. Coarse grid model training " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > outfile("o", "out",
+                                         "Trained packed model (.cms)", true,
+                                         "", "string", cmd);
+  TCLAP::ValueArg< std::string > model(
+      "m", "model", "Packed model (.cms) to continue training", false, "",
+      "string", cmd);
+  TCLAP::ValueArg< float > spacing(
+      "", "spacing", "Grid spacing of a new model in mm", false, 10, "Float",
+      cmd);
+  TCLAP::MultiArg< int > classes("c", "class", "Class label (1, 2 and 3)",
+                                 false, "Integer", cmd);
+  TCLAP::ValueArg< std::string > exclude(
+      "e", "exclude", "Voxels not to train on e.g. lesions", false, "",
+      "string", cmd);
+  TCLAP::ValueArg< std::string > pve(
+      "p", "pve", "Tissue types in the model space e.g. pve", true, "",
+      "string", cmd);
+  TCLAP::MultiArg< std::string > images(
+      "i", "image", "Sequence in the model space, one for each --sequence",
+      true, "string", cmd);
+  TCLAP::MultiArg< std::string > sequences("q", "sequence",
+                                           "Sequence name e.g. flair", true,
+                                           "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    if (sequences.getValue().size() != images.getValue().size())
+      {
+      itkGenericExceptionMacro(<< "Each --sequence needs an --image.");
+      }
+
+    ImageType::Pointer tissue = cascade::util::LoadImage< ImageType >(
+        pve.getValue());
+    ImageType::Pointer excluded;
+    if (exclude.isSet())
+      {
+      excluded = cascade::util::LoadImage< ImageType >(exclude.getValue());
+      }
+
+    /** The trained model has all groups of the old model and the new ones */
+    cascade::util::StateModelInfo oldInfo;
+    StateImageType::Pointer oldModel;
+    if (model.isSet())
+      {
+      oldModel = cascade::util::ReadStateModel< StateImageType >(
+          model.getValue(), oldInfo);
+      if (oldInfo.MeasurementDimension != 1)
+        {
+        itkGenericExceptionMacro(<< model.getValue()
+                                 << " is not a model of single sequence states.");
+        }
+      }
+    cascade::util::StateModelInfo info = oldInfo;
+    std::vector< int > labels = classes.getValue();
+    if (labels.empty() && !model.isSet())
+      {
+      labels.push_back(1);
+      labels.push_back(2);
+      labels.push_back(3);
+      }
+    for (unsigned int c = 0; c < labels.size(); c++)
+      if (std::find(info.Classes.begin(), info.Classes.end(), labels[c])
+          == info.Classes.end()) info.Classes.push_back(labels[c]);
+    if (labels.empty()) labels = info.Classes;
+    for (unsigned int s = 0; s < sequences.getValue().size(); s++)
+      if (std::find(info.Sequences.begin(), info.Sequences.end(),
+                    sequences.getValue()[s]) == info.Sequences.end())
+        info.Sequences.push_back(sequences.getValue()[s]);
+
+    /** A new grid covers the tissue image with the given spacing */
+    TrainFilterType::SizeType gridSize;
+    TrainFilterType::SpacingType gridSpacing;
+    for (unsigned int i = 0; i < DIM; i++)
+      {
+      const double extent = (tissue->GetLargestPossibleRegion().GetSize(i) - 1)
+          * tissue->GetSpacing()[i];
+      gridSpacing[i] = spacing.getValue();
+      gridSize[i] = static_cast< itk::SizeValueType >(std::ceil(
+          extent / gridSpacing[i])) + 1;
+      }
+
+    StateImageType::Pointer trained = StateImageType::New();
+    if (oldModel)
+      {
+      trained->CopyInformation(oldModel);
+      trained->SetRegions(oldModel->GetLargestPossibleRegion());
+      }
+    else
+      {
+      StateImageType::RegionType region;
+      region.SetSize(gridSize);
+      trained->SetRegions(region);
+      trained->SetSpacing(gridSpacing);
+      trained->SetOrigin(tissue->GetOrigin());
+      trained->SetDirection(tissue->GetDirection());
+      }
+    trained->SetNumberOfComponentsPerPixel(info.GetNumberOfComponents());
+    trained->Allocate();
+    StateImageType::PixelType emptyState(info.GetNumberOfComponents());
+    emptyState.Fill(0);
+    trained->FillBuffer(emptyState);
+
+    for (unsigned int c = 0; c < info.Classes.size(); c++)
+      {
+      const int label = info.Classes[c];
+      const bool isTrained = std::find(labels.begin(), labels.end(), label)
+          != labels.end();
+
+      ImageType::Pointer classMask;
+      if (isTrained)
+        {
+        ThresholdFilterType::Pointer thresholdFilter =
+            ThresholdFilterType::New();
+        thresholdFilter->SetInput(tissue);
+        thresholdFilter->SetLowerThreshold(label);
+        thresholdFilter->SetUpperThreshold(label);
+        thresholdFilter->SetInsideValue(1);
+        thresholdFilter->SetOutsideValue(0);
+        thresholdFilter->Update();
+        classMask = thresholdFilter->GetOutput();
+        if (excluded)
+          {
+          MaskNegatedFilterType::Pointer maskFilter =
+              MaskNegatedFilterType::New();
+          maskFilter->SetInput(classMask);
+          maskFilter->SetMaskImage(excluded);
+          maskFilter->Update();
+          classMask = maskFilter->GetOutput();
+          }
+        }
+
+      for (unsigned int s = 0; s < info.Sequences.size(); s++)
+        {
+        const std::string sequence = info.Sequences[s];
+        const unsigned int group = info.GetGroupIndex(label, sequence);
+        const int oldGroup = oldInfo.GetGroupIndex(label, sequence);
+        const std::vector< std::string >::const_iterator given = std::find(
+            sequences.getValue().begin(), sequences.getValue().end(), sequence);
+
+        StateImageType::Pointer initialState;
+        if (oldModel && oldGroup >= 0)
+          {
+          initialState = cascade::util::ExtractStateGroups(
+              oldModel.GetPointer(),
+              std::vector< unsigned int >(1, oldGroup), StateLength);
+          }
+        if (!isTrained || given == sequences.getValue().end())
+          {
+          if (initialState)
+            SetStateGroup(trained, group, initialState);
+          continue;
+          }
+
+        ComposeFilterType::Pointer composeFilter = ComposeFilterType::New();
+        composeFilter->SetInput(
+            0,
+            cascade::util::LoadImage< ImageType >(
+                images.getValue()[given - sequences.getValue().begin()]));
+
+        TrainFilterType::Pointer trainFilter = TrainFilterType::New();
+        trainFilter->SetInput(composeFilter->GetOutput());
+        trainFilter->SetMaskImage(classMask);
+        if (initialState)
+          {
+          trainFilter->SetInitialState(initialState);
+          }
+        else
+          {
+          trainFilter->SetOutputParametersFromImage(trained);
+          }
+        trainFilter->Update();
+        SetStateGroup(trained, group, trainFilter->GetOutput());
+        }
+      }
+
+    cascade::util::WriteStateModel(outfile.getValue(), info,
+                                   trained.GetPointer());
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }
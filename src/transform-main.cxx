@@ -19,45 +19,102 @@
  * CPP Headers
  */
 
-#include <fstream>
 #include <string>
 /*
  * General ITK
  */
 #include "itkImage.h"
-/*
- * ITK Filters
- */
-#include "itkCastImageFilter.h"
-#include "itkUnaryFunctorImageFilter.h"
 /*
  * Others
  */
+#include "stage/transformStage.h"
 
-#include "util/itkIntensityTableLookupFunctor.h"
-
+#include "util/histogram.h"
 #include "util/helpers.h"
+#include "util/batch.h"
+#include "util/profiler.h"
+#include "util/threading.h"
 #include "3rdparty/tclap/CmdLine.h"
 
+typedef cascade::stage::TransformStage TransformStageType;
+
 /*
- * Pixel types
- */
-typedef unsigned int InputPixelType;
-typedef float OutputPixelType;
-typedef float InterimPixelType;
-/*
- * Image types
+ * What to apply to an image: either a transformation file or a target
+ * histogram, optionally with the histogram of the image.
  */
-typedef itk::Image< InputPixelType, DIM > InputImageType;
-typedef itk::Image< OutputPixelType, DIM > OutputImageType;
-typedef itk::Image< InterimPixelType, DIM > InterimImageType;
+struct TransformSettings
+  {
+  std::string Transform;
+  std::string SourceHist;
+  std::string TargetHist;
+  std::string Mask;
+  unsigned int Bins;
+  };
+
+cascade::util::HistogramTable LoadHistogram(const std::string & filename)
+  {
+  cascade::util::HistogramTable histogram;
+  if (!cascade::util::ReadHistogram(filename, histogram))
+    {
+    itkGenericExceptionMacro("Can not read histogram " << filename);
+    }
+  return histogram;
+  }
+
+void TransformImage(const std::string & inputFile,
+                    const std::string & outputFile,
+                    const TransformSettings & settings)
+  {
+  TransformStageType::InputImageType::Pointer inputImage =
+      cascade::util::LoadImage< TransformStageType::InputImageType >(
+          inputFile);
+
+  cascade::stage::ImageType::Pointer outputImage;
+  if (!settings.TargetHist.empty())
+    {
+    const cascade::util::HistogramTable target = LoadHistogram(
+        settings.TargetHist);
+    cascade::util::HistogramTable source;
+    TransformStageType::MaskImageType::Pointer maskImage;
+    if (!settings.SourceHist.empty())
+      {
+      source = LoadHistogram(settings.SourceHist);
+      }
+    else if (!settings.Mask.empty())
+      {
+      maskImage = cascade::util::LoadImage< TransformStageType::MaskImageType >(
+          settings.Mask);
+      }
+    outputImage = TransformStageType::Process(
+        inputImage, target, settings.SourceHist.empty() ? 0 : &source,
+        maskImage, settings.Bins);
+    }
+  else
+    {
+    outputImage = TransformStageType::Process(inputImage, settings.Transform);
+    }
 
-typedef itk::CastImageFilter< InputImageType, InterimImageType > CastToInterimType;
-typedef itk::CastImageFilter< InterimImageType, OutputImageType > CastToOutputType;
+  cascade::util::WriteImage(outputFile, outputImage.GetPointer());
+  }
 
-typedef itk::IntensityTableLookupFunctor< InterimPixelType, InterimPixelType > LookupFunctorType;
-typedef itk::UnaryFunctorImageFilter< InterimImageType, InterimImageType,
-    LookupFunctorType > LookupTransform;
+/*
+ * Manifest rows are "input transform output [source-hist]". A transform
+ * ending with .hist is a target histogram.
+ */
+void TransformJob(const cascade::util::ManifestRow & row, void* userData)
+  {
+  TransformSettings settings = *static_cast< TransformSettings* >(userData);
+  if (cascade::util::endsWith(row[1], ".hist"))
+    {
+    settings.TargetHist = row[1];
+    if (row.size() > 3) settings.SourceHist = row[3];
+    }
+  else
+    {
+    settings.Transform = row[1];
+    }
+  TransformImage(row[0], row[2], settings);
+  }
 
 int main(int argc, char *argv[])
   {
@@ -72,9 +129,49 @@ int main(int argc, char *argv[])
                                            "Intensity transformation file",
                                            false, "", "string", cmd);
 
+  TCLAP::ValueArg< std::string > sourceHist(
+      "", "source-hist",
+      "Histogram of the input (.hist). Computed from the input if not given.",
+      false, "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > targetHist(
+      "", "target-hist",
+      "Standard histogram (.hist) to match the input to. Replaces --transform.",
+      false, "", "string", cmd);
+
+  TCLAP::ValueArg< std::string > mask(
+      "m", "mask", "Mask for the input histogram e.g. WMGM.nii.gz", false, "",
+      "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > bins("b", "bins",
+                                       "Bins of the input histogram", false,
+                                       100, "Integer", cmd);
+
+  TCLAP::ValueArg< unsigned int > jobs(
+      "j", "jobs", "Number of images processed at the same time in batch mode",
+      false, 2, "Integer", cmd);
+
   TCLAP::ValueArg< std::string > input("i", "input",
                                        "Input sequences e.g. MPRAGE.nii.gz",
-                                       true, "", "string", cmd);
+                                       true, "", "string");
+
+  TCLAP::ValueArg< std::string > batch(
+      "", "batch",
+      "Manifest with one \"input transform output [source-hist]\" per line. "
+      "The transform is a target histogram if it ends with .hist. Other "
+      "options apply to all the images.",
+      true, "", "string");
+  cmd.xorAdd(input, batch);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
 
   /*
    * Parse the argv array.
@@ -92,35 +189,39 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
     }
 
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
   /*
    * Argument and setting up the pipeline
    */
   try
     {
-    CastToInterimType::Pointer castToInterim = CastToInterimType::New();
-    castToInterim->SetInput(
-        cascade::util::LoadImage< InputImageType >(input.getValue()));
-
-    LookupFunctorType lookupFunctor;
-
-    std::ifstream infile(transform.getValue().c_str());
-    double from, to, perc;
-    while (infile >> perc >> from >> to)
-    {
-      lookupFunctor.AddLookupRow(from, to);
-    }
-    lookupFunctor.AddLookupRow(0, 0);
-
-    LookupTransform::Pointer lookupTransform = LookupTransform::New();
-    lookupTransform->SetInput(castToInterim->GetOutput());
-    lookupTransform->SetFunctor(lookupFunctor);
-    lookupTransform->Update();
-
-    CastToOutputType::Pointer castToOutput = CastToOutputType::New();
-    castToOutput->SetInput(lookupTransform->GetOutput());
-    castToOutput->Update();
-
-    cascade::util::WriteImage(outfile.getValue(), castToOutput->GetOutput());
+    TransformSettings settings;
+    settings.Transform = transform.getValue();
+    settings.SourceHist = sourceHist.getValue();
+    settings.TargetHist = targetHist.getValue();
+    settings.Mask = mask.getValue();
+    settings.Bins = bins.getValue();
+
+    if (batch.isSet())
+      {
+      const cascade::util::ManifestType manifest =
+          cascade::util::ReadManifest(batch.getValue(), 3, 4);
+      settings.Transform.clear();
+      settings.TargetHist.clear();
+      settings.SourceHist.clear();
+      if (cascade::util::RunBatch(manifest, TransformJob, &settings,
+                                  jobs.getValue()))
+        {
+        return EXIT_FAILURE;
+        }
+      }
+    else
+      {
+      TransformImage(input.getValue(), outfile.getValue(), settings);
+      }
     }
   catch (itk::ExceptionObject & err)
     {
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "itkMacro.h"
+#include "itkMultiThreader.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkImageIOFactory.h"
+
+#include "threading.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+typedef std::vector< std::string > ManifestRow;
+typedef std::vector< ManifestRow > ManifestType;
+
+/*
+ * Parse a batch manifest: one job per line with whitespace separated
+ * columns. Empty lines and lines starting with '#' are skipped. Every job
+ * should have between minColumns and maxColumns columns. name is used in
+ * the error messages.
+ */
+inline ManifestType ParseManifest(std::istream &stream,
+                                  std::string const &name, size_t minColumns,
+                                  size_t maxColumns)
+  {
+  ManifestType manifest;
+  std::string line;
+  for (unsigned int lineNumber = 1; std::getline(stream, line); lineNumber++)
+    {
+    std::istringstream lineStream(line);
+    ManifestRow row;
+    std::string column;
+    while (lineStream >> column)
+      row.push_back(column);
+    if (row.empty() || row[0][0] == '#') continue;
+    if (row.size() < minColumns || row.size() > maxColumns)
+      {
+      itkGenericExceptionMacro(
+          name << ":" << lineNumber << ": expected " << minColumns
+          << " to " << maxColumns << " columns but got " << row.size());
+      }
+    manifest.push_back(row);
+    }
+  return manifest;
+  }
+
+/** Read a batch manifest file, see ParseManifest */
+inline ManifestType ReadManifest(std::string const &filename,
+                                 size_t minColumns, size_t maxColumns)
+  {
+  std::ifstream file(filename.c_str());
+  if (!file)
+    {
+    itkGenericExceptionMacro("Can not read manifest " << filename);
+    }
+  return ParseManifest(file, filename, minColumns, maxColumns);
+  }
+
+/** Processes a single manifest row, failures are reported by throwing */
+typedef void (*BatchJobFunction)(const ManifestRow & row, void* userData);
+
+namespace batch
+{
+
+struct Pool
+  {
+  const ManifestType* Manifest;
+  BatchJobFunction Job;
+  void* UserData;
+  size_t NextJob;
+  size_t NumberOfFailedJobs;
+  bool PinToNumaNodes;
+  itk::SimpleFastMutexLock Lock;
+  };
+
+inline std::string JoinRow(const ManifestRow & row)
+  {
+  std::string joined;
+  for (size_t c = 0; c < row.size(); c++)
+    joined += (c ? " " : "") + row[c];
+  return joined;
+  }
+
+inline ITK_THREAD_RETURN_TYPE WorkerCallback(void* arg)
+  {
+  itk::MultiThreader::ThreadInfoStruct* info =
+      static_cast< itk::MultiThreader::ThreadInfoStruct* >(arg);
+  Pool* pool = static_cast< Pool* >(info->UserData);
+  if (pool->PinToNumaNodes) PinToNumaNode(info->ThreadID);
+  while (true)
+    {
+    pool->Lock.Lock();
+    const size_t job = pool->NextJob++;
+    pool->Lock.Unlock();
+    if (job >= pool->Manifest->size()) break;
+
+    const ManifestRow & row = (*pool->Manifest)[job];
+    std::string error;
+    try
+      {
+      pool->Job(row, pool->UserData);
+      }
+    catch (itk::ExceptionObject & err)
+      {
+      error = err.GetDescription();
+      }
+    catch (std::exception & err)
+      {
+      error = err.what();
+      }
+    if (!error.empty())
+      {
+      pool->Lock.Lock();
+      ++pool->NumberOfFailedJobs;
+      std::cerr << "Failed: " << JoinRow(row) << "\n  " << error << std::endl;
+      pool->Lock.Unlock();
+      }
+    }
+  return ITK_THREAD_RETURN_VALUE;
+  }
+
+}  // namespace batch
+
+/*
+ * Run job on every manifest row with a pool of numberOfWorkers workers.
+ * While one worker reads or writes its images the others compute, and the
+ * ITK threads are shared between the workers. With $CASCADE_PIN_NUMA the
+ * workers are spread over the NUMA nodes. Returns the number of failed jobs.
+ */
+inline size_t RunBatch(ManifestType const &manifest, BatchJobFunction job,
+                       void* userData, unsigned int numberOfWorkers)
+  {
+  if (manifest.empty()) return 0;
+
+  const itk::ThreadIdType numberOfThreads =
+      itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  const itk::ThreadIdType workers = std::max< itk::ThreadIdType >(
+      std::min< size_t >(numberOfWorkers, manifest.size()), 1);
+
+  /** Factories are registered once before the workers start */
+  itk::ImageIOFactory::CreateImageIO("", itk::ImageIOFactory::ReadMode);
+
+  batch::Pool pool;
+  pool.Manifest = &manifest;
+  pool.Job = job;
+  pool.UserData = userData;
+  pool.NextJob = 0;
+  pool.NumberOfFailedJobs = 0;
+  pool.PinToNumaNodes = IsNumaPinningEnabled();
+
+  itk::MultiThreader::SetGlobalDefaultNumberOfThreads(
+      std::max< itk::ThreadIdType >(numberOfThreads / workers, 1));
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  threader->SetNumberOfThreads(workers);
+  threader->SetSingleMethod(batch::WorkerCallback, &pool);
+  threader->SingleMethodExecute();
+  itk::MultiThreader::SetGlobalDefaultNumberOfThreads(numberOfThreads);
+
+  return pool.NumberOfFailedJobs;
+  }
+
+}  // namespace util
+
+}  // namespace cascade
+
+#endif /* BATCH_H_ */
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "itkIntTypes.h"
+#include "profiler.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * A benchmark case runs its kernel the given number of times. Items are the
+ * units of work of one iteration e.g. the voxels of an image.
+ */
+typedef void (*BenchmarkFunction)(void* userData,
+                                  itk::SizeValueType iterations);
+
+struct BenchmarkResult
+{
+  std::string Name;
+  itk::SizeValueType Iterations;
+  double WallTime;
+  double CPUTime;
+  itk::SizeValueType ItemsPerIteration;
+};
+
+/*
+ * Runs benchmark cases in the manner of Google Benchmark: the number of
+ * iterations grows until a run takes at least the minimum time and the
+ * times of that run are reported per iteration.
+ */
+class BenchmarkRunner
+{
+public:
+  BenchmarkRunner(double minimumTime, std::string const &filter) :
+      m_MinimumTime(minimumTime), m_Filter(filter)
+    {
+    }
+
+  /** Cases whose name does not contain the filter are skipped */
+  void Run(std::string const &name, BenchmarkFunction function,
+           void* userData, itk::SizeValueType itemsPerIteration)
+    {
+    if (name.find(m_Filter) == std::string::npos) return;
+
+    BenchmarkResult result;
+    result.Name = name;
+    result.ItemsPerIteration = itemsPerIteration;
+    result.Iterations = 1;
+    while (true)
+      {
+      result.CPUTime = Profiler::GetCPUTime();
+      result.WallTime = Profiler::GetWallTime();
+      function(userData, result.Iterations);
+      result.WallTime = Profiler::GetWallTime() - result.WallTime;
+      result.CPUTime = Profiler::GetCPUTime() - result.CPUTime;
+      if (result.WallTime >= m_MinimumTime || result.Iterations >= 1000000000)
+        break;
+      /** Aim 40% over the minimum time, at most ten times more iterations */
+      const double scale = result.WallTime > 0 ?
+          1.4 * m_MinimumTime / result.WallTime : 10;
+      const itk::SizeValueType next = static_cast< itk::SizeValueType >(
+          result.Iterations * (scale < 10 ? scale : 10));
+      result.Iterations = next > result.Iterations ? next :
+                                                     result.Iterations + 1;
+      }
+    m_Results.push_back(result);
+
+    char line[256];
+    std::sprintf(line, "%-48s %14.1f ns %14.1f ns %12lu %14.4g items/s",
+                 name.c_str(), 1e9 * result.WallTime / result.Iterations,
+                 1e9 * result.CPUTime / result.Iterations,
+                 static_cast< unsigned long >(result.Iterations),
+                 ItemsPerSecond(result));
+    std::cout << line << std::endl;
+    }
+
+  std::vector< BenchmarkResult > const & GetResults() const
+    {
+    return m_Results;
+    }
+
+  /*
+   * Google Benchmark like JSON, times in nanoseconds per iteration:
+   * {"context": {...}, "benchmarks": [{"name": ..., "iterations": ...,
+   * "real_time": ..., "cpu_time": ..., "time_unit": "ns",
+   * "items_per_second": ...}, ...]}
+   */
+  void Write(std::ostream & out, std::string const &tool,
+             std::string const &version, std::string const &buildInfo,
+             unsigned int maximumThreads) const
+    {
+    out << "{\n  \"context\": {\n    \"tool\": \"" << tool
+        << "\",\n    \"version\": \"" << version
+        << "\",\n    \"build\": \"" << buildInfo
+        << "\",\n    \"max_threads\": " << maximumThreads
+        << ",\n    \"min_time\": " << m_MinimumTime
+        << "\n  },\n  \"benchmarks\": [";
+    for (size_t r = 0; r < m_Results.size(); r++)
+      {
+      const BenchmarkResult & result = m_Results[r];
+      char times[256];
+      std::sprintf(times, "\"real_time\": %.3f, \"cpu_time\": %.3f, "
+                   "\"time_unit\": \"ns\", \"items_per_second\": %.6g",
+                   1e9 * result.WallTime / result.Iterations,
+                   1e9 * result.CPUTime / result.Iterations,
+                   ItemsPerSecond(result));
+      out << (r ? ",\n" : "\n") << "    {\"name\": \"" << result.Name
+          << "\", \"iterations\": " << result.Iterations << ", " << times
+          << "}";
+      }
+    out << "\n  ]\n}\n";
+    }
+
+private:
+  static double ItemsPerSecond(BenchmarkResult const &result)
+    {
+    return result.WallTime > 0 ?
+        result.ItemsPerIteration * result.Iterations / result.WallTime : 0;
+    }
+
+  double m_MinimumTime;
+  std::string m_Filter;
+  std::vector< BenchmarkResult > m_Results;
+};
+
+}  // namespace util
+
+}  // namespace cascade
+
+#endif /* BENCHMARK_H_ */
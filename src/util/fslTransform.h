@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef FSLTRANSFORM_H_
+#define FSLTRANSFORM_H_
+
+#include <string>
+#include <fstream>
+#include "itkImage.h"
+#include "itkAffineTransform.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_vector.h"
+#include "vnl/algo/vnl_determinant.h"
+#include "vnl/algo/vnl_matrix_inverse.h"
+#include "helpers.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * FSL tools (flirt, fnirt, applywarp) express positions in "FSL mm": voxel
+ * indices scaled by the spacing, with the x index reversed when the voxel to
+ * world matrix has a positive determinant (neurological storage).
+ */
+template< class ImageT >
+bool IsFSLFlipped(const ImageT* image)
+  {
+  const unsigned int D = ImageT::ImageDimension;
+  const vnl_matrix< double > direction(
+      image->GetDirection().GetVnlMatrix().data_block(), D, D);
+  return vnl_determinant(direction) > 0;
+  }
+
+/** Homogeneous matrix from voxel index to FSL mm */
+template< class ImageT >
+vnl_matrix< double > FSLFromIndexMatrix(const ImageT* image)
+  {
+  const unsigned int D = ImageT::ImageDimension;
+  vnl_matrix< double > matrix(D + 1, D + 1, 0.0);
+  for (unsigned int d = 0; d < D; d++)
+    matrix(d, d) = image->GetSpacing()[d];
+  matrix(D, D) = 1;
+  if (IsFSLFlipped(image))
+    {
+    const double last = image->GetLargestPossibleRegion().GetSize(0) - 1;
+    matrix(0, 0) = -image->GetSpacing()[0];
+    matrix(0, D) = last * image->GetSpacing()[0];
+    }
+  return matrix;
+  }
+
+/** Homogeneous matrix from voxel index to ITK physical space */
+template< class ImageT >
+vnl_matrix< double > PhysicalFromIndexMatrix(const ImageT* image)
+  {
+  const unsigned int D = ImageT::ImageDimension;
+  vnl_matrix< double > matrix(D + 1, D + 1, 0.0);
+  for (unsigned int i = 0; i < D; i++)
+    {
+    for (unsigned int j = 0; j < D; j++)
+      matrix(i, j) = image->GetDirection()(i, j) * image->GetSpacing()[j];
+    matrix(i, D) = image->GetOrigin()[i];
+    }
+  matrix(D, D) = 1;
+  return matrix;
+  }
+
+/** Homogeneous matrix from FSL mm to ITK physical space */
+template< class ImageT >
+vnl_matrix< double > PhysicalFromFSLMatrix(const ImageT* image)
+  {
+  return PhysicalFromIndexMatrix(image)
+      * vnl_matrix_inverse< double >(FSLFromIndexMatrix(image)).inverse();
+  }
+
+/*
+ * Read a flirt matrix (-omat) from moving to reference as an ITK affine
+ * transform from reference to moving physical points, the direction used
+ * for resampling.
+ */
+template< class ReferenceImageT, class MovingImageT >
+typename itk::AffineTransform< double, ReferenceImageT::ImageDimension >::Pointer ReadFSLMatrix(
+    std::string filename, const ReferenceImageT* reference,
+    const MovingImageT* moving)
+  {
+  const unsigned int D = ReferenceImageT::ImageDimension;
+  typedef itk::AffineTransform< double, ReferenceImageT::ImageDimension > AffineTransformType;
+
+  std::ifstream file(filename.c_str());
+  vnl_matrix< double > fslMatrix(D + 1, D + 1);
+  for (unsigned int i = 0; i < D + 1; i++)
+    for (unsigned int j = 0; j < D + 1; j++)
+      file >> fslMatrix(i, j);
+  if (!file)
+    {
+    itkGenericExceptionMacro(<< "Can not read FSL matrix " << filename);
+    }
+
+  const vnl_matrix< double > matrix = PhysicalFromFSLMatrix(moving)
+      * vnl_matrix_inverse< double >(fslMatrix).inverse()
+      * vnl_matrix_inverse< double >(PhysicalFromFSLMatrix(reference)).inverse();
+
+  typename AffineTransformType::MatrixType linear;
+  typename AffineTransformType::OutputVectorType offset;
+  for (unsigned int i = 0; i < D; i++)
+    {
+    for (unsigned int j = 0; j < D; j++)
+      linear(i, j) = matrix(i, j);
+    offset[i] = matrix(i, D);
+    }
+  typename AffineTransformType::Pointer transform = AffineTransformType::New();
+  transform->SetMatrix(linear);
+  transform->SetOffset(offset);
+  return transform;
+  }
+
+/*
+ * Read an FSL warp field (e.g. from invwarp or convertwarp) as an ITK
+ * displacement field in physical space. The field is stored as a 4D image
+ * whose last axis holds the components and defines the reference grid. The
+ * warp maps into the FSL mm of input, relative to the reference position
+ * (convertwarp --relout) or absolute (--absout).
+ */
+template< class FieldT, class InputImageT >
+typename FieldT::Pointer ReadFSLWarpField(std::string filename,
+                                          const InputImageT* input,
+                                          bool relative = true)
+  {
+  const unsigned int D = FieldT::ImageDimension;
+  typedef itk::Image< float, FieldT::ImageDimension + 1 > WarpImageType;
+
+  typename WarpImageType::Pointer warp = LoadImage< WarpImageType >(filename);
+  const typename WarpImageType::RegionType warpRegion =
+      warp->GetLargestPossibleRegion();
+  if (warpRegion.GetSize(D) != D)
+    {
+    itkGenericExceptionMacro(<< filename << " is not a " << D
+                             << " component warp field.");
+    }
+
+  typename FieldT::RegionType region;
+  typename FieldT::SpacingType spacing;
+  typename FieldT::PointType origin;
+  typename FieldT::DirectionType direction;
+  for (unsigned int i = 0; i < D; i++)
+    {
+    region.SetIndex(i, warpRegion.GetIndex(i));
+    region.SetSize(i, warpRegion.GetSize(i));
+    spacing[i] = warp->GetSpacing()[i];
+    origin[i] = warp->GetOrigin()[i];
+    for (unsigned int j = 0; j < D; j++)
+      direction(i, j) = warp->GetDirection()(i, j);
+    }
+  typename FieldT::Pointer field = FieldT::New();
+  field->SetRegions(region);
+  field->SetSpacing(spacing);
+  field->SetOrigin(origin);
+  field->SetDirection(direction);
+  field->Allocate();
+
+  const vnl_matrix< double > fieldFSL = FSLFromIndexMatrix(field.GetPointer());
+  const vnl_matrix< double > fieldPhysical = PhysicalFromIndexMatrix(
+      field.GetPointer());
+  const vnl_matrix< double > inputPhysical = PhysicalFromFSLMatrix(input);
+
+  /** Components are the slowest varying axis of the 4D buffer */
+  const float* buffer = warp->GetBufferPointer();
+  const itk::SizeValueType numberOfPixels = region.GetNumberOfPixels();
+
+  vnl_vector< double > index(D + 1, 1.0);
+  vnl_vector< double > position(D + 1, 1.0);
+  itk::ImageRegionIteratorWithIndex< FieldT > it(field, region);
+  for (itk::SizeValueType p = 0; !it.IsAtEnd(); ++it, ++p)
+    {
+    for (unsigned int c = 0; c < D; c++)
+      index[c] = it.GetIndex()[c];
+    if (relative) position = fieldFSL * index;
+    else position.fill(0);
+    for (unsigned int c = 0; c < D; c++)
+      position[c] += buffer[c * numberOfPixels + p];
+    position[D] = 1;
+
+    const vnl_vector< double > displacement = inputPhysical * position
+        - fieldPhysical * index;
+    typename FieldT::PixelType pixel;
+    for (unsigned int c = 0; c < D; c++)
+      pixel[c] = displacement[c];
+    it.Set(pixel);
+    }
+  return field;
+  }
+
+} // namespace util
+
+} // namespace cascade
+
+#endif /* FSLTRANSFORM_H_ */
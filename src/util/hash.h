@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstdio>
+#include <string>
+#include "itkIntTypes.h"
+#include "itkMacro.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * 64 bit FNV-1a, used to identify contents e.g. the inputs of a stage. It is
+ * not a cryptographic hash.
+ */
+typedef itk::uint64_t HashType;
+
+static const HashType HashOffsetBasis = 14695981039346656037ULL;
+static const HashType HashPrime = 1099511628211ULL;
+
+inline HashType HashBytes(const void* data, size_t length,
+                          HashType hash = HashOffsetBasis)
+  {
+  const unsigned char* bytes = static_cast< const unsigned char* >(data);
+  for (size_t i = 0; i < length; i++)
+    {
+    hash ^= bytes[i];
+    hash *= HashPrime;
+    }
+  return hash;
+  }
+
+/** The length is hashed too, so consecutive strings do not run together */
+inline HashType HashString(std::string const &value,
+                           HashType hash = HashOffsetBasis)
+  {
+  const itk::uint64_t length = value.size();
+  hash = HashBytes(&length, sizeof(length), hash);
+  return HashBytes(value.data(), value.size(), hash);
+  }
+
+inline HashType HashFile(std::string const &filename,
+                         HashType hash = HashOffsetBasis)
+  {
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file)
+    {
+    itkGenericExceptionMacro("Can not read " << filename);
+    }
+  char buffer[1 << 16];
+  size_t length;
+  while ((length = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    hash = HashBytes(buffer, length, hash);
+  const bool failed = std::ferror(file) != 0;
+  std::fclose(file);
+  if (failed)
+    {
+    itkGenericExceptionMacro("Can not read " << filename);
+    }
+  return hash;
+  }
+
+inline std::string HashToString(HashType hash)
+  {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex(16, '0');
+  for (int i = 15; i >= 0; i--, hash >>= 4)
+    hex[i] = digits[hash & 0xf];
+  return hex;
+  }
+
+}  // namespace util
+
+}  // namespace cascade
+
+#endif /* HASH_H_ */
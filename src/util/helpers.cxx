@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "util/helpers.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+bool endsWith(std::string const &fullString, std::string const &ending)
+  {
+  if (fullString.length() >= ending.length())
+    {
+    return (0
+        == fullString.compare(fullString.length() - ending.length(),
+                              ending.length(), ending));
+    }
+  else
+    {
+    return false;
+    }
+  }
+
+}  // namespace util
+
+}  // namespace cascade
@@ -20,12 +20,24 @@
 
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <typeinfo>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
 #include "itkBinaryThresholdImageFilter.h"
 #include "itkImageMaskSpatialObject.h"
 #include <itkExtractImageFilter.h>
 #include "itkMinimumMaximumImageCalculator.h"
+#include "itkNiftiImageIO.h"
+#include "itkMemoryMappedImageContainer.h"
+#include "parallelGzip.h"
 
 #define ReportFilterMacro(FILTER) ::cascade::util::WriteImage( #FILTER ".nii.gz" , FILTER->GetOutput())
 
@@ -46,11 +58,30 @@ template< class ImageT >
 typename ImageT::Pointer LoadImage(std::string filename);
 
 template< class ImageT >
-void WriteImage(std::string filename, const ImageT* image);
+typename ImageT::Pointer MapImage(std::string filename);
+
+template< class ImageT >
+typename ImageT::Pointer InflateImage(std::string filename);
+
+/*
+ * .nii.gz images are written as parallel multi-member gzip with the given
+ * zlib compression level.
+ */
+template< class ImageT >
+void WriteImage(std::string filename, const ImageT* image,
+                int compressionLevel = 6);
 
 template< class ImageT >
 void IsImageProper(const ImageT* image);
 
+/*
+ * A new image over the pixels of image. Pipelines set the requested region
+ * of their inputs, so an image read by several threads is only plugged in
+ * through its own view.
+ */
+template< class ImageT >
+typename ImageT::Pointer ShareImage(const ImageT* image);
+
 bool endsWith(std::string const &fullString, std::string const &ending);
 
 
@@ -97,11 +128,266 @@ typename ImageT::Pointer CropImage(const ImageT* image,
   return output;
 
   }
+/*
+ * The fields of a NIfTI-1 header needed to map its voxels.
+ */
+struct NiftiHeaderInfo
+  {
+  float VoxOffset;
+  float SclSlope;
+  float SclInter;
+  /** The header is in the other byte order */
+  bool Swapped;
+  };
+
+/*
+ * Read the header of a single file NIfTI-1 image, compressed or not. Only the
+ * header is inflated. Fails for other files.
+ */
+inline bool ReadNiftiHeader(std::string const &filename, NiftiHeaderInfo &info)
+  {
+  unsigned char header[348];
+  gzFile file = gzopen(filename.c_str(), "rb");
+  if (!file) return false;
+  const int length = gzread(file, header, sizeof(header));
+  gzclose(file);
+  if (length != static_cast< int >(sizeof(header))
+      || std::memcmp(header + 344, "n+1", 4) != 0)
+    return false;
+
+  ::itk::int32_t sizeofHeader;
+  std::memcpy(&sizeofHeader, header, sizeof(sizeofHeader));
+  info.Swapped = sizeofHeader != 348;
+  if (info.Swapped)
+    {
+    for (unsigned int field = 0; field < 120; field += 4)
+      {
+      std::swap(header[field], header[field + 3]);
+      std::swap(header[field + 1], header[field + 2]);
+      }
+    std::memcpy(&sizeofHeader, header, sizeof(sizeofHeader));
+    if (sizeofHeader != 348) return false;
+    }
+
+  std::memcpy(&info.VoxOffset, header + 108, sizeof(float));
+  std::memcpy(&info.SclSlope, header + 112, sizeof(float));
+  std::memcpy(&info.SclInter, header + 116, sizeof(float));
+  return true;
+  }
+
+/*
+ * An image with the geometry of a single file NIfTI image (.nii or .nii.gz)
+ * whose voxels can be used as they are stored, with no buffer allocated. A
+ * null pointer is returned when they can not, e.g. the pixel type on disk
+ * differs from the pixel type of the image or the intensities are scaled.
+ */
+template< class ImageT >
+typename ImageT::Pointer NiftiImageInformation(std::string filename,
+                                               NiftiHeaderInfo & header)
+  {
+  typedef typename ImageT::PixelContainer PixelContainerType;
+  const unsigned int dim = ImageT::ImageDimension;
+  typename ImageT::Pointer image;
+
+  if (!ReadNiftiHeader(filename, header) || header.Swapped
+      || !(header.VoxOffset >= 348 && header.VoxOffset < 4294967296.0f)
+      || header.VoxOffset != static_cast< ::itk::uint32_t >(header.VoxOffset))
+    return image;
+  if (header.SclSlope != 0 && (header.SclSlope != 1 || header.SclInter != 0))
+    return image;
+
+  ::itk::NiftiImageIO::Pointer io = ::itk::NiftiImageIO::New();
+  io->SetFileName(filename);
+  io->ReadImageInformation();
+  if (io->GetNumberOfDimensions() != dim || io->GetNumberOfComponents() != 1
+      || io->GetPixelType() != ::itk::ImageIOBase::SCALAR
+      || typeid(typename ImageT::PixelType)
+          != typeid(typename PixelContainerType::Element)
+      || io->GetComponentTypeInfo()
+          != typeid(typename PixelContainerType::Element))
+    return image;
+
+  typename ImageT::RegionType region;
+  typename ImageT::SpacingType spacing;
+  typename ImageT::PointType origin;
+  typename ImageT::DirectionType direction;
+  for (unsigned int i = 0; i < dim; i++)
+    {
+    region.SetIndex(i, 0);
+    region.SetSize(i, io->GetDimensions(i));
+    spacing[i] = io->GetSpacing(i);
+    origin[i] = io->GetOrigin(i);
+    const std::vector< double > axis = io->GetDirection(i);
+    for (unsigned int j = 0; j < dim; j++)
+      direction[j][i] = axis[j];
+    }
+
+  image = ImageT::New();
+  image->SetRegions(region);
+  image->SetSpacing(spacing);
+  image->SetOrigin(origin);
+  image->SetDirection(direction);
+  return image;
+  }
+
+/*
+ * Use the voxels of an uncompressed NIfTI image (.nii) in place through a
+ * private memory mapping instead of reading them. A null pointer is returned
+ * when the file can not be used as is, see NiftiImageInformation.
+ */
+template< class ImageT >
+typename ImageT::Pointer MapImage(std::string filename)
+  {
+  typedef typename ImageT::PixelContainer PixelContainerType;
+  typedef ::itk::MemoryMappedImageContainer<
+      typename PixelContainerType::ElementIdentifier,
+      typename PixelContainerType::Element > MappedContainerType;
+
+  NiftiHeaderInfo header;
+  typename ImageT::Pointer image;
+  if (!endsWith(filename, ".nii")) return image;
+  image = NiftiImageInformation< ImageT >(filename, header);
+  if (!image) return image;
+
+  typename MappedContainerType::Pointer container = MappedContainerType::New();
+  if (!container->MapFile(
+      filename, static_cast< ::itk::SizeValueType >(header.VoxOffset),
+      image->GetLargestPossibleRegion().GetNumberOfPixels()))
+    return typename ImageT::Pointer();
+  image->SetPixelContainer(container);
+  return image;
+  }
+
+/*
+ * Inflate a multi-member NIfTI image (.nii.gz) written by WriteImage straight
+ * into the image buffer, in parallel. The member sizes must add up to the
+ * header and voxels of the image before anything is allocated. A null
+ * pointer is returned for other files, see also NiftiImageInformation.
+ */
+template< class ImageT >
+typename ImageT::Pointer InflateImage(std::string filename)
+  {
+  typedef typename ImageT::PixelContainer PixelContainerType;
+  typedef typename PixelContainerType::Element ElementType;
+
+  NiftiHeaderInfo header;
+  typename ImageT::Pointer image;
+  if (!endsWith(filename, ".nii.gz")) return image;
+  image = NiftiImageInformation< ImageT >(filename, header);
+  if (!image) return image;
+
+  const ::itk::uint64_t offset = static_cast< ::itk::uint64_t >(
+      header.VoxOffset);
+  const ::itk::uint64_t voxels =
+      image->GetLargestPossibleRegion().GetNumberOfPixels();
+  const ::itk::uint64_t limit = static_cast< ::itk::uint64_t >(-1);
+  if (voxels > (limit - offset) / sizeof(ElementType))
+    return typename ImageT::Pointer();
+  const ::itk::uint64_t length = voxels * sizeof(ElementType);
+
+  GzipMemberFile file;
+  if (!file.Open(filename, offset + length))
+    return typename ImageT::Pointer();
+  image->Allocate();
+  file.Inflate(offset,
+               reinterpret_cast< unsigned char* >(image->GetBufferPointer()),
+               length);
+  return image;
+  }
+
+/*
+ * Create an empty file with a unique name in directory and the given suffix.
+ */
+inline std::string CreateTemporaryFile(std::string const &directory,
+                                       std::string const &suffix)
+  {
+  std::string name = directory + "/cascade-XXXXXX" + suffix;
+  std::vector< char > buffer(name.begin(), name.end());
+  buffer.push_back('\0');
+  const int fd = mkstemps(&buffer[0], static_cast< int >(suffix.size()));
+  if (fd < 0)
+    {
+    itkGenericExceptionMacro("Can not create a temporary file in " << directory);
+    }
+  close(fd);
+  return std::string(&buffer[0]);
+  }
+
+inline mode_t ReadFileCreationMask()
+  {
+  const mode_t mask = umask(0);
+  umask(mask);
+  return mask;
+  }
+
+/** Mode of a newly created file, the umask is read before main runs */
+static const mode_t DefaultFileMode = 0666 & ~ReadFileCreationMask();
+
+/*
+ * Give a file made by CreateTemporaryFile the mode of a newly created file,
+ * mkstemps leaves it to the owner only.
+ */
+inline bool SetDefaultFileMode(std::string const &filename)
+  {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  const bool changed = fchmod(fd, DefaultFileMode) == 0;
+  close(fd);
+  return changed;
+  }
+
+inline std::string TemporaryDirectory()
+  {
+  const char* tmp = std::getenv("TMPDIR");
+  return tmp && *tmp ? tmp : "/tmp";
+  }
+
+inline std::string DirectoryName(std::string const &filename)
+  {
+  const std::string::size_type slash = filename.find_last_of('/');
+  if (slash == std::string::npos) return ".";
+  return slash == 0 ? "/" : filename.substr(0, slash);
+  }
+
+/*
+ * Copy a file as it is. The copy is made next to the target and renamed, so
+ * the target is never left half written. It gets the mode of a newly
+ * created file.
+ */
+inline void CopyFile(std::string const &source, std::string const &target)
+  {
+  std::ifstream in(source.c_str(), std::ios::binary);
+  if (!in)
+    {
+    itkGenericExceptionMacro("Can not read " << source);
+    }
+  const std::string temporary = CreateTemporaryFile(DirectoryName(target), "");
+  std::ofstream out(temporary.c_str(), std::ios::binary);
+  /** Streaming an empty buffer would flag the copy as failed */
+  if (in.peek() != std::ifstream::traits_type::eof()) out << in.rdbuf();
+  out.close();
+  if (!out || !SetDefaultFileMode(temporary)
+      || std::rename(temporary.c_str(), target.c_str()) != 0)
+    {
+    std::remove(temporary.c_str());
+    itkGenericExceptionMacro("Can not write " << target);
+    }
+  }
+
+/*
+ * Uncompressed NIfTI images with the requested pixel type are memory mapped.
+ * Multi-member .nii.gz images written by WriteImage are inflated in parallel
+ * straight into the image buffer. Everything else is read through the ITK
+ * image IO.
+ */
 template< class ImageT >
 typename ImageT::Pointer LoadImage(std::string filename)
   {
   typedef ::itk::ImageFileReader< ImageT > ImageReaderType;
-  typename ImageT::Pointer image;
+  typename ImageT::Pointer image = MapImage< ImageT >(filename);
+  if (!image) image = InflateImage< ImageT >(filename);
+  if (image) return image;
+
   typename ImageReaderType::Pointer reader = ImageReaderType::New();
   reader->SetFileName(filename);
   image = reader->GetOutput();
@@ -111,13 +397,34 @@ typename ImageT::Pointer LoadImage(std::string filename)
   }
 
 template< class ImageT >
-void WriteImage(std::string filename, const ImageT* image)
+void WriteImage(std::string filename, const ImageT* image,
+                int compressionLevel)
   {
   typedef ::itk::ImageFileWriter< ImageT > ImageWriterType;
   typename ImageWriterType::Pointer writer = ImageWriterType::New();
-  writer->SetFileName(filename);
   writer->SetInput(image);
-  writer->Update();
+  if (!endsWith(filename, ".nii.gz"))
+    {
+    writer->SetFileName(filename);
+    writer->Update();
+    return;
+    }
+
+  /** ITK writes the uncompressed image, compression is done in parallel */
+  const std::string uncompressed = CreateTemporaryFile(DirectoryName(filename),
+                                                       ".nii");
+  try
+    {
+    writer->SetFileName(uncompressed);
+    writer->Update();
+    GzipCompressFile(uncompressed, filename, compressionLevel);
+    }
+  catch (...)
+    {
+    std::remove(uncompressed.c_str());
+    throw;
+    }
+  std::remove(uncompressed.c_str());
   }
 
 template< class ImageT >
@@ -132,18 +439,16 @@ void IsImageProper(const ImageT* image)
             << imageCalculatorFilter->GetMaximum() << "]" << std::endl;
   }
 
-bool endsWith(std::string const &fullString, std::string const &ending)
+template< class ImageT >
+typename ImageT::Pointer ShareImage(const ImageT* image)
   {
-  if (fullString.length() >= ending.length())
-    {
-    return (0
-        == fullString.compare(fullString.length() - ending.length(),
-                              ending.length(), ending));
-    }
-  else
-    {
-    return false;
-    }
+  typename ImageT::Pointer view = ImageT::New();
+  view->CopyInformation(image);
+  view->SetRegions(image->GetLargestPossibleRegion());
+  view->SetPixelContainer(
+      const_cast< typename ImageT::PixelContainer* >(
+          image->GetPixelContainer()));
+  return view;
   }
 
 }  // namespace util
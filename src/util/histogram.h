@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "itkMacro.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * A row of a .hist file: "index intensity density cumulative".
+ * Histograms computed by cascade-histogram store the bin number as index and
+ * the bin center as intensity. The standard histograms in data/histograms
+ * store the normalised intensity in the index column.
+ */
+struct HistogramRow
+  {
+  double Index;
+  double Intensity;
+  double Density;
+  double Cumulative;
+  };
+
+typedef std::vector< HistogramRow > HistogramTable;
+
+/*
+ * Normalised histogram of samples with bins equal bins over [minimum,
+ * maximum]. Samples outside the range are counted in the first or last bin
+ * as fslstats -H does.
+ */
+template< class TSample >
+HistogramTable ComputeHistogram(const std::vector< TSample > & samples,
+                                unsigned int bins, double minimum,
+                                double maximum)
+  {
+  if (bins == 0 || !(maximum > minimum))
+    {
+    itkGenericExceptionMacro(
+        "Invalid histogram range [" << minimum << ", " << maximum << "] with "
+        << bins << " bins.");
+    }
+  if (samples.empty())
+    {
+    itkGenericExceptionMacro("No sample for the histogram.");
+    }
+
+  std::vector< double > counts(bins, 0.0);
+  const double scale = bins / (maximum - minimum);
+  for (size_t s = 0; s < samples.size(); s++)
+    {
+    const double position = (static_cast< double >(samples[s]) - minimum)
+        * scale;
+    unsigned int bin = 0;
+    if (position >= bins) bin = bins - 1;
+    else if (position > 0) bin = static_cast< unsigned int >(position);
+    counts[bin]++;
+    }
+
+  HistogramTable table(bins);
+  double cumulative = 0;
+  for (unsigned int b = 0; b < bins; b++)
+    {
+    table[b].Index = b;
+    table[b].Intensity = minimum + (b + 0.5) / scale;
+    table[b].Density = counts[b] / samples.size();
+    cumulative += table[b].Density;
+    table[b].Cumulative = cumulative;
+    }
+  return table;
+  }
+
+inline bool ReadHistogram(std::string const &filename, HistogramTable &table)
+  {
+  std::ifstream file(filename.c_str());
+  if (!file) return false;
+  table.clear();
+  std::string line;
+  while (std::getline(file, line))
+    {
+    std::istringstream stream(line);
+    HistogramRow row;
+    if (stream >> row.Index >> row.Intensity >> row.Density >> row.Cumulative)
+      table.push_back(row);
+    }
+  return !table.empty();
+  }
+
+/** Write a .hist file, "-" writes to the standard output */
+inline void WriteHistogram(std::string const &filename,
+                           HistogramTable const &table)
+  {
+  std::ostringstream stream;
+  stream.setf(std::ios::fixed);
+  stream.precision(10);
+  for (size_t r = 0; r < table.size(); r++)
+    {
+    const long index = static_cast< long >(table[r].Index);
+    if (index == table[r].Index) stream << index;
+    else stream << table[r].Index;
+    stream << " " << table[r].Intensity
+           << " " << table[r].Density << " " << table[r].Cumulative << "\n";
+    }
+
+  if (filename == "-")
+    {
+    std::fwrite(stream.str().data(), 1, stream.str().size(), stdout);
+    std::fflush(stdout);
+    return;
+    }
+  std::ofstream file(filename.c_str());
+  file << stream.str();
+  file.close();
+  if (!file)
+    {
+    itkGenericExceptionMacro("Can not write histogram to " << filename);
+    }
+  }
+
+/*
+ * A row of an intensity transformation: the source intensity at a
+ * percentile and the target intensity it is mapped to.
+ */
+struct IntensityMatchRow
+  {
+  double Percentile;
+  double From;
+  double To;
+  };
+
+typedef std::vector< IntensityMatchRow > IntensityMatchTable;
+
+/*
+ * Match the cumulative density of source to target. Every source bin center
+ * is mapped to the target index column linearly interpolated at the source
+ * cumulative density. Beyond the last target bin the last two bins are
+ * extrapolated and negative intensities are clamped to zero, as
+ * cascade-histogram-match.sh does.
+ */
+inline IntensityMatchTable MatchHistograms(HistogramTable const &source,
+                                           HistogramTable const &target)
+  {
+  if (target.size() < 2)
+    {
+    itkGenericExceptionMacro("Target histogram needs at least two bins.");
+    }
+
+  IntensityMatchTable table;
+  table.reserve(source.size());
+  const size_t n = target.size();
+  size_t j = 0;
+  for (size_t i = 0; i < source.size(); i++)
+    {
+    const double percentile = source[i].Cumulative;
+    double percLo, percHi, intLo, intHi;
+    while (true)
+      {
+      /** Past the end the target is extended by its last step */
+      const size_t lo = std::min(j, n - 2);
+      const double lastPerc = 2 * target[lo + 1].Cumulative
+          - target[lo].Cumulative;
+      const double lastInt = 2 * target[lo + 1].Index - target[lo].Index;
+      percLo = j < n ? target[j].Cumulative : lastPerc;
+      intLo = j < n ? target[j].Index : lastInt;
+      percHi = j + 1 < n ? target[j + 1].Cumulative : lastPerc;
+      intHi = j + 1 < n ? target[j + 1].Index : lastInt;
+
+      /** Nothing changes past the end, stop there instead of looping */
+      if (percentile <= percHi || j >= n) break;
+      j++;
+      }
+
+    double to;
+    if (percLo == percHi)
+      {
+      to = (intHi - intLo) / 2;
+      }
+    else
+      {
+      to = (intHi - intLo) / (percHi - percLo) * (percentile - percLo) + intLo;
+      }
+
+    IntensityMatchRow row;
+    row.Percentile = percentile;
+    row.From = source[i].Intensity;
+    row.To = to > 0 ? to : 0;
+    table.push_back(row);
+    }
+  return table;
+  }
+
+}  // namespace util
+
+}  // namespace cascade
+
+#endif /* HISTOGRAM_H_ */
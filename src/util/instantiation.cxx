@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+/*
+ * Explicit instantiations of the cascade filters for the pixel types and
+ * dimensions the tools use. The tools are compiled with
+ * CASCADE_MANUAL_INSTANTIATION so the filter bodies are compiled once here
+ * instead of in every executable.
+ *
+ * The state images are VectorImage, so a single instantiation covers every
+ * number of channels (D=1..4 and beyond).
+ */
+#include "buildinfo.h"
+
+#include "itkImage.h"
+#include "itkVectorImage.h"
+
+#include "util/itkWeightedSinglePassMeanCovarianceUpdate.hxx"
+#include "util/itkStateInterpolatorFunction.hxx"
+#include "util/itkStateResampleImageFilter.hxx"
+#include "util/itkTrainSingleNodeFilter.hxx"
+#include "util/itkNormalModelScoreImageFilter.hxx"
+#include "util/itkMaskedQuantileImageFilter.hxx"
+#include "util/itkComponentStatisticsOpeningImageFilter.hxx"
+#include "util/itkLesionHypothesisImageFilter.hxx"
+#include "util/itkTissueTypeRefinementFilter.hxx"
+#include "util/itkOrientationEnhanceFilter.hxx"
+
+#define CASCADE_INSTANTIATE_FILTERS(D)                                                          \
+  template class StateInterpolatorFunction< VectorImage< float, D >, double >;                  \
+  template class StateResampleImageFilter< VectorImage< float, D > >;                           \
+  template class TrainSingleNodeFilter< VectorImage< float, D >, VectorImage< float, D > >;     \
+  template class NormalModelScoreImageFilter< Image< float, D >, Image< float, D > >;           \
+  template class MaskedQuantileImageFilter< Image< float, D >, Image< unsigned char, D > >;     \
+  template class MaskedQuantileImageFilter< Image< float, D >, Image< float, D > >;             \
+  template class MaskedQuantileImageFilter< Image< unsigned int, D >, Image< unsigned char, D > >; \
+  template class ComponentStatisticsOpeningImageFilter< Image< float, D >, Image< float, D > >; \
+  template class ComponentStatisticsOpeningImageFilter< Image< unsigned int, D >, Image< unsigned int, D > >; \
+  template class LesionHypothesisImageFilter< Image< float, D >, Image< unsigned char, D > >;   \
+  template class TissueTypeRefinementFilter< Image< float, D >, Image< unsigned char, D > >;    \
+  template class OrientationEnhanceFilter< Image< float, D >, Image< float, D > >;
+
+namespace itk
+{
+/** The state pixel does not depend on the dimension */
+template class WeightedSinglePassMeanCovarianceUpdate< VariableLengthVector< float > >;
+
+CASCADE_INSTANTIATE_FILTERS(2)
+CASCADE_INSTANTIATE_FILTERS(3)
+#if DIM != 2 && DIM != 3
+CASCADE_INSTANTIATE_FILTERS(DIM)
+#endif
+} // end namespace itk
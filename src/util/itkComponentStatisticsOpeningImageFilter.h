@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkComponentStatisticsOpeningImageFilter_h
+#define __itkComponentStatisticsOpeningImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkNumericTraits.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/*
+ * Statistics opening on the connected components of a thresholded image.
+ *
+ * Pixels with value above or equal to BinarizeThreshold are labeled into
+ * connected components in a single raster scan (union-find). While labeling,
+ * only the moments needed by the requested attribute are accumulated per
+ * component and merged whenever two provisional components meet. Components
+ * whose attribute is lower than Lambda (or higher if ReverseOrdering is set)
+ * are removed and the output is the input masked with the remaining
+ * components.
+ *
+ * The filter is equivalent to BinaryImageToShapeLabelMap +
+ * LabelStatisticsOpening + MaskImageFilter for the supported attributes, but
+ * does not build a label map, a dense label image or per-label histograms.
+ */
+template< class TInputImage, class TOutputImage = TInputImage >
+class ITK_EXPORT ComponentStatisticsOpeningImageFilter: public ImageToImageFilter<
+    TInputImage, TOutputImage >
+{
+public:
+  /** Standard "Self" & Superclass typedef.   */
+  typedef ComponentStatisticsOpeningImageFilter Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self > Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory.  */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods)  */
+  itkTypeMacro(ComponentStatisticsOpeningImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int,
+      TInputImage::ImageDimension);
+
+    /** Image typedef support. */
+    typedef TInputImage InputImageType;
+    typedef TOutputImage OutputImageType;
+    typedef typename InputImageType::PixelType InputPixelType;
+    typedef typename OutputImageType::PixelType OutputPixelType;
+    typedef typename OutputImageType::RegionType OutputImageRegionType;
+
+    /** Component labels of the internal label buffer. */
+    typedef unsigned int LabelType;
+
+    typedef enum
+      {
+      NUMBER_OF_PIXELS,
+      MINIMUM,
+      MAXIMUM,
+      MEAN,
+      SUM,
+      STANDARD_DEVIATION,
+      VARIANCE
+      } AttributeType;
+
+    itkSetMacro(BinarizeThreshold, InputPixelType);
+    itkGetConstMacro(BinarizeThreshold, InputPixelType);
+
+    itkSetMacro(Lambda, double);
+    itkGetConstMacro(Lambda, double);
+
+    itkSetMacro(ReverseOrdering, bool);
+    itkGetConstMacro(ReverseOrdering, bool);
+    itkBooleanMacro(ReverseOrdering);
+
+    itkSetMacro(FullyConnected, bool);
+    itkGetConstMacro(FullyConnected, bool);
+    itkBooleanMacro(FullyConnected);
+
+    itkSetMacro(Attribute, AttributeType);
+    itkGetConstMacro(Attribute, AttributeType);
+    /** Set the attribute by its LabelStatisticsOpening name e.g. "Maximum" */
+    void SetAttribute(const std::string & name);
+
+    /** Whether an attribute name can be computed by this filter */
+    static bool IsAttributeSupported(const std::string & name);
+
+    /** Number of components found and kept in the last update */
+    itkGetConstMacro(NumberOfComponents, SizeValueType);
+    itkGetConstMacro(NumberOfKeptComponents, SizeValueType);
+
+#ifdef ITK_USE_CONCEPT_CHECKING
+    /** Begin concept checking */
+    itkConceptMacro( InputConvertibleToOutputCheck,
+        ( Concept::Convertible< InputPixelType, OutputPixelType > ) );
+    /** End concept checking */
+#endif
+  protected:
+    ComponentStatisticsOpeningImageFilter();
+    virtual ~ComponentStatisticsOpeningImageFilter()
+      {}
+
+    /** Labeling needs the whole image. */
+    void GenerateInputRequestedRegion();
+    void EnlargeOutputRequestedRegion(DataObject *);
+
+    void GenerateData();
+
+    void PrintSelf(std::ostream & os, Indent indent) const;
+  private:
+    ComponentStatisticsOpeningImageFilter(const Self &); //purposely not implemented
+    void operator=(const Self &);//purposely not implemented
+
+    /** Running moments of a single component */
+    struct ComponentStatistics
+      {
+      SizeValueType Count;
+      double Sum;
+      double SumOfSquares;
+      double Minimum;
+      double Maximum;
+
+      ComponentStatistics() :
+          Count(0), Sum(0), SumOfSquares(0),
+          Minimum(NumericTraits< double >::max()),
+          Maximum(NumericTraits< double >::NonpositiveMin())
+        {
+        }
+      inline void Add(const double v)
+        {
+        ++Count;
+        Sum += v;
+        SumOfSquares += v * v;
+        if (v < Minimum) Minimum = v;
+        if (v > Maximum) Maximum = v;
+        }
+      inline void Merge(const ComponentStatistics & other)
+        {
+        Count += other.Count;
+        Sum += other.Sum;
+        SumOfSquares += other.SumOfSquares;
+        if (other.Minimum < Minimum) Minimum = other.Minimum;
+        if (other.Maximum > Maximum) Maximum = other.Maximum;
+        }
+      double Get(const AttributeType attribute) const;
+      };
+
+    inline LabelType FindRoot(LabelType label);
+    LabelType Union(LabelType a, LabelType b);
+
+    InputPixelType m_BinarizeThreshold;
+    double m_Lambda;
+    bool m_ReverseOrdering;
+    bool m_FullyConnected;
+    AttributeType m_Attribute;
+
+    SizeValueType m_NumberOfComponents;
+    SizeValueType m_NumberOfKeptComponents;
+
+    std::vector< LabelType > m_Parent;
+    std::vector< ComponentStatistics > m_Statistics;
+    };} // end namespace itk
+
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
+#include "itkComponentStatisticsOpeningImageFilter.hxx"
+#endif
+
+#endif
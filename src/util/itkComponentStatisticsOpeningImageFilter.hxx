@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkComponentStatisticsOpeningImageFilter_hxx
+#define __itkComponentStatisticsOpeningImageFilter_hxx
+#include "itkComponentStatisticsOpeningImageFilter.h"
+
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+template< class TInputImage, class TOutputImage >
+ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::ComponentStatisticsOpeningImageFilter()
+  {
+  m_BinarizeThreshold = NumericTraits< InputPixelType >::Zero;
+  m_Lambda = 0.0;
+  m_ReverseOrdering = false;
+  m_FullyConnected = true;
+  m_Attribute = NUMBER_OF_PIXELS;
+  m_NumberOfComponents = 0;
+  m_NumberOfKeptComponents = 0;
+  }
+
+template< class TInputImage, class TOutputImage >
+bool ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::IsAttributeSupported(
+    const std::string & name)
+  {
+  return name == "NumberOfPixels" || name == "Minimum" || name == "Maximum"
+      || name == "Mean" || name == "Sum" || name == "StandardDeviation"
+      || name == "Variance";
+  }
+
+template< class TInputImage, class TOutputImage >
+void ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::SetAttribute(
+    const std::string & name)
+  {
+  if (name == "NumberOfPixels") this->SetAttribute(NUMBER_OF_PIXELS);
+  else if (name == "Minimum") this->SetAttribute(MINIMUM);
+  else if (name == "Maximum") this->SetAttribute(MAXIMUM);
+  else if (name == "Mean") this->SetAttribute(MEAN);
+  else if (name == "Sum") this->SetAttribute(SUM);
+  else if (name == "StandardDeviation") this->SetAttribute(STANDARD_DEVIATION);
+  else if (name == "Variance") this->SetAttribute(VARIANCE);
+  else
+    {
+    itkExceptionMacro("Unsupported attribute: " << name);
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+double ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::ComponentStatistics::Get(
+    const AttributeType attribute) const
+  {
+  const double n = static_cast< double >(Count);
+  double variance = 0;
+  switch (attribute)
+    {
+  case NUMBER_OF_PIXELS:
+    return n;
+  case MINIMUM:
+    return Minimum;
+  case MAXIMUM:
+    return Maximum;
+  case MEAN:
+    return Sum / n;
+  case SUM:
+    return Sum;
+  case STANDARD_DEVIATION:
+  case VARIANCE:
+    /** Same unbiased estimate as LabelStatisticsImageFilter */
+    if (Count > 1)
+      {
+      variance = (SumOfSquares - Sum * Sum / n) / (n - 1);
+      if (variance < 0) variance = 0;
+      }
+    return attribute == VARIANCE ? variance : std::sqrt(variance);
+    }
+  return 0;
+  }
+
+template< class TInputImage, class TOutputImage >
+typename ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::LabelType ComponentStatisticsOpeningImageFilter<
+    TInputImage, TOutputImage >::FindRoot(LabelType label)
+  {
+  while (m_Parent[label] != label)
+    {
+    /** Path halving keeps the trees flat without recursion */
+    m_Parent[label] = m_Parent[m_Parent[label]];
+    label = m_Parent[label];
+    }
+  return label;
+  }
+
+template< class TInputImage, class TOutputImage >
+typename ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::LabelType ComponentStatisticsOpeningImageFilter<
+    TInputImage, TOutputImage >::Union(LabelType a, LabelType b)
+  {
+  a = this->FindRoot(a);
+  b = this->FindRoot(b);
+  if (a == b) return a;
+  if (b < a) std::swap(a, b);
+  m_Parent[b] = a;
+  m_Statistics[a].Merge(m_Statistics[b]);
+  return a;
+  }
+
+template< class TInputImage, class TOutputImage >
+void ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::GenerateInputRequestedRegion()
+  {
+  Superclass::GenerateInputRequestedRegion();
+  InputImageType * input = const_cast< InputImageType * >(this->GetInput());
+  if (input)
+    {
+    input->SetRequestedRegionToLargestPossibleRegion();
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+void ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::EnlargeOutputRequestedRegion(
+    DataObject *)
+  {
+  this->GetOutput()->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+template< class TInputImage, class TOutputImage >
+void ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::GenerateData()
+  {
+  this->AllocateOutputs();
+
+  const InputImageType* inputImage = this->GetInput();
+  OutputImageType* outputImage = this->GetOutput();
+  itkAssertOrThrowMacro(inputImage, "Input image should be set.");
+
+  const OutputImageRegionType region = outputImage->GetRequestedRegion();
+  typedef typename OutputImageRegionType::IndexType IndexType;
+  typedef typename OutputImageRegionType::SizeType SizeType;
+  typedef typename IndexType::OffsetType OffsetType;
+
+  const SizeType size = region.GetSize();
+
+  /**
+   * Neighbours already visited in a raster scan: the ones whose last non-zero
+   * offset component is negative.
+   */
+  std::vector< OffsetType > neighbors;
+  std::vector< OffsetValueType > linearNeighbors;
+  unsigned int numberOfOffsets = 1;
+  for (unsigned int d = 0; d < ImageDimension; d++)
+    numberOfOffsets *= 3;
+  for (unsigned int n = 0; n < numberOfOffsets; n++)
+    {
+    OffsetType offset;
+    unsigned int code = n;
+    unsigned int nonZero = 0;
+    int last = 0;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+      {
+      offset[d] = static_cast< OffsetValueType >(code % 3) - 1;
+      code /= 3;
+      if (offset[d] != 0)
+        {
+        ++nonZero;
+        last = offset[d];
+        }
+      }
+    if (last >= 0) continue;
+    if (!m_FullyConnected && nonZero != 1) continue;
+
+    OffsetValueType linear = 0;
+    OffsetValueType stride = 1;
+    for (unsigned int d = 0; d < ImageDimension; d++)
+      {
+      linear += offset[d] * stride;
+      stride *= static_cast< OffsetValueType >(size[d]);
+      }
+    neighbors.push_back(offset);
+    linearNeighbors.push_back(linear);
+    }
+
+  std::vector< LabelType > labels(region.GetNumberOfPixels(), 0);
+  m_Parent.assign(1, 0);
+  m_Statistics.assign(1, ComponentStatistics());
+
+  ImageRegionConstIteratorWithIndex< InputImageType > iit(inputImage, region);
+  for (SizeValueType p = 0; !iit.IsAtEnd(); ++iit, ++p)
+    {
+    const InputPixelType value = iit.Get();
+    if (!(value >= m_BinarizeThreshold)) continue;
+
+    const IndexType index = iit.GetIndex();
+    LabelType label = 0;
+    for (unsigned int n = 0; n < neighbors.size(); n++)
+      {
+      if (!region.IsInside(index + neighbors[n])) continue;
+      const LabelType neighborLabel = labels[p + linearNeighbors[n]];
+      if (neighborLabel == 0) continue;
+      label = label ? this->Union(label, neighborLabel) :
+                      this->FindRoot(neighborLabel);
+      }
+    if (label == 0)
+      {
+      label = static_cast< LabelType >(m_Parent.size());
+      m_Parent.push_back(label);
+      m_Statistics.push_back(ComponentStatistics());
+      }
+    labels[p] = label;
+    m_Statistics[this->FindRoot(label)].Add(static_cast< double >(value));
+    }
+
+  /** Decide once per component which ones survive */
+  std::vector< bool > keep(m_Parent.size(), false);
+  m_NumberOfComponents = 0;
+  m_NumberOfKeptComponents = 0;
+  for (LabelType l = 1; l < m_Parent.size(); l++)
+    {
+    if (this->FindRoot(l) != l) continue;
+    const double attribute = m_Statistics[l].Get(m_Attribute);
+    keep[l] = m_ReverseOrdering ? attribute <= m_Lambda : attribute >= m_Lambda;
+    ++m_NumberOfComponents;
+    if (keep[l]) ++m_NumberOfKeptComponents;
+    }
+
+  ImageRegionConstIterator< InputImageType > mit(inputImage, region);
+  ImageRegionIterator< OutputImageType > oit(outputImage, region);
+  for (SizeValueType p = 0; !oit.IsAtEnd(); ++mit, ++oit, ++p)
+    {
+    if (labels[p] && keep[this->FindRoot(labels[p])])
+      {
+      oit.Set(static_cast< OutputPixelType >(mit.Get()));
+      }
+    else
+      {
+      oit.Set(NumericTraits< OutputPixelType >::ZeroValue());
+      }
+    }
+
+  m_Parent.clear();
+  m_Statistics.clear();
+  }
+
+template< class TInputImage, class TOutputImage >
+void ComponentStatisticsOpeningImageFilter< TInputImage, TOutputImage >::PrintSelf(
+    std::ostream & os, Indent indent) const
+  {
+  Superclass::PrintSelf(os, indent);
+  os << indent << "BinarizeThreshold: " << m_BinarizeThreshold << std::endl;
+  os << indent << "Lambda: " << m_Lambda << std::endl;
+  os << indent << "ReverseOrdering: " << m_ReverseOrdering << std::endl;
+  os << indent << "FullyConnected: " << m_FullyConnected << std::endl;
+  os << indent << "Attribute: " << m_Attribute << std::endl;
+  }
+} // end namespace itk
+
+#endif
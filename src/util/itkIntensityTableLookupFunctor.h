@@ -66,10 +66,10 @@ public:
       }
     else
       {
-      int index = 1;
-
-      for (; index < (m_Table.size() - 1); index++)
-        if (x < m_Table[index].first) break;
+      /** First row above x between the second and the last row */
+      const size_t index = std::upper_bound(m_Table.begin() + 1,
+                                            m_Table.end() - 1, x, InputLess)
+          - m_Table.begin();
 
       const double slope = (m_Table[index].second - m_Table[index - 1].second)
           / (m_Table[index].first - m_Table[index - 1].first);
@@ -88,6 +88,11 @@ public:
 
     }
 private:
+  static bool InputLess(const TInput & x, const LookupRowType & row)
+    {
+    return x < row.first;
+    }
+
   LookupTableType m_Table;
 };
 
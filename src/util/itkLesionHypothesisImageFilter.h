@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkLesionHypothesisImageFilter_h
+#define __itkLesionHypothesisImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <vector>
+
+namespace itk
+{
+/*
+ * Mask of the voxels that may be white matter lesion.
+ *
+ * A voxel is kept if it is inside the brain (T1 is not zero), not brighter
+ * than T1Threshold on T1, and for each light sequence (e.g. FLAIR, T2) either
+ * in GM or at least its WM threshold, and either in WM or at least its GM
+ * threshold. If a WM distance image is set, voxels further than
+ * BoundaryRadius from WM are removed and if a CSF image is set, voxels in CSF
+ * are removed. Tissue images are masks (non zero) or partial volumes.
+ *
+ * The distance image is expected as squared physical distance e.g. the
+ * output of SignedMaurerDistanceMapImageFilter with SquaredDistance on.
+ */
+template< class TInputImage, class TOutputImage >
+class ITK_EXPORT LesionHypothesisImageFilter: public ImageToImageFilter<
+    TInputImage, TOutputImage >
+{
+public:
+  /** Standard "Self" & Superclass typedef.   */
+  typedef LesionHypothesisImageFilter Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self > Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory.  */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods)  */
+  itkTypeMacro(LesionHypothesisImageFilter, ImageToImageFilter);
+
+    /** Image typedef support. */
+    typedef TInputImage InputImageType;
+    typedef typename InputImageType::PixelType InputPixelType;
+    typedef TOutputImage OutputImageType;
+    typedef typename OutputImageType::PixelType OutputPixelType;
+    typedef typename OutputImageType::RegionType OutputImageRegionType;
+
+    void SetT1Image(const InputImageType* image);
+    void SetWMImage(const InputImageType* image);
+    void SetGMImage(const InputImageType* image);
+
+    /** Optional CSF mask */
+    void SetCSFImage(const InputImageType* image);
+
+    /** Optional squared distance to WM */
+    void SetWMDistanceImage(const InputImageType* image);
+
+    /** Lesions should be at least wmThreshold out of GM and gmThreshold out of WM */
+    void AddLightImage(const InputImageType* image, double wmThreshold,
+                       double gmThreshold);
+
+    itkSetMacro(T1Threshold, double);
+    itkGetConstMacro(T1Threshold, double);
+
+    itkSetMacro(BoundaryRadius, double);
+    itkGetConstMacro(BoundaryRadius, double);
+
+  protected:
+    LesionHypothesisImageFilter();
+    virtual ~LesionHypothesisImageFilter()
+      {}
+
+    void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+        ThreadIdType threadId);
+
+    void PrintSelf(std::ostream & os, Indent indent) const;
+  private:
+    LesionHypothesisImageFilter(const Self &); //purposely not implemented
+    void operator=(const Self &);//purposely not implemented
+
+    const InputImageType* GetNthImage(unsigned int idx) const;
+
+    /** Inputs after the fixed ones are the light sequences */
+    itkStaticConstMacro(FirstLightInput, unsigned int, 5);
+
+    double m_T1Threshold;
+    double m_BoundaryRadius;
+    std::vector< double > m_WMThresholds;
+    std::vector< double > m_GMThresholds;
+    };} // end namespace itk
+
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
+#include "itkLesionHypothesisImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkLesionHypothesisImageFilter_hxx
+#define __itkLesionHypothesisImageFilter_hxx
+#include "itkLesionHypothesisImageFilter.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+
+namespace itk
+{
+template< class TInputImage, class TOutputImage >
+LesionHypothesisImageFilter< TInputImage, TOutputImage >::LesionHypothesisImageFilter()
+  {
+  m_T1Threshold = NumericTraits< double >::max();
+  m_BoundaryRadius = 1.0;
+
+  this->SetNumberOfRequiredInputs(3);
+  }
+
+template< class TInputImage, class TOutputImage >
+void LesionHypothesisImageFilter< TInputImage, TOutputImage >::SetT1Image(
+    const InputImageType* image)
+  {
+  this->SetNthInput(0, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void LesionHypothesisImageFilter< TInputImage, TOutputImage >::SetWMImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(1, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void LesionHypothesisImageFilter< TInputImage, TOutputImage >::SetGMImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(2, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void LesionHypothesisImageFilter< TInputImage, TOutputImage >::SetCSFImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(3, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void LesionHypothesisImageFilter< TInputImage, TOutputImage >::SetWMDistanceImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(4, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void LesionHypothesisImageFilter< TInputImage, TOutputImage >::AddLightImage(
+    const InputImageType* image, double wmThreshold, double gmThreshold)
+  {
+  this->SetNthInput(FirstLightInput + m_WMThresholds.size(),
+                    const_cast< InputImageType* >(image));
+  m_WMThresholds.push_back(wmThreshold);
+  m_GMThresholds.push_back(gmThreshold);
+  }
+
+template< class TInputImage, class TOutputImage >
+const typename LesionHypothesisImageFilter< TInputImage, TOutputImage >::InputImageType*
+LesionHypothesisImageFilter< TInputImage, TOutputImage >::GetNthImage(
+    unsigned int idx) const
+  {
+  return static_cast< const InputImageType* >(this->ProcessObject::GetInput(idx));
+  }
+
+template< class TInputImage, class TOutputImage >
+void LesionHypothesisImageFilter< TInputImage, TOutputImage >::ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread, ThreadIdType)
+  {
+  typedef ImageRegionConstIterator< InputImageType > InputIteratorType;
+  typedef ImageRegionIterator< OutputImageType > OutputIteratorType;
+
+  InputIteratorType t1It(this->GetNthImage(0), outputRegionForThread);
+  InputIteratorType wmIt(this->GetNthImage(1), outputRegionForThread);
+  InputIteratorType gmIt(this->GetNthImage(2), outputRegionForThread);
+
+  const bool hasCSF = this->GetNthImage(3) != 0;
+  InputIteratorType csfIt;
+  if (hasCSF)
+    {
+    csfIt = InputIteratorType(this->GetNthImage(3), outputRegionForThread);
+    }
+  const bool hasDistance = this->GetNthImage(4) != 0;
+  InputIteratorType distanceIt;
+  if (hasDistance)
+    {
+    distanceIt = InputIteratorType(this->GetNthImage(4), outputRegionForThread);
+    }
+
+  const unsigned int numberOfSequences = m_WMThresholds.size();
+  std::vector< InputIteratorType > sequenceIt(numberOfSequences);
+  for (unsigned int s = 0; s < numberOfSequences; s++)
+    {
+    sequenceIt[s] = InputIteratorType(this->GetNthImage(FirstLightInput + s),
+                                      outputRegionForThread);
+    }
+
+  const InputPixelType zero = NumericTraits< InputPixelType >::ZeroValue();
+  const double squaredRadius = m_BoundaryRadius * m_BoundaryRadius;
+  OutputIteratorType outIt(this->GetOutput(), outputRegionForThread);
+  for (; !outIt.IsAtEnd(); ++outIt, ++t1It, ++wmIt, ++gmIt)
+    {
+    const InputPixelType t1 = t1It.Get();
+    const bool wm = wmIt.Get() != zero;
+    const bool gm = gmIt.Get() != zero;
+
+    bool hypothesis = t1 != zero && t1 <= m_T1Threshold;
+    for (unsigned int s = 0; s < numberOfSequences; s++)
+      {
+      const InputPixelType value = sequenceIt[s].Get();
+      ++sequenceIt[s];
+      const bool isSet = value != zero;
+      hypothesis &= (isSet && value >= m_WMThresholds[s]) || gm;
+      hypothesis &= (isSet && value >= m_GMThresholds[s]) || wm;
+      }
+    if (hasDistance)
+      {
+      hypothesis &= distanceIt.Get() <= squaredRadius;
+      ++distanceIt;
+      }
+    if (hasCSF)
+      {
+      hypothesis &= csfIt.Get() == zero;
+      ++csfIt;
+      }
+    outIt.Set(hypothesis ? 1 : 0);
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+void LesionHypothesisImageFilter< TInputImage, TOutputImage >::PrintSelf(
+    std::ostream & os, Indent indent) const
+  {
+  Superclass::PrintSelf(os, indent);
+  os << indent << "T1Threshold: " << m_T1Threshold << std::endl;
+  os << indent << "BoundaryRadius: " << m_BoundaryRadius << std::endl;
+  os << indent << "NumberOfLightImages: " << m_WMThresholds.size()
+     << std::endl;
+  }
+} // end namespace itk
+
+#endif
@@ -24,7 +24,9 @@
 
 #include "itkWeightedSinglePassMeanCovarianceUpdate.h"
 #include "itkStateInterpolatorFunction.h"
+#include "stateModel.h"
 
+#include <string>
 #include <vector>
 
 namespace itk
@@ -102,6 +104,33 @@ public:
     itkSetConstObjectMacro(StateImage, StateImageType);
     itkGetConstObjectMacro(StateImage, StateImageType);
 
+    /**
+     * Group of the state image to use when it holds several states per pixel
+     * e.g. a packed state model. Each group has the state length of the
+     * input measurement.
+     */
+    itkSetMacro(StateGroup, unsigned int);
+    itkGetConstMacro(StateGroup, unsigned int);
+
+    /**
+     * Use the states of a class in a packed state model, as read by
+     * ReadStateModel, without unpacking it. sequence is the first sequence
+     * of the input measurement.
+     */
+    void SetStateModel(const StateImageType* model,
+        const cascade::util::StateModelInfo & info, int label,
+        const std::string & sequence)
+      {
+      const int group = info.GetGroupIndex(label, sequence);
+      if (group < 0)
+        {
+        itkExceptionMacro("No state of " << sequence << " class " << label
+                          << " in the model");
+        }
+      this->SetStateImage(model);
+      this->SetStateGroup(group);
+      }
+
     itkSetConstObjectMacro(Transform, TransformType);
     itkGetConstObjectMacro(Transform, TransformType);
 
@@ -120,6 +149,8 @@ public:
 
     void PrintSelf(std::ostream & os, Indent indent) const;
 
+    /** Profiles the threaded generation as a whole */
+    void GenerateData();
     void BeforeThreadedGenerateData();
     void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
         ThreadIdType threadId);
@@ -127,6 +158,8 @@ public:
 
     typedef typename InputImageType::PointType InputPointType;
     typedef typename StateImageType::PointType StatePointType;
+    typedef typename StateInterpolateType::ContinuousIndexType StateIndexType;
+    typedef typename StateInterpolateType::NeighborListType NeighborListType;
 
     typedef ImageRegionConstIterator< InputImageType > InputIteratorType;
     typedef ImageRegionConstIterator< MaskImageType > MaskIteratorType;
@@ -136,6 +169,10 @@ public:
 
     void operator=(const Self &);//purposely not implemented
 
+    /** Merge the neighbour states of the selected group */
+    void EvaluateStateGroup(const StateIndexType & index, StateType & state,
+        StateType & neighborState) const;
+
     typename TransformType::ConstPointer m_Transform;
     typename StateImageType::ConstPointer m_StateImage;
 
@@ -147,6 +184,10 @@ public:
     bool m_HasMask;
     bool m_HasStateImage;
 
+    unsigned int m_StateGroup;
+    /** Length of a group, zero if the whole pixel is the state */
+    unsigned int m_StateGroupLength;
+
     int m_PositiveOrientation;
     int m_ConsiderOrientation;
     };}
@@ -22,6 +22,7 @@
 #include "itkIdentityTransform.h"
 #include "itkContinuousIndex.h"
 #include "itkImageDuplicator.h"
+#include "profiler.h"
 
 namespace itk
 {
@@ -41,12 +42,22 @@ MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::MahalanobisDistance
   m_HasStateImage = false;
   m_HasGlobalState = false;
   m_HasMask = false;
+  m_StateGroup = 0;
+  m_StateGroupLength = 0;
   m_OutsideValue = NumericTraits< OutputPixelType >::ZeroValue();
   /** Binary not of zero. All bits set. */
   m_PositiveOrientation = ~(0);
   m_ConsiderOrientation = ~(0);
   }
 template< class TInputImage, class TOutputImage >
+void MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::GenerateData()
+  {
+  cascade::util::ProfileScope profile(
+      this->GetNameOfClass(), "distance",
+      this->GetOutput()->GetRequestedRegion().GetNumberOfPixels());
+  Superclass::GenerateData();
+  }
+template< class TInputImage, class TOutputImage >
 void MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::BeforeThreadedGenerateData()
   {
   InputImageType *inputImage =
@@ -68,8 +79,24 @@ void MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::BeforeThreaded
     itkAssertOrThrowMacro(m_Transform.IsNotNull(),
                           "Transformation function should be set.");
     m_StateInterpolator->SetInputImage(m_StateImage);
+
+    const unsigned int stateLength = StateFunc::MeasurementToStateDim(
+        inputImage->GetNumberOfComponentsPerPixel());
+    const unsigned int length = m_StateImage->GetNumberOfComponentsPerPixel();
+    m_StateGroupLength = 0;
+    if (length != stateLength || m_StateGroup != 0)
+      {
+      if (length % stateLength != 0
+          || (m_StateGroup + 1) * stateLength > length)
+        {
+        itkExceptionMacro("State image with " << length
+                          << " components has no group " << m_StateGroup);
+        }
+      m_StateGroupLength = stateLength;
+      }
     if (!m_HasGlobalState)
       {
+      m_GlobalState.SetSize(stateLength);
       m_GlobalState.Fill(0.);
       }
     }
@@ -86,6 +113,7 @@ void MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::ThreadedGenera
   const InputImageType* inputImage = this->GetInput();
 
   StateType state = m_GlobalState;
+  StateType neighborState = m_GlobalState;
   if (!m_HasStateImage) StateFunc::MakeReady(state);
 
   InputIteratorType iImageIt(inputImage, outputRegionForThread);
@@ -114,13 +142,19 @@ void MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::ThreadedGenera
         InputPointType iPoint;
         inputImage->TransformIndexToPhysicalPoint(iImageIt.GetIndex(), iPoint);
         StatePointType sPoint = m_Transform->TransformPoint(iPoint);
-        if (m_StateInterpolator->IsInsideBuffer(sPoint))
+        StateIndexType sIndex;
+        m_StateImage->TransformPhysicalPointToContinuousIndex(sPoint, sIndex);
+        if (!m_StateInterpolator->IsInsideBuffer(sIndex))
+          {
+          state = m_GlobalState;
+          }
+        else if (m_StateGroupLength)
           {
-          state = m_StateInterpolator->Evaluate(sPoint);
+          this->EvaluateStateGroup(sIndex, state, neighborState);
           }
         else
           {
-          state = m_GlobalState;
+          state = m_StateInterpolator->EvaluateAtContinuousIndex(sIndex);
           }
         StateFunc::MakeReady(state);
         }
@@ -149,6 +183,33 @@ void MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::ThreadedGenera
     }
   }
 
+template< class TInputImage, class TOutputImage >
+void MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::EvaluateStateGroup(
+    const StateIndexType & index, StateType & state,
+    StateType & neighborState) const
+  {
+  const NeighborListType neighbors =
+      m_StateInterpolator->GetWeightsForContinuousIndex(index);
+  const unsigned int first = m_StateGroup * m_StateGroupLength;
+  bool isEmpty = true;
+  state.Fill(0);
+  for (unsigned int n = 0; n < neighbors.size(); n++)
+    {
+    const StateType neighbor = m_StateImage->GetPixel(neighbors[n].first);
+    if (neighbor[first] == 0) continue;
+    for (unsigned int k = 0; k < m_StateGroupLength; k++)
+      neighborState[k] = neighbor[first + k];
+    if (isEmpty)
+      {
+      for (unsigned int k = 0; k < m_StateGroupLength; k++)
+        state[k] = neighborState[k] * neighbors[n].second;
+      isEmpty = false;
+      continue;
+      }
+    StateFunc::Merge(state, neighborState, neighbors[n].second);
+    }
+  }
+
 template< class TInputImage, class TOutputImage >
 DataObject::Pointer MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::MakeOutput(
     unsigned int idx)
@@ -189,6 +250,7 @@ void MahalanobisDistanceImageFilter< TInputImage, TOutputImage >::PrintSelf(
   {
   Superclass::PrintSelf(os, indent);
   os << indent << "Transform: " << m_Transform << std::endl;
+  os << indent << "StateGroup: " << m_StateGroup << std::endl;
   }
 } // end namespace itk
 
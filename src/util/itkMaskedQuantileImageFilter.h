@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkMaskedQuantileImageFilter_h
+#define __itkMaskedQuantileImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkImage.h"
+
+#include <vector>
+
+namespace itk
+{
+/*
+ * Quantiles of an image over several masks in a single threaded pass.
+ *
+ * Every channel collects the input pixels inside its own mask (non-zero mask
+ * pixels, or the whole image when the channel has no mask), optionally
+ * ignoring zero valued pixels as fslstats does for -P. All channels are
+ * filled while the image is traversed once and are sorted after the pass,
+ * so any number of quantiles can then be queried for free.
+ *
+ * The input is passed through as the output.
+ */
+template< class TInputImage,
+    class TMaskImage = Image< unsigned char, TInputImage::ImageDimension > >
+class ITK_EXPORT MaskedQuantileImageFilter: public ImageToImageFilter<
+    TInputImage, TInputImage >
+{
+public:
+  /** Standard "Self" & Superclass typedef.   */
+  typedef MaskedQuantileImageFilter Self;
+  typedef ImageToImageFilter< TInputImage, TInputImage > Superclass;
+  typedef SmartPointer< Self > Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory.  */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods)  */
+  itkTypeMacro(MaskedQuantileImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(ImageDimension, unsigned int,
+      TInputImage::ImageDimension);
+
+    /** Image typedef support. */
+    typedef TInputImage InputImageType;
+    typedef typename InputImageType::PixelType InputPixelType;
+    typedef typename InputImageType::RegionType OutputImageRegionType;
+    typedef TMaskImage MaskImageType;
+    typedef typename MaskImageType::PixelType MaskPixelType;
+
+    typedef std::vector< InputPixelType > SampleType;
+
+    /**
+     * Add a channel of samples and return its index. A null mask takes the
+     * whole image.
+     */
+    unsigned int AddChannel(const MaskImageType* mask, bool ignoreZero = true);
+    unsigned int GetNumberOfChannels() const
+      {
+      return static_cast< unsigned int >(m_Channels.size());
+      }
+    /** Remove all channels */
+    void ClearChannels();
+
+    /**
+     * The p quantile (0 <= p <= 1) of a channel, the sample at floor(p*n)
+     * as fslstats does. Throws if the channel is empty.
+     */
+    double GetQuantile(unsigned int channel, double p) const;
+
+    /** Sorted samples of a channel after the update */
+    const SampleType & GetSamples(unsigned int channel) const;
+
+  protected:
+    MaskedQuantileImageFilter();
+    virtual ~MaskedQuantileImageFilter()
+      {}
+
+    /** Pass the input through */
+    void AllocateOutputs();
+
+    void BeforeThreadedGenerateData();
+    void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+        ThreadIdType threadId);
+    void AfterThreadedGenerateData();
+
+    void PrintSelf(std::ostream & os, Indent indent) const;
+  private:
+    MaskedQuantileImageFilter(const Self &); //purposely not implemented
+    void operator=(const Self &);//purposely not implemented
+
+    struct Channel
+      {
+      bool HasMask;
+      bool IgnoreZero;
+      /** Index of the mask among the filter inputs */
+      unsigned int MaskInput;
+      SampleType Samples;
+      };
+
+    std::vector< Channel > m_Channels;
+    /** Samples per thread and channel during the update */
+    std::vector< std::vector< SampleType > > m_ThreadSamples;
+    };} // end namespace itk
+
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
+#include "itkMaskedQuantileImageFilter.hxx"
+#endif
+
+#endif
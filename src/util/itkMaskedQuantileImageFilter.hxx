@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkMaskedQuantileImageFilter_hxx
+#define __itkMaskedQuantileImageFilter_hxx
+#include "itkMaskedQuantileImageFilter.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "quantile.h"
+
+#include <algorithm>
+
+namespace itk
+{
+template< class TInputImage, class TMaskImage >
+MaskedQuantileImageFilter< TInputImage, TMaskImage >::MaskedQuantileImageFilter()
+  {
+  this->SetNumberOfRequiredInputs(1);
+  }
+
+template< class TInputImage, class TMaskImage >
+unsigned int MaskedQuantileImageFilter< TInputImage, TMaskImage >::AddChannel(
+    const MaskImageType* mask, bool ignoreZero)
+  {
+  Channel channel;
+  channel.HasMask = mask != 0;
+  channel.IgnoreZero = ignoreZero;
+  channel.MaskInput = 0;
+  if (mask)
+    {
+    channel.MaskInput = this->GetNumberOfIndexedInputs();
+    this->SetNthInput(channel.MaskInput, const_cast< MaskImageType* >(mask));
+    }
+  m_Channels.push_back(channel);
+  this->Modified();
+  return static_cast< unsigned int >(m_Channels.size() - 1);
+  }
+
+template< class TInputImage, class TMaskImage >
+void MaskedQuantileImageFilter< TInputImage, TMaskImage >::ClearChannels()
+  {
+  for (unsigned int i = this->GetNumberOfIndexedInputs(); i > 1; i--)
+    this->RemoveInput(i - 1);
+  m_Channels.clear();
+  this->Modified();
+  }
+
+template< class TInputImage, class TMaskImage >
+double MaskedQuantileImageFilter< TInputImage, TMaskImage >::GetQuantile(
+    unsigned int channel, double p) const
+  {
+  const SampleType & samples = this->GetSamples(channel);
+  if (samples.empty())
+    {
+    itkExceptionMacro("No sample in channel " << channel);
+    }
+  return static_cast< double >(
+      samples[cascade::util::QuantileIndex(samples.size(), p)]);
+  }
+
+template< class TInputImage, class TMaskImage >
+const typename MaskedQuantileImageFilter< TInputImage, TMaskImage >::SampleType &
+MaskedQuantileImageFilter< TInputImage, TMaskImage >::GetSamples(
+    unsigned int channel) const
+  {
+  itkAssertOrThrowMacro(channel < m_Channels.size(), "No such channel.");
+  return m_Channels[channel].Samples;
+  }
+
+template< class TInputImage, class TMaskImage >
+void MaskedQuantileImageFilter< TInputImage, TMaskImage >::AllocateOutputs()
+  {
+  InputImageType* image = const_cast< InputImageType* >(this->GetInput());
+  this->GraftOutput(image);
+  }
+
+template< class TInputImage, class TMaskImage >
+void MaskedQuantileImageFilter< TInputImage, TMaskImage >::BeforeThreadedGenerateData()
+  {
+  m_ThreadSamples.assign(this->GetNumberOfThreads(),
+                         std::vector< SampleType >(m_Channels.size()));
+  }
+
+template< class TInputImage, class TMaskImage >
+void MaskedQuantileImageFilter< TInputImage, TMaskImage >::ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId)
+  {
+  typedef ImageRegionConstIterator< InputImageType > InputIteratorType;
+  typedef ImageRegionConstIterator< MaskImageType > MaskIteratorType;
+
+  const unsigned int numberOfChannels = m_Channels.size();
+  std::vector< SampleType > & samples = m_ThreadSamples[threadId];
+
+  std::vector< MaskIteratorType > masks(numberOfChannels);
+  for (unsigned int c = 0; c < numberOfChannels; c++)
+    {
+    if (!m_Channels[c].HasMask) continue;
+    const MaskImageType* mask = static_cast< const MaskImageType* >(
+        this->ProcessObject::GetInput(m_Channels[c].MaskInput));
+    masks[c] = MaskIteratorType(mask, outputRegionForThread);
+    }
+
+  const MaskPixelType maskOff = NumericTraits< MaskPixelType >::ZeroValue();
+  const InputPixelType zero = NumericTraits< InputPixelType >::ZeroValue();
+  for (InputIteratorType it(this->GetInput(), outputRegionForThread);
+      !it.IsAtEnd(); ++it)
+    {
+    const InputPixelType value = it.Get();
+    for (unsigned int c = 0; c < numberOfChannels; c++)
+      {
+      const Channel & channel = m_Channels[c];
+      bool inside = true;
+      if (channel.HasMask)
+        {
+        inside = masks[c].Get() != maskOff;
+        ++masks[c];
+        }
+      if (inside && !(channel.IgnoreZero && value == zero))
+        samples[c].push_back(value);
+      }
+    }
+  }
+
+template< class TInputImage, class TMaskImage >
+void MaskedQuantileImageFilter< TInputImage, TMaskImage >::AfterThreadedGenerateData()
+  {
+  for (unsigned int c = 0; c < m_Channels.size(); c++)
+    {
+    SampleType & samples = m_Channels[c].Samples;
+    SizeValueType total = 0;
+    for (unsigned int t = 0; t < m_ThreadSamples.size(); t++)
+      total += m_ThreadSamples[t][c].size();
+    samples.clear();
+    samples.reserve(total);
+    for (unsigned int t = 0; t < m_ThreadSamples.size(); t++)
+      {
+      samples.insert(samples.end(), m_ThreadSamples[t][c].begin(),
+                     m_ThreadSamples[t][c].end());
+      SampleType().swap(m_ThreadSamples[t][c]);
+      }
+    std::sort(samples.begin(), samples.end());
+    }
+  m_ThreadSamples.clear();
+  }
+
+template< class TInputImage, class TMaskImage >
+void MaskedQuantileImageFilter< TInputImage, TMaskImage >::PrintSelf(
+    std::ostream & os, Indent indent) const
+  {
+  Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfChannels: " << m_Channels.size() << std::endl;
+  }
+} // end namespace itk
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkMemoryMappedImageContainer_h
+#define __itkMemoryMappedImageContainer_h
+
+#include "itkImportImageContainer.h"
+
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace itk
+{
+/*
+ * Pixel container whose buffer is a private memory mapping of a file.
+ *
+ * The file is mapped copy-on-write: pixels are read lazily from the page
+ * cache, so several processes reading the same file share the memory, and
+ * in-place modifications never reach the file. The mapping is released
+ * when the container is destroyed.
+ */
+template< typename TElementIdentifier, typename TElement >
+class ITK_EXPORT MemoryMappedImageContainer: public ImportImageContainer<
+    TElementIdentifier, TElement >
+{
+public:
+  /** Standard class typedefs. */
+  typedef MemoryMappedImageContainer Self;
+  typedef ImportImageContainer< TElementIdentifier, TElement > Superclass;
+  typedef SmartPointer< Self > Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  typedef TElementIdentifier ElementIdentifier;
+  typedef TElement Element;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(MemoryMappedImageContainer, ImportImageContainer);
+
+  /**
+   * Map a file and use numberOfElements elements starting at dataOffset bytes
+   * as the buffer. Returns false if the file can not be mapped or is too
+   * short.
+   */
+  bool MapFile(const std::string & filename, const SizeValueType dataOffset,
+               const ElementIdentifier numberOfElements)
+    {
+    this->Unmap();
+#ifdef _WIN32
+    return false;
+#else
+    if (dataOffset % sizeof(Element) != 0) return false;
+
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    const SizeValueType dataLength = static_cast< SizeValueType >(numberOfElements)
+        * sizeof(Element);
+    if (::fstat(fd, &st) != 0
+        || static_cast< SizeValueType >(st.st_size) < dataOffset + dataLength)
+      {
+      ::close(fd);
+      return false;
+      }
+
+    void* mapping = ::mmap(0, dataOffset + dataLength, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE, fd, 0);
+    /** The mapping stays valid after the descriptor is closed */
+    ::close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    m_Mapping = mapping;
+    m_MappingLength = dataOffset + dataLength;
+    this->SetImportPointer(
+        reinterpret_cast< Element* >(static_cast< char* >(mapping) + dataOffset),
+        numberOfElements, false);
+    return true;
+#endif
+    }
+
+  bool IsMapped() const
+    {
+    return m_Mapping != 0;
+    }
+
+protected:
+  MemoryMappedImageContainer() :
+      m_Mapping(0), m_MappingLength(0)
+    {
+    }
+  virtual ~MemoryMappedImageContainer()
+    {
+    this->Unmap();
+    }
+
+  void Unmap()
+    {
+#ifndef _WIN32
+    if (m_Mapping)
+      {
+      ::munmap(m_Mapping, m_MappingLength);
+      }
+#endif
+    m_Mapping = 0;
+    m_MappingLength = 0;
+    }
+
+private:
+  MemoryMappedImageContainer(const Self &); //purposely not implemented
+  void operator=(const Self &); //purposely not implemented
+
+  void* m_Mapping;
+  SizeValueType m_MappingLength;
+};
+} // end namespace itk
+
+#endif
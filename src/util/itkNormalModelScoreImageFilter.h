@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkNormalModelScoreImageFilter_h
+#define __itkNormalModelScoreImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <vector>
+
+namespace itk
+{
+/*
+ * Native space model of the normal brain and z-score of a sequence.
+ *
+ * Each class (e.g. GM 2 and WM 3 of the label image) has a state in native
+ * space: the number of samples N, their sum and their sum of squared
+ * deviations M2. Inside the class the model is
+ *   mean = max(sum / N, MeanMinimum)
+ *   std  = min(max(sqrt(M2 / (N - 1)), StandardDeviationMinimum), mean)
+ * scaled by the ratio of the class median of the sequence to the class median
+ * of the model mean. MeanMinimum is the MeanMinimumPercentile and
+ * StandardDeviationMinimum the standard deviation of the non-zero sequence
+ * voxels in the reference class (WM).
+ *
+ * The z-score is (x - mean) / std for light, (mean - x) / std for dark and
+ * |x - mean| / std for other sequences, zero outside the mask and where std
+ * is zero. If a previous score is set, the output is the maximum of both.
+ *
+ * The medians and minimums come from a first threaded pass that only
+ * collects samples. The model and the score are then computed in a second
+ * threaded pass without intermediate images:
+ *   0 z-score, 1 model mean, 2 model standard deviation.
+ */
+template< class TInputImage, class TOutputImage = TInputImage >
+class ITK_EXPORT NormalModelScoreImageFilter: public ImageToImageFilter<
+    TInputImage, TOutputImage >
+{
+public:
+  /** Standard "Self" & Superclass typedef.   */
+  typedef NormalModelScoreImageFilter Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self > Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory.  */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods)  */
+  itkTypeMacro(NormalModelScoreImageFilter, ImageToImageFilter);
+
+    /** Image typedef support. */
+    typedef TInputImage InputImageType;
+    typedef typename InputImageType::PixelType InputPixelType;
+    typedef TOutputImage OutputImageType;
+    typedef typename OutputImageType::PixelType OutputPixelType;
+    typedef typename OutputImageType::RegionType OutputImageRegionType;
+
+    typedef ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+    using Superclass::MakeOutput;
+    virtual DataObject::Pointer MakeOutput(DataObjectPointerArraySizeType idx);
+
+    typedef enum
+      {
+      LIGHT,
+      DARK,
+      OTHER
+      } SequenceType;
+
+    /** Sequence in the range space */
+    void SetRangeImage(const InputImageType* image);
+    /** Tissue types e.g. brain_pve */
+    void SetLabelImage(const InputImageType* image);
+    /** Optional mask of the score e.g. WMGM */
+    void SetMaskImage(const InputImageType* image);
+    /** Optional score of the previous sequences */
+    void SetPreviousScoreImage(const InputImageType* image);
+
+    /** State of a class in native space */
+    void AddClass(InputPixelType label, const InputImageType* number,
+                  const InputImageType* sum, const InputImageType* m2);
+
+    itkSetMacro(SequenceType, SequenceType);
+    itkGetConstMacro(SequenceType, SequenceType);
+
+    itkSetMacro(ReferenceLabel, InputPixelType);
+    itkGetConstMacro(ReferenceLabel, InputPixelType);
+
+    itkSetMacro(MeanMinimumPercentile, double);
+    itkGetConstMacro(MeanMinimumPercentile, double);
+
+    /** Computed during the update */
+    itkGetConstMacro(MeanMinimum, double);
+    itkGetConstMacro(StandardDeviationMinimum, double);
+    double GetCorrectionRatio(unsigned int classIndex) const;
+
+    OutputImageType* GetScoreOutput();
+    OutputImageType* GetMeanOutput();
+    OutputImageType* GetStandardDeviationOutput();
+
+  protected:
+    NormalModelScoreImageFilter();
+    virtual ~NormalModelScoreImageFilter()
+      {}
+
+    /** Medians need the whole image. */
+    void GenerateInputRequestedRegion();
+    void EnlargeOutputRequestedRegion(DataObject *);
+
+    void BeforeThreadedGenerateData();
+    void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+        ThreadIdType threadId);
+
+    void PrintSelf(std::ostream & os, Indent indent) const;
+  private:
+    NormalModelScoreImageFilter(const Self &); //purposely not implemented
+    void operator=(const Self &);//purposely not implemented
+
+    typedef std::vector< InputPixelType > SampleType;
+
+    /** Samples of one thread in the first pass */
+    struct ThreadSamples
+      {
+      std::vector< SampleType > Range;
+      std::vector< SampleType > Mean;
+      SampleType Reference;
+      };
+
+    static ITK_THREAD_RETURN_TYPE SamplingThreaderCallback(void *arg);
+    void ThreadedSample(const OutputImageRegionType & region,
+                        ThreadIdType threadId);
+
+    const InputImageType* GetNthImage(unsigned int idx) const;
+    /** Index of the class of a label or -1 */
+    int FindClass(InputPixelType label) const;
+
+    /** sum / N with NaN as zero, as fslmaths -nan */
+    static double RawMean(double number, double sum);
+
+    itkStaticConstMacro(NumberOfOutputs, unsigned int, 3);
+    /** Inputs after the fixed ones are N, sum and M2 of each class */
+    itkStaticConstMacro(FirstClassInput, unsigned int, 4);
+
+    SequenceType m_SequenceType;
+    InputPixelType m_ReferenceLabel;
+    double m_MeanMinimumPercentile;
+
+    double m_MeanMinimum;
+    double m_StandardDeviationMinimum;
+    std::vector< InputPixelType > m_Labels;
+    std::vector< double > m_CorrectionRatios;
+
+    std::vector< ThreadSamples > m_ThreadSamples;
+    };} // end namespace itk
+
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
+#include "itkNormalModelScoreImageFilter.hxx"
+#endif
+
+#endif
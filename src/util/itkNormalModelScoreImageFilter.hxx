@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkNormalModelScoreImageFilter_hxx
+#define __itkNormalModelScoreImageFilter_hxx
+#include "itkNormalModelScoreImageFilter.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMultiThreader.h"
+#include "quantile.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+template< class TInputImage, class TOutputImage >
+NormalModelScoreImageFilter< TInputImage, TOutputImage >::NormalModelScoreImageFilter()
+  {
+  m_SequenceType = OTHER;
+  m_ReferenceLabel = 3;
+  m_MeanMinimumPercentile = 0.2;
+  m_MeanMinimum = 0;
+  m_StandardDeviationMinimum = 0;
+
+  this->SetNumberOfRequiredInputs(2);
+  this->SetNumberOfRequiredOutputs(NumberOfOutputs);
+  for (unsigned int i = 0; i < NumberOfOutputs; i++)
+    {
+    this->SetNthOutput(i, this->MakeOutput(i));
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+DataObject::Pointer NormalModelScoreImageFilter< TInputImage, TOutputImage >::MakeOutput(
+    DataObjectPointerArraySizeType)
+  {
+  return OutputImageType::New().GetPointer();
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::SetRangeImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(0, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::SetLabelImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(1, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::SetMaskImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(2, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::SetPreviousScoreImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(3, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::AddClass(
+    InputPixelType label, const InputImageType* number,
+    const InputImageType* sum, const InputImageType* m2)
+  {
+  const unsigned int first = FirstClassInput + 3 * m_Labels.size();
+  this->SetNthInput(first, const_cast< InputImageType* >(number));
+  this->SetNthInput(first + 1, const_cast< InputImageType* >(sum));
+  this->SetNthInput(first + 2, const_cast< InputImageType* >(m2));
+  m_Labels.push_back(label);
+  }
+
+template< class TInputImage, class TOutputImage >
+double NormalModelScoreImageFilter< TInputImage, TOutputImage >::GetCorrectionRatio(
+    unsigned int classIndex) const
+  {
+  itkAssertOrThrowMacro(classIndex < m_CorrectionRatios.size(),
+                        "No such class.");
+  return m_CorrectionRatios[classIndex];
+  }
+
+template< class TInputImage, class TOutputImage >
+const typename NormalModelScoreImageFilter< TInputImage, TOutputImage >::InputImageType*
+NormalModelScoreImageFilter< TInputImage, TOutputImage >::GetNthImage(
+    unsigned int idx) const
+  {
+  return static_cast< const InputImageType* >(this->ProcessObject::GetInput(idx));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* NormalModelScoreImageFilter< TInputImage, TOutputImage >::GetScoreOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(0));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* NormalModelScoreImageFilter< TInputImage, TOutputImage >::GetMeanOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(1));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* NormalModelScoreImageFilter< TInputImage, TOutputImage >::GetStandardDeviationOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(2));
+  }
+
+template< class TInputImage, class TOutputImage >
+int NormalModelScoreImageFilter< TInputImage, TOutputImage >::FindClass(
+    InputPixelType label) const
+  {
+  for (unsigned int c = 0; c < m_Labels.size(); c++)
+    {
+    if (m_Labels[c] == label) return c;
+    }
+  return -1;
+  }
+
+template< class TInputImage, class TOutputImage >
+double NormalModelScoreImageFilter< TInputImage, TOutputImage >::RawMean(
+    double number, double sum)
+  {
+  const double mean = sum / number;
+  return mean == mean ? mean : 0;
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::GenerateInputRequestedRegion()
+  {
+  Superclass::GenerateInputRequestedRegion();
+  for (unsigned int i = 0; i < this->GetNumberOfIndexedInputs(); i++)
+    {
+    InputImageType * input = const_cast< InputImageType * >(this->GetNthImage(i));
+    if (input)
+      {
+      input->SetRequestedRegionToLargestPossibleRegion();
+      }
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::EnlargeOutputRequestedRegion(
+    DataObject *)
+  {
+  for (unsigned int i = 0; i < NumberOfOutputs; i++)
+    {
+    this->ProcessObject::GetOutput(i)->SetRequestedRegionToLargestPossibleRegion();
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+ITK_THREAD_RETURN_TYPE NormalModelScoreImageFilter< TInputImage, TOutputImage >::SamplingThreaderCallback(
+    void *arg)
+  {
+  MultiThreader::ThreadInfoStruct* info =
+      static_cast< MultiThreader::ThreadInfoStruct* >(arg);
+  Self* filter = static_cast< Self* >(info->UserData);
+
+  OutputImageRegionType splitRegion;
+  const ThreadIdType total = filter->SplitRequestedRegion(
+      info->ThreadID, info->NumberOfThreads, splitRegion);
+  if (info->ThreadID < total)
+    {
+    filter->ThreadedSample(splitRegion, info->ThreadID);
+    }
+  return ITK_THREAD_RETURN_VALUE;
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::ThreadedSample(
+    const OutputImageRegionType & region, ThreadIdType threadId)
+  {
+  typedef ImageRegionConstIterator< InputImageType > InputIteratorType;
+
+  const unsigned int numberOfClasses = m_Labels.size();
+  ThreadSamples & samples = m_ThreadSamples[threadId];
+  samples.Range.assign(numberOfClasses, SampleType());
+  samples.Mean.assign(numberOfClasses, SampleType());
+
+  std::vector< InputIteratorType > numberIt(numberOfClasses);
+  std::vector< InputIteratorType > sumIt(numberOfClasses);
+  for (unsigned int c = 0; c < numberOfClasses; c++)
+    {
+    numberIt[c] = InputIteratorType(this->GetNthImage(FirstClassInput + 3 * c),
+                                    region);
+    sumIt[c] = InputIteratorType(this->GetNthImage(FirstClassInput + 3 * c + 1),
+                                 region);
+    }
+
+  const InputPixelType zero = NumericTraits< InputPixelType >::ZeroValue();
+  InputIteratorType rangeIt(this->GetNthImage(0), region);
+  InputIteratorType labelIt(this->GetNthImage(1), region);
+  for (; !rangeIt.IsAtEnd(); ++rangeIt, ++labelIt)
+    {
+    const int c = this->FindClass(labelIt.Get());
+    if (c >= 0)
+      {
+      const InputPixelType value = rangeIt.Get();
+      samples.Range[c].push_back(value);
+      samples.Mean[c].push_back(RawMean(numberIt[c].Get(), sumIt[c].Get()));
+      if (m_Labels[c] == m_ReferenceLabel && value != zero)
+        samples.Reference.push_back(value);
+      }
+    for (unsigned int k = 0; k < numberOfClasses; k++)
+      {
+      ++numberIt[k];
+      ++sumIt[k];
+      }
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::BeforeThreadedGenerateData()
+  {
+  const unsigned int numberOfClasses = m_Labels.size();
+  if (this->FindClass(m_ReferenceLabel) < 0)
+    {
+    itkExceptionMacro("Reference label " << m_ReferenceLabel
+                      << " is not one of the classes.");
+    }
+
+  m_ThreadSamples.assign(this->GetNumberOfThreads(), ThreadSamples());
+  MultiThreader* threader = this->GetMultiThreader();
+  threader->SetNumberOfThreads(this->GetNumberOfThreads());
+  threader->SetSingleMethod(SamplingThreaderCallback, this);
+  threader->SingleMethodExecute();
+
+  /** Merge the samples of all threads */
+  std::vector< SampleType > range(numberOfClasses);
+  std::vector< SampleType > mean(numberOfClasses);
+  SampleType reference;
+  for (unsigned int t = 0; t < m_ThreadSamples.size(); t++)
+    {
+    ThreadSamples & samples = m_ThreadSamples[t];
+    for (unsigned int c = 0; c < samples.Range.size(); c++)
+      {
+      range[c].insert(range[c].end(), samples.Range[c].begin(),
+                      samples.Range[c].end());
+      mean[c].insert(mean[c].end(), samples.Mean[c].begin(),
+                     samples.Mean[c].end());
+      }
+    reference.insert(reference.end(), samples.Reference.begin(),
+                     samples.Reference.end());
+    }
+  m_ThreadSamples.clear();
+
+  if (reference.empty())
+    {
+    itkExceptionMacro("No sample in the reference class " << m_ReferenceLabel);
+    }
+  /** Standard deviation of the non-zero voxels as fslstats -S */
+  double sum = 0;
+  double sumOfSquares = 0;
+  for (unsigned int i = 0; i < reference.size(); i++)
+    {
+    sum += reference[i];
+    sumOfSquares += static_cast< double >(reference[i]) * reference[i];
+    }
+  const double n = reference.size();
+  double variance = 0;
+  if (n > 1) variance = (sumOfSquares - sum * sum / n) / (n - 1);
+  m_StandardDeviationMinimum = variance > 0 ? std::sqrt(variance) : 0;
+  m_MeanMinimum = cascade::util::SelectQuantile(reference,
+                                                m_MeanMinimumPercentile);
+
+  /*
+   * The model mean is max(raw mean, MeanMinimum) which is monotone, so its
+   * median is the maximum of the raw median and MeanMinimum.
+   */
+  m_CorrectionRatios.assign(numberOfClasses, 0);
+  for (unsigned int c = 0; c < numberOfClasses; c++)
+    {
+    if (range[c].empty())
+      {
+      itkExceptionMacro("No voxel with label " << m_Labels[c]);
+      }
+    const double rangeMedian = cascade::util::SelectQuantile(range[c], 0.5);
+    const double modelMedian = std::max(
+        static_cast< double >(cascade::util::SelectQuantile(mean[c], 0.5)),
+        m_MeanMinimum);
+    if (modelMedian == 0)
+      {
+      itkExceptionMacro("Median of the model of label " << m_Labels[c]
+                        << " is zero.");
+      }
+    m_CorrectionRatios[c] = rangeMedian / modelMedian;
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread, ThreadIdType)
+  {
+  typedef ImageRegionConstIterator< InputImageType > InputIteratorType;
+  typedef ImageRegionIterator< OutputImageType > OutputIteratorType;
+
+  const unsigned int numberOfClasses = m_Labels.size();
+  std::vector< InputIteratorType > numberIt(numberOfClasses);
+  std::vector< InputIteratorType > sumIt(numberOfClasses);
+  std::vector< InputIteratorType > m2It(numberOfClasses);
+  for (unsigned int c = 0; c < numberOfClasses; c++)
+    {
+    const unsigned int first = FirstClassInput + 3 * c;
+    numberIt[c] = InputIteratorType(this->GetNthImage(first),
+                                    outputRegionForThread);
+    sumIt[c] = InputIteratorType(this->GetNthImage(first + 1),
+                                 outputRegionForThread);
+    m2It[c] = InputIteratorType(this->GetNthImage(first + 2),
+                                outputRegionForThread);
+    }
+
+  const bool hasMask = this->GetNthImage(2) != 0;
+  InputIteratorType maskIt;
+  if (hasMask)
+    {
+    maskIt = InputIteratorType(this->GetNthImage(2), outputRegionForThread);
+    }
+  const bool hasPrevious = this->GetNthImage(3) != 0;
+  InputIteratorType previousIt;
+  if (hasPrevious)
+    {
+    previousIt = InputIteratorType(this->GetNthImage(3), outputRegionForThread);
+    }
+
+  OutputIteratorType scoreIt(this->GetScoreOutput(), outputRegionForThread);
+  OutputIteratorType meanIt(this->GetMeanOutput(), outputRegionForThread);
+  OutputIteratorType stdIt(this->GetStandardDeviationOutput(),
+                           outputRegionForThread);
+
+  const InputPixelType zero = NumericTraits< InputPixelType >::ZeroValue();
+  InputIteratorType rangeIt(this->GetNthImage(0), outputRegionForThread);
+  InputIteratorType labelIt(this->GetNthImage(1), outputRegionForThread);
+  for (; !rangeIt.IsAtEnd(); ++rangeIt, ++labelIt, ++scoreIt, ++meanIt, ++stdIt)
+    {
+    double mean = 0;
+    double deviation = 0;
+    const int c = this->FindClass(labelIt.Get());
+    if (c >= 0)
+      {
+      const double number = numberIt[c].Get();
+      mean = std::max(RawMean(number, sumIt[c].Get()), m_MeanMinimum);
+      deviation = std::sqrt(1.0 / ((number - 1) / m2It[c].Get()));
+      if (!(deviation > 0)) deviation = 0;
+      deviation = std::min(std::max(deviation, m_StandardDeviationMinimum),
+                           mean);
+      mean *= m_CorrectionRatios[c];
+      deviation *= m_CorrectionRatios[c];
+      }
+    for (unsigned int k = 0; k < numberOfClasses; k++)
+      {
+      ++numberIt[k];
+      ++sumIt[k];
+      ++m2It[k];
+      }
+
+    double score = 0;
+    bool inside = true;
+    if (hasMask)
+      {
+      inside = maskIt.Get() != zero;
+      ++maskIt;
+      }
+    if (inside && deviation != 0)
+      {
+      const double value = rangeIt.Get();
+      switch (m_SequenceType)
+        {
+      case LIGHT:
+        score = (value - mean) / deviation;
+        break;
+      case DARK:
+        score = (mean - value) / deviation;
+        break;
+      default:
+        score = std::fabs(value - mean) / deviation;
+        }
+      }
+    if (hasPrevious)
+      {
+      score = std::max(score, static_cast< double >(previousIt.Get()));
+      ++previousIt;
+      }
+
+    scoreIt.Set(static_cast< OutputPixelType >(score));
+    meanIt.Set(static_cast< OutputPixelType >(mean));
+    stdIt.Set(static_cast< OutputPixelType >(deviation));
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+void NormalModelScoreImageFilter< TInputImage, TOutputImage >::PrintSelf(
+    std::ostream & os, Indent indent) const
+  {
+  Superclass::PrintSelf(os, indent);
+  os << indent << "SequenceType: " << m_SequenceType << std::endl;
+  os << indent << "ReferenceLabel: " << m_ReferenceLabel << std::endl;
+  os << indent << "MeanMinimumPercentile: " << m_MeanMinimumPercentile
+     << std::endl;
+  os << indent << "MeanMinimum: " << m_MeanMinimum << std::endl;
+  os << indent << "StandardDeviationMinimum: " << m_StandardDeviationMinimum
+     << std::endl;
+  os << indent << "NumberOfClasses: " << m_Labels.size() << std::endl;
+  }
+} // end namespace itk
+
+#endif
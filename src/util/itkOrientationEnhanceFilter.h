@@ -81,7 +81,7 @@ public:
     void operator=(const Self &);//purposely not implemented
     };} // end namespace itk
 
-#ifndef ITK_MANUAL_INSTANTIATION
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
 #include "itkOrientationEnhanceFilter.hxx"
 #endif
 
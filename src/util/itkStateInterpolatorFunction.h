@@ -94,7 +94,7 @@ public:
     const unsigned int m_Neighbors;
     };} // end namespace itk
 
-#ifndef ITK_MANUAL_INSTANTIATION
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
 #include "itkStateInterpolatorFunction.hxx"
 #endif
 #endif /* STATEINTERPOLATORFUNCTION_H_ */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkStateResampleImageFilter_h
+#define __itkStateResampleImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkVectorImage.h"
+#include "itkTransform.h"
+#include "itkStateInterpolatorFunction.h"
+#include "itkWeightedSinglePassMeanCovarianceUpdate.h"
+
+namespace itk
+{
+/*
+ * Resample a state image onto a reference grid through a transform.
+ *
+ * The state image is a VectorImage of groups of StateGroupSize components,
+ * each a [weight, weighted sum, covariance] state (e.g. N, sum and M2 of
+ * every class and sequence). The transform maps points of the reference grid
+ * into the state image, as for ResampleImageFilter, and can be any ITK
+ * transform e.g. an affine or a displacement field transform. For every
+ * output pixel the neighbours and weights are computed once by
+ * StateInterpolatorFunction::GetWeightsForContinuousIndex and every group is
+ * interpolated by merging the neighbour states with these weights, as
+ * StateInterpolatorFunction::EvaluateAtContinuousIndex does for a single
+ * state. Unlike a linear interpolation of each component, the merge keeps
+ * the spread between the neighbour means in the covariance. Pixels mapped
+ * outside the state image are empty states.
+ */
+template< class TStateImage >
+class ITK_EXPORT StateResampleImageFilter: public ImageToImageFilter<
+    TStateImage, TStateImage >
+{
+public:
+  /** Standard "Self" & Superclass typedef.   */
+  typedef StateResampleImageFilter Self;
+  typedef ImageToImageFilter< TStateImage, TStateImage > Superclass;
+  typedef SmartPointer< Self > Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory.  */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods)  */
+  itkTypeMacro(StateResampleImageFilter, ImageToImageFilter);
+
+  itkStaticConstMacro(Dimension, unsigned int, TStateImage::ImageDimension);
+
+    /** Image typedef support. */
+    typedef TStateImage StateImageType;
+    typedef typename StateImageType::PixelType StateType;
+    typedef typename StateImageType::RegionType OutputImageRegionType;
+    typedef ImageBase< itkGetStaticConstMacro(Dimension) > ImageBaseType;
+    typedef Transform< double, itkGetStaticConstMacro(Dimension),
+        itkGetStaticConstMacro(Dimension) > TransformType;
+
+    typedef StateInterpolatorFunction< StateImageType, double > StateInterpolateType;
+    typedef WeightedSinglePassMeanCovarianceUpdate< StateType > StateUpdater;
+
+    /** Maps reference points to state points, identity by default */
+    itkSetConstObjectMacro(Transform, TransformType);
+    itkGetConstObjectMacro(Transform, TransformType);
+
+    /** Grid of the output, the state grid by default */
+    itkSetConstObjectMacro(ReferenceImage, ImageBaseType);
+    itkGetConstObjectMacro(ReferenceImage, ImageBaseType);
+
+    /** Number of components of each state, zero for the whole pixel */
+    itkSetMacro(StateGroupSize, unsigned int);
+    itkGetConstMacro(StateGroupSize, unsigned int);
+
+  protected:
+    StateResampleImageFilter();
+    virtual ~StateResampleImageFilter()
+      {}
+
+    /** The output is on the grid of the reference image */
+    void GenerateOutputInformation();
+    void GenerateInputRequestedRegion();
+
+    void BeforeThreadedGenerateData();
+    void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+        ThreadIdType threadId);
+
+    void PrintSelf(std::ostream & os, Indent indent) const;
+  private:
+    StateResampleImageFilter(const Self &); //purposely not implemented
+    void operator=(const Self &);//purposely not implemented
+
+    typename TransformType::ConstPointer m_Transform;
+    typename ImageBaseType::ConstPointer m_ReferenceImage;
+    unsigned int m_StateGroupSize;
+    /** Group size used by the current update */
+    unsigned int m_GroupLength;
+    typename StateInterpolateType::Pointer m_StateInterpolate;
+    };} // end namespace itk
+
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
+#include "itkStateResampleImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkStateResampleImageFilter_hxx
+#define __itkStateResampleImageFilter_hxx
+#include "itkStateResampleImageFilter.h"
+
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkIdentityTransform.h"
+
+namespace itk
+{
+template< class TStateImage >
+StateResampleImageFilter< TStateImage >::StateResampleImageFilter()
+  {
+  m_Transform = IdentityTransform< double, Dimension >::New().GetPointer();
+  m_StateGroupSize = 0;
+  m_GroupLength = 0;
+  m_StateInterpolate = StateInterpolateType::New();
+  }
+
+template< class TStateImage >
+void StateResampleImageFilter< TStateImage >::GenerateOutputInformation()
+  {
+  Superclass::GenerateOutputInformation();
+
+  const StateImageType* state = this->GetInput();
+  StateImageType* output = this->GetOutput();
+  if (!state || !output) return;
+
+  if (m_ReferenceImage.IsNotNull())
+    {
+    output->SetLargestPossibleRegion(
+        m_ReferenceImage->GetLargestPossibleRegion());
+    output->SetSpacing(m_ReferenceImage->GetSpacing());
+    output->SetOrigin(m_ReferenceImage->GetOrigin());
+    output->SetDirection(m_ReferenceImage->GetDirection());
+    }
+  output->SetNumberOfComponentsPerPixel(state->GetNumberOfComponentsPerPixel());
+  }
+
+template< class TStateImage >
+void StateResampleImageFilter< TStateImage >::GenerateInputRequestedRegion()
+  {
+  /** Output regions do not map to input regions through a transform */
+  StateImageType* state = const_cast< StateImageType* >(this->GetInput());
+  if (state)
+    {
+    state->SetRequestedRegionToLargestPossibleRegion();
+    }
+  }
+
+template< class TStateImage >
+void StateResampleImageFilter< TStateImage >::BeforeThreadedGenerateData()
+  {
+  const unsigned int length = this->GetInput()->GetNumberOfComponentsPerPixel();
+  m_GroupLength = m_StateGroupSize ? m_StateGroupSize : length;
+  if (m_GroupLength == 0 || length % m_GroupLength != 0)
+    {
+    itkExceptionMacro("State length " << length
+                      << " is not a multiple of the group size "
+                      << m_GroupLength);
+    }
+  /** The group size should be 1 + D + D(D+1)/2 for some D */
+  unsigned int D = 0;
+  while (D < 17 && StateUpdater::MeasurementToStateDim(D) < m_GroupLength)
+    ++D;
+  if (StateUpdater::MeasurementToStateDim(D) != m_GroupLength)
+    {
+    itkExceptionMacro("Group size " << m_GroupLength
+                      << " is not a valid state length.");
+    }
+  itkAssertOrThrowMacro(m_Transform.IsNotNull(),
+                        "Transformation function should be set.");
+  m_StateInterpolate->SetInputImage(this->GetInput());
+  }
+
+template< class TStateImage >
+void StateResampleImageFilter< TStateImage >::ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread, ThreadIdType)
+  {
+  typedef ImageRegionIteratorWithIndex< StateImageType > OutputIteratorType;
+  typedef typename StateInterpolateType::ContinuousIndexType ContinuousIndexType;
+  typedef typename StateInterpolateType::NeighborListType NeighborListType;
+  typedef typename StateImageType::PointType PointType;
+
+  const StateImageType* state = this->GetInput();
+  StateImageType* output = this->GetOutput();
+  const unsigned int length = state->GetNumberOfComponentsPerPixel();
+  const unsigned int groups = length / m_GroupLength;
+
+  /** Buffers are reused for every pixel */
+  StateType pixel(length);
+  StateType group(m_GroupLength);
+  StateType neighborGroup(m_GroupLength);
+
+  OutputIteratorType oit(output, outputRegionForThread);
+  for (; !oit.IsAtEnd(); ++oit)
+    {
+    PointType point;
+    output->TransformIndexToPhysicalPoint(oit.GetIndex(), point);
+
+    ContinuousIndexType index;
+    state->TransformPhysicalPointToContinuousIndex(
+        m_Transform->TransformPoint(point), index);
+    pixel.Fill(0);
+    if (m_StateInterpolate->IsInsideBuffer(index))
+      {
+      const NeighborListType neighbors =
+          m_StateInterpolate->GetWeightsForContinuousIndex(index);
+      for (unsigned int g = 0; g < groups; g++)
+        {
+        const unsigned int first = g * m_GroupLength;
+        bool isEmpty = true;
+        for (unsigned int n = 0; n < neighbors.size(); n++)
+          {
+          const StateType neighbor = state->GetPixel(neighbors[n].first);
+          if (neighbor[first] == 0) continue;
+          const double weight = neighbors[n].second;
+          if (isEmpty)
+            {
+            /** Same as merging into an empty state, without reallocating */
+            for (unsigned int k = 0; k < m_GroupLength; k++)
+              group[k] = neighbor[first + k] * weight;
+            isEmpty = false;
+            continue;
+            }
+          for (unsigned int k = 0; k < m_GroupLength; k++)
+            neighborGroup[k] = neighbor[first + k];
+          StateUpdater::Merge(group, neighborGroup, weight);
+          }
+        if (isEmpty) continue;
+        for (unsigned int k = 0; k < m_GroupLength; k++)
+          pixel[first + k] = group[k];
+        }
+      }
+    oit.Set(pixel);
+    }
+  }
+
+template< class TStateImage >
+void StateResampleImageFilter< TStateImage >::PrintSelf(
+    std::ostream & os, Indent indent) const
+  {
+  Superclass::PrintSelf(os, indent);
+  os << indent << "StateGroupSize: " << m_StateGroupSize << std::endl;
+  os << indent << "Transform: " << m_Transform << std::endl;
+  os << indent << "ReferenceImage: " << m_ReferenceImage << std::endl;
+  }
+} // end namespace itk
+
+#endif
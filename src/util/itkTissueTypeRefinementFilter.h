@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkTissueTypeRefinementFilter_h
+#define __itkTissueTypeRefinementFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <vector>
+
+namespace itk
+{
+/*
+ * Tissue masks from the FAST partial volume estimates.
+ *
+ * CSF, GM and WM are the voxels whose partial volume is at least
+ * ProbabilityThreshold. Voxels of the hyperintense sequences (e.g. FLAIR, T2)
+ * above their threshold are possible WM, restricted to where the standard
+ * white matter probability is at least StandardWhiteThreshold (if set) and
+ * to non CSF voxels. Possible WM is added to WM, then CSF and GM are removed
+ * where WM is set. All outputs are computed in a single pass:
+ *   0 CSF (1), 1 GM (2), 2 WM (3), 3 WMGM (1), 4 PVE (1, 2, 3) and
+ *   5 possible WM (1).
+ */
+template< class TInputImage, class TOutputImage >
+class ITK_EXPORT TissueTypeRefinementFilter: public ImageToImageFilter<
+    TInputImage, TOutputImage >
+{
+public:
+  /** Standard "Self" & Superclass typedef.   */
+  typedef TissueTypeRefinementFilter Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self > Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory.  */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods)  */
+  itkTypeMacro(TissueTypeRefinementFilter, ImageToImageFilter);
+
+    /** Image typedef support. */
+    typedef TInputImage InputImageType;
+    typedef typename InputImageType::PixelType InputPixelType;
+    typedef TOutputImage OutputImageType;
+    typedef typename OutputImageType::PixelType OutputPixelType;
+    typedef typename OutputImageType::RegionType OutputImageRegionType;
+
+    typedef ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+    using Superclass::MakeOutput;
+    virtual DataObject::Pointer MakeOutput(DataObjectPointerArraySizeType idx);
+
+    /** Partial volume estimates */
+    void SetCSFProbabilityImage(const InputImageType* image);
+    void SetGMProbabilityImage(const InputImageType* image);
+    void SetWMProbabilityImage(const InputImageType* image);
+
+    /** Optional white matter probability in the subject space */
+    void SetStandardWhiteImage(const InputImageType* image);
+
+    /** Voxels of image at least threshold (and not zero) are possible WM */
+    void AddHyperintenseImage(const InputImageType* image, double threshold);
+
+    itkSetMacro(ProbabilityThreshold, double);
+    itkGetConstMacro(ProbabilityThreshold, double);
+
+    itkSetMacro(StandardWhiteThreshold, double);
+    itkGetConstMacro(StandardWhiteThreshold, double);
+
+    OutputImageType* GetCSFOutput();
+    OutputImageType* GetGMOutput();
+    OutputImageType* GetWMOutput();
+    OutputImageType* GetWMGMOutput();
+    OutputImageType* GetPVEOutput();
+    OutputImageType* GetPossibleWMOutput();
+
+  protected:
+    TissueTypeRefinementFilter();
+    virtual ~TissueTypeRefinementFilter()
+      {}
+
+    void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+        ThreadIdType threadId);
+
+    void PrintSelf(std::ostream & os, Indent indent) const;
+  private:
+    TissueTypeRefinementFilter(const Self &); //purposely not implemented
+    void operator=(const Self &);//purposely not implemented
+
+    const InputImageType* GetNthImage(unsigned int idx) const;
+
+    itkStaticConstMacro(NumberOfOutputs, unsigned int, 6);
+    /** Inputs after the fixed ones are the hyperintense sequences */
+    itkStaticConstMacro(FirstHyperintenseInput, unsigned int, 4);
+
+    double m_ProbabilityThreshold;
+    double m_StandardWhiteThreshold;
+    std::vector< double > m_HyperintenseThresholds;
+    };} // end namespace itk
+
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
+#include "itkTissueTypeRefinementFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef __itkTissueTypeRefinementFilter_hxx
+#define __itkTissueTypeRefinementFilter_hxx
+#include "itkTissueTypeRefinementFilter.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+
+namespace itk
+{
+template< class TInputImage, class TOutputImage >
+TissueTypeRefinementFilter< TInputImage, TOutputImage >::TissueTypeRefinementFilter()
+  {
+  m_ProbabilityThreshold = 0.5;
+  m_StandardWhiteThreshold = 0.35;
+
+  this->SetNumberOfRequiredInputs(3);
+  this->SetNumberOfRequiredOutputs(NumberOfOutputs);
+  for (unsigned int i = 0; i < NumberOfOutputs; i++)
+    {
+    this->SetNthOutput(i, this->MakeOutput(i));
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+DataObject::Pointer TissueTypeRefinementFilter< TInputImage, TOutputImage >::MakeOutput(
+    DataObjectPointerArraySizeType)
+  {
+  return OutputImageType::New().GetPointer();
+  }
+
+template< class TInputImage, class TOutputImage >
+void TissueTypeRefinementFilter< TInputImage, TOutputImage >::SetCSFProbabilityImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(0, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void TissueTypeRefinementFilter< TInputImage, TOutputImage >::SetGMProbabilityImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(1, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void TissueTypeRefinementFilter< TInputImage, TOutputImage >::SetWMProbabilityImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(2, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void TissueTypeRefinementFilter< TInputImage, TOutputImage >::SetStandardWhiteImage(
+    const InputImageType* image)
+  {
+  this->SetNthInput(3, const_cast< InputImageType* >(image));
+  }
+
+template< class TInputImage, class TOutputImage >
+void TissueTypeRefinementFilter< TInputImage, TOutputImage >::AddHyperintenseImage(
+    const InputImageType* image, double threshold)
+  {
+  this->SetNthInput(FirstHyperintenseInput + m_HyperintenseThresholds.size(),
+                    const_cast< InputImageType* >(image));
+  m_HyperintenseThresholds.push_back(threshold);
+  }
+
+template< class TInputImage, class TOutputImage >
+const typename TissueTypeRefinementFilter< TInputImage, TOutputImage >::InputImageType*
+TissueTypeRefinementFilter< TInputImage, TOutputImage >::GetNthImage(
+    unsigned int idx) const
+  {
+  return static_cast< const InputImageType* >(this->ProcessObject::GetInput(idx));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* TissueTypeRefinementFilter< TInputImage, TOutputImage >::GetCSFOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(0));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* TissueTypeRefinementFilter< TInputImage, TOutputImage >::GetGMOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(1));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* TissueTypeRefinementFilter< TInputImage, TOutputImage >::GetWMOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(2));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* TissueTypeRefinementFilter< TInputImage, TOutputImage >::GetWMGMOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(3));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* TissueTypeRefinementFilter< TInputImage, TOutputImage >::GetPVEOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(4));
+  }
+
+template< class TInputImage, class TOutputImage >
+TOutputImage* TissueTypeRefinementFilter< TInputImage, TOutputImage >::GetPossibleWMOutput()
+  {
+  return static_cast< OutputImageType* >(this->ProcessObject::GetOutput(5));
+  }
+
+template< class TInputImage, class TOutputImage >
+void TissueTypeRefinementFilter< TInputImage, TOutputImage >::ThreadedGenerateData(
+    const OutputImageRegionType & outputRegionForThread, ThreadIdType)
+  {
+  typedef ImageRegionConstIterator< InputImageType > InputIteratorType;
+  typedef ImageRegionIterator< OutputImageType > OutputIteratorType;
+
+  InputIteratorType csfIt(this->GetNthImage(0), outputRegionForThread);
+  InputIteratorType gmIt(this->GetNthImage(1), outputRegionForThread);
+  InputIteratorType wmIt(this->GetNthImage(2), outputRegionForThread);
+
+  const bool hasStandardWhite = this->GetNthImage(3) != 0;
+  InputIteratorType whiteIt;
+  if (hasStandardWhite)
+    {
+    whiteIt = InputIteratorType(this->GetNthImage(3), outputRegionForThread);
+    }
+
+  const unsigned int numberOfSequences = m_HyperintenseThresholds.size();
+  std::vector< InputIteratorType > sequenceIt(numberOfSequences);
+  for (unsigned int s = 0; s < numberOfSequences; s++)
+    {
+    sequenceIt[s] = InputIteratorType(
+        this->GetNthImage(FirstHyperintenseInput + s), outputRegionForThread);
+    }
+
+  std::vector< OutputIteratorType > outIt(NumberOfOutputs);
+  for (unsigned int i = 0; i < NumberOfOutputs; i++)
+    {
+    outIt[i] = OutputIteratorType(
+        static_cast< OutputImageType* >(this->ProcessObject::GetOutput(i)),
+        outputRegionForThread);
+    }
+
+  const InputPixelType zero = NumericTraits< InputPixelType >::ZeroValue();
+  const double threshold = m_ProbabilityThreshold;
+  for (; !csfIt.IsAtEnd(); ++csfIt, ++gmIt, ++wmIt)
+    {
+    /** NaN partial volumes compare false and are not tissue */
+    bool csf = csfIt.Get() >= threshold;
+    bool gm = gmIt.Get() >= threshold;
+    bool wm = wmIt.Get() >= threshold;
+
+    bool possibleWM = false;
+    for (unsigned int s = 0; s < numberOfSequences; s++)
+      {
+      const InputPixelType value = sequenceIt[s].Get();
+      possibleWM |= value >= m_HyperintenseThresholds[s] && value != zero;
+      ++sequenceIt[s];
+      }
+    if (hasStandardWhite)
+      {
+      possibleWM &= whiteIt.Get() >= m_StandardWhiteThreshold;
+      ++whiteIt;
+      }
+    possibleWM &= !csf;
+
+    wm |= possibleWM;
+    csf &= !wm;
+    gm &= !wm;
+
+    outIt[0].Set(csf ? 1 : 0);
+    outIt[1].Set(gm ? 2 : 0);
+    outIt[2].Set(wm ? 3 : 0);
+    outIt[3].Set(gm || wm ? 1 : 0);
+    outIt[4].Set(csf + 2 * gm + 3 * wm);
+    outIt[5].Set(possibleWM ? 1 : 0);
+    for (unsigned int i = 0; i < NumberOfOutputs; i++)
+      ++outIt[i];
+    }
+  }
+
+template< class TInputImage, class TOutputImage >
+void TissueTypeRefinementFilter< TInputImage, TOutputImage >::PrintSelf(
+    std::ostream & os, Indent indent) const
+  {
+  Superclass::PrintSelf(os, indent);
+  os << indent << "ProbabilityThreshold: " << m_ProbabilityThreshold << std::endl;
+  os << indent << "StandardWhiteThreshold: " << m_StandardWhiteThreshold
+     << std::endl;
+  os << indent << "NumberOfHyperintenseImages: "
+     << m_HyperintenseThresholds.size() << std::endl;
+  }
+} // end namespace itk
+
+#endif
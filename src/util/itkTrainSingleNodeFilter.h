@@ -180,7 +180,7 @@ public:
 
     };}
 
-#ifndef ITK_MANUAL_INSTANTIATION
+#if !defined(ITK_MANUAL_INSTANTIATION) && !defined(CASCADE_MANUAL_INSTANTIATION)
 #include "itkTrainSingleNodeFilter.hxx"
 #endif
 
@@ -22,6 +22,7 @@
 #include "itkIdentityTransform.h"
 #include "itkContinuousIndex.h"
 #include "itkImageDuplicator.h"
+#include "profiler.h"
 
 #include <vector>
 #include <algorithm>
@@ -169,8 +170,15 @@ void TrainSingleNodeFilter< TInputImage, TOutputImage >::GenerateData()
   itkAssertOrThrowMacro(m_Transform.IsNotNull(),
                         "Transformation function should be set.");
 
+  cascade::util::ProfileScope initialProfile(
+      this->GetNameOfClass(), "initial-state",
+      outputImage->GetLargestPossibleRegion().GetNumberOfPixels());
   this->SetInitialState();
+  initialProfile.Stop();
 
+  cascade::util::ProfileScope updateProfile(
+      this->GetNameOfClass(), "update",
+      inputImage->GetRequestedRegion().GetNumberOfPixels());
   InputIteratorType iit(inputImage, inputImage->GetRequestedRegion());
   MaskIteratorType mit;
   if (mask) mit = MaskIteratorType(mask, mask->GetRequestedRegion());
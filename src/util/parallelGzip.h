@@ -0,0 +1,470 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+
+#ifndef PARALLELGZIP_H_
+#define PARALLELGZIP_H_
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "itk_zlib.h"
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+#include "itkMultiThreader.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * Multi-member gzip files that can be compressed and decompressed in
+ * parallel.
+ *
+ * The data is split into fixed size blocks and every block is stored as an
+ * independent gzip member, so any gzip reader inflates the file as one
+ * stream. As in BGZF, each member header carries an extra subfield ('C','S')
+ * with the total size of the member. This lets the reader find all members
+ * without inflating them and inflate them concurrently. Files without the
+ * subfield, e.g. written by ITK or FSL, are left to the regular readers.
+ */
+namespace gzip
+{
+
+const unsigned int HeaderSize = 20;
+const unsigned int TrailerSize = 8;
+const size_t DefaultBlockSize = 1 << 20;
+
+inline void PutUInt32(unsigned char* p, itk::uint32_t v)
+  {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+  }
+
+inline itk::uint32_t GetUInt32(const unsigned char* p)
+  {
+  return static_cast< itk::uint32_t >(p[0])
+      | (static_cast< itk::uint32_t >(p[1]) << 8)
+      | (static_cast< itk::uint32_t >(p[2]) << 16)
+      | (static_cast< itk::uint32_t >(p[3]) << 24);
+  }
+
+/** A block of the uncompressed data and its gzip member */
+struct Block
+  {
+  const unsigned char* Input;
+  size_t InputLength;
+  unsigned char* Output;
+  size_t OutputLength;
+  bool Failed;
+  };
+
+struct Job
+  {
+  std::vector< Block >* Blocks;
+  int Level;
+  };
+
+/** Deflate one block into a complete gzip member */
+inline bool CompressBlock(Block & block, int level)
+  {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+  const size_t bound = deflateBound(&stream,
+                                    static_cast< uLong >(block.InputLength));
+  block.Output = new unsigned char[HeaderSize + bound + TrailerSize];
+  stream.next_in = const_cast< Bytef* >(block.Input);
+  stream.avail_in = static_cast< uInt >(block.InputLength);
+  stream.next_out = block.Output + HeaderSize;
+  stream.avail_out = static_cast< uInt >(bound);
+  const int status = deflate(&stream, Z_FINISH);
+  const size_t deflated = stream.total_out;
+  deflateEnd(&stream);
+  if (status != Z_STREAM_END) return false;
+
+  unsigned char* h = block.Output;
+  block.OutputLength = HeaderSize + deflated + TrailerSize;
+  h[0] = 31;
+  h[1] = 139;
+  h[2] = 8; // deflate
+  h[3] = 4; // FEXTRA
+  PutUInt32(h + 4, 0); // MTIME
+  h[8] = 0; // XFL
+  h[9] = 255; // OS unknown
+  h[10] = 8; // XLEN
+  h[11] = 0;
+  h[12] = 'C';
+  h[13] = 'S';
+  h[14] = 4; // SLEN
+  h[15] = 0;
+  PutUInt32(h + 16, static_cast< itk::uint32_t >(block.OutputLength));
+
+  unsigned char* t = h + HeaderSize + deflated;
+  PutUInt32(t, crc32(crc32(0L, Z_NULL, 0), block.Input,
+                     static_cast< uInt >(block.InputLength)));
+  PutUInt32(t + 4, static_cast< itk::uint32_t >(block.InputLength));
+  return true;
+  }
+
+/** Inflate one member in place of its uncompressed block */
+inline bool DecompressBlock(Block & block)
+  {
+  const unsigned char* trailer = block.Input + block.InputLength - TrailerSize;
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) return false;
+  stream.next_in = const_cast< Bytef* >(block.Input + HeaderSize);
+  stream.avail_in = static_cast< uInt >(block.InputLength - HeaderSize
+      - TrailerSize);
+  stream.next_out = block.Output;
+  stream.avail_out = static_cast< uInt >(block.OutputLength);
+  const int status = inflate(&stream, Z_FINISH);
+  const size_t inflated = stream.total_out;
+  inflateEnd(&stream);
+  return status == Z_STREAM_END && inflated == block.OutputLength
+      && GetUInt32(trailer)
+          == crc32(crc32(0L, Z_NULL, 0), block.Output,
+                   static_cast< uInt >(block.OutputLength));
+  }
+
+inline ITK_THREAD_RETURN_TYPE CompressCallback(void* arg)
+  {
+  itk::MultiThreader::ThreadInfoStruct* info =
+      static_cast< itk::MultiThreader::ThreadInfoStruct* >(arg);
+  Job* job = static_cast< Job* >(info->UserData);
+  std::vector< Block > & blocks = *job->Blocks;
+  for (size_t b = info->ThreadID; b < blocks.size(); b += info->NumberOfThreads)
+    blocks[b].Failed = !CompressBlock(blocks[b], job->Level);
+  return ITK_THREAD_RETURN_VALUE;
+  }
+
+inline ITK_THREAD_RETURN_TYPE DecompressCallback(void* arg)
+  {
+  itk::MultiThreader::ThreadInfoStruct* info =
+      static_cast< itk::MultiThreader::ThreadInfoStruct* >(arg);
+  Job* job = static_cast< Job* >(info->UserData);
+  std::vector< Block > & blocks = *job->Blocks;
+  for (size_t b = info->ThreadID; b < blocks.size(); b += info->NumberOfThreads)
+    blocks[b].Failed = !DecompressBlock(blocks[b]);
+  return ITK_THREAD_RETURN_VALUE;
+  }
+
+inline void Run(ITK_THREAD_RETURN_TYPE (*callback)(void*), Job & job)
+  {
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  const itk::ThreadIdType threads = std::min< size_t >(
+      threader->GetNumberOfThreads(), job.Blocks->size());
+  threader->SetNumberOfThreads(std::max< itk::ThreadIdType >(threads, 1));
+  threader->SetSingleMethod(callback, &job);
+  threader->SingleMethodExecute();
+  }
+
+inline bool ReadFile(const std::string & filename,
+                     std::vector< unsigned char > & data)
+  {
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file) return false;
+  file.seekg(0, std::ios::end);
+  data.resize(static_cast< size_t >(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  return data.empty()
+      || file.read(reinterpret_cast< char* >(&data[0]), data.size());
+  }
+
+}  // namespace gzip
+
+/*
+ * Compress a file into a multi-member gzip file using all ITK threads.
+ * level is the zlib compression level (0-9).
+ */
+inline void GzipCompressFile(const std::string & source,
+                             const std::string & destination, int level,
+                             size_t blockSize = gzip::DefaultBlockSize)
+  {
+  std::vector< unsigned char > data;
+  if (!gzip::ReadFile(source, data))
+    {
+    itkGenericExceptionMacro("Can not read " << source);
+    }
+
+  /** An empty file still needs one member to be valid gzip */
+  const size_t numberOfBlocks = std::max< size_t >(
+      (data.size() + blockSize - 1) / blockSize, 1);
+  std::vector< gzip::Block > blocks(numberOfBlocks);
+  for (size_t b = 0; b < numberOfBlocks; b++)
+    {
+    const size_t begin = b * blockSize;
+    blocks[b].Input = data.empty() ? 0 : &data[0] + begin;
+    blocks[b].InputLength = std::min(blockSize, data.size() - begin);
+    blocks[b].Output = 0;
+    blocks[b].OutputLength = 0;
+    blocks[b].Failed = false;
+    }
+
+  gzip::Job job;
+  job.Blocks = &blocks;
+  job.Level = level;
+  gzip::Run(gzip::CompressCallback, job);
+
+  bool failed = false;
+  std::ofstream file(destination.c_str(),
+                     std::ios::out | std::ios::binary | std::ios::trunc);
+  for (size_t b = 0; b < numberOfBlocks; b++)
+    {
+    failed |= blocks[b].Failed || !file;
+    if (!failed)
+      {
+      file.write(reinterpret_cast< char* >(blocks[b].Output),
+                 blocks[b].OutputLength);
+      }
+    delete[] blocks[b].Output;
+    }
+  file.close();
+  if (failed || !file)
+    {
+    itkGenericExceptionMacro("Can not compress " << source << " to "
+                             << destination);
+    }
+  }
+
+/*
+ * A multi-member gzip file written by GzipCompressFile, mapped read only so
+ * the compressed data is neither copied nor kept beyond the page cache. Open
+ * only parses the member headers and trailers and fails for other files, for
+ * members whose uncompressed size is more than deflate can produce from them
+ * and when the sizes do not add up to the expected uncompressed size.
+ */
+class GzipMemberFile
+{
+public:
+  GzipMemberFile() :
+      m_Data(0), m_Length(0), m_UncompressedSize(0)
+    {
+    }
+  ~GzipMemberFile()
+    {
+    this->Close();
+    }
+
+  bool Open(const std::string & filename, itk::uint64_t expectedSize)
+    {
+    this->Close();
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0)
+      {
+      m_Length = static_cast< size_t >(status.st_size);
+      void* data = mmap(0, m_Length, PROT_READ, MAP_PRIVATE, fd, 0);
+      m_Data = data == MAP_FAILED ? 0 : static_cast< unsigned char* >(data);
+      }
+    close(fd);
+    if (!m_Data || !this->ReadMembers(expectedSize))
+      {
+      this->Close();
+      return false;
+      }
+    return true;
+    }
+
+  void Close()
+    {
+    if (m_Data) munmap(m_Data, m_Length);
+    m_Data = 0;
+    m_Length = 0;
+    m_UncompressedSize = 0;
+    m_Blocks.clear();
+    m_Starts.clear();
+    }
+
+  itk::uint64_t GetUncompressedSize() const
+    {
+    return m_UncompressedSize;
+    }
+
+  /*
+   * Inflate the uncompressed bytes from offset to offset + length into
+   * output using all ITK threads. Members entirely in the range are
+   * inflated in place, the ones it cuts through aside.
+   */
+  void Inflate(itk::uint64_t offset, unsigned char* output,
+               itk::uint64_t length) const
+    {
+    if (offset + length > m_UncompressedSize)
+      {
+      itkGenericExceptionMacro("Range is past the end of the gzip data.");
+      }
+    std::vector< gzip::Block > blocks;
+    bool failed = false;
+    for (size_t b = 0; b < m_Blocks.size() && !failed; b++)
+      {
+      const itk::uint64_t start = m_Starts[b];
+      const itk::uint64_t end = start + m_Blocks[b].OutputLength;
+      if (end <= offset || start >= offset + length) continue;
+
+      gzip::Block block = m_Blocks[b];
+      if (start >= offset && end <= offset + length)
+        {
+        block.Output = output + (start - offset);
+        blocks.push_back(block);
+        continue;
+        }
+
+      std::vector< unsigned char > member(block.OutputLength);
+      block.Output = member.empty() ? 0 : &member[0];
+      failed = !gzip::DecompressBlock(block);
+      const itk::uint64_t first = std::max(start, offset);
+      const itk::uint64_t last = std::min(end, offset + length);
+      if (!failed)
+        std::memcpy(output + (first - offset), &member[first - start],
+                    static_cast< size_t >(last - first));
+      }
+
+    gzip::Job job;
+    job.Blocks = &blocks;
+    job.Level = 0;
+    if (!blocks.empty()) gzip::Run(gzip::DecompressCallback, job);
+    for (size_t b = 0; b < blocks.size(); b++)
+      failed |= blocks[b].Failed;
+    if (failed)
+      {
+      itkGenericExceptionMacro("Corrupted gzip member.");
+      }
+    }
+
+private:
+  GzipMemberFile(const GzipMemberFile &); //purposely not implemented
+  void operator=(const GzipMemberFile &); //purposely not implemented
+
+  /** Largest expansion of deflate, the rest is not valid data */
+  static const itk::uint64_t MaximumRatio = 1032;
+
+  bool ReadMembers(itk::uint64_t expectedSize)
+    {
+    for (size_t p = 0; p < m_Length;)
+      {
+      const unsigned char* h = m_Data + p;
+      if (m_Length - p < gzip::HeaderSize + gzip::TrailerSize || h[0] != 31
+          || h[1] != 139 || h[2] != 8 || h[3] != 4 || h[10] != 8 || h[11] != 0
+          || h[12] != 'C' || h[13] != 'S' || h[14] != 4 || h[15] != 0)
+        return false;
+      const size_t memberLength = gzip::GetUInt32(h + 16);
+      if (memberLength < gzip::HeaderSize + gzip::TrailerSize
+          || memberLength > m_Length - p)
+        return false;
+
+      gzip::Block block;
+      block.Input = h;
+      block.InputLength = memberLength;
+      block.Output = 0;
+      block.OutputLength = gzip::GetUInt32(h + memberLength - 4);
+      block.Failed = false;
+      if (block.OutputLength > MaximumRatio * memberLength
+          || block.OutputLength > expectedSize - m_UncompressedSize)
+        return false;
+      m_Blocks.push_back(block);
+      m_Starts.push_back(m_UncompressedSize);
+      m_UncompressedSize += block.OutputLength;
+      p += memberLength;
+      }
+    return !m_Blocks.empty() && m_UncompressedSize == expectedSize;
+    }
+
+  unsigned char* m_Data;
+  size_t m_Length;
+  itk::uint64_t m_UncompressedSize;
+  std::vector< gzip::Block > m_Blocks;
+  std::vector< itk::uint64_t > m_Starts;
+};
+
+/*
+ * Uncompressed size of a gzip file read from the member trailers, nothing is
+ * inflated. For files written by GzipCompressFile the member sizes are summed
+ * and exact is set. For other files the size stored in the last member is
+ * returned, which is the uncompressed size modulo 2^32 only if the file has a
+ * single member.
+ */
+inline bool GzipUncompressedSize(const std::string & filename,
+                                 itk::uint64_t & size, bool & exact)
+  {
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file) return false;
+  file.seekg(0, std::ios::end);
+  const itk::uint64_t fileSize = static_cast< itk::uint64_t >(file.tellg());
+  if (fileSize < gzip::HeaderSize + gzip::TrailerSize) return false;
+
+  unsigned char h[gzip::HeaderSize];
+  size = 0;
+  exact = true;
+  for (itk::uint64_t p = 0; p < fileSize && exact;)
+    {
+    file.seekg(p, std::ios::beg);
+    if (!file.read(reinterpret_cast< char* >(h), sizeof(h))) return false;
+    const itk::uint32_t memberLength = gzip::GetUInt32(h + 16);
+    exact = h[0] == 31 && h[1] == 139 && h[3] == 4 && h[12] == 'C'
+        && h[13] == 'S' && memberLength >= gzip::HeaderSize + gzip::TrailerSize
+        && memberLength <= fileSize - p;
+    if (!exact) break;
+    file.seekg(p + memberLength - 4, std::ios::beg);
+    if (!file.read(reinterpret_cast< char* >(h), 4)) return false;
+    size += gzip::GetUInt32(h);
+    p += memberLength;
+    }
+  if (exact) return true;
+
+  file.clear();
+  file.seekg(fileSize - 4, std::ios::beg);
+  if (!file.read(reinterpret_cast< char* >(h), 4)) return false;
+  size = gzip::GetUInt32(h);
+  return true;
+  }
+
+/*
+ * Uncompressed size of a gzip file by inflating it. Returns false if the
+ * file is not valid gzip or is truncated.
+ */
+inline bool GzipInflatedSize(const std::string & filename,
+                             itk::uint64_t & size)
+  {
+  gzFile file = gzopen(filename.c_str(), "rb");
+  if (!file) return false;
+  std::vector< char > buffer(gzip::DefaultBlockSize);
+  int length;
+  size = 0;
+  while ((length = gzread(file, &buffer[0],
+                          static_cast< unsigned >(buffer.size()))) > 0)
+    size += length;
+  return gzclose(file) == Z_OK && length == 0;
+  }
+
+}  // namespace util
+
+}  // namespace cascade
+
+#endif /* PARALLELGZIP_H_ */
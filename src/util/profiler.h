@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include "itkIntTypes.h"
+#include "itkMacro.h"
+#include "itkSimpleFastMutexLock.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * Cost of a sub-stage of a pipeline, summed over all its calls. CPU time is
+ * the user and system time of the whole process, so it includes the worker
+ * threads and, in batch mode, the other images processed meanwhile. The
+ * peak RSS delta is how much the sub-stage raised the high-water mark of the
+ * resident memory.
+ */
+struct ProfileRecord
+{
+  std::string Site;
+  std::string Stage;
+  itk::SizeValueType Calls;
+  double WallTime;
+  double CPUTime;
+  long PeakRSSDelta;
+  itk::SizeValueType Voxels;
+};
+
+/*
+ * Collects the ProfileRecords of the process. Nothing is measured unless
+ * profiling is enabled e.g. by --profile.
+ */
+class Profiler
+{
+public:
+  static Profiler & GetInstance()
+    {
+    static Profiler instance;
+    return instance;
+    }
+
+  void SetEnabled(bool enabled)
+    {
+    m_Enabled = enabled;
+    }
+  bool IsEnabled() const
+    {
+    return m_Enabled;
+    }
+
+  void Add(ProfileRecord const &record)
+    {
+    m_Lock.Lock();
+    size_t r = 0;
+    while (r < m_Records.size()
+        && (m_Records[r].Site != record.Site
+            || m_Records[r].Stage != record.Stage))
+      ++r;
+    if (r == m_Records.size())
+      {
+      m_Records.push_back(record);
+      }
+    else
+      {
+      ProfileRecord & sum = m_Records[r];
+      sum.Calls += record.Calls;
+      sum.WallTime += record.WallTime;
+      sum.CPUTime += record.CPUTime;
+      sum.PeakRSSDelta += record.PeakRSSDelta;
+      sum.Voxels += record.Voxels;
+      }
+    m_Lock.Unlock();
+    }
+
+  /*
+   * Version 1 of the schema, records in the order they were first seen:
+   * {"schema": 1, "tool": ..., "version": ..., "peak_rss_kb": ...,
+   * "records": [{"site": ...,
+   * "stage": ..., "calls": ..., "wall_seconds": ..., "cpu_seconds": ...,
+   * "peak_rss_delta_kb": ..., "voxels": ...}, ...]}
+   */
+  void Write(std::string const &filename, std::string const &tool,
+             std::string const &version)
+    {
+    std::ofstream out(filename.c_str());
+    if (!out)
+      {
+      itkGenericExceptionMacro("Can not write " << filename);
+      }
+    m_Lock.Lock();
+    out << "{\n  \"schema\": 1,\n  \"tool\": " << Quote(tool)
+        << ",\n  \"version\": " << Quote(version)
+        << ",\n  \"peak_rss_kb\": " << GetPeakRSS() << ",\n  \"records\": [";
+    for (size_t r = 0; r < m_Records.size(); r++)
+      {
+      const ProfileRecord & record = m_Records[r];
+      char times[128];
+      std::sprintf(times, "\"wall_seconds\": %.6f, \"cpu_seconds\": %.6f",
+                   record.WallTime, record.CPUTime);
+      out << (r ? ",\n" : "\n") << "    {\"site\": " << Quote(record.Site)
+          << ", \"stage\": " << Quote(record.Stage) << ", \"calls\": "
+          << record.Calls << ", " << times << ", \"peak_rss_delta_kb\": "
+          << record.PeakRSSDelta << ", \"voxels\": " << record.Voxels << "}";
+      }
+    out << "\n  ]\n}\n";
+    m_Lock.Unlock();
+    }
+
+  static double GetWallTime()
+    {
+    timeval now;
+    gettimeofday(&now, 0);
+    return now.tv_sec + now.tv_usec * 1e-6;
+    }
+  static double GetCPUTime()
+    {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6
+        + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+    }
+  /** In kilobytes */
+  static long GetPeakRSS()
+    {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+    }
+
+private:
+  Profiler() :
+      m_Enabled(false)
+    {
+    }
+
+  static std::string Quote(std::string const &value)
+    {
+    std::string quoted = "\"";
+    for (size_t i = 0; i < value.size(); i++)
+      {
+      if (value[i] == '"' || value[i] == '\\') quoted += '\\';
+      quoted += value[i];
+      }
+    return quoted + "\"";
+    }
+
+  bool m_Enabled;
+  std::vector< ProfileRecord > m_Records;
+  itk::SimpleFastMutexLock m_Lock;
+};
+
+/*
+ * Measures the scope it lives in, or until Stop, as a sub-stage of a site,
+ * usually the class name of a pipeline e.g.
+ *   ProfileScope profile(this->GetNameOfClass(), "shrink", voxels);
+ */
+class ProfileScope
+{
+public:
+  ProfileScope(std::string const &site, std::string const &stage,
+               itk::SizeValueType voxels = 0) :
+      m_Enabled(Profiler::GetInstance().IsEnabled())
+    {
+    if (!m_Enabled) return;
+    m_Record.Site = site;
+    m_Record.Stage = stage;
+    m_Record.Calls = 1;
+    m_Record.Voxels = voxels;
+    m_Record.PeakRSSDelta = Profiler::GetPeakRSS();
+    m_Record.CPUTime = Profiler::GetCPUTime();
+    m_Record.WallTime = Profiler::GetWallTime();
+    }
+  ~ProfileScope()
+    {
+    this->Stop();
+    }
+
+  /** End the sub-stage before the end of the scope */
+  void Stop()
+    {
+    if (!m_Enabled) return;
+    m_Enabled = false;
+    m_Record.WallTime = Profiler::GetWallTime() - m_Record.WallTime;
+    m_Record.CPUTime = Profiler::GetCPUTime() - m_Record.CPUTime;
+    m_Record.PeakRSSDelta = Profiler::GetPeakRSS() - m_Record.PeakRSSDelta;
+    Profiler::GetInstance().Add(m_Record);
+    }
+
+  /** For sub-stages that only know their size at the end */
+  void SetVoxels(itk::SizeValueType voxels)
+    {
+    m_Record.Voxels = voxels;
+    }
+
+private:
+  ProfileScope(const ProfileScope &); //purposely not implemented
+  void operator=(const ProfileScope &); //purposely not implemented
+
+  bool m_Enabled;
+  ProfileRecord m_Record;
+};
+
+/*
+ * Profiles a whole tool and writes the records when it goes out of scope,
+ * also when the tool fails. An empty filename disables profiling.
+ */
+class ProfileOutput
+{
+public:
+  ProfileOutput(std::string const &filename, std::string const &tool,
+                std::string const &version) :
+      m_Filename(filename), m_Tool(tool.substr(tool.find_last_of('/') + 1)),
+      m_Version(version), m_Scope(0)
+    {
+    if (m_Filename.empty()) return;
+    Profiler::GetInstance().SetEnabled(true);
+    m_Scope = new ProfileScope(m_Tool, "total");
+    }
+  ~ProfileOutput()
+    {
+    if (m_Filename.empty()) return;
+    delete m_Scope;
+    try
+      {
+      Profiler::GetInstance().Write(m_Filename, m_Tool, m_Version);
+      }
+    catch (itk::ExceptionObject & err)
+      {
+      std::cerr << err << std::endl;
+      }
+    }
+
+private:
+  ProfileOutput(const ProfileOutput &); //purposely not implemented
+  void operator=(const ProfileOutput &); //purposely not implemented
+
+  std::string m_Filename;
+  std::string m_Tool;
+  std::string m_Version;
+  ProfileScope* m_Scope;
+};
+
+}  // namespace util
+
+}  // namespace cascade
+
+#endif /* PROFILER_H_ */
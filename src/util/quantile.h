@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef QUANTILE_H_
+#define QUANTILE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * Index of the p quantile (0 <= p <= 1) in n sorted samples, the sample at
+ * floor(p*n) as fslstats -p/-P does.
+ */
+inline std::size_t QuantileIndex(std::size_t n, double p)
+  {
+  const double position = std::floor(p * n);
+  std::size_t index = 0;
+  if (position > 0) index = static_cast< std::size_t >(position);
+  if (index >= n) index = n - 1;
+  return index;
+  }
+
+/*
+ * The p quantile of unsorted samples in linear time. The samples are
+ * reordered. samples should not be empty.
+ */
+template< class TSample >
+TSample SelectQuantile(std::vector< TSample > & samples, double p)
+  {
+  typename std::vector< TSample >::iterator nth = samples.begin()
+      + QuantileIndex(samples.size(), p);
+  std::nth_element(samples.begin(), nth, samples.end());
+  return *nth;
+  }
+
+} // namespace util
+
+} // namespace cascade
+
+#endif /* QUANTILE_H_ */
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+
+#ifndef REPORTWRITER_H_
+#define REPORTWRITER_H_
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+#include "itkByteSwapper.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * Writes a table of numbers, one row per object, either as CSV or as a
+ * compact column oriented binary file.
+ *
+ * CSV is written through an internal buffer and is only flushed when the
+ * buffer is full or the writer is closed. Values are printed with enough
+ * digits to be read back without loss.
+ *
+ * The binary layout (little endian on every host) is:
+ *   char[8]    magic "CSCRPT1\0"
+ *   uint32     number of columns
+ *   uint32     reserved (0)
+ *   uint64     number of rows
+ *   per column: uint32 name length followed by the name (not terminated)
+ *   padding up to a multiple of 8 bytes
+ *   per column: number of rows float64 values
+ * so every column can be mapped directly as a double array.
+ *
+ * A filename of "-" writes to the standard output.
+ */
+class ReportWriter
+{
+public:
+  typedef enum
+    {
+    CSV,
+    BINARY
+    } FormatType;
+
+  ReportWriter(const std::string & filename, const FormatType format,
+               const std::vector< std::string > & columns) :
+      m_Format(format), m_Columns(columns), m_NumberOfRows(0), m_File(0),
+      m_OwnFile(false)
+    {
+    if (m_Columns.empty())
+      {
+      itkGenericExceptionMacro("Report should have at least one column.");
+      }
+    if (filename == "-")
+      {
+      m_File = stdout;
+      }
+    else
+      {
+      m_File = std::fopen(filename.c_str(), "wb");
+      m_OwnFile = true;
+      }
+    if (!m_File)
+      {
+      itkGenericExceptionMacro("Can not open report file: " << filename);
+      }
+
+    if (m_Format == CSV)
+      {
+      m_Buffer.reserve(BufferSize);
+      for (size_t c = 0; c < m_Columns.size(); c++)
+        {
+        if (c) m_Buffer.push_back(',');
+        m_Buffer.append(m_Columns[c]);
+        }
+      m_Buffer.push_back('\n');
+      }
+    else
+      {
+      m_Values.resize(m_Columns.size());
+      }
+    }
+
+  ~ReportWriter()
+    {
+    /** Errors can not be reported from a destructor, call Close() instead */
+    try
+      {
+      this->Close();
+      }
+    catch (...)
+      {
+      }
+    }
+
+  /** Parse "csv" or "binary" */
+  static bool ParseFormat(const std::string & name, FormatType & format)
+    {
+    if (name == "csv")
+      {
+      format = CSV;
+      return true;
+      }
+    if (name == "binary")
+      {
+      format = BINARY;
+      return true;
+      }
+    return false;
+    }
+
+  size_t GetNumberOfColumns() const
+    {
+    return m_Columns.size();
+    }
+
+  /** Append a row, values should have one entry per column */
+  void AddRow(const std::vector< double > & values)
+    {
+    if (values.size() != m_Columns.size())
+      {
+      itkGenericExceptionMacro(
+          "Expected " << m_Columns.size() << " values but got " << values.size());
+      }
+    ++m_NumberOfRows;
+    if (m_Format == BINARY)
+      {
+      for (size_t c = 0; c < values.size(); c++)
+        m_Values[c].push_back(values[c]);
+      return;
+      }
+
+    char number[32];
+    for (size_t c = 0; c < values.size(); c++)
+      {
+      const int length = std::snprintf(number, sizeof(number), "%.17g",
+                                       values[c]);
+      if (c) m_Buffer.push_back(',');
+      m_Buffer.append(number, length);
+      }
+    m_Buffer.push_back('\n');
+    if (m_Buffer.size() >= BufferSize)
+      {
+      this->Flush();
+      }
+    }
+
+  /** Write whatever is pending and release the file */
+  void Close()
+    {
+    if (!m_File) return;
+    if (m_Format == BINARY)
+      {
+      this->WriteBinary();
+      }
+    this->Flush();
+    const bool failed = std::fflush(m_File) != 0;
+    if (m_OwnFile)
+      {
+      std::fclose(m_File);
+      }
+    m_File = 0;
+    if (failed)
+      {
+      itkGenericExceptionMacro("Failed writing the report.");
+      }
+    }
+
+private:
+  ReportWriter(const ReportWriter &); //purposely not implemented
+  void operator=(const ReportWriter &); //purposely not implemented
+
+  static const size_t BufferSize = 1 << 20;
+
+  void Flush()
+    {
+    if (m_Buffer.empty()) return;
+    if (std::fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File)
+        != m_Buffer.size())
+      {
+      itkGenericExceptionMacro("Failed writing the report.");
+      }
+    m_Buffer.clear();
+    }
+
+  template< class T >
+  void Append(T value)
+    {
+    itk::ByteSwapper< T >::SwapFromSystemToLittleEndian(&value);
+    m_Buffer.append(reinterpret_cast< const char* >(&value), sizeof(T));
+    }
+
+  void WriteBinary()
+    {
+    m_Buffer.append("CSCRPT1", 8);
+    this->Append(static_cast< itk::uint32_t >(m_Columns.size()));
+    this->Append(static_cast< itk::uint32_t >(0));
+    this->Append(static_cast< itk::uint64_t >(m_NumberOfRows));
+    for (size_t c = 0; c < m_Columns.size(); c++)
+      {
+      this->Append(static_cast< itk::uint32_t >(m_Columns[c].size()));
+      m_Buffer.append(m_Columns[c]);
+      }
+    m_Buffer.append((8 - m_Buffer.size() % 8) % 8, '\0');
+    this->Flush();
+
+    for (size_t c = 0; c < m_Values.size(); c++)
+      {
+      const size_t n = m_Values[c].size();
+      if (n)
+        {
+        itk::ByteSwapper< double >::SwapRangeFromSystemToLittleEndian(
+            &m_Values[c][0], n);
+        }
+      if (n && std::fwrite(&m_Values[c][0], sizeof(double), n, m_File) != n)
+        {
+        itkGenericExceptionMacro("Failed writing the report.");
+        }
+      std::vector< double >().swap(m_Values[c]);
+      }
+    }
+
+  FormatType m_Format;
+  std::vector< std::string > m_Columns;
+  size_t m_NumberOfRows;
+  std::FILE* m_File;
+  bool m_OwnFile;
+  std::string m_Buffer;
+  std::vector< std::vector< double > > m_Values;
+};
+
+}  // namespace util
+
+}  // namespace cascade
+
+#endif /* REPORTWRITER_H_ */
@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef STATEMODEL_H_
+#define STATEMODEL_H_
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <typeinfo>
+#include <cstdio>
+#include "itkVectorImage.h"
+#include "itkMemoryMappedImageContainer.h"
+#include "helpers.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * Packed state model (.cms).
+ *
+ * All states of a model in a single uncompressed file: a text header padded
+ * with zeros to StateModelHeaderLength bytes followed by the float32 voxels
+ * of a VectorImage, components of a pixel next to each other. The header
+ * lists the grid, the measurement dimension D, the sequences and the
+ * classes. Every class has one state group of 1 + D + D(D+1)/2 components
+ * for each D consecutive sequences, classes in the order of the header:
+ *
+ *   CASCADE_STATE_MODEL 1
+ *   byteorder little
+ *   size 91 109 91
+ *   spacing 2 2 2
+ *   origin 90 -126 -72
+ *   direction -1 0 0 0 1 0 0 0 1
+ *   measurement 1
+ *   sequences flair t1 t2
+ *   classes 2 3
+ *
+ * The data starts at a page boundary so the file can be memory mapped.
+ */
+static const unsigned int StateModelHeaderLength = 4096;
+static const char* const StateModelMagic = "CASCADE_STATE_MODEL";
+
+struct StateModelInfo
+  {
+  unsigned int MeasurementDimension;
+  std::vector< std::string > Sequences;
+  std::vector< int > Classes;
+
+  StateModelInfo() :
+      MeasurementDimension(1)
+    {
+    }
+
+  unsigned int GetGroupLength() const
+    {
+    return 1 + MeasurementDimension
+        + MeasurementDimension * (MeasurementDimension + 1) / 2;
+    }
+  unsigned int GetGroupsPerClass() const
+    {
+    return Sequences.size() / MeasurementDimension;
+    }
+  unsigned int GetNumberOfComponents() const
+    {
+    return Classes.size() * GetGroupsPerClass() * GetGroupLength();
+    }
+  /*
+   * Group of a class whose first sequence is the given one, -1 if the model
+   * has no such group.
+   */
+  int GetGroupIndex(int label, std::string const &sequence) const
+    {
+    const std::vector< int >::const_iterator c = std::find(Classes.begin(),
+                                                           Classes.end(),
+                                                           label);
+    const std::vector< std::string >::const_iterator s = std::find(
+        Sequences.begin(), Sequences.end(), sequence);
+    if (c == Classes.end() || s == Sequences.end()) return -1;
+    const unsigned int sequenceIndex = s - Sequences.begin();
+    if (sequenceIndex % MeasurementDimension != 0) return -1;
+    return (c - Classes.begin()) * GetGroupsPerClass()
+        + sequenceIndex / MeasurementDimension;
+    }
+  };
+
+inline bool IsLittleEndian()
+  {
+  const unsigned int one = 1;
+  return *reinterpret_cast< const unsigned char* >(&one) == 1;
+  }
+
+template< class StateImageT >
+void WriteStateModel(std::string filename, StateModelInfo const &info,
+                     const StateImageT* state)
+  {
+  typedef typename StateImageT::InternalPixelType ValueType;
+  const unsigned int D = StateImageT::ImageDimension;
+
+  if (info.Sequences.empty() || info.Classes.empty()
+      || info.Sequences.size() % info.MeasurementDimension != 0
+      || state->GetNumberOfComponentsPerPixel()
+          != info.GetNumberOfComponents())
+    {
+    itkGenericExceptionMacro(<< "State image with "
+                             << state->GetNumberOfComponentsPerPixel()
+                             << " components does not match the model of "
+                             << filename);
+    }
+
+  std::ostringstream header;
+  header << StateModelMagic << " 1\n";
+  header << "byteorder " << (IsLittleEndian() ? "little" : "big") << "\n";
+  header << "size";
+  for (unsigned int i = 0; i < D; i++)
+    header << " " << state->GetLargestPossibleRegion().GetSize(i);
+  header << "\nspacing";
+  header.precision(17);
+  for (unsigned int i = 0; i < D; i++)
+    header << " " << state->GetSpacing()[i];
+  header << "\norigin";
+  for (unsigned int i = 0; i < D; i++)
+    header << " " << state->GetOrigin()[i];
+  header << "\ndirection";
+  for (unsigned int i = 0; i < D; i++)
+    for (unsigned int j = 0; j < D; j++)
+      header << " " << state->GetDirection()(i, j);
+  header << "\nmeasurement " << info.MeasurementDimension;
+  header << "\nsequences";
+  for (unsigned int i = 0; i < info.Sequences.size(); i++)
+    header << " " << info.Sequences[i];
+  header << "\nclasses";
+  for (unsigned int i = 0; i < info.Classes.size(); i++)
+    header << " " << info.Classes[i];
+  header << "\n";
+
+  std::string text = header.str();
+  if (text.size() >= StateModelHeaderLength)
+    {
+    itkGenericExceptionMacro(<< "State model header is too long.");
+    }
+  text.resize(StateModelHeaderLength, '\0');
+
+  /** Written aside and renamed, the old model may still be mapped */
+  const std::string temporary = CreateTemporaryFile(DirectoryName(filename),
+                                                    ".cms");
+  std::ofstream file(temporary.c_str(), std::ios::binary);
+  file.write(text.data(), text.size());
+
+  /** The buffer is written in chunks converted to float */
+  const ValueType* buffer = state->GetBufferPointer();
+  const itk::SizeValueType length =
+      state->GetLargestPossibleRegion().GetNumberOfPixels()
+          * state->GetNumberOfComponentsPerPixel();
+  std::vector< float > chunk(1 << 16);
+  for (itk::SizeValueType offset = 0; offset < length; offset += chunk.size())
+    {
+    const itk::SizeValueType n = std::min< itk::SizeValueType >(chunk.size(),
+                                                                length - offset);
+    for (itk::SizeValueType i = 0; i < n; i++)
+      chunk[i] = static_cast< float >(buffer[offset + i]);
+    file.write(reinterpret_cast< const char* >(&chunk[0]), n * sizeof(float));
+    }
+  file.close();
+  if (!file || !SetDefaultFileMode(temporary)
+      || std::rename(temporary.c_str(), filename.c_str()) != 0)
+    {
+    std::remove(temporary.c_str());
+    itkGenericExceptionMacro(<< "Can not write state model " << filename);
+    }
+  }
+
+/*
+ * Read a packed state model. The voxels are memory mapped when the file
+ * matches the pixel type and byte order, otherwise they are read.
+ */
+template< class StateImageT >
+typename StateImageT::Pointer ReadStateModel(std::string filename,
+                                             StateModelInfo &info)
+  {
+  typedef typename StateImageT::InternalPixelType ValueType;
+  typedef typename StateImageT::PixelContainer PixelContainerType;
+  typedef itk::MemoryMappedImageContainer<
+      typename PixelContainerType::ElementIdentifier, ValueType > MappedContainerType;
+  const unsigned int D = StateImageT::ImageDimension;
+
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  std::vector< char > text(StateModelHeaderLength + 1, '\0');
+  file.read(&text[0], StateModelHeaderLength);
+  if (!file)
+    {
+    itkGenericExceptionMacro(<< "Can not read state model " << filename);
+    }
+
+  std::istringstream header(std::string(&text[0]));
+  std::string magic, key, byteOrder;
+  int version = 0;
+  header >> magic >> version;
+  if (magic != StateModelMagic || version != 1)
+    {
+    itkGenericExceptionMacro(<< filename << " is not a state model.");
+    }
+
+  typename StateImageT::RegionType region;
+  typename StateImageT::SpacingType spacing;
+  typename StateImageT::PointType origin;
+  typename StateImageT::DirectionType direction;
+  info = StateModelInfo();
+  std::string line;
+  while (std::getline(header, line))
+    {
+    std::istringstream fields(line);
+    if (!(fields >> key)) continue;
+    if (key == "byteorder") fields >> byteOrder;
+    else if (key == "size")
+      {
+      for (unsigned int i = 0; i < D; i++)
+        {
+        itk::SizeValueType size = 0;
+        fields >> size;
+        region.SetIndex(i, 0);
+        region.SetSize(i, size);
+        }
+      }
+    else if (key == "spacing")
+      for (unsigned int i = 0; i < D; i++)
+        fields >> spacing[i];
+    else if (key == "origin")
+      for (unsigned int i = 0; i < D; i++)
+        fields >> origin[i];
+    else if (key == "direction")
+      for (unsigned int i = 0; i < D; i++)
+        for (unsigned int j = 0; j < D; j++)
+          fields >> direction(i, j);
+    else if (key == "measurement") fields >> info.MeasurementDimension;
+    else if (key == "sequences")
+      {
+      std::string sequence;
+      while (fields >> sequence)
+        info.Sequences.push_back(sequence);
+      }
+    else if (key == "classes")
+      {
+      int label;
+      while (fields >> label)
+        info.Classes.push_back(label);
+      }
+    if (fields.fail() && !fields.eof())
+      {
+      itkGenericExceptionMacro(<< "Malformed " << key << " in " << filename);
+      }
+    }
+  if (info.MeasurementDimension == 0 || info.Sequences.empty()
+      || info.Classes.empty()
+      || info.Sequences.size() % info.MeasurementDimension != 0
+      || region.GetNumberOfPixels() == 0)
+    {
+    itkGenericExceptionMacro(<< "Incomplete state model header in " << filename);
+    }
+
+  const unsigned int components = info.GetNumberOfComponents();
+  const itk::SizeValueType length = region.GetNumberOfPixels() * components;
+  const bool swapped = byteOrder != (IsLittleEndian() ? "little" : "big");
+
+  typename StateImageT::Pointer state = StateImageT::New();
+  state->SetRegions(region);
+  state->SetSpacing(spacing);
+  state->SetOrigin(origin);
+  state->SetDirection(direction);
+  state->SetNumberOfComponentsPerPixel(components);
+
+  typename MappedContainerType::Pointer container = MappedContainerType::New();
+  if (!swapped && typeid(ValueType) == typeid(float)
+      && container->MapFile(filename, StateModelHeaderLength, length))
+    {
+    state->SetPixelContainer(container);
+    return state;
+    }
+
+  state->Allocate();
+  ValueType* buffer = state->GetBufferPointer();
+  std::vector< float > chunk(1 << 16);
+  for (itk::SizeValueType offset = 0; offset < length; offset += chunk.size())
+    {
+    const itk::SizeValueType n = std::min< itk::SizeValueType >(chunk.size(),
+                                                                length - offset);
+    file.read(reinterpret_cast< char* >(&chunk[0]), n * sizeof(float));
+    if (!file)
+      {
+      itkGenericExceptionMacro(<< "State model " << filename << " is too short.");
+      }
+    for (itk::SizeValueType i = 0; i < n; i++)
+      {
+      if (swapped)
+        {
+        char* bytes = reinterpret_cast< char* >(&chunk[i]);
+        std::swap(bytes[0], bytes[3]);
+        std::swap(bytes[1], bytes[2]);
+        }
+      buffer[offset + i] = static_cast< ValueType >(chunk[i]);
+      }
+    }
+  return state;
+  }
+
+/*
+ * A state image holding the given groups of a packed state model, in the
+ * given order.
+ */
+template< class StateImageT >
+typename StateImageT::Pointer ExtractStateGroups(
+    const StateImageT* state, std::vector< unsigned int > const &groups,
+    unsigned int groupLength)
+  {
+  typedef typename StateImageT::RegionType RegionType;
+  const RegionType region = state->GetLargestPossibleRegion();
+
+  typename StateImageT::Pointer output = StateImageT::New();
+  output->CopyInformation(state);
+  output->SetRegions(region);
+  output->SetNumberOfComponentsPerPixel(groups.size() * groupLength);
+  output->Allocate();
+
+  const unsigned int inputLength = state->GetNumberOfComponentsPerPixel();
+  for (unsigned int g = 0; g < groups.size(); g++)
+    {
+    if ((groups[g] + 1) * groupLength > inputLength)
+      {
+      itkGenericExceptionMacro(<< "No state group " << groups[g]);
+      }
+    }
+  const unsigned int outputLength = output->GetNumberOfComponentsPerPixel();
+  const typename StateImageT::InternalPixelType* in = state->GetBufferPointer();
+  typename StateImageT::InternalPixelType* out = output->GetBufferPointer();
+  const itk::SizeValueType numberOfPixels = region.GetNumberOfPixels();
+  for (itk::SizeValueType p = 0; p < numberOfPixels; p++)
+    {
+    for (unsigned int g = 0; g < groups.size(); g++)
+      std::copy(in + p * inputLength + groups[g] * groupLength,
+                in + p * inputLength + (groups[g] + 1) * groupLength,
+                out + p * outputLength + g * groupLength);
+    }
+  return output;
+  }
+
+} // namespace util
+
+} // namespace cascade
+
+#endif /* STATEMODEL_H_ */
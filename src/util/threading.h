@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef THREADING_H_
+#define THREADING_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "itkIntTypes.h"
+#include "itkMultiThreader.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/** Smallest number of voxels worth a thread of its own */
+const itk::SizeValueType MinimumVoxelsPerThread = 64 * 1024;
+
+/*
+ * Set the number of threads of the ITK filters created afterwards. Zero
+ * means $CASCADE_NUM_THREADS, or the ITK default when it is not set i.e.
+ * $ITK_GLOBAL_DEFAULT_NUMBER_OF_THREADS or all cores. Returns the number of
+ * threads in use.
+ */
+inline itk::ThreadIdType SetNumberOfThreads(unsigned int threads)
+  {
+  const char* environment = std::getenv("CASCADE_NUM_THREADS");
+  const int requested = environment ? std::atoi(environment) : 0;
+  if (threads == 0 && requested > 0) threads = requested;
+  if (threads != 0)
+    itk::MultiThreader::SetGlobalDefaultNumberOfThreads(threads);
+  return itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  }
+
+/*
+ * Threads worth starting for a filter over the given number of voxels, at
+ * most maximumThreads or the ITK default when zero. ITK starts all its
+ * threads even when the region splits into fewer pieces, so filters on
+ * small images e.g. a single slice are given fewer.
+ */
+inline itk::ThreadIdType ThreadsForVoxels(itk::SizeValueType voxels,
+                                          itk::ThreadIdType maximumThreads = 0)
+  {
+  if (maximumThreads == 0)
+    maximumThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  const itk::SizeValueType useful = voxels / MinimumVoxelsPerThread;
+  return static_cast< itk::ThreadIdType >(std::max< itk::SizeValueType >(
+      std::min< itk::SizeValueType >(useful, maximumThreads), 1));
+  }
+
+/** CPUs of a list such as "0-3,8-11" as in /sys/devices/system/node */
+inline std::vector< int > ParseCPUList(const std::string & list)
+  {
+  std::vector< int > cpus;
+  std::istringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ','))
+    {
+    const std::string::size_type dash = range.find('-');
+    const int first = std::atoi(range.substr(0, dash).c_str());
+    const int last = dash == std::string::npos ? first :
+                         std::atoi(range.substr(dash + 1).c_str());
+    for (int cpu = first; cpu <= last; cpu++)
+      cpus.push_back(cpu);
+    }
+  return cpus;
+  }
+
+/** CPUs of every NUMA node, empty when the topology is not known */
+inline std::vector< std::vector< int > > NumaNodes()
+  {
+  std::vector< std::vector< int > > nodes;
+  while (true)
+    {
+    std::ostringstream filename;
+    filename << "/sys/devices/system/node/node" << nodes.size() << "/cpulist";
+    std::ifstream file(filename.str().c_str());
+    std::string list;
+    if (!std::getline(file, list)) break;
+    nodes.push_back(ParseCPUList(list));
+    }
+  return nodes;
+  }
+
+/** Whether $CASCADE_PIN_NUMA asks for the workers to be pinned */
+inline bool IsNumaPinningEnabled()
+  {
+  const char* environment = std::getenv("CASCADE_PIN_NUMA");
+  return environment && *environment && std::string(environment) != "0";
+  }
+
+/*
+ * Pin the calling thread to the CPUs of a NUMA node, node modulo the number
+ * of nodes. The threads it starts afterwards, e.g. the ITK threads of the
+ * filters it runs, inherit the CPUs and so allocate and touch the memory of
+ * the same node. Returns false when there is nothing to pin to.
+ */
+inline bool PinToNumaNode(size_t node)
+  {
+#ifdef __linux__
+  const std::vector< std::vector< int > > nodes = NumaNodes();
+  if (nodes.size() < 2) return false;
+
+  const std::vector< int > & cpus = nodes[node % nodes.size()];
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t c = 0; c < cpus.size(); c++)
+    if (cpus[c] >= 0 && cpus[c] < CPU_SETSIZE) CPU_SET(cpus[c], &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  (void) node;
+  return false;
+#endif
+  }
+
+}  // namespace util
+
+}  // namespace cascade
+
+#endif /* THREADING_H_ */
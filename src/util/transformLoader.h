@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#ifndef TRANSFORMLOADER_H_
+#define TRANSFORMLOADER_H_
+
+#include <string>
+#include "itkTransform.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkTransformFileReader.h"
+#include "itkTransformFactoryBase.h"
+#include "helpers.h"
+#include "fslTransform.h"
+
+namespace cascade
+{
+
+namespace util
+{
+
+/*
+ * Load a transform from reference to moving physical points, the direction
+ * used for resampling moving onto the reference grid:
+ *   .mat          FSL flirt matrix from moving to reference
+ *   .nii/.nii.gz  FSL warp field on the reference grid into moving
+ *   otherwise     ITK transform file (.tfm, .txt, .h5)
+ */
+template< class ReferenceImageT, class MovingImageT >
+typename itk::Transform< double, ReferenceImageT::ImageDimension,
+    ReferenceImageT::ImageDimension >::Pointer LoadTransform(
+    std::string filename, const ReferenceImageT* reference,
+    const MovingImageT* moving, bool relativeWarp = true)
+  {
+  const unsigned int D = ReferenceImageT::ImageDimension;
+  typedef itk::Transform< double, ReferenceImageT::ImageDimension,
+      ReferenceImageT::ImageDimension > TransformType;
+  typedef itk::DisplacementFieldTransform< double,
+      ReferenceImageT::ImageDimension > FieldTransformType;
+  typedef typename FieldTransformType::DisplacementFieldType FieldType;
+
+  if (endsWith(filename, ".mat"))
+    {
+    return ReadFSLMatrix(filename, reference, moving).GetPointer();
+    }
+  if (endsWith(filename, ".nii") || endsWith(filename, ".nii.gz"))
+    {
+    typename FieldTransformType::Pointer transform = FieldTransformType::New();
+    transform->SetDisplacementField(
+        ReadFSLWarpField< FieldType >(filename, moving, relativeWarp));
+    return transform.GetPointer();
+    }
+
+  itk::TransformFactoryBase::RegisterDefaultTransforms();
+  itk::TransformFileReader::Pointer reader = itk::TransformFileReader::New();
+  reader->SetFileName(filename);
+  reader->Update();
+  if (reader->GetTransformList()->empty())
+    {
+    itkGenericExceptionMacro(<< "No transform in " << filename);
+    }
+  TransformType* transform = dynamic_cast< TransformType* >(
+      reader->GetTransformList()->front().GetPointer());
+  if (!transform)
+    {
+    itkGenericExceptionMacro(<< filename << " is not a " << D
+                             << "D double precision transform.");
+    }
+  return transform;
+  }
+
+} // namespace util
+
+} // namespace cascade
+
+#endif /* TRANSFORMLOADER_H_ */
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2013 Soheil Damangir - All Rights Reserved
+ * You may use and distribute, but not modify this code under the terms of the
+ * Creative Commons Attribution-NonCommercial-NoDerivs 3.0 Unported License
+ * under the following conditions:
+ *
+ * Attribution — You must attribute the work in the manner specified by the
+ * author or licensor (but not in any way that suggests that they endorse you
+ * or your use of the work).
+ * Noncommercial — You may not use this work for commercial purposes.
+ * No Derivative Works — You may not alter, transform, or build upon this
+ * work
+ *
+ * To view a copy of the license, visit
+ * http://creativecommons.org/licenses/by-nc-nd/3.0/
+ */
+#include "buildinfo.h"
+/*
+ * CPP Headers
+ */
+#include <string>
+#include <vector>
+/*
+ * General ITK
+ */
+#include "itkImage.h"
+#include "itkVectorImage.h"
+#include "itkVector.h"
+/*
+ * ITK Filters
+ */
+#include "itkComposeImageFilter.h"
+#include "itkVectorIndexSelectionCastImageFilter.h"
+/*
+ * Others
+ */
+#include "util/itkStateResampleImageFilter.h"
+#include "util/transformLoader.h"
+#include "util/stateModel.h"
+#include "util/helpers.h"
+#include "util/profiler.h"
+#include "util/threading.h"
+#include "3rdparty/tclap/CmdLine.h"
+
+/*
+ * Pixel types
+ */
+typedef float PixelType;
+/*
+ * Image types
+ */
+typedef itk::Image< PixelType, DIM > ImageType;
+typedef itk::VectorImage< PixelType, DIM > StateImageType;
+
+typedef itk::ComposeImageFilter< ImageType, StateImageType > ComposeFilterType;
+typedef itk::VectorIndexSelectionCastImageFilter< StateImageType, ImageType > SelectFilterType;
+typedef itk::StateResampleImageFilter< StateImageType > ResampleFilterType;
+
+/** Scalar state files of a sequence and class, in state order */
+static const char* const StateSuffixes[] = { "number", "mean", "stddev" };
+static const unsigned int StateLength = 3;
+
+std::string StateFileName(const std::string & prefix,
+                          const std::string & sequence, int label,
+                          const char* suffix)
+  {
+  std::ostringstream filename;
+  filename << prefix << "_" << sequence << "_" << label << "_" << suffix
+           << ".nii.gz";
+  return filename.str();
+  }
+
+int main(int argc, char *argv[])
+  {
+  TCLAP::CmdLine cmd(
+      "Cascade(v" CASCADE_VERSION ") - Segmentation of White Matter Lesion. State warping " BUILDINFO,
+      ' ', CASCADE_VERSION);
+
+  TCLAP::ValueArg< std::string > outPrefix(
+      "o", "out", "Prefix of the warped state files", true, "", "string", cmd);
+
+  TCLAP::SwitchArg absoluteSwitch("a", "absolute",
+                                  "FSL warp field uses absolute convention",
+                                  cmd, false);
+  TCLAP::ValueArg< std::string > transformFile(
+      "t", "transform",
+      "Transform from state to reference: FSL matrix (.mat), FSL warp field (.nii.gz, convertwarp --relout) or ITK transform file",
+      true, "", "string", cmd);
+  TCLAP::ValueArg< std::string > space(
+      "", "space",
+      "Image the state side of an FSL transform refers to, the state grid by default",
+      false, "", "string", cmd);
+  TCLAP::ValueArg< std::string > referenceImage(
+      "r", "reference", "Image defining the output grid", true, "", "string",
+      cmd);
+
+  TCLAP::MultiArg< int > classes("c", "class", "Class label (2 and 3)", false,
+                                 "Integer", cmd);
+  TCLAP::MultiArg< std::string > sequences("q", "sequence",
+                                           "Sequence name e.g. flair", true,
+                                           "string", cmd);
+  TCLAP::ValueArg< std::string > statePrefix(
+      "s", "state",
+      "Packed model (.cms) or state prefix, <prefix>_<sequence>_<class>_{number,mean,stddev}.nii.gz",
+      true, "", "string", cmd);
+
+  TCLAP::ValueArg< unsigned int > threads(
+      "", "threads",
+      "Number of threads, $CASCADE_NUM_THREADS or all cores by default",
+      false, 0, "Integer", cmd);
+
+  TCLAP::ValueArg< std::string > profile(
+      "", "profile",
+      "Write the time and memory used by each step to a JSON file", false, "",
+      "string", cmd);
+
+  /*
+   * Parse the argv array.
+   */
+  try
+    {
+    cmd.parse(argc, argv);
+    }
+  catch (TCLAP::ArgException &e)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "error: " << e.error() << " for arg " << e.argId()
+                 << std::endl;
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  cascade::util::ProfileOutput profileOutput(profile.getValue(), argv[0],
+                                             CASCADE_VERSION);
+  cascade::util::SetNumberOfThreads(threads.getValue());
+
+  /*
+   * Argument and setting up the pipeline
+   */
+  try
+    {
+    std::vector< int > labels = classes.getValue();
+    if (labels.empty())
+      {
+      labels.push_back(2);
+      labels.push_back(3);
+      }
+
+    /** All states of all sequences and classes in one vector image */
+    const bool isModel = cascade::util::endsWith(statePrefix.getValue(),
+                                                 ".cms");
+    cascade::util::StateModelInfo info;
+    StateImageType::Pointer model;
+    if (isModel)
+      {
+      model = cascade::util::ReadStateModel< StateImageType >(
+          statePrefix.getValue(), info);
+      if (info.MeasurementDimension != 1)
+        {
+        itkGenericExceptionMacro(<< statePrefix.getValue()
+                                 << " is not a model of single sequence states.");
+        }
+      }
+    ComposeFilterType::Pointer composeFilter = ComposeFilterType::New();
+    std::vector< unsigned int > groups;
+    std::vector< std::string > outputs;
+    for (unsigned int s = 0; s < sequences.getValue().size(); s++)
+      {
+      for (unsigned int c = 0; c < labels.size(); c++)
+        {
+        const std::string sequence = sequences.getValue()[s];
+        if (isModel)
+          {
+          const int group = info.GetGroupIndex(labels[c], sequence);
+          if (group < 0)
+            {
+            itkGenericExceptionMacro(<< "No state of " << sequence << " class "
+                                     << labels[c] << " in "
+                                     << statePrefix.getValue());
+            }
+          groups.push_back(group);
+          }
+        for (unsigned int k = 0; k < StateLength; k++)
+          {
+          if (!isModel)
+            {
+            composeFilter->SetInput(
+                outputs.size(),
+                cascade::util::LoadImage< ImageType >(
+                    StateFileName(statePrefix.getValue(), sequence, labels[c],
+                                  StateSuffixes[k])));
+            }
+          outputs.push_back(
+              StateFileName(outPrefix.getValue(), sequence, labels[c],
+                            StateSuffixes[k]));
+          }
+        }
+      }
+    StateImageType::Pointer state;
+    if (isModel)
+      {
+      state = cascade::util::ExtractStateGroups(model.GetPointer(), groups,
+                                                StateLength);
+      }
+    else
+      {
+      composeFilter->Update();
+      state = composeFilter->GetOutput();
+      }
+
+    ImageType::Pointer reference = cascade::util::LoadImage< ImageType >(
+        referenceImage.getValue());
+
+    /** FSL transforms refer to the image they were estimated with */
+    ImageType::Pointer spaceImage;
+    const itk::ImageBase< DIM >* stateSpace = state.GetPointer();
+    if (space.isSet())
+      {
+      spaceImage = cascade::util::LoadImage< ImageType >(space.getValue());
+      stateSpace = spaceImage.GetPointer();
+      }
+
+    ResampleFilterType::Pointer resampleFilter = ResampleFilterType::New();
+    resampleFilter->SetInput(state);
+    resampleFilter->SetReferenceImage(reference);
+    resampleFilter->SetTransform(
+        cascade::util::LoadTransform(transformFile.getValue(),
+                                     reference.GetPointer(), stateSpace,
+                                     !absoluteSwitch.getValue()));
+    resampleFilter->SetStateGroupSize(StateLength);
+    resampleFilter->Update();
+
+    for (unsigned int i = 0; i < outputs.size(); i++)
+      {
+      SelectFilterType::Pointer selectFilter = SelectFilterType::New();
+      selectFilter->SetInput(resampleFilter->GetOutput());
+      selectFilter->SetIndex(i);
+      selectFilter->Update();
+      cascade::util::WriteImage(outputs[i], selectFilter->GetOutput());
+      }
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::ostringstream errorMessage;
+    errorMessage << "Exception caught!\n" << err << "\n";
+    itk::OutputWindowDisplayErrorText(errorMessage.str().c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+  }